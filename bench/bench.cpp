@@ -0,0 +1,366 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "../main/logging.h"
+#include "../main/meta.h"
+using namespace progressia::main::logging;
+
+namespace progressia::bench {
+
+std::atomic<uint64_t> sink = 0; // NOLINT
+
+/*
+ * Options
+ */
+
+Options::Options(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strncmp(arg, "--", 2) != 0) {
+            warn() << "Ignoring argument \"" << arg << "\"";
+            continue;
+        }
+
+        arg += 2;
+        const char *separator = strchr(arg, '=');
+        if (separator == nullptr) {
+            values[arg] = "";
+        } else {
+            values[std::string(arg, separator)] = separator + 1;
+        }
+    }
+}
+
+bool Options::has(const std::string &key) const {
+    return values.count(key) != 0;
+}
+
+std::string Options::getString(const std::string &key,
+                               const std::string &defaultValue) const {
+    auto it = values.find(key);
+    return it == values.end() ? defaultValue : it->second;
+}
+
+uint64_t Options::getUint(const std::string &key,
+                          uint64_t defaultValue) const {
+    auto it = values.find(key);
+    if (it == values.end()) {
+        return defaultValue;
+    }
+
+    char *end = nullptr;
+    uint64_t result = std::strtoull(it->second.c_str(), &end, 10);
+    if (it->second.empty() || *end != '\0') {
+        fatal() << "Option --" << key
+                << " expects a non-negative integer, got \"" << it->second
+                << "\"";
+        // REPORT_ERROR
+        exit(1);
+    }
+
+    return result;
+}
+
+/*
+ * Stopwatch
+ */
+
+Stopwatch::Stopwatch() : start(std::chrono::steady_clock::now()) {}
+
+void Stopwatch::restart() { start = std::chrono::steady_clock::now(); }
+
+double Stopwatch::elapsed() const {
+    return std::chrono::duration<double, std::micro>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+/*
+ * Harness
+ */
+
+namespace {
+
+double percentile(const std::vector<double> &sorted, double fraction) {
+    auto index = static_cast<std::size_t>(
+        std::ceil(fraction * static_cast<double>(sorted.size())));
+    return sorted[std::clamp<std::size_t>(index, 1, sorted.size()) - 1];
+}
+
+void writeJsonString(std::ostream &out, const std::string &str) {
+    out << '"';
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) >= ' ') {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+} // namespace
+
+void Harness::setParameter(const std::string &key, const std::string &value) {
+    parameters.emplace_back(key, value);
+}
+
+void Harness::setParameter(const std::string &key, uint64_t value) {
+    setParameter(key, std::to_string(value));
+}
+
+void Harness::addSample(const std::string &seriesName, double microseconds) {
+    auto it = series.find(seriesName);
+    if (it == series.end()) {
+        seriesOrder.push_back(seriesName);
+        it = series.emplace(seriesName, std::vector<double>()).first;
+    }
+
+    it->second.push_back(microseconds);
+}
+
+void Harness::setMetric(const std::string &name, double value,
+                        const std::string &unit) {
+    metrics.push_back({name, value, unit});
+}
+
+std::vector<Harness::Result> Harness::getResults() const {
+    constexpr double P50 = 0.50;
+    constexpr double P95 = 0.95;
+
+    std::vector<Result> results;
+    results.reserve(seriesOrder.size());
+
+    for (const auto &name : seriesOrder) {
+        std::vector<double> sorted = series.at(name);
+        std::sort(sorted.begin(), sorted.end());
+
+        double total = 0;
+        for (double sample : sorted) {
+            total += sample;
+        }
+
+        results.push_back({name, sorted.size(), total,
+                           total / static_cast<double>(sorted.size()),
+                           sorted.front(), percentile(sorted, P50),
+                           percentile(sorted, P95), sorted.back()});
+    }
+
+    return results;
+}
+
+double Harness::getMedian(const std::string &seriesName) const {
+    constexpr double P50 = 0.50;
+
+    auto it = series.find(seriesName);
+    if (it == series.end() || it->second.empty()) {
+        return 0;
+    }
+
+    std::vector<double> sorted = it->second;
+    std::sort(sorted.begin(), sorted.end());
+    return percentile(sorted, P50);
+}
+
+void Harness::writeJson(std::ostream &out) const {
+    using namespace progressia::main::meta;
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\n  \"version\": ";
+    writeJsonString(out, VERSION);
+    out << ",\n  \"build\": ";
+    writeJsonString(out, BUILD_ID);
+    out << ",\n  \"unit\": \"us\",\n  \"parameters\": {";
+
+    for (std::size_t i = 0; i < parameters.size(); i++) {
+        out << (i == 0 ? "\n    " : ",\n    ");
+        writeJsonString(out, parameters[i].first);
+        out << ": ";
+        writeJsonString(out, parameters[i].second);
+    }
+
+    out << "\n  },\n  \"results\": [";
+
+    auto results = getResults();
+    for (std::size_t i = 0; i < results.size(); i++) {
+        const auto &r = results[i];
+        out << (i == 0 ? "\n    " : ",\n    ") << "{\"name\": ";
+        writeJsonString(out, r.name);
+        out << ", \"samples\": " << r.samples << ", \"total\": " << r.total
+            << ", \"mean\": " << r.mean << ", \"min\": " << r.min
+            << ", \"median\": " << r.median << ", \"p95\": " << r.p95
+            << ", \"max\": " << r.max << "}";
+    }
+
+    out << "\n  ],\n  \"metrics\": [";
+
+    for (std::size_t i = 0; i < metrics.size(); i++) {
+        const auto &m = metrics[i];
+        out << (i == 0 ? "\n    " : ",\n    ") << "{\"name\": ";
+        writeJsonString(out, m.name);
+        out << ", \"value\": " << m.value << ", \"unit\": ";
+        writeJsonString(out, m.unit);
+        out << "}";
+    }
+
+    out << "\n  ]\n}\n";
+}
+
+void Harness::writeCsv(std::ostream &out) const {
+    out << std::fixed << std::setprecision(3);
+    out << "name,samples,total_us,mean_us,min_us,median_us,p95_us,max_us\n";
+
+    for (const auto &r : getResults()) {
+        out << r.name << ',' << r.samples << ',' << r.total << ',' << r.mean
+            << ',' << r.min << ',' << r.median << ',' << r.p95 << ',' << r.max
+            << '\n';
+    }
+
+    if (!metrics.empty()) {
+        out << "\nname,value,unit\n";
+        for (const auto &m : metrics) {
+            out << m.name << ',' << m.value << ',' << m.unit << '\n';
+        }
+    }
+}
+
+void Harness::logSummary() const {
+    auto m = info("Benchmark results (mean / median / p95, us):");
+    for (const auto &r : getResults()) {
+        m << "\n\t" << r.name << ": " << r.mean << " / " << r.median << " / "
+          << r.p95 << " (" << r.samples << " samples)";
+    }
+
+    for (const auto &metric : metrics) {
+        m << "\n\t" << metric.name << ": " << metric.value << " "
+          << metric.unit;
+    }
+}
+
+/*
+ * Runner
+ */
+
+namespace {
+
+void printUsage(const char *me, const std::vector<Suite> &suites,
+                const char *resultsName) {
+    std::cout << "Usage: " << me << " [--suites=NAME[,NAME...]] [OPTIONS...]\n"
+              << "Runs deterministic benchmarks and writes results as JSON "
+                 "or CSV.\n\n"
+              << "  --suites=LIST  comma-separated suites to run, default is "
+                 "all\n"
+              << "  --format=FMT   json (default) or csv\n"
+              << "  --out=PATH     output file, default is run/bench/"
+              << resultsName << ".<format>\n\n";
+
+    for (const auto &suite : suites) {
+        std::cout << suite.usage << "\n";
+    }
+
+    std::cout << "Available suites:";
+    for (const auto &suite : suites) {
+        std::cout << " " << suite.name;
+    }
+    std::cout << std::endl;
+}
+
+bool isSelected(const std::string &list, const char *name) {
+    if (list.empty()) {
+        return true;
+    }
+
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (item == name) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+} // namespace
+
+int runSuites(int argc, char *argv[], const std::vector<Suite> &suites,
+              const char *resultsName) {
+    Options options(argc, argv);
+
+    if (options.has("help")) {
+        printUsage(argv[0], suites, resultsName);
+        return 0;
+    }
+
+    auto format = options.getString("format", "json");
+    if (format != "json" && format != "csv") {
+        std::cerr << "Unknown format \"" << format << "\"; expected json or csv"
+                  << std::endl;
+        return 1;
+    }
+
+    auto selection = options.getString("suites", "");
+    auto outPath = options.getString(
+        "out", std::string("run/bench/") + resultsName + "." + format);
+
+    info() << "Starting " << main::meta::NAME << " benchmarks "
+           << main::meta::VERSION << "+" << main::meta::BUILD_ID;
+
+    Harness harness;
+    harness.setParameter("suites", selection.empty() ? "all" : selection);
+
+    bool anySelected = false;
+    for (const auto &suite : suites) {
+        if (!isSelected(selection, suite.name)) {
+            continue;
+        }
+
+        anySelected = true;
+        info() << "Running suite " << suite.name;
+        suite.run(harness, options);
+    }
+
+    if (!anySelected) {
+        std::cerr << "No suites selected; see --help" << std::endl;
+        return 1;
+    }
+
+    harness.logSummary();
+
+    auto parent = std::filesystem::path(outPath).parent_path();
+    if (!parent.empty()) {
+        std::error_code errorCode;
+        std::filesystem::create_directories(parent, errorCode);
+        if (errorCode) {
+            error() << "Could not create directory " << parent.string()
+                    << ": " << errorCode.message();
+            return 1;
+        }
+    }
+
+    std::ofstream out(outPath);
+    if (format == "json") {
+        harness.writeJson(out);
+    } else {
+        harness.writeCsv(out);
+    }
+
+    if (!out) {
+        error() << "Could not write results to " << outPath;
+        return 1;
+    }
+
+    info() << "Results written to " << outPath;
+    return 0;
+}
+
+} // namespace progressia::bench
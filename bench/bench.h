@@ -0,0 +1,206 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../main/util.h"
+
+namespace progressia::bench {
+
+/*
+ * Command line options of the form --key=value.
+ */
+class Options {
+  private:
+    std::map<std::string, std::string> values;
+
+  public:
+    Options(int argc, char *argv[]);
+
+    bool has(const std::string &key) const;
+    std::string getString(const std::string &key,
+                          const std::string &defaultValue) const;
+    uint64_t getUint(const std::string &key, uint64_t defaultValue) const;
+};
+
+/*
+ * Measures wall-clock time since construction or last restart().
+ */
+class Stopwatch {
+  private:
+    std::chrono::steady_clock::time_point start;
+
+  public:
+    Stopwatch();
+
+    void restart();
+
+    /*
+     * Returns elapsed time in microseconds.
+     */
+    double elapsed() const;
+};
+
+/*
+ * Collects timing samples grouped into named series and reports statistics
+ * in machine-readable form.
+ */
+class Harness : private progressia::main::NonCopyable {
+  public:
+    /*
+     * Statistics of a series, in microseconds.
+     */
+    struct Result {
+        std::string name;
+        std::size_t samples;
+        double total;
+        double mean;
+        double min;
+        double median;
+        double p95;
+        double max;
+    };
+
+  private:
+    std::vector<std::pair<std::string, std::string>> parameters;
+
+    struct Metric {
+        std::string name;
+        double value;
+        std::string unit;
+    };
+    std::vector<Metric> metrics;
+
+    // Series are reported in order of first appearance
+    std::vector<std::string> seriesOrder;
+    std::unordered_map<std::string, std::vector<double>> series;
+
+  public:
+    Harness() = default;
+
+    /*
+     * Records a parameter of the run so that results can be compared only
+     * with runs that used identical parameters.
+     */
+    void setParameter(const std::string &key, const std::string &value);
+    void setParameter(const std::string &key, uint64_t value);
+
+    void addSample(const std::string &seriesName, double microseconds);
+
+    /*
+     * Records a single measured value that is not a duration, such as memory
+     * usage.
+     */
+    void setMetric(const std::string &name, double value,
+                   const std::string &unit);
+
+    /*
+     * Runs f once and records its duration.
+     */
+    template <typename F> void time(const std::string &seriesName, F &&f) {
+        Stopwatch stopwatch;
+        f();
+        addSample(seriesName, stopwatch.elapsed());
+    }
+
+    std::vector<Result> getResults() const;
+
+    /*
+     * Returns the median of a series in microseconds, or 0 if it has no
+     * samples.
+     */
+    double getMedian(const std::string &seriesName) const;
+
+    void writeJson(std::ostream &) const;
+    void writeCsv(std::ostream &) const;
+    void logSummary() const;
+};
+
+/*
+ * Keeps results alive so that the compiler does not remove measured loops.
+ */
+extern std::atomic<uint64_t> sink; // NOLINT
+
+/*
+ * A group of benchmarks that can be selected by name.
+ */
+struct Suite {
+    const char *name;
+    void (*run)(Harness &, const Options &);
+
+    // Help for the options of the suite, one or more lines
+    const char *usage;
+};
+
+/*
+ * Runs the suites selected on the command line and writes their results to
+ * run/bench/<resultsName>.<format> unless another path is given. Returns
+ * the exit code of the program.
+ */
+int runSuites(int argc, char *argv[], const std::vector<Suite> &,
+              const char *resultsName);
+
+/*
+ * Renders synthetic scenes through GraphicsInterface in headless mode.
+ * Built only into progressia_graphics_bench.
+ */
+void runGraphicsBench(Harness &, const Options &);
+
+/*
+ * Measures Chunk memory usage and block access throughput.
+ */
+void runChunkBench(Harness &, const Options &);
+
+/*
+ * Compares size and speed of chunk codecs on generated terrain.
+ */
+void runCodecBench(Harness &, const Options &);
+
+/*
+ * Measures JobSystem scheduling overhead per job and scaling of CPU-bound
+ * jobs with the number of workers.
+ */
+void runJobsBench(Harness &, const Options &);
+
+/*
+ * Measures ChunkIO save and load throughput with each available IoBackend.
+ */
+void runIoBench(Harness &, const Options &);
+
+/*
+ * Measures LightEngine propagation over generated terrain and the cost of
+ * single block changes.
+ */
+void runLightBench(Harness &, const Options &);
+
+/*
+ * Compares naive and greedy ChunkMesher throughput and output size on
+ * typical and extreme chunks.
+ */
+void runMesherBench(Harness &, const Options &);
+
+/*
+ * Measures OccupancyIndex ray casts over generated terrain against a
+ * block-by-block DDA, on one and several threads, and the cost of updates.
+ */
+void runRaycastBench(Harness &, const Options &);
+
+/*
+ * Moves a viewer through generated terrain with ChunkManager and reports
+ * the time to load and mesh the surroundings and the memory they take.
+ */
+void runStreamingBench(Harness &, const Options &);
+
+/*
+ * Measures noise kernels with and without SIMD and TerrainGenerator
+ * throughput with each number of workers.
+ */
+void runTerrainBench(Harness &, const Options &);
+
+} // namespace progressia::bench
@@ -0,0 +1,128 @@
+#include "bench.h"
+
+#include <array>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../main/world/chunk.h"
+
+namespace progressia::bench {
+
+namespace {
+
+using progressia::main::BlockId;
+using progressia::main::Chunk;
+
+Chunk makeRandomChunk(std::size_t distinct, std::mt19937 &random) {
+    Chunk chunk;
+    for (std::size_t i = 0; i < Chunk::VOLUME; i++) {
+        chunk.set(i, static_cast<BlockId>(random() % distinct));
+    }
+    chunk.compact();
+    return chunk;
+}
+
+// Stone below, dirt and grass in a thin layer, air above
+Chunk makeTerrainChunk() {
+    constexpr BlockId STONE = 1;
+    constexpr BlockId DIRT = 2;
+    constexpr BlockId GRASS = 3;
+    constexpr int SURFACE = 9;
+
+    Chunk chunk;
+    chunk.fill(0, 0, 0, Chunk::SIZE, Chunk::SIZE, SURFACE - 3, STONE);
+    chunk.fill(0, 0, SURFACE - 3, Chunk::SIZE, Chunk::SIZE, SURFACE, DIRT);
+    chunk.fill(0, 0, SURFACE, Chunk::SIZE, Chunk::SIZE, SURFACE + 1, GRASS);
+    return chunk;
+}
+
+} // namespace
+
+void runChunkBench(Harness &harness, const Options &options) {
+    constexpr uint64_t DEFAULT_ITERATIONS = 1000;
+    constexpr uint64_t DEFAULT_SEED = 42;
+    constexpr std::array<std::size_t, 5> PALETTE_SIZES = {1, 2, 16, 256,
+                                                           4096};
+
+    auto iterations = options.getUint("chunk-iterations", DEFAULT_ITERATIONS);
+    auto seed = options.getUint("seed", DEFAULT_SEED);
+
+    harness.setParameter("chunk.size", Chunk::SIZE);
+    harness.setParameter("chunk.iterations", iterations);
+    harness.setParameter("chunk.seed", seed);
+
+    std::mt19937 random(static_cast<uint32_t>(seed));
+
+    std::vector<std::size_t> randomIndices(Chunk::VOLUME);
+    for (auto &index : randomIndices) {
+        index = random() % Chunk::VOLUME;
+    }
+
+    harness.setMetric("chunk.memory.terrain",
+                      static_cast<double>(makeTerrainChunk().getMemoryUsage()),
+                      "bytes");
+
+    // Each sample covers Chunk::VOLUME accesses
+    for (std::size_t distinct : PALETTE_SIZES) {
+        auto suffix = ".p" + std::to_string(distinct);
+        auto chunk = makeRandomChunk(distinct, random);
+
+        harness.setMetric("chunk.memory" + suffix,
+                          static_cast<double>(chunk.getMemoryUsage()),
+                          "bytes");
+        harness.setMetric("chunk.bits" + suffix, chunk.getBitsPerBlock(),
+                          "bits");
+
+        std::vector<BlockId> values(Chunk::VOLUME);
+        for (auto &value : values) {
+            value = static_cast<BlockId>(random() % distinct);
+        }
+
+        for (uint64_t i = 0; i < iterations; i++) {
+            harness.time("chunk.get.sequential" + suffix, [&]() {
+                uint64_t sum = 0;
+                for (std::size_t index = 0; index < Chunk::VOLUME; index++) {
+                    sum += chunk.get(index);
+                }
+                sink += sum;
+            });
+
+            harness.time("chunk.get.random" + suffix, [&]() {
+                uint64_t sum = 0;
+                for (std::size_t index : randomIndices) {
+                    sum += chunk.get(index);
+                }
+                sink += sum;
+            });
+
+            harness.time("chunk.forEach" + suffix, [&]() {
+                uint64_t sum = 0;
+                // Mixing in random data keeps the compiler from folding the
+                // single-entry case into a closed form
+                chunk.forEach([&](int x, int y, int z, BlockId block) {
+                    sum += block ^ values[Chunk::getIndex(x, y, z)];
+                });
+                sink += sum;
+            });
+
+            harness.time("chunk.set.random" + suffix, [&]() {
+                for (std::size_t j = 0; j < Chunk::VOLUME; j++) {
+                    chunk.set(randomIndices[j], values[j]);
+                }
+            });
+        }
+    }
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        auto chunk = makeTerrainChunk();
+        constexpr int BOX_MIN = 4;
+        constexpr int BOX_MAX = 12;
+        harness.time("chunk.fill.box", [&]() {
+            chunk.fill(BOX_MIN, BOX_MIN, BOX_MIN, BOX_MAX, BOX_MAX, BOX_MAX,
+                       static_cast<BlockId>(i % 4));
+        });
+    }
+}
+
+} // namespace progressia::bench
@@ -0,0 +1,133 @@
+#include "bench.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../main/logging.h"
+#include "../main/world/chunk_codec.h"
+#include "terrain.h"
+
+namespace progressia::bench {
+
+namespace {
+
+using progressia::main::Chunk;
+using progressia::main::ChunkCodec;
+using progressia::main::ChunkCompression;
+using progressia::main::ChunkEncoding;
+
+struct Variant {
+    std::string name;
+    ChunkEncoding encoding;
+};
+
+bool isSame(const Chunk &a, const Chunk &b) {
+    for (std::size_t i = 0; i < Chunk::VOLUME; i++) {
+        if (a.get(i) != b.get(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+void runCodecBench(Harness &harness, const Options &options) {
+    constexpr uint64_t DEFAULT_CHUNKS = 1024;
+    constexpr uint64_t DEFAULT_ITERATIONS = 5;
+    constexpr uint64_t DEFAULT_SEED = 42;
+
+    auto chunkCount = options.getUint("codec-chunks", DEFAULT_CHUNKS);
+    auto iterations = options.getUint("codec-iterations", DEFAULT_ITERATIONS);
+    auto seed = options.getUint("seed", DEFAULT_SEED);
+
+    harness.setParameter("codec.chunks", chunkCount);
+    harness.setParameter("codec.iterations", iterations);
+    harness.setParameter("codec.seed", seed);
+
+    auto chunks = generateTerrainChunks(chunkCount, seed);
+
+    // Sizes and speeds are relative to Chunk::serialize() output
+    std::size_t rawBytes = 0;
+    {
+        std::vector<uint8_t> buffer;
+        for (const auto &entry : chunks) {
+            buffer.clear();
+            entry.second.serialize(buffer);
+            rawBytes += buffer.size();
+        }
+    }
+
+    const std::vector<Variant> variants = {
+        {"none", {ChunkCompression::NONE, 0}},
+        {"rle", {ChunkCompression::RLE, 0}},
+        {"lz1", {ChunkCompression::LZ, 1}},
+        {"lz9", {ChunkCompression::LZ, 9}},
+        {"rle_lz1", {ChunkCompression::RLE_LZ, 1}},
+        {"rle_lz5", {ChunkCompression::RLE_LZ, 5}},
+        {"rle_lz9", {ChunkCompression::RLE_LZ, 9}},
+    };
+
+    std::vector<uint8_t> encoded;
+    std::vector<std::size_t> ends(chunks.size());
+    Chunk decoded;
+
+    for (const auto &variant : variants) {
+        const ChunkCodec &codec =
+            *progressia::main::getChunkCodec(variant.encoding.compression);
+        std::string suffix = "." + variant.name;
+        bool correct = true;
+
+        for (uint64_t i = 0; i < iterations; i++) {
+            harness.time("codec.encode" + suffix, [&]() {
+                encoded.clear();
+                for (std::size_t j = 0; j < chunks.size(); j++) {
+                    codec.encode(chunks[j].second, variant.encoding.level,
+                                 encoded);
+                    ends[j] = encoded.size();
+                }
+            });
+
+            harness.time("codec.decode" + suffix, [&]() {
+                std::size_t begin = 0;
+                for (std::size_t j = 0; j < chunks.size(); j++) {
+                    correct = codec.decode(encoded.data() + begin,
+                                           ends[j] - begin, decoded) &&
+                              correct;
+                    begin = ends[j];
+                }
+            });
+        }
+
+        // Checked outside of measurements
+        std::size_t begin = 0;
+        for (std::size_t j = 0; j < chunks.size(); j++) {
+            correct = codec.decode(encoded.data() + begin, ends[j] - begin,
+                                   decoded) &&
+                      isSame(decoded, chunks[j].second) && correct;
+            begin = ends[j];
+        }
+        if (!correct) {
+            main::logging::error() << "Codec " << variant.name
+                                   << " did not reproduce the chunks";
+        }
+
+        // Bytes per microsecond are megabytes per second
+        auto raw = static_cast<double>(rawBytes);
+        harness.setMetric("codec.ratio" + suffix,
+                          raw / static_cast<double>(encoded.size()), "x");
+        harness.setMetric("codec.size" + suffix,
+                          static_cast<double>(encoded.size()) /
+                              static_cast<double>(chunks.size()),
+                          "B/chunk");
+        harness.setMetric("codec.encode.speed" + suffix,
+                          raw / harness.getMedian("codec.encode" + suffix),
+                          "MB/s");
+        harness.setMetric("codec.decode.speed" + suffix,
+                          raw / harness.getMedian("codec.decode" + suffix),
+                          "MB/s");
+    }
+}
+
+} // namespace progressia::bench
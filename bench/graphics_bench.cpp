@@ -0,0 +1,318 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <random>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/mat4x4.hpp>
+
+#include "../desktop/graphics/vulkan_common.h"
+#include "../desktop/graphics/vulkan_frame_capture.h"
+#include "../desktop/graphics/vulkan_mgmt.h"
+#include "../main/logging.h"
+#include "../main/rendering.h"
+#include "../main/rendering/image.h"
+using namespace progressia::main::logging;
+
+namespace progressia::bench {
+
+namespace {
+
+using progressia::main::Image;
+using progressia::main::Vertex;
+
+/*
+ * Generates reproducible values on all platforms. Standard distributions
+ * are implementation-defined, so they are not used.
+ */
+class Random {
+  private:
+    std::mt19937 engine;
+
+  public:
+    explicit Random(uint32_t seed) : engine(seed) {}
+
+    float next(float min, float max) {
+        return min + (max - min) * static_cast<float>(engine()) /
+                         static_cast<float>(std::mt19937::max());
+    }
+};
+
+Image makeTexture(std::size_t index) {
+    constexpr std::size_t SIZE = 64;
+    constexpr std::size_t CELL = 8;
+    constexpr std::size_t CHANNELS = 4;
+    constexpr Image::Byte FULL = 0xFF;
+    constexpr unsigned MULTIPLIER = 37;
+
+    Image image{SIZE, SIZE, std::vector<Image::Byte>(SIZE * SIZE * CHANNELS)};
+
+    auto shade = static_cast<Image::Byte>(index * MULTIPLIER);
+    for (std::size_t y = 0; y < SIZE; y++) {
+        for (std::size_t x = 0; x < SIZE; x++) {
+            bool dark = ((x / CELL) + (y / CELL)) % 2 == 0;
+            auto *pixel = &image.data[(y * SIZE + x) * CHANNELS];
+            pixel[0] = dark ? shade : FULL - shade;
+            pixel[1] = dark ? FULL - shade : shade;
+            pixel[2] = static_cast<Image::Byte>(x * y);
+            pixel[3] = FULL;
+        }
+    }
+
+    return image;
+}
+
+void addRect(glm::vec3 origin, glm::vec3 width, glm::vec3 height,
+             glm::vec4 color, std::vector<Vertex> &vertices,
+             std::vector<Vertex::Index> &indices) {
+
+    glm::vec3 normal = glm::normalize(glm::cross(width, height));
+    auto offset = static_cast<Vertex::Index>(vertices.size());
+
+    vertices.push_back({origin, color, normal, {0, 0}});
+    vertices.push_back({origin + width, color, normal, {0, 1}});
+    vertices.push_back({origin + width + height, color, normal, {1, 1}});
+    vertices.push_back({origin + height, color, normal, {1, 0}});
+
+    for (Vertex::Index i : {0, 1, 2, 0, 2, 3}) {
+        indices.push_back(offset + i);
+    }
+}
+
+void addBox(glm::vec3 origin, glm::vec3 size, glm::vec4 color,
+            std::vector<Vertex> &vertices,
+            std::vector<Vertex::Index> &indices) {
+    glm::vec3 x(size.x, 0, 0);
+    glm::vec3 y(0, size.y, 0);
+    glm::vec3 z(0, 0, size.z);
+
+    addRect(origin, y, x, color, vertices, indices);
+    addRect(origin, x, z, color, vertices, indices);
+    addRect(origin, z, y, color, vertices, indices);
+    addRect(origin + y, z, x, color, vertices, indices);
+    addRect(origin + x, y, z, color, vertices, indices);
+    addRect(origin + z, x, y, color, vertices, indices);
+}
+
+} // namespace
+
+void runGraphicsBench(Harness &harness, const Options &options) {
+    constexpr uint64_t DEFAULT_PRIMITIVES = 2000;
+    constexpr uint64_t DEFAULT_TEXTURES = 16;
+    constexpr uint64_t DEFAULT_VIEWS = 2;
+    constexpr uint64_t DEFAULT_FRAMES = 300;
+    constexpr uint64_t DEFAULT_WARMUP = 10;
+    constexpr uint64_t DEFAULT_SIZE = 512;
+    constexpr uint64_t DEFAULT_SEED = 42;
+
+    auto primitiveCount = options.getUint("primitives", DEFAULT_PRIMITIVES);
+    auto textureCount =
+        std::max<uint64_t>(1, options.getUint("textures", DEFAULT_TEXTURES));
+    auto viewCount =
+        std::max<uint64_t>(1, options.getUint("views", DEFAULT_VIEWS));
+    auto frames = options.getUint("frames", DEFAULT_FRAMES);
+    auto warmup = options.getUint("warmup", DEFAULT_WARMUP);
+    auto size = options.getUint("size", DEFAULT_SIZE);
+    auto seed = options.getUint("seed", DEFAULT_SEED);
+    auto culling = options.getUint("culling", 1) != 0;
+    auto gpuCulling = options.getUint("gpu-culling", 0) != 0;
+
+    // Golden image for checking that optimizations do not change output
+    std::optional<uint64_t> captureFrame;
+    if (options.has("capture")) {
+        captureFrame = options.getUint("capture", 0);
+    }
+    auto captureOut =
+        options.getString("capture-out", "run/bench/graphics-capture.tga");
+
+    harness.setParameter("graphics.primitives", primitiveCount);
+    harness.setParameter("graphics.textures", textureCount);
+    harness.setParameter("graphics.views", viewCount);
+    harness.setParameter("graphics.frames", frames);
+    harness.setParameter("graphics.warmup", warmup);
+    harness.setParameter("graphics.size", size);
+    harness.setParameter("graphics.seed", seed);
+    harness.setParameter("graphics.culling", culling ? 1 : 0);
+    if (captureFrame) {
+        harness.setParameter("graphics.capture", *captureFrame);
+    }
+
+    desktop::PresentSettings settings;
+    settings.headless = true;
+    settings.headlessExtent = {static_cast<uint32_t>(size),
+                               static_cast<uint32_t>(size)};
+
+    desktop::VulkanManager vulkanManager(settings);
+    auto &gint = vulkanManager.getVulkan()->getGint();
+    gint.setCullingEnabled(culling);
+
+    if (gpuCulling && !gint.isGpuCullingSupported()) {
+        warn() << "GPU culling is not supported, culling on CPU";
+        gpuCulling = false;
+    }
+    gint.setGpuCullingEnabled(gpuCulling);
+    harness.setParameter("graphics.gpuCulling", gpuCulling ? 1 : 0);
+
+    Random random(static_cast<uint32_t>(seed));
+
+    // Resource creation
+
+    std::vector<std::unique_ptr<main::Texture>> textures;
+    for (uint64_t i = 0; i < textureCount; i++) {
+        auto image = makeTexture(i);
+        harness.time("graphics.newTexture", [&]() {
+            textures.push_back(gint.newTexture(image));
+        });
+    }
+
+    constexpr float WORLD_SIZE = 20;
+    std::vector<std::unique_ptr<main::Primitive>> primitives;
+    for (uint64_t i = 0; i < primitiveCount; i++) {
+        std::vector<Vertex> vertices;
+        std::vector<Vertex::Index> indices;
+
+        glm::vec3 origin(random.next(-WORLD_SIZE, WORLD_SIZE),
+                         random.next(-WORLD_SIZE, WORLD_SIZE),
+                         random.next(-WORLD_SIZE, WORLD_SIZE));
+        glm::vec3 boxSize(random.next(0.2F, 2), random.next(0.2F, 2),
+                          random.next(0.2F, 2));
+        glm::vec4 color(random.next(0, 1), random.next(0, 1),
+                        random.next(0, 1), 1);
+        addBox(origin, boxSize, color, vertices, indices);
+
+        auto *texture = &*textures[i % textureCount];
+        harness.time("graphics.newPrimitive", [&]() {
+            primitives.push_back(gint.newPrimitive(vertices, indices, texture));
+        });
+    }
+
+    std::vector<std::unique_ptr<main::View>> views;
+    std::vector<std::unique_ptr<main::Light>> lights;
+    for (uint64_t i = 0; i < viewCount; i++) {
+        views.push_back(gint.newView());
+        lights.push_back(gint.newLight());
+    }
+
+    // Frames
+
+    constexpr float FOV = 70.0F;
+    constexpr float Z_NEAR = 0.1F;
+    constexpr float Z_FAR = 100.0F;
+    constexpr float CAMERA_DISTANCE = 40.0F;
+
+    uint64_t measuredFrames = 0;
+    uint64_t visibleTotal = 0;
+    uint64_t culledTotal = 0;
+
+    for (uint64_t frame = 0; frame < warmup + frames; frame++) {
+        bool measure = frame >= warmup;
+        Stopwatch stopwatch;
+
+        if (!vulkanManager.startRender()) {
+            continue;
+        }
+
+        if (measure) {
+            harness.addSample("graphics.frame.start", stopwatch.elapsed());
+        }
+        stopwatch.restart();
+
+        float time = gint.tmp_getTime();
+        auto extent = gint.getViewport();
+        auto proj = glm::perspective(glm::radians(FOV), extent.x / extent.y,
+                                     Z_NEAR, Z_FAR);
+        proj[1][1] *= -1;
+
+        // Each view draws its share of primitives from its own angle
+        for (uint64_t v = 0; v < viewCount; v++) {
+            float angle = time + static_cast<float>(v);
+            auto eye = glm::vec3(glm::cos(angle), glm::sin(angle), 0.5F) *
+                       CAMERA_DISTANCE;
+            views[v]->configure(
+                proj, glm::lookAt(eye, glm::vec3(0), glm::vec3(0, 0, 1)));
+            views[v]->use();
+
+            lights[v]->configure(glm::vec3(1), glm::vec3(1, -2, 1), 0.2F,
+                                 0.1F);
+            lights[v]->use();
+
+            gint.setModelTransform(glm::mat4(1));
+            for (uint64_t i = v; i < primitiveCount; i += viewCount) {
+                primitives[i]->draw();
+            }
+        }
+
+        double record = stopwatch.elapsed();
+
+        if (frame == captureFrame) {
+            auto path = std::filesystem::path(captureOut);
+            std::error_code errorCode;
+            if (path.has_parent_path()) {
+                std::filesystem::create_directories(path.parent_path(),
+                                                    errorCode);
+            }
+
+            if (errorCode) {
+                error() << "Could not create directory "
+                        << path.parent_path().string() << ": "
+                        << errorCode.message();
+            } else {
+                vulkanManager.getVulkan()->getFrameCapture().request(
+                    [path](main::Image &&image) {
+                        if (!main::saveImageTga(image, path.string())) {
+                            error() << "Could not write capture to "
+                                    << path.string();
+                        }
+                    });
+            }
+        }
+
+        // Flush explicitly so that endRender() only submits
+        stopwatch.restart();
+        gint.flush();
+        double flush = stopwatch.elapsed();
+
+        // All draws of the frame have been flushed
+        auto cullingStats = gint.getCullingStats();
+
+        stopwatch.restart();
+        vulkanManager.endRender();
+        double submit = stopwatch.elapsed();
+
+        if (measure) {
+            harness.addSample("graphics.frame.record", record);
+            harness.addSample("graphics.flush", flush);
+            harness.addSample("graphics.frame.submit", submit);
+            harness.addSample("graphics.frame.cpu", record + flush + submit);
+
+            measuredFrames++;
+            visibleTotal += cullingStats.visible;
+            culledTotal += cullingStats.culled;
+        }
+    }
+
+    if (measuredFrames != 0) {
+        auto frameCount = static_cast<double>(measuredFrames);
+        harness.setMetric("graphics.culling.visible",
+                          static_cast<double>(visibleTotal) / frameCount,
+                          "draws/frame");
+        harness.setMetric("graphics.culling.culled",
+                          static_cast<double>(culledTotal) / frameCount,
+                          "draws/frame");
+    }
+
+    vulkanManager.getVulkan()->getFrameCapture().finish();
+
+    lights.clear();
+    views.clear();
+    primitives.clear();
+    textures.clear();
+}
+
+} // namespace progressia::bench
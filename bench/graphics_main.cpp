@@ -0,0 +1,24 @@
+#include <vector>
+
+#include "../main/profiler.h"
+#include "bench.h"
+
+namespace {
+
+using progressia::bench::Suite;
+
+const std::vector<Suite> SUITES = {
+    {"graphics", progressia::bench::runGraphicsBench,
+     "Graphics suite options (headless rendering):\n"
+     "  --primitives=N --textures=M --views=K --frames=F\n"
+     "  --warmup=W --size=PIXELS --seed=S --culling=0|1\n"
+     "  --gpu-culling=0|1  cull in a compute shader\n"
+     "  --capture=FRAME --capture-out=PATH  write FRAME as TGA\n"},
+};
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    progressia::main::profiler::setThreadName("Main");
+    return progressia::bench::runSuites(argc, argv, SUITES, "graphics");
+}
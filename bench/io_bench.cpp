@@ -0,0 +1,160 @@
+#include "bench.h"
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../main/io/io_backend.h"
+#include "../main/jobs/job_system.h"
+#include "../main/logging.h"
+#include "../main/world/chunk_io.h"
+#include "terrain.h"
+
+namespace progressia::bench {
+
+namespace {
+
+using progressia::main::Chunk;
+using progressia::main::ChunkIO;
+using progressia::main::IoBackend;
+using progressia::main::JobSystem;
+
+struct Backend {
+    std::string name;
+    std::function<std::unique_ptr<IoBackend>()> create;
+};
+
+double toChunksPerSecond(std::size_t chunks, double microseconds) {
+    return static_cast<double>(chunks) * 1e6 / microseconds;
+}
+
+bool removeScratch(const std::filesystem::path &directory) {
+    std::error_code errorCode;
+    std::filesystem::remove_all(directory, errorCode);
+    if (errorCode) {
+        main::logging::error() << "Could not remove " << directory.string()
+                               << ": " << errorCode.message();
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+void runIoBench(Harness &harness, const Options &options) {
+    constexpr uint64_t DEFAULT_CHUNKS = 4096;
+    constexpr uint64_t DEFAULT_ITERATIONS = 3;
+    constexpr uint64_t DEFAULT_THREADS = 4;
+    constexpr uint64_t DEFAULT_SEED = 42;
+    constexpr std::size_t RESAVES = 4;
+
+    auto chunkCount = options.getUint("io-chunks", DEFAULT_CHUNKS);
+    auto iterations = options.getUint("io-iterations", DEFAULT_ITERATIONS);
+    auto threads = options.getUint("io-threads", DEFAULT_THREADS);
+    auto seed = options.getUint("seed", DEFAULT_SEED);
+
+    // Only this subdirectory is ever deleted, so that --io-dir may point
+    // anywhere
+    std::filesystem::path directory =
+        std::filesystem::path(options.getString("io-dir", "run/bench")) /
+        "progressia-io-bench";
+
+    harness.setParameter("io.chunks", chunkCount);
+    harness.setParameter("io.iterations", iterations);
+    harness.setParameter("io.threads", threads);
+    harness.setParameter("io.seed", seed);
+
+    auto chunks = generateTerrainChunks(chunkCount, seed);
+
+    std::vector<Backend> backends = {
+        {"pool", [threads]() { return IoBackend::createThreadPool(threads); }},
+    };
+    if (IoBackend::createIoUring()) {
+        backends.push_back(
+            {"uring", []() { return IoBackend::createIoUring(); }});
+    } else {
+        main::logging::info() << "io_uring is not available, skipping it";
+    }
+
+    JobSystem jobs(1);
+
+    for (const auto &backend : backends) {
+        std::string suffix = "." + backend.name;
+        std::size_t loaded = 0;
+        std::size_t coalesced = 0;
+
+        for (uint64_t i = 0; i < iterations; i++) {
+            if (!removeScratch(directory)) {
+                return;
+            }
+
+            // Each chunk written once, then synced
+            harness.time("io.save" + suffix, [&]() {
+                ChunkIO io(directory, backend.create(), jobs);
+                for (const auto &[position, chunk] : chunks) {
+                    io.save(position, chunk);
+                }
+                io.flush();
+            });
+
+            // Every chunk read back; the page cache is usually warm
+            harness.time("io.load" + suffix, [&]() {
+                ChunkIO io(directory, backend.create(), jobs);
+                for (const auto &entry : chunks) {
+                    io.load(entry.first, [&loaded](Chunk *chunk) {
+                        loaded += chunk != nullptr ? 1 : 0;
+                    });
+                }
+                io.flush();
+                jobs.runMainThreadJobs();
+            });
+
+            // Each chunk saved several times in a row, as dirty chunks are
+            harness.time("io.resave" + suffix, [&]() {
+                ChunkIO io(directory, backend.create(), jobs);
+                for (std::size_t j = 0; j < RESAVES; j++) {
+                    for (const auto &[position, chunk] : chunks) {
+                        io.save(position, chunk);
+                    }
+                }
+                io.flush();
+                coalesced += io.getStats().savesCoalesced;
+            });
+        }
+
+        if (loaded != chunks.size() * iterations) {
+            main::logging::error() << "Only " << loaded << " of "
+                                   << chunks.size() * iterations
+                                   << " chunks were loaded";
+        }
+
+        harness.setMetric(
+            "io.save.throughput" + suffix,
+            toChunksPerSecond(chunks.size(),
+                              harness.getMedian("io.save" + suffix)),
+            "chunks/s");
+        harness.setMetric(
+            "io.load.throughput" + suffix,
+            toChunksPerSecond(chunks.size(),
+                              harness.getMedian("io.load" + suffix)),
+            "chunks/s");
+        harness.setMetric(
+            "io.resave.throughput" + suffix,
+            toChunksPerSecond(chunks.size() * RESAVES,
+                              harness.getMedian("io.resave" + suffix)),
+            "chunks/s");
+        harness.setMetric("io.resave.coalesced" + suffix,
+                          100.0 * static_cast<double>(coalesced) /
+                              static_cast<double>(chunks.size() * RESAVES *
+                                                  iterations),
+                          "%");
+    }
+
+    removeScratch(directory);
+}
+
+} // namespace progressia::bench
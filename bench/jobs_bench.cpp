@@ -0,0 +1,128 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../main/jobs/job_system.h"
+
+namespace progressia::bench {
+
+namespace {
+
+using progressia::main::JobCounter;
+using progressia::main::JobSystem;
+
+// Integer hashing that takes roughly a microsecond per 100 rounds
+uint64_t spin(uint64_t seed, uint64_t rounds) {
+    uint64_t x = seed;
+    for (uint64_t i = 0; i < rounds; i++) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+    }
+    return x;
+}
+
+std::vector<std::size_t> getThreadCounts(std::size_t maximum) {
+    std::vector<std::size_t> result;
+    for (std::size_t count = 1; count < maximum; count *= 2) {
+        result.push_back(count);
+    }
+    result.push_back(maximum);
+    return result;
+}
+
+} // namespace
+
+void runJobsBench(Harness &harness, const Options &options) {
+    constexpr uint64_t DEFAULT_COUNT = 100000;
+    constexpr uint64_t DEFAULT_WORK_COUNT = 2000;
+    constexpr uint64_t DEFAULT_WORK_ROUNDS = 5000;
+    constexpr uint64_t DEFAULT_ITERATIONS = 5;
+
+    auto count = options.getUint("jobs-count", DEFAULT_COUNT);
+    auto workCount = options.getUint("jobs-work-count", DEFAULT_WORK_COUNT);
+    auto workRounds = options.getUint("jobs-work-rounds", DEFAULT_WORK_ROUNDS);
+    auto iterations = options.getUint("jobs-iterations", DEFAULT_ITERATIONS);
+    auto maxThreads = options.getUint(
+        "jobs-max-threads",
+        std::max<uint64_t>(std::thread::hardware_concurrency(), 1));
+
+    harness.setParameter("jobs.count", count);
+    harness.setParameter("jobs.work.count", workCount);
+    harness.setParameter("jobs.work.rounds", workRounds);
+    harness.setParameter("jobs.iterations", iterations);
+    harness.setParameter("jobs.maxThreads", maxThreads);
+
+    double baseline = 0;
+
+    for (std::size_t threads : getThreadCounts(maxThreads)) {
+        JobSystem jobs(threads);
+        auto suffix = ".t" + std::to_string(threads);
+
+        for (uint64_t i = 0; i < iterations; i++) {
+            // Empty jobs submitted from outside the pool
+            harness.time("jobs.external" + suffix, [&]() {
+                JobCounter counter;
+                for (uint64_t j = 0; j < count; j++) {
+                    jobs.submit([]() {}, &counter);
+                }
+                jobs.wait(counter);
+            });
+
+            // Empty jobs submitted by a worker to its own deque and stolen
+            // by the others
+            harness.time("jobs.nested" + suffix, [&]() {
+                JobCounter counter;
+                jobs.submit(
+                    [&]() {
+                        for (uint64_t j = 0; j < count; j++) {
+                            jobs.submit([]() {}, &counter);
+                        }
+                    },
+                    &counter);
+                jobs.wait(counter);
+            });
+
+            // A chain of dependent jobs, each waiting for the previous one
+            harness.time("jobs.chain" + suffix, [&]() {
+                constexpr std::size_t CHAIN_LENGTH = 1000;
+                std::vector<JobCounter> links(CHAIN_LENGTH);
+                jobs.submit([]() {}, &links[0]);
+                for (std::size_t j = 1; j < CHAIN_LENGTH; j++) {
+                    jobs.submitAfter(links[j - 1], []() {}, &links[j]);
+                }
+                jobs.wait(links.back());
+            });
+
+            harness.time("jobs.work" + suffix, [&]() {
+                JobCounter counter;
+                for (uint64_t j = 0; j < workCount; j++) {
+                    jobs.submit(
+                        [j, workRounds]() { sink += spin(j, workRounds); },
+                        &counter);
+                }
+                jobs.wait(counter);
+            });
+        }
+
+        double external = harness.getMedian("jobs.external" + suffix);
+        double nested = harness.getMedian("jobs.nested" + suffix);
+        double work = harness.getMedian("jobs.work" + suffix);
+
+        harness.setMetric("jobs.overhead.external" + suffix,
+                          external * 1000 / static_cast<double>(count),
+                          "ns/job");
+        harness.setMetric("jobs.overhead.nested" + suffix,
+                          nested * 1000 / static_cast<double>(count), "ns/job");
+
+        if (threads == 1) {
+            baseline = work;
+        }
+        harness.setMetric("jobs.speedup" + suffix, baseline / work, "x");
+    }
+}
+
+} // namespace progressia::bench
@@ -0,0 +1,199 @@
+#include "bench.h"
+
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../main/jobs/job_system.h"
+#include "../main/world/block_types.h"
+#include "../main/world/light_engine.h"
+#include "../main/world/terrain_generator.h"
+
+namespace progressia::bench {
+
+namespace {
+
+using progressia::main::BLOCK_AIR;
+using progressia::main::BlockId;
+using progressia::main::BlockTypes;
+using progressia::main::Chunk;
+using progressia::main::ChunkPositionHash;
+using progressia::main::JobSystem;
+using progressia::main::LightEngine;
+using progressia::main::TerrainGenerator;
+using progressia::main::TerrainSettings;
+
+/*
+ * Generated chunks with lookup by block position.
+ */
+class Region {
+  private:
+    std::vector<glm::ivec3> positions;
+    std::vector<Chunk> chunks;
+    std::unordered_map<glm::ivec3, std::size_t, ChunkPositionHash> lookup;
+
+  public:
+    Region(const TerrainGenerator &generator, int radius, int minZ,
+           int maxZ) {
+        for (int z = minZ; z <= maxZ; z++) {
+            for (int y = -radius; y < radius; y++) {
+                for (int x = -radius; x < radius; x++) {
+                    lookup[{x, y, z}] = positions.size();
+                    positions.emplace_back(x, y, z);
+                }
+            }
+        }
+
+        JobSystem jobs;
+        generator.generate(jobs, positions, chunks);
+    }
+
+    const std::vector<glm::ivec3> &getPositions() const { return positions; }
+    const Chunk &getChunk(std::size_t i) const { return chunks[i]; }
+
+    /*
+     * Returns the chunk containing block and the index of block in it, or
+     * nullptr if the chunk is outside the region.
+     */
+    Chunk *find(const glm::ivec3 &block, glm::ivec3 &position,
+                std::size_t &index) {
+        position = {block.x >> Chunk::SIZE_BITS, block.y >> Chunk::SIZE_BITS,
+                    block.z >> Chunk::SIZE_BITS};
+        auto it = lookup.find(position);
+        if (it == lookup.end()) {
+            return nullptr;
+        }
+
+        glm::ivec3 local = block - position * Chunk::SIZE;
+        index = Chunk::getIndex(local.x, local.y, local.z);
+        return &chunks[it->second];
+    }
+};
+
+} // namespace
+
+void runLightBench(Harness &harness, const Options &options) {
+    constexpr uint64_t DEFAULT_RADIUS = 4;
+    constexpr uint64_t DEFAULT_EDITS = 64;
+    constexpr uint64_t DEFAULT_ITERATIONS = 3;
+    constexpr uint64_t DEFAULT_SEED = 42;
+    constexpr uint8_t TORCH_EMISSION = 14;
+
+    // Terrain lies in chunk layers 0 and 1, caves reach below
+    constexpr int MIN_Z = -2;
+    constexpr int MAX_Z = 1;
+
+    auto radius = options.getUint("light-radius", DEFAULT_RADIUS);
+    auto edits = options.getUint("light-edits", DEFAULT_EDITS);
+    auto iterations = options.getUint("light-iterations", DEFAULT_ITERATIONS);
+    auto seed = options.getUint("seed", DEFAULT_SEED);
+
+    harness.setParameter("light.radius", radius);
+    harness.setParameter("light.edits", edits);
+    harness.setParameter("light.iterations", iterations);
+    harness.setParameter("light.seed", seed);
+
+    BlockTypes types;
+    glm::vec4 white(1, 1, 1, 1);
+
+    TerrainSettings terrain;
+    terrain.seed = static_cast<uint32_t>(seed);
+    terrain.stone = types.add({"stone", true, true, 0, white});
+    terrain.dirt = types.add({"dirt", true, true, 1, white});
+    terrain.grass = types.add({"grass", true, true, 2, white});
+    BlockId torch =
+        types.add({"torch", true, false, 3, white, TORCH_EMISSION});
+
+    Region region(TerrainGenerator(terrain), static_cast<int>(radius), MIN_Z,
+                  MAX_Z);
+    const auto &positions = region.getPositions();
+    auto chunkCount = static_cast<double>(positions.size());
+
+    // Whole region from scratch
+    std::unique_ptr<LightEngine> engine;
+    uint64_t initialNodes = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        engine = std::make_unique<LightEngine>(types);
+        harness.time("light.initial", [&]() {
+            for (std::size_t c = 0; c < positions.size(); c++) {
+                engine->addChunk(positions[c], region.getChunk(c));
+            }
+            engine->run();
+        });
+        initialNodes =
+            engine->getStats().additions + engine->getStats().removals;
+    }
+
+    // Medians are in microseconds
+    double initial = harness.getMedian("light.initial");
+    harness.setMetric("light.initial.speed", chunkCount * 1e6 / initial,
+                      "chunks/s");
+    harness.setMetric("light.initial.nodes",
+                      static_cast<double>(initialNodes) / initial, "M/s");
+
+    std::size_t memory = 0;
+    std::size_t uniform = 0;
+    for (const auto &position : positions) {
+        const auto *light = engine->getLight(position);
+        memory += light->getMemoryUsage();
+        uniform += light->isUniform() ? 1 : 0;
+    }
+    harness.setMetric("light.memoryPerChunk",
+                      static_cast<double>(memory) / chunkCount, "B/chunk");
+    harness.setMetric("light.uniform",
+                      static_cast<double>(uniform) * 100 / chunkCount, "%");
+
+    // Single block changes at the surface, each undone right away
+    std::mt19937 random(static_cast<uint32_t>(seed));
+    auto side = static_cast<int>(radius) * Chunk::SIZE;
+    std::uniform_int_distribution<int> coordinate(-side, side - 1);
+
+    auto setBlock = [&](const glm::ivec3 &block, BlockId id) {
+        glm::ivec3 position;
+        std::size_t index = 0;
+        region.find(block, position, index)->set(index, id);
+        engine->blockChanged(position, index);
+    };
+
+    auto getBlock = [&](const glm::ivec3 &block) {
+        glm::ivec3 position;
+        std::size_t index = 0;
+        const Chunk *chunk = region.find(block, position, index);
+        return chunk == nullptr ? BLOCK_AIR : chunk->get(index);
+    };
+
+    auto before = engine->getStats();
+    for (uint64_t i = 0; i < edits; i++) {
+        glm::ivec3 surface(coordinate(random), coordinate(random),
+                           (MAX_Z + 1) * Chunk::SIZE - 2);
+        while (surface.z > MIN_Z * Chunk::SIZE &&
+               getBlock(surface) == BLOCK_AIR) {
+            surface.z--;
+        }
+        glm::ivec3 above = surface + glm::ivec3(0, 0, 1);
+        BlockId ground = getBlock(surface);
+
+        setBlock(above, torch);
+        harness.time("light.torch.place", [&]() { engine->run(); });
+        setBlock(above, BLOCK_AIR);
+        harness.time("light.torch.remove", [&]() { engine->run(); });
+
+        setBlock(surface, BLOCK_AIR);
+        harness.time("light.dig", [&]() { engine->run(); });
+        setBlock(surface, ground);
+        harness.time("light.fill", [&]() { engine->run(); });
+    }
+
+    auto after = engine->getStats();
+    auto changes = static_cast<double>(edits * 4);
+    harness.setMetric(
+        "light.edit.nodes",
+        static_cast<double>(after.additions + after.removals -
+                            before.additions - before.removals) /
+            changes,
+        "nodes/edit");
+}
+
+} // namespace progressia::bench
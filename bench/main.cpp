@@ -0,0 +1,56 @@
+#include <vector>
+
+#include "../main/profiler.h"
+#include "bench.h"
+
+namespace {
+
+using progressia::bench::Suite;
+
+// Suites that need no GPU; the graphics suite is in graphics_main.cpp
+const std::vector<Suite> SUITES = {
+    {"chunk", progressia::bench::runChunkBench,
+     "Chunk suite options:\n"
+     "  --chunk-iterations=N --seed=S\n"},
+    {"codec", progressia::bench::runCodecBench,
+     "Codec suite options:\n"
+     "  --codec-chunks=N --codec-iterations=N --seed=S\n"},
+    {"jobs", progressia::bench::runJobsBench,
+     "Jobs suite options:\n"
+     "  --jobs-count=N --jobs-work-count=N --jobs-work-rounds=N\n"
+     "  --jobs-iterations=N --jobs-max-threads=N\n"},
+    {"io", progressia::bench::runIoBench,
+     "I/O suite options:\n"
+     "  --io-chunks=N --io-iterations=N --io-threads=N --seed=S\n"
+     "  --io-dir=PATH  where to create scratch directory "
+     "progressia-io-bench,\n"
+     "                 default is run/bench\n"},
+    {"light", progressia::bench::runLightBench,
+     "Light suite options:\n"
+     "  --light-radius=CHUNKS --light-edits=N --light-iterations=N\n"
+     "  --seed=S\n"},
+    {"mesher", progressia::bench::runMesherBench,
+     "Mesher suite options:\n"
+     "  --mesher-iterations=N --seed=S\n"},
+    {"raycast", progressia::bench::runRaycastBench,
+     "Raycast suite options:\n"
+     "  --raycast-radius=CHUNKS --raycast-rays=N --raycast-distance=BLOCKS\n"
+     "  --raycast-edits=N --raycast-iterations=N --raycast-max-threads=N\n"
+     "  --seed=S\n"},
+    {"streaming", progressia::bench::runStreamingBench,
+     "Streaming suite options:\n"
+     "  --streaming-radius=CHUNKS --streaming-steps=N --seed=S\n"
+     "  --streaming-budget-mb=N --streaming-lod1=CHUNKS\n"
+     "  --streaming-lod2=CHUNKS --streaming-lod3=CHUNKS\n"},
+    {"terrain", progressia::bench::runTerrainBench,
+     "Terrain suite options:\n"
+     "  --terrain-chunks=N --terrain-samples=N --seed=S\n"
+     "  --terrain-iterations=N --terrain-max-threads=N\n"},
+};
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    progressia::main::profiler::setThreadName("Main");
+    return progressia::bench::runSuites(argc, argv, SUITES, "results");
+}
@@ -0,0 +1,140 @@
+#include "bench.h"
+
+#include <array>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../main/world/block_types.h"
+#include "../main/world/chunk.h"
+#include "../main/world/chunk_mesher.h"
+
+namespace progressia::bench {
+
+namespace {
+
+using progressia::main::BlockId;
+using progressia::main::BlockTypes;
+using progressia::main::Chunk;
+using progressia::main::ChunkMesher;
+using progressia::main::ChunkNeighbours;
+using progressia::main::MAX_LOD_LEVEL;
+using progressia::main::MeshingMode;
+
+struct Scene {
+    std::string name;
+    Chunk chunk;
+    ChunkNeighbours neighbours;
+};
+
+} // namespace
+
+void runMesherBench(Harness &harness, const Options &options) {
+    constexpr uint64_t DEFAULT_ITERATIONS = 200;
+    constexpr uint64_t DEFAULT_SEED = 42;
+    constexpr int SURFACE = 9;
+
+    auto iterations = options.getUint("mesher-iterations", DEFAULT_ITERATIONS);
+    auto seed = options.getUint("seed", DEFAULT_SEED);
+
+    harness.setParameter("mesher.iterations", iterations);
+    harness.setParameter("mesher.seed", seed);
+
+    BlockTypes types;
+    glm::vec4 white(1, 1, 1, 1);
+    BlockId stone = types.add({"stone", true, true, 0, white});
+    BlockId dirt = types.add({"dirt", true, true, 1, white});
+    BlockId glass = types.add({"glass", true, false, 2, white});
+
+    std::mt19937 random(static_cast<uint32_t>(seed));
+
+    Chunk solid(stone);
+
+    // Neighbours point into scenes, which must not reallocate
+    constexpr std::size_t SCENE_COUNT = 3;
+    std::vector<Scene> scenes;
+    scenes.reserve(SCENE_COUNT);
+
+    // Flat ground surrounded by identical chunks
+    Scene &terrain = scenes.emplace_back();
+    terrain.name = "terrain";
+    terrain.chunk.fill(0, 0, 0, Chunk::SIZE, Chunk::SIZE, SURFACE, stone);
+    terrain.chunk.fill(0, 0, SURFACE, Chunk::SIZE, Chunk::SIZE, SURFACE + 1,
+                       dirt);
+    terrain.neighbours.fill(&terrain.chunk);
+
+    // Worst case for culling: about half of the faces are exposed
+    Scene &noise = scenes.emplace_back();
+    noise.name = "random";
+    for (std::size_t i = 0; i < Chunk::VOLUME; i++) {
+        BlockId block = progressia::main::BLOCK_AIR;
+        switch (random() % 4) {
+        case 0:
+            block = stone;
+            break;
+        case 1:
+            block = glass;
+            break;
+        default:
+            break;
+        }
+        noise.chunk.set(i, block);
+    }
+    noise.neighbours.fill(nullptr);
+
+    // Best case: every face is hidden
+    Scene &buried = scenes.emplace_back();
+    buried.name = "buried";
+    buried.chunk.fill(stone);
+    buried.neighbours.fill(&solid);
+
+    constexpr std::array<std::pair<MeshingMode, const char *>, 2> MODES = {{
+        {MeshingMode::NAIVE, "naive"},
+        {MeshingMode::GREEDY, "greedy"},
+    }};
+
+    ChunkMesher mesher(types);
+
+    auto measure = [&](const std::string &suffix, const auto &build) {
+        Stopwatch total;
+        for (uint64_t i = 0; i < iterations; i++) {
+            harness.time("mesher.build" + suffix, build);
+        }
+
+        double seconds = total.elapsed() / 1e6;
+        harness.setMetric("mesher.throughput" + suffix,
+                          static_cast<double>(iterations) / seconds,
+                          "chunks/s");
+
+        std::size_t vertices = 0;
+        for (std::size_t i = 0; i < mesher.getLayerCount(); i++) {
+            vertices += mesher.getLayer(i).vertices.size();
+        }
+        harness.setMetric("mesher.quads" + suffix,
+                          static_cast<double>(mesher.getQuadCount()),
+                          "quads");
+        harness.setMetric("mesher.vertices" + suffix,
+                          static_cast<double>(vertices), "vertices");
+    };
+
+    for (const auto &[mode, modeName] : MODES) {
+        for (const auto &scene : scenes) {
+            measure(std::string(".") + modeName + "." + scene.name, [&]() {
+                mesher.build(scene.chunk, scene.neighbours, {0, 0, 0}, mode);
+            });
+        }
+    }
+
+    // Neighbours of the scenes stand in for chunks at the same level
+    for (unsigned level = 1; level <= MAX_LOD_LEVEL; level++) {
+        for (const auto &scene : scenes) {
+            measure(".lod" + std::to_string(level) + "." + scene.name, [&]() {
+                mesher.buildLod(scene.chunk, scene.neighbours, {0, 0, 0},
+                                level);
+            });
+        }
+    }
+}
+
+} // namespace progressia::bench
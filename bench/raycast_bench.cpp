@@ -0,0 +1,289 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/geometric.hpp>
+
+#include "../main/jobs/job_system.h"
+#include "../main/world/block_types.h"
+#include "../main/world/occupancy_index.h"
+#include "../main/world/terrain_generator.h"
+
+namespace progressia::bench {
+
+namespace {
+
+using progressia::main::BlockTypes;
+using progressia::main::Chunk;
+using progressia::main::JobSystem;
+using progressia::main::JobCounter;
+using progressia::main::OccupancyIndex;
+using progressia::main::TerrainGenerator;
+using progressia::main::TerrainSettings;
+
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction;
+};
+
+/*
+ * Traces ray one block at a time, for comparison with
+ * OccupancyIndex::raycast().
+ */
+bool raycastNaive(const OccupancyIndex &index, const Ray &ray,
+                  float maxDistance, OccupancyIndex::RayHit &hit) {
+    glm::vec3 step = ray.direction / glm::length(ray.direction);
+    glm::ivec3 block(glm::floor(ray.origin));
+    glm::ivec3 normal(0, 0, 0);
+
+    glm::ivec3 sign;
+    glm::vec3 next;
+    glm::vec3 delta;
+    for (int axis = 0; axis < 3; axis++) {
+        sign[axis] = step[axis] > 0 ? 1 : -1;
+        delta[axis] = step[axis] == 0 ? INFINITY : 1 / std::abs(step[axis]);
+        float side = static_cast<float>(block[axis] + (sign[axis] > 0));
+        next[axis] = step[axis] == 0
+                         ? INFINITY
+                         : (side - ray.origin[axis]) / step[axis];
+    }
+
+    float distance = 0;
+    while (distance <= maxDistance) {
+        if (index.isOccupied(block)) {
+            hit = {block, normal, distance};
+            return true;
+        }
+
+        int axis = 0;
+        if (next[1] < next[axis]) {
+            axis = 1;
+        }
+        if (next[2] < next[axis]) {
+            axis = 2;
+        }
+
+        distance = next[axis];
+        next[axis] += delta[axis];
+        block[axis] += sign[axis];
+        normal = glm::ivec3(0, 0, 0);
+        normal[axis] = -sign[axis];
+    }
+
+    return false;
+}
+
+std::vector<std::size_t> getThreadCounts(std::size_t maximum) {
+    std::vector<std::size_t> result;
+    for (std::size_t count = 1; count < maximum; count *= 2) {
+        result.push_back(count);
+    }
+    result.push_back(maximum);
+    return result;
+}
+
+} // namespace
+
+void runRaycastBench(Harness &harness, const Options &options) {
+    constexpr uint64_t DEFAULT_RADIUS = 6;
+    constexpr uint64_t DEFAULT_RAYS = 1 << 16;
+    constexpr uint64_t DEFAULT_DISTANCE = 64;
+    constexpr uint64_t DEFAULT_EDITS = 4096;
+    constexpr uint64_t DEFAULT_ITERATIONS = 5;
+    constexpr uint64_t DEFAULT_SEED = 42;
+    constexpr std::size_t RAYS_PER_JOB = 1024;
+
+    // Terrain lies in chunk layers 0 and 1, caves reach below
+    constexpr int MIN_Z = -2;
+    constexpr int MAX_Z = 1;
+
+    auto radius = options.getUint("raycast-radius", DEFAULT_RADIUS);
+    auto rayCount = options.getUint("raycast-rays", DEFAULT_RAYS);
+    auto maxDistance = options.getUint("raycast-distance", DEFAULT_DISTANCE);
+    auto edits = options.getUint("raycast-edits", DEFAULT_EDITS);
+    auto iterations =
+        options.getUint("raycast-iterations", DEFAULT_ITERATIONS);
+    auto seed = options.getUint("seed", DEFAULT_SEED);
+    auto maxThreads = options.getUint(
+        "raycast-max-threads",
+        std::max<uint64_t>(std::thread::hardware_concurrency(), 1));
+
+    harness.setParameter("raycast.radius", radius);
+    harness.setParameter("raycast.rays", rayCount);
+    harness.setParameter("raycast.distance", maxDistance);
+    harness.setParameter("raycast.edits", edits);
+    harness.setParameter("raycast.iterations", iterations);
+    harness.setParameter("raycast.seed", seed);
+    harness.setParameter("raycast.maxThreads", maxThreads);
+
+    BlockTypes types;
+    glm::vec4 white(1, 1, 1, 1);
+
+    TerrainSettings terrain;
+    terrain.seed = static_cast<uint32_t>(seed);
+    terrain.stone = types.add({"stone", true, true, 0, white});
+    terrain.dirt = types.add({"dirt", true, true, 1, white});
+    terrain.grass = types.add({"grass", true, true, 2, white});
+
+    auto side = static_cast<int>(radius);
+    std::vector<glm::ivec3> positions;
+    for (int z = MIN_Z; z <= MAX_Z; z++) {
+        for (int y = -side; y < side; y++) {
+            for (int x = -side; x < side; x++) {
+                positions.emplace_back(x, y, z);
+            }
+        }
+    }
+
+    std::vector<Chunk> chunks;
+    {
+        JobSystem jobs;
+        TerrainGenerator(terrain).generate(jobs, positions, chunks);
+    }
+    auto chunkCount = static_cast<double>(positions.size());
+
+    // Medians are in microseconds
+    OccupancyIndex index(types);
+    for (uint64_t i = 0; i < iterations; i++) {
+        harness.time("raycast.build", [&]() {
+            for (std::size_t c = 0; c < positions.size(); c++) {
+                index.addChunk(positions[c], chunks[c]);
+            }
+        });
+    }
+    harness.setMetric("raycast.build.speed",
+                      chunkCount * 1e6 / harness.getMedian("raycast.build"),
+                      "chunks/s");
+
+    std::size_t memory = 0;
+    for (const auto &position : positions) {
+        memory += index.getMemoryUsage(position);
+    }
+    harness.setMetric("raycast.memoryPerChunk",
+                      static_cast<double>(memory) / chunkCount, "B/chunk");
+
+    // Rays in all directions from just above the surface, like picking and
+    // line of sight between players
+    std::mt19937 random(static_cast<uint32_t>(seed));
+    auto extent = static_cast<float>(side * Chunk::SIZE);
+    std::uniform_real_distribution<float> horizontal(-extent, extent);
+    std::uniform_real_distribution<float> height(
+        static_cast<float>(terrain.baseHeight),
+        static_cast<float>(terrain.baseHeight + Chunk::SIZE));
+    std::normal_distribution<float> component;
+
+    std::vector<Ray> rays(rayCount);
+    for (auto &ray : rays) {
+        ray.origin = {horizontal(random), horizontal(random), height(random)};
+        do {
+            ray.direction = {component(random), component(random),
+                             component(random)};
+        } while (glm::length(ray.direction) == 0);
+    }
+
+    auto distance = static_cast<float>(maxDistance);
+    auto raysDouble = static_cast<double>(rayCount);
+
+    // Both tracers must agree on every hit
+    std::size_t hits = 0;
+    std::size_t mismatches = 0;
+    for (const auto &ray : rays) {
+        OccupancyIndex::RayHit hit{};
+        OccupancyIndex::RayHit expected{};
+        bool found = index.raycast(ray.origin, ray.direction, distance, hit);
+        bool naive = raycastNaive(index, ray, distance, expected);
+
+        hits += found ? 1 : 0;
+        if (found != naive ||
+            (found && (hit.block != expected.block ||
+                       hit.normal != expected.normal))) {
+            mismatches++;
+        }
+    }
+    harness.setMetric("raycast.hits",
+                      static_cast<double>(hits) * 100 / raysDouble, "%");
+    harness.setMetric("raycast.mismatches", static_cast<double>(mismatches),
+                      "rays");
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        harness.time("raycast.naive", [&]() {
+            for (const auto &ray : rays) {
+                OccupancyIndex::RayHit hit{};
+                raycastNaive(index, ray, distance, hit);
+            }
+        });
+    }
+    double naive = harness.getMedian("raycast.naive");
+    harness.setMetric("raycast.naive.speed", raysDouble * 1e6 / naive,
+                      "rays/s");
+
+    // The calling thread traces rays too while it waits for workers
+    double baseline = 0;
+    for (std::size_t threads : getThreadCounts(maxThreads)) {
+        auto name = "raycast.t" + std::to_string(threads);
+        std::unique_ptr<JobSystem> jobs;
+        if (threads > 1) {
+            jobs = std::make_unique<JobSystem>(threads - 1);
+        }
+
+        auto trace = [&](std::size_t begin, std::size_t end) {
+            for (std::size_t r = begin; r < end; r++) {
+                OccupancyIndex::RayHit hit{};
+                index.raycast(rays[r].origin, rays[r].direction, distance,
+                              hit);
+            }
+        };
+
+        for (uint64_t i = 0; i < iterations; i++) {
+            harness.time(name, [&]() {
+                if (!jobs) {
+                    trace(0, rays.size());
+                    return;
+                }
+
+                JobCounter counter;
+                for (std::size_t r = 0; r < rays.size(); r += RAYS_PER_JOB) {
+                    std::size_t end = std::min(r + RAYS_PER_JOB, rays.size());
+                    jobs->submit([&, r, end]() { trace(r, end); }, &counter);
+                }
+                jobs->wait(counter);
+            });
+        }
+
+        double time = harness.getMedian(name);
+        if (threads == 1) {
+            baseline = time;
+            harness.setMetric("raycast.speedup.naive", naive / time, "x");
+        }
+        harness.setMetric(name + ".speed", raysDouble * 1e6 / time, "rays/s");
+        harness.setMetric(name + ".speedup", baseline / time, "x");
+    }
+
+    // Single blocks set and cleared at the ray origins
+    std::vector<glm::ivec3> blocks;
+    for (uint64_t i = 0; i < edits; i++) {
+        blocks.emplace_back(glm::floor(rays[i % rays.size()].origin));
+    }
+    for (uint64_t i = 0; i < iterations; i++) {
+        harness.time("raycast.update", [&]() {
+            for (const auto &block : blocks) {
+                index.blockChanged(block, terrain.stone);
+            }
+            for (const auto &block : blocks) {
+                index.blockChanged(block, progressia::main::BLOCK_AIR);
+            }
+        });
+    }
+    harness.setMetric("raycast.update.speed",
+                      static_cast<double>(edits * 2) * 1e6 /
+                          harness.getMedian("raycast.update"),
+                      "updates/s");
+}
+
+} // namespace progressia::bench
@@ -0,0 +1,161 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <thread>
+
+#include "../main/jobs/job_system.h"
+#include "../main/world/block_types.h"
+#include "../main/world/chunk_manager.h"
+#include "../main/world/terrain_generator.h"
+
+namespace progressia::bench {
+
+namespace {
+
+using progressia::main::BlockTypes;
+using progressia::main::Chunk;
+using progressia::main::ChunkManager;
+using progressia::main::ChunkManagerSettings;
+using progressia::main::JobSystem;
+using progressia::main::MAX_LOD_LEVEL;
+using progressia::main::TerrainGenerator;
+using progressia::main::TerrainSettings;
+
+/*
+ * Updates manager until every requested chunk is loaded, lit and meshed.
+ * Returns the number of updates.
+ */
+uint64_t settle(ChunkManager &manager) {
+    uint64_t updates = 0;
+    while (true) {
+        manager.update();
+        manager.takeMeshes();
+        manager.takeUnloaded();
+        updates++;
+
+        auto stats = manager.getStats();
+        if (stats.loading == 0 && stats.meshing == 0 && stats.unlit == 0 &&
+            !stats.lighting) {
+            return updates;
+        }
+        std::this_thread::yield();
+    }
+}
+
+} // namespace
+
+void runStreamingBench(Harness &harness, const Options &options) {
+    constexpr uint64_t DEFAULT_RADIUS = 6;
+    constexpr uint64_t DEFAULT_STEPS = 32;
+    constexpr uint64_t DEFAULT_BUDGET_MB = 256;
+    constexpr uint64_t DEFAULT_SEED = 42;
+    constexpr uint64_t DEFAULT_LOD_STEP = 2;
+
+    auto radius = options.getUint("streaming-radius", DEFAULT_RADIUS);
+    auto steps = options.getUint("streaming-steps", DEFAULT_STEPS);
+    auto budget = options.getUint("streaming-budget-mb", DEFAULT_BUDGET_MB);
+    auto seed = options.getUint("seed", DEFAULT_SEED);
+
+    // Rings of coarser levels of detail, each a few chunks wide by default
+    std::array<uint64_t, MAX_LOD_LEVEL> lodRadii{};
+    for (unsigned level = 1; level <= MAX_LOD_LEVEL; level++) {
+        auto name = "streaming-lod" + std::to_string(level);
+        lodRadii[level - 1] =
+            options.getUint(name, radius + DEFAULT_LOD_STEP * level);
+    }
+
+    harness.setParameter("streaming.radius", radius);
+    harness.setParameter("streaming.steps", steps);
+    harness.setParameter("streaming.budgetMb", budget);
+    harness.setParameter("streaming.seed", seed);
+    for (unsigned level = 1; level <= MAX_LOD_LEVEL; level++) {
+        harness.setParameter("streaming.lod" + std::to_string(level),
+                             lodRadii[level - 1]);
+    }
+
+    BlockTypes types;
+    glm::vec4 white(1, 1, 1, 1);
+
+    TerrainSettings terrain;
+    terrain.seed = static_cast<uint32_t>(seed);
+    terrain.stone = types.add({"stone", true, true, 0, white});
+    terrain.dirt = types.add({"dirt", true, true, 1, white});
+    terrain.grass = types.add({"grass", true, true, 2, white});
+
+    ChunkManagerSettings settings;
+    settings.loadRadius = static_cast<float>(radius);
+    settings.unloadRadius = static_cast<float>(radius) + 2;
+    settings.memoryBudget = static_cast<std::size_t>(budget) << 20;
+    for (unsigned level = 1; level <= MAX_LOD_LEVEL; level++) {
+        settings.lodRadii[level - 1] = static_cast<float>(lodRadii[level - 1]);
+    }
+
+    JobSystem jobs;
+    ChunkManager manager(types, jobs, TerrainGenerator(terrain), nullptr,
+                         settings);
+
+    // The viewer flies east above the surface, one chunk per step
+    glm::vec3 viewer(0, 0, terrain.baseHeight + Chunk::SIZE);
+    manager.setViewerPosition(viewer);
+
+    uint64_t fillUpdates = 0;
+    harness.time("streaming.fill", [&]() { fillUpdates = settle(manager); });
+
+    auto filled = manager.getStats();
+    std::size_t peakLoaded = filled.loaded;
+    std::size_t peakMemory = filled.memoryUsage;
+
+    for (uint64_t i = 0; i < steps; i++) {
+        viewer.x += Chunk::SIZE;
+        manager.setViewerPosition(viewer);
+
+        harness.time("streaming.step", [&]() { settle(manager); });
+
+        auto stats = manager.getStats();
+        peakLoaded = std::max(peakLoaded, stats.loaded);
+        peakMemory = std::max(peakMemory, stats.memoryUsage);
+    }
+
+    auto stats = manager.getStats();
+    harness.setMetric("streaming.fill.chunks",
+                      static_cast<double>(filled.loaded), "chunks");
+    harness.setMetric("streaming.fill.updates",
+                      static_cast<double>(fillUpdates), "updates");
+    harness.setMetric("streaming.peak.chunks",
+                      static_cast<double>(peakLoaded), "chunks");
+    harness.setMetric("streaming.peak.memory",
+                      static_cast<double>(peakMemory) / (1 << 20), "MiB");
+    harness.setMetric("streaming.memoryPerChunk",
+                      static_cast<double>(peakMemory) /
+                          static_cast<double>(std::max<std::size_t>(
+                              peakLoaded, 1)),
+                      "B/chunk");
+    harness.setMetric("streaming.uploaded",
+                      static_cast<double>(stats.uploaded), "chunks");
+    harness.setMetric("streaming.generated",
+                      static_cast<double>(stats.chunksGenerated), "chunks");
+    harness.setMetric("streaming.unloaded",
+                      static_cast<double>(stats.unloaded), "chunks");
+    harness.setMetric("streaming.evicted", static_cast<double>(stats.evicted),
+                      "chunks");
+
+    // Level 0 is full detail
+    for (unsigned level = 0; level <= MAX_LOD_LEVEL; level++) {
+        const auto &ring = stats.levels[level];
+        auto prefix = "streaming.lod" + std::to_string(level);
+        harness.setMetric(prefix + ".chunks", static_cast<double>(ring.chunks),
+                          "chunks");
+        harness.setMetric(prefix + ".memory",
+                          static_cast<double>(ring.memoryUsage) / (1 << 20),
+                          "MiB");
+        harness.setMetric(prefix + ".vertices",
+                          static_cast<double>(ring.vertices), "vertices");
+        harness.setMetric(prefix + ".meshMemory",
+                          static_cast<double>(ring.meshMemory) / (1 << 20),
+                          "MiB");
+    }
+}
+
+} // namespace progressia::bench
@@ -0,0 +1,56 @@
+#include "terrain.h"
+
+#include <random>
+
+#include "../main/world/terrain_generator.h"
+
+namespace progressia::bench {
+
+using progressia::main::BlockId;
+using progressia::main::Chunk;
+
+std::vector<std::pair<glm::ivec3, Chunk>>
+generateTerrainChunks(std::size_t count, uint64_t seed) {
+    constexpr BlockId ORE_FIRST = 4;
+    constexpr BlockId ORE_COUNT = 6;
+
+    main::TerrainSettings settings;
+    settings.seed = static_cast<uint32_t>(seed);
+    settings.stone = 1;
+    settings.dirt = 2;
+    settings.grass = 3;
+    main::TerrainGenerator generator(settings);
+
+    std::mt19937 random(static_cast<uint32_t>(seed));
+    std::vector<std::pair<glm::ivec3, Chunk>> result;
+    result.reserve(count);
+
+    // A square of columns, two chunks deep
+    int side = 1;
+    while (std::size_t(side) * side * 2 < count) {
+        side++;
+    }
+
+    for (std::size_t i = 0; i < count; i++) {
+        auto column = static_cast<int>(i / 2);
+        glm::ivec3 position(column % side, column / side,
+                            static_cast<int>(i % 2) - 1);
+        Chunk &chunk = result.emplace_back(position, Chunk()).second;
+        generator.generate(position, chunk);
+
+        // The generator only places three kinds of blocks
+        for (int j = 0; j < 40; j++) {
+            std::size_t index = random() % Chunk::VOLUME;
+            if (chunk.get(index) == settings.stone) {
+                chunk.set(index, static_cast<BlockId>(ORE_FIRST +
+                                                      random() % ORE_COUNT));
+            }
+        }
+
+        chunk.compact();
+    }
+
+    return result;
+}
+
+} // namespace progressia::bench
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "../main/world/chunk.h"
+
+namespace progressia::bench {
+
+/*
+ * Generates count chunks of TerrainGenerator terrain with scattered ore.
+ * Chunks form a square area two chunks deep; the lower half is
+ * underground.
+ */
+std::vector<std::pair<glm::ivec3, main::Chunk>>
+generateTerrainChunks(std::size_t count, uint64_t seed);
+
+} // namespace progressia::bench
@@ -0,0 +1,178 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../main/jobs/job_system.h"
+#include "../main/world/noise.h"
+#include "../main/world/terrain_generator.h"
+
+namespace progressia::bench {
+
+namespace {
+
+using progressia::main::Chunk;
+using progressia::main::JobSystem;
+using progressia::main::TerrainGenerator;
+using progressia::main::TerrainSettings;
+namespace simd = progressia::main::simd;
+namespace noise = progressia::main::noise;
+
+struct Samples {
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+};
+
+template <typename B> void consume(typename B::Float sum) {
+    std::array<float, B::WIDTH> lanes; // NOLINT
+    sum.store(lanes.data());
+    float total = 0;
+    for (float lane : lanes) {
+        total += lane;
+    }
+    sink += static_cast<uint64_t>(total != 0);
+}
+
+template <typename B>
+void timeNoise(Harness &harness, const Samples &samples,
+               const std::string &suffix) {
+    using Float = typename B::Float;
+    std::size_t count = samples.x.size() / B::WIDTH * B::WIDTH;
+
+    harness.time("terrain.noise2" + suffix, [&]() {
+        Float sum = Float::splat(0);
+        for (std::size_t i = 0; i < count; i += B::WIDTH) {
+            sum = sum + noise::simplex2<B>(Float::load(&samples.x[i]),
+                                           Float::load(&samples.y[i]), 1);
+        }
+        consume<B>(sum);
+    });
+
+    harness.time("terrain.noise3" + suffix, [&]() {
+        Float sum = Float::splat(0);
+        for (std::size_t i = 0; i < count; i += B::WIDTH) {
+            sum = sum + noise::simplex3<B>(Float::load(&samples.x[i]),
+                                           Float::load(&samples.y[i]),
+                                           Float::load(&samples.z[i]), 1);
+        }
+        consume<B>(sum);
+    });
+}
+
+std::vector<std::size_t> getThreadCounts(std::size_t maximum) {
+    std::vector<std::size_t> result;
+    for (std::size_t count = 1; count < maximum; count *= 2) {
+        result.push_back(count);
+    }
+    result.push_back(maximum);
+    return result;
+}
+
+} // namespace
+
+void runTerrainBench(Harness &harness, const Options &options) {
+    constexpr uint64_t DEFAULT_CHUNKS = 512;
+    constexpr uint64_t DEFAULT_SAMPLES = 1 << 18;
+    constexpr uint64_t DEFAULT_ITERATIONS = 5;
+    constexpr uint64_t DEFAULT_SEED = 42;
+
+    auto chunkCount = options.getUint("terrain-chunks", DEFAULT_CHUNKS);
+    auto sampleCount = options.getUint("terrain-samples", DEFAULT_SAMPLES);
+    auto iterations = options.getUint("terrain-iterations", DEFAULT_ITERATIONS);
+    auto seed = options.getUint("seed", DEFAULT_SEED);
+    auto maxThreads = options.getUint(
+        "terrain-max-threads",
+        std::max<uint64_t>(std::thread::hardware_concurrency(), 1));
+
+    harness.setParameter("terrain.chunks", chunkCount);
+    harness.setParameter("terrain.samples", sampleCount);
+    harness.setParameter("terrain.iterations", iterations);
+    harness.setParameter("terrain.seed", seed);
+    harness.setParameter("terrain.maxThreads", maxThreads);
+    harness.setParameter("terrain.simd", simd::Native::NAME);
+
+    // Noise kernels alone, scalar against the native backend
+    Samples samples;
+    {
+        std::mt19937 random(static_cast<uint32_t>(seed));
+        std::uniform_real_distribution<float> coordinate(-1000, 1000);
+        for (uint64_t i = 0; i < sampleCount; i++) {
+            samples.x.push_back(coordinate(random));
+            samples.y.push_back(coordinate(random));
+            samples.z.push_back(coordinate(random));
+        }
+    }
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        timeNoise<simd::Scalar>(harness, samples, ".scalar");
+        timeNoise<simd::Native>(harness, samples, ".simd");
+    }
+
+    // Samples per microsecond are millions of samples per second
+    auto samplesDouble = static_cast<double>(sampleCount);
+    for (const char *kernel : {"noise2", "noise3"}) {
+        std::string name = std::string("terrain.") + kernel;
+        double scalar = harness.getMedian(name + ".scalar");
+        double vector = harness.getMedian(name + ".simd");
+        harness.setMetric(name + ".speed.scalar", samplesDouble / scalar,
+                          "M/s");
+        harness.setMetric(name + ".speed.simd", samplesDouble / vector,
+                          "M/s");
+        harness.setMetric(name + ".speedup", scalar / vector, "x");
+    }
+
+    // Whole chunks: a square area two chunks deep around the surface
+    TerrainSettings settings;
+    settings.seed = static_cast<uint32_t>(seed);
+    settings.stone = 1;
+    settings.dirt = 2;
+    settings.grass = 3;
+    TerrainGenerator generator(settings);
+
+    std::vector<glm::ivec3> positions;
+    int side = 1;
+    while (std::size_t(side) * side * 2 < chunkCount) {
+        side++;
+    }
+    for (uint64_t i = 0; i < chunkCount; i++) {
+        auto column = static_cast<int>(i / 2);
+        positions.emplace_back(column % side, column / side,
+                               static_cast<int>(i % 2) - 1);
+    }
+
+    std::vector<Chunk> chunks;
+    double baseline = 0;
+    auto chunksDouble = static_cast<double>(chunkCount);
+
+    for (std::size_t threads : getThreadCounts(maxThreads)) {
+        JobSystem jobs(threads);
+        auto name = "terrain.generate.t" + std::to_string(threads);
+
+        for (uint64_t i = 0; i < iterations; i++) {
+            harness.time(name, [&]() {
+                generator.generate(jobs, positions, chunks);
+            });
+        }
+
+        double time = harness.getMedian(name);
+        if (threads == 1) {
+            baseline = time;
+        }
+
+        // Medians are in microseconds
+        harness.setMetric(name + ".speed", chunksDouble * 1e6 / time,
+                          "chunks/s");
+        harness.setMetric(name + ".columns",
+                          chunksDouble * Chunk::SIZE * Chunk::SIZE * 1e6 /
+                              time,
+                          "columns/s");
+        harness.setMetric(name + ".speedup", baseline / time, "x");
+    }
+}
+
+} // namespace progressia::bench
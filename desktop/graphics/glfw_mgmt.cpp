@@ -8,6 +8,7 @@
 
 #include "../../main/logging.h"
 #include "../../main/meta.h"
+#include "../../main/profiler.h"
 #include "../../main/util.h"
 
 using namespace progressia::main::logging;
@@ -16,11 +17,14 @@ namespace progressia::desktop {
 
 static void onGlfwError(int errorCode, const char *description);
 static void onWindowGeometryChange(GLFWwindow *window, int width, int height);
+static void onKey(GLFWwindow *window, int key, int scancode, int action,
+                  int mods);
 
 class GlfwManagerImpl : public GlfwManager {
   private:
     GLFWwindow *window = nullptr;
     std::function<void()> onScreenResize = nullptr;
+    std::function<void()> onScreenshot = nullptr;
 
   public:
     DISABLE_COPYING(GlfwManagerImpl)
@@ -55,6 +59,7 @@ class GlfwManagerImpl : public GlfwManager {
                                   title.c_str(), nullptr, nullptr);
 
         glfwSetWindowSizeCallback(window, onWindowGeometryChange);
+        glfwSetKeyCallback(window, onKey);
 
         debug("GLFW init complete");
     }
@@ -65,6 +70,10 @@ class GlfwManagerImpl : public GlfwManager {
         onScreenResize = hook;
     }
 
+    void setOnScreenshot(std::function<void()> hook) override {
+        onScreenshot = hook;
+    }
+
     void showWindow() override {
         glfwShowWindow(window);
         debug("Window now visible");
@@ -76,6 +85,7 @@ class GlfwManagerImpl : public GlfwManager {
 
     friend GLFWwindow *getGLFWWindowHandle();
     friend void onWindowGeometryChange(GLFWwindow *, int, int);
+    friend void onKey(GLFWwindow *, int, int, int, int);
 };
 
 namespace {
@@ -118,6 +128,25 @@ void onWindowGeometryChange(GLFWwindow *window, [[maybe_unused]] int width,
     }
 }
 
+void onKey(GLFWwindow *window, int key, [[maybe_unused]] int scancode,
+           int action, [[maybe_unused]] int mods) {
+    if (action != GLFW_PRESS) {
+        return;
+    }
+
+    if (key == GLFW_KEY_F12) {
+        progressia::main::profiler::requestDump();
+    }
+
+    if (key == GLFW_KEY_F2) {
+        auto manager = theGlfwManager.lock();
+        if (manager && manager->window == window &&
+            manager->onScreenshot != nullptr) {
+            manager->onScreenshot();
+        }
+    }
+}
+
 GLFWwindow *getGLFWWindowHandle() {
     if (auto manager = theGlfwManager.lock()) {
         return manager->window;
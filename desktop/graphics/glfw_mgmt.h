@@ -12,6 +12,11 @@ class GlfwManager {
 
     virtual void setOnScreenResize(std::function<void()>) = 0;
 
+    /*
+     * Sets the function called when the user requests a screenshot (F2).
+     */
+    virtual void setOnScreenshot(std::function<void()>) = 0;
+
     virtual void showWindow() = 0;
     virtual bool shouldRun() = 0;
     virtual void doGlfwRoutine() = 0;
@@ -22,6 +22,8 @@ layout(location = 0) in  vec3 inPosition;
 layout(location = 1) in  vec4 inColor;
 layout(location = 2) in  vec3 inNormal;
 layout(location = 3) in  vec2 inTexCoord;
+layout(location = 4) in  vec2 inLight;
+layout(location = 5) in  float inOcclusion;
 
 layout(location = 0) out vec4 fragColor;
 layout(location = 2) out vec2 fragTexCoord;
@@ -33,15 +35,20 @@ void main() {
     
     fragColor.a = inColor.a;
     
+    // Each level is 80% as bright as the next one; directional light only
+    // shades skylight
+    vec2 brightness = pow(vec2(0.8), (1 - inLight) * 15);
+    vec3 color = inColor.rgb * inOcclusion;
+    
     float exposure = dot(light.from.xyz, (model * vec4(inNormal, 1)).xyz);
     if (exposure < -light.softness) {
-        fragColor.rgb = inColor.rgb * (
+        fragColor.rgb = color * (
             (exposure + 1) * ((0.5 - light.contrast) / (1 - light.softness))
         );
     } else if (exposure < light.softness) {
         // FIXME
         fragColor.rgb =
-            inColor.rgb
+            color
             * (
                 0.5 + exposure * light.contrast / light.softness
             )
@@ -51,12 +58,14 @@ void main() {
             );
     } else {
         fragColor.rgb =
-            inColor.rgb
+            color
             * (
                 0.5 + light.contrast + (exposure - light.softness) * ((0.5 - light.contrast) / (1 - light.softness))
             )
             * light.color.rgb;
     }
     
+    fragColor.rgb = max(fragColor.rgb * brightness.y, color * brightness.x);
+    
     fragTexCoord = inTexCoord;
 }
@@ -17,9 +17,13 @@
 #include <glm/vec4.hpp>
 
 #include "../../main/logging.h"
+#include "../../main/profiler.h"
 #include "../../main/rendering.h"
+#include "../../main/rendering/culling.h"
 #include "vulkan_buffer.h"
+#include "vulkan_command_recorder.h"
 #include "vulkan_frame.h"
+#include "vulkan_gpu_culling.h"
 #include "vulkan_pipeline.h"
 #include "vulkan_swap_chain.h"
 #include "vulkan_texture_descriptors.h"
@@ -43,6 +47,8 @@ auto getVertexFieldProperties() {
         FieldProperties{offsetof(Vertex, color), VK_FORMAT_R32G32B32A32_SFLOAT},
         FieldProperties{offsetof(Vertex, normal), VK_FORMAT_R32G32B32_SFLOAT},
         FieldProperties{offsetof(Vertex, texCoord), VK_FORMAT_R32G32_SFLOAT},
+        FieldProperties{offsetof(Vertex, light), VK_FORMAT_R32G32_SFLOAT},
+        FieldProperties{offsetof(Vertex, occlusion), VK_FORMAT_R32_SFLOAT},
     };
 }
 
@@ -101,6 +107,11 @@ std::vector<char> Adapter::loadFragmentShader() {
     return tmp_readFile("shader.frag.spv");
 }
 
+// NOLINTNEXTLINE(readability-convert-member-functions-to-static): future-proofing
+std::vector<char> Adapter::loadCullingShader() {
+    return tmp_readFile("cull.comp.spv");
+}
+
 // NOLINTNEXTLINE(readability-convert-member-functions-to-static): future-proofing
 VkVertexInputBindingDescription Adapter::getVertexInputBindingDescription() {
     VkVertexInputBindingDescription bindingDescription{};
@@ -162,7 +173,11 @@ namespace {
 struct DrawRequest {
     progressia::desktop::Texture *texture;
     IndexedBuffer<Vertex> *vertices;
+    const BoundingBox *bounds;
     glm::mat4 modelTransform;
+
+    // Offset of the draw command written by GpuCulling, if used
+    VkDeviceSize indirectOffset;
 };
 
 // NOLINTNEXTLINE: TODO
@@ -172,6 +187,78 @@ constexpr std::size_t PENDING_DRAW_COMMANDS_MAX_SIZE = 100000;
 // NOLINTNEXTLINE: TODO
 glm::mat4 currentModelTransform;
 
+// Frustum of the View in use; pending draws are flushed before it changes
+// NOLINTNEXTLINE: TODO
+Frustum currentFrustum;
+
+// NOLINTNEXTLINE: TODO
+bool cullingEnabled = true;
+// NOLINTNEXTLINE: TODO
+bool gpuCullingEnabled = false;
+
+// Reused between flushes to avoid allocations
+// NOLINTNEXTLINE: TODO
+BoxBatch cullingBatch;
+// NOLINTNEXTLINE: TODO
+std::vector<uint8_t> cullingResults;
+
+// NOLINTNEXTLINE: TODO
+GraphicsInterface::CullingStats cullingStats;
+// NOLINTNEXTLINE: TODO
+uint64_t cullingStatsFrame = 0;
+
+bool isGpuCullingActive(Vulkan &vulkan) {
+    return cullingEnabled && gpuCullingEnabled &&
+           vulkan.getGpuCulling().isSupported();
+}
+
+GraphicsInterface::CullingStats &getFrameCullingStats(Vulkan &vulkan) {
+    if (cullingStatsFrame != vulkan.getLastStartedFrame()) {
+        cullingStatsFrame = vulkan.getLastStartedFrame();
+        cullingStats = {};
+    }
+    return cullingStats;
+}
+
+/*
+ * Removes draw requests outside of currentFrustum, keeping the order of the
+ * others.
+ */
+void cullPendingDrawCommands(Vulkan &vulkan) {
+    PROFILE_SCOPE("cullPendingDrawCommands");
+
+    auto &stats = getFrameCullingStats(vulkan);
+    std::size_t total = pendingDrawCommands.size();
+
+    if (!cullingEnabled) {
+        stats.visible += total;
+        return;
+    }
+
+    cullingBatch.clear();
+    cullingBatch.reserve(total);
+    for (const auto &cmd : pendingDrawCommands) {
+        cullingBatch.add(*cmd.bounds, cmd.modelTransform);
+    }
+
+    cullingResults.resize(total);
+    std::size_t visible =
+        cullingBatch.cull(currentFrustum, cullingResults.data());
+
+    if (visible != total) {
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < total; i++) {
+            if (cullingResults[i] != 0) {
+                pendingDrawCommands[kept++] = pendingDrawCommands[i];
+            }
+        }
+        pendingDrawCommands.resize(kept);
+    }
+
+    stats.visible += visible;
+    stats.culled += total - visible;
+}
+
 } // namespace
 
 struct progressia::main::Texture::Backend {
@@ -186,6 +273,7 @@ progressia::main::Texture::~Texture() = default;
 struct Primitive::Backend {
     IndexedBuffer<Vertex> buf;
     progressia::main::Texture *tex;
+    BoundingBox bounds;
 };
 
 Primitive::Primitive(std::unique_ptr<Backend> backend)
@@ -199,7 +287,8 @@ void Primitive::draw() {
     }
 
     pendingDrawCommands.push_back({&backend->tex->backend->texture,
-                                   &backend->buf, currentModelTransform});
+                                   &backend->buf, &backend->bounds,
+                                   currentModelTransform, 0});
 }
 
 const progressia::main::Texture *Primitive::getTexture() const {
@@ -208,6 +297,7 @@ const progressia::main::Texture *Primitive::getTexture() const {
 
 struct View::Backend {
     Adapter::ViewUniform::State state;
+    Frustum frustum;
 };
 
 View::View(std::unique_ptr<Backend> backend) : backend(std::move(backend)) {}
@@ -216,11 +306,13 @@ View::~View() = default;
 
 void View::configure(const glm::mat4 &proj, const glm::mat4 &view) {
     backend->state.update(proj, view);
+    backend->frustum = Frustum(proj * view);
 }
 
 void View::use() {
     backend->state.uniform->getVulkan().getGint().flush();
     backend->state.bind();
+    currentFrustum = backend->frustum;
 }
 
 struct Light::Backend {
@@ -260,12 +352,13 @@ std::unique_ptr<Primitive>
 GraphicsInterface::newPrimitive(const std::vector<Vertex> &vertices,
                                 const std::vector<Vertex::Index> &indices,
                                 progressia::main::Texture *texture) {
+    PROFILE_SCOPE("GraphicsInterface::newPrimitive");
 
     auto primitive = std::make_unique<Primitive>(
         std::unique_ptr<Primitive::Backend>(new Primitive::Backend{
             IndexedBuffer<Vertex>(vertices.size(), indices.size(),
                                   *static_cast<Vulkan *>(this->backend)),
-            texture}));
+            texture, computeBoundingBox(vertices)}));
 
     primitive->backend->buf.load(vertices.data(), indices.data());
 
@@ -274,8 +367,11 @@ GraphicsInterface::newPrimitive(const std::vector<Vertex> &vertices,
 
 std::unique_ptr<View> GraphicsInterface::newView() {
     return std::make_unique<View>(std::unique_ptr<View::Backend>(
-        new View::Backend{Adapter::ViewUniform::State(
-            static_cast<Vulkan *>(this->backend)->getAdapter().createView())}));
+        new View::Backend{
+            Adapter::ViewUniform::State(static_cast<Vulkan *>(this->backend)
+                                            ->getAdapter()
+                                            .createView()),
+            Frustum()}));
 }
 
 std::unique_ptr<Light> GraphicsInterface::newLight() {
@@ -298,44 +394,110 @@ void GraphicsInterface::setModelTransform(const glm::mat4 &m) {
 }
 
 void GraphicsInterface::flush() {
+    PROFILE_SCOPE("GraphicsInterface::flush");
+
+    auto *vulkan = static_cast<Vulkan *>(this->backend);
+    auto *pipelineLayout = vulkan->getPipeline().getLayout();
+
+    // Batches that do not fit into GPU culling buffers are culled here
+    auto &gpuCulling = vulkan->getGpuCulling();
+    bool indirect =
+        isGpuCullingActive(*vulkan) && vulkan->getCurrentFrame() != nullptr &&
+        !pendingDrawCommands.empty() &&
+        gpuCulling.beginBatch(currentFrustum, pendingDrawCommands.size());
+
+    if (indirect) {
+        for (auto &cmd : pendingDrawCommands) {
+            cmd.indirectOffset =
+                gpuCulling.addObject(*cmd.bounds, cmd.modelTransform,
+                                     cmd.vertices->getIndexCount());
+        }
+    } else {
+        cullPendingDrawCommands(*vulkan);
+    }
 
-    auto *commandBuffer = static_cast<Vulkan *>(this->backend)
-                              ->getCurrentFrame()
-                              ->getCommandBuffer();
-    auto *pipelineLayout =
-        static_cast<Vulkan *>(this->backend)->getPipeline().getLayout();
+    // Draw requests are split into ranges that are recorded in parallel
+    auto recordRange = [&](VkCommandBuffer commandBuffer, std::size_t begin,
+                           std::size_t end) {
+        progressia::desktop::Texture *lastTexture = nullptr;
+
+        for (std::size_t i = begin; i < end; i++) {
+            auto &cmd = pendingDrawCommands[i];
+
+            if (cmd.texture != lastTexture) {
+                lastTexture = cmd.texture;
+                cmd.texture->bind(commandBuffer);
+            }
+
+            auto &m = cmd.modelTransform;
+            // Evil transposition: column_major -> row_major
+            // clang-format off
+            std::remove_reference_t<decltype(m)>::value_type src[3*4] {
+                m[0][0], m[0][1], m[0][2], m[0][3],
+                m[1][0], m[1][1], m[1][2], m[1][3],
+                m[2][0], m[2][1], m[2][2], m[2][3]
+            };
+            // clang-format on
+
+            vkCmdPushConstants(commandBuffer, pipelineLayout,
+                               VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(src),
+                               &src);
+
+            if (indirect) {
+                cmd.vertices->drawIndirect(commandBuffer,
+                                           gpuCulling.getIndirectBuffer(),
+                                           cmd.indirectOffset);
+            } else {
+                cmd.vertices->draw(commandBuffer);
+            }
+        }
+    };
 
-    progressia::desktop::Texture *lastTexture = nullptr;
+    // REPORT_ERROR if getCurrentFrame() == nullptr
+    vulkan->getCommandRecorder().record(pendingDrawCommands.size(),
+                                        recordRange);
 
-    for (auto &cmd : pendingDrawCommands) {
-        if (cmd.texture != lastTexture) {
-            lastTexture = cmd.texture;
-            cmd.texture->bind();
-        }
+    pendingDrawCommands.clear();
+}
 
-        auto &m = cmd.modelTransform;
-        // Evil transposition: column_major -> row_major
-        // clang-format off
-        std::remove_reference_t<decltype(m)>::value_type src[3*4] {
-            m[0][0], m[0][1], m[0][2], m[0][3],
-            m[1][0], m[1][1], m[1][2], m[1][3],
-            m[2][0], m[2][1], m[2][2], m[2][3]
-        };
-        // clang-format on
-
-        vkCmdPushConstants(
-            // REPORT_ERROR if getCurrentFrame() == nullptr
-            commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0,
-            sizeof(src), &src);
-
-        cmd.vertices->draw(commandBuffer);
+// NOLINTNEXTLINE(readability-convert-member-functions-to-static): future-proofing
+void GraphicsInterface::setCullingEnabled(bool enabled) {
+    cullingEnabled = enabled;
+}
+
+GraphicsInterface::CullingStats GraphicsInterface::getCullingStats() {
+    auto *vulkan = static_cast<Vulkan *>(this->backend);
+
+    if (isGpuCullingActive(*vulkan)) {
+        auto stats = vulkan->getGpuCulling().getLastStats();
+        return {stats.visible, stats.culled};
     }
 
-    pendingDrawCommands.clear();
+    return getFrameCullingStats(*vulkan);
+}
+
+// NOLINTNEXTLINE(readability-convert-member-functions-to-static): future-proofing
+void GraphicsInterface::setGpuCullingEnabled(bool enabled) {
+    gpuCullingEnabled = enabled;
+}
+
+bool GraphicsInterface::isGpuCullingSupported() {
+    return static_cast<Vulkan *>(this->backend)->getGpuCulling().isSupported();
 }
 
 // NOLINTNEXTLINE: TODO
-float GraphicsInterface::tmp_getTime() { return glfwGetTime(); }
+float GraphicsInterface::tmp_getTime() {
+    auto *vulkan = static_cast<Vulkan *>(this->backend);
+
+    if (vulkan->isHeadless()) {
+        // Headless runs must be reproducible, so time advances per frame
+        constexpr float FRAMES_PER_SECOND = 60.0F;
+        return static_cast<float>(vulkan->getLastStartedFrame()) /
+               FRAMES_PER_SECOND;
+    }
+
+    return glfwGetTime();
+}
 
 uint64_t GraphicsInterface::getLastStartedFrame() {
     return static_cast<Vulkan *>(this->backend)->getLastStartedFrame();
@@ -58,6 +58,7 @@ class Adapter : public VkObjectWrapper {
 
     std::vector<char> loadVertexShader();
     std::vector<char> loadFragmentShader();
+    std::vector<char> loadCullingShader();
 
     ViewUniform::State createView();
     LightUniform::State createLight();
@@ -3,6 +3,9 @@
 #include <vector>
 
 #include "vulkan_common.h"
+#include "vulkan_gpu_profiler.h"
+
+#include "../../main/profiler.h"
 
 namespace progressia::desktop {
 
@@ -110,6 +113,7 @@ template <typename Item> class FastReadBuffer : public VkObjectWrapper {
   private:
     void recordCopyCommands() {
         commandBuffer = vulkan.getCommandPool().beginMultiUse();
+        vulkan.getGpuProfiler().beginUpload(commandBuffer);
 
         VkBufferCopy copyRegion{};
         copyRegion.srcOffset = 0;
@@ -118,12 +122,16 @@ template <typename Item> class FastReadBuffer : public VkObjectWrapper {
         vkCmdCopyBuffer(commandBuffer, stagingBuffer.buffer,
                         remoteBuffer.buffer, 1, &copyRegion);
 
+        vulkan.getGpuProfiler().endUpload(commandBuffer);
         vkEndCommandBuffer(commandBuffer);
     }
 
   public:
     void flush() const {
+        PROFILE_SCOPE("FastReadBuffer::flush");
+
         vulkan.getCommandPool().submitMultiUse(commandBuffer, true);
+        vulkan.getGpuProfiler().collectUpload();
     }
 
     void load(const Item *data) const {
@@ -171,15 +179,32 @@ class IndexedBufferBase : public VkObjectWrapper {
         indexBuffer.load(indices);
     }
 
-    void draw(VkCommandBuffer commandBuffer) {
+    uint32_t getIndexCount() const {
+        return static_cast<uint32_t>(indexBuffer.getItemCount());
+    }
+
+    void bind(VkCommandBuffer commandBuffer) {
         VkDeviceSize offset = 0;
         vkCmdBindVertexBuffers(commandBuffer, 0, 1,
                                &vertexBuffer.remoteBuffer.buffer, &offset);
         vkCmdBindIndexBuffer(commandBuffer, indexBuffer.remoteBuffer.buffer, 0,
                              INDEX_TYPE);
-        vkCmdDrawIndexed(commandBuffer,
-                         static_cast<uint32_t>(indexBuffer.getItemCount()), 1,
-                         0, 0, 0);
+    }
+
+    void draw(VkCommandBuffer commandBuffer) {
+        bind(commandBuffer);
+        vkCmdDrawIndexed(commandBuffer, getIndexCount(), 1, 0, 0, 0);
+    }
+
+    /*
+     * Draws with the VkDrawIndexedIndirectCommand at offset in
+     * indirectBuffer, which is expected to draw all indices.
+     */
+    void drawIndirect(VkCommandBuffer commandBuffer, VkBuffer indirectBuffer,
+                      VkDeviceSize offset) {
+        bind(commandBuffer);
+        vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffer, offset, 1,
+                                 sizeof(VkDrawIndexedIndirectCommand));
     }
 
     Vulkan &getVulkan() { return vertexBuffer.getVulkan(); }
@@ -0,0 +1,195 @@
+#include "vulkan_command_recorder.h"
+
+#include <algorithm>
+
+#include "vulkan_frame.h"
+
+#include "../../main/logging.h"
+#include "../../main/profiler.h"
+using namespace progressia::main::logging;
+
+namespace progressia::desktop {
+
+/*
+ * SecondaryCommandPool
+ */
+
+SecondaryCommandPool::SecondaryCommandPool(Vulkan &vulkan, const Queue &queue)
+    : pool(), usedBuffers(0), vulkan(vulkan) {
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = queue.getFamilyIndex();
+
+    vulkan.handleVkResult(
+        "Could not create SecondaryCommandPool",
+        vkCreateCommandPool(vulkan.getDevice(), &poolInfo, nullptr, &pool));
+}
+
+SecondaryCommandPool::~SecondaryCommandPool() {
+    // Command buffers are freed together with the pool
+    vkDestroyCommandPool(vulkan.getDevice(), pool, nullptr);
+}
+
+VkCommandBuffer SecondaryCommandPool::next() {
+    if (usedBuffers == buffers.size()) {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandPool = pool;
+        allocInfo.commandBufferCount = 1;
+
+        auto *commandBuffer = VkCommandBuffer();
+        vulkan.handleVkResult("Could not allocate secondary command buffer",
+                              vkAllocateCommandBuffers(vulkan.getDevice(),
+                                                       &allocInfo,
+                                                       &commandBuffer));
+
+        buffers.push_back(commandBuffer);
+    }
+
+    return buffers[usedBuffers++];
+}
+
+void SecondaryCommandPool::reset() {
+    vkResetCommandPool(vulkan.getDevice(), pool, 0);
+    usedBuffers = 0;
+}
+
+/*
+ * CommandRecorder
+ */
+
+CommandRecorder::CommandRecorder(Vulkan &vulkan)
+    : generation(0), shuttingDown(false), tasksRemaining(0), frame(nullptr),
+      task(nullptr), itemCount(0), chunkCount(0), timestampScope(0),
+      vulkan(vulkan) {
+
+    std::size_t hardwareThreads = std::thread::hardware_concurrency();
+    std::size_t workerCount =
+        hardwareThreads > 1 ? std::min(hardwareThreads - 1, MAX_WORKERS) : 0;
+
+    workers.reserve(workerCount);
+    for (std::size_t i = 0; i < workerCount; i++) {
+        // Thread 0 is the thread calling record()
+        workers.emplace_back([this, i]() { runWorker(i + 1); });
+    }
+
+    debug() << "Command recording will use " << getThreadCount()
+            << " thread(s)";
+}
+
+CommandRecorder::~CommandRecorder() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        shuttingDown = true;
+    }
+    workAvailable.notify_all();
+
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+std::size_t CommandRecorder::getThreadCount() const {
+    return workers.size() + 1;
+}
+
+void CommandRecorder::runWorker(std::size_t threadIndex) {
+    progressia::main::profiler::setThreadName("Command recorder");
+    uint64_t lastGeneration = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workAvailable.wait(lock, [&]() {
+                return shuttingDown || generation != lastGeneration;
+            });
+
+            if (shuttingDown) {
+                return;
+            }
+
+            lastGeneration = generation;
+            if (threadIndex >= chunkCount) {
+                continue;
+            }
+        }
+
+        runChunk(threadIndex);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasksRemaining--;
+            if (tasksRemaining == 0) {
+                workDone.notify_one();
+            }
+        }
+    }
+}
+
+void CommandRecorder::runChunk(std::size_t chunk) {
+    PROFILE_SCOPE("CommandRecorder::runChunk");
+
+    std::size_t begin = itemCount * chunk / chunkCount;
+    std::size_t end = itemCount * (chunk + 1) / chunkCount;
+
+    VkCommandBuffer commandBuffer = frame->beginSecondary(chunk);
+
+    // Chunks are executed in order, so the scope spans the entire batch
+    if (chunk == 0) {
+        frame->getTimestamps().writeBegin(commandBuffer, timestampScope);
+    }
+
+    (*task)(commandBuffer, begin, end);
+
+    if (chunk == chunkCount - 1) {
+        frame->getTimestamps().writeEnd(commandBuffer, timestampScope);
+    }
+
+    frame->endSecondary(commandBuffer);
+
+    results[chunk] = commandBuffer;
+}
+
+void CommandRecorder::record(std::size_t itemCount, const Task &task) {
+    if (itemCount == 0) {
+        return;
+    }
+
+    // REPORT_ERROR if getCurrentFrame() == nullptr
+    this->frame = vulkan.getCurrentFrame();
+    this->task = &task;
+    this->itemCount = itemCount;
+
+    std::size_t chunksWanted =
+        (itemCount + MIN_ITEMS_PER_BUFFER - 1) / MIN_ITEMS_PER_BUFFER;
+    this->chunkCount = std::min(chunksWanted, getThreadCount());
+
+    results.assign(chunkCount, VK_NULL_HANDLE);
+    timestampScope = frame->getTimestamps().allocateScope("flush");
+
+    if (chunkCount > 1) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasksRemaining = chunkCount - 1;
+            generation++;
+        }
+        workAvailable.notify_all();
+    }
+
+    runChunk(0);
+
+    if (chunkCount > 1) {
+        std::unique_lock<std::mutex> lock(mutex);
+        workDone.wait(lock, [&]() { return tasksRemaining == 0; });
+    }
+
+    frame->executeSecondaries(results);
+
+    this->frame = nullptr;
+    this->task = nullptr;
+}
+
+} // namespace progressia::desktop
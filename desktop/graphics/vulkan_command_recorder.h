@@ -0,0 +1,96 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "vulkan_common.h"
+
+namespace progressia::desktop {
+
+/*
+ * A command pool that hands out secondary command buffers. Each recording
+ * thread of each Frame owns one, so no external synchronization is needed.
+ */
+class SecondaryCommandPool : public VkObjectWrapper {
+  private:
+    VkCommandPool pool;
+    std::vector<VkCommandBuffer> buffers;
+    std::size_t usedBuffers;
+
+    Vulkan &vulkan;
+
+  public:
+    SecondaryCommandPool(Vulkan &vulkan, const Queue &queue);
+    ~SecondaryCommandPool();
+
+    /*
+     * Returns a command buffer that has not been used since last reset().
+     */
+    VkCommandBuffer next();
+
+    /*
+     * Makes all buffers available again. Buffers must not be pending
+     * execution.
+     */
+    void reset();
+};
+
+/*
+ * Records draw lists into secondary command buffers using a pool of worker
+ * threads. The calling thread participates in recording as thread 0.
+ */
+class CommandRecorder : public VkObjectWrapper {
+  public:
+    /*
+     * Records items [begin; end) into a secondary command buffer.
+     */
+    using Task = std::function<void(VkCommandBuffer, std::size_t begin,
+                                    std::size_t end)>;
+
+  private:
+    constexpr static std::size_t MAX_WORKERS = 7;
+    constexpr static std::size_t MIN_ITEMS_PER_BUFFER = 256;
+
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable workDone;
+
+    uint64_t generation;
+    bool shuttingDown;
+    std::size_t tasksRemaining;
+
+    // Current job, valid while tasksRemaining > 0
+    Frame *frame;
+    const Task *task;
+    std::size_t itemCount;
+    std::size_t chunkCount;
+    std::vector<VkCommandBuffer> results;
+    uint32_t timestampScope;
+
+    Vulkan &vulkan;
+
+    void runWorker(std::size_t threadIndex);
+    void runChunk(std::size_t chunk);
+
+  public:
+    CommandRecorder(Vulkan &vulkan);
+    ~CommandRecorder();
+
+    /*
+     * Returns the number of threads that may record simultaneously,
+     * including the calling thread.
+     */
+    std::size_t getThreadCount() const;
+
+    /*
+     * Splits itemCount items into chunks, records the chunks in parallel and
+     * schedules resulting buffers for execution in the current frame in
+     * order. Blocks until all chunks are recorded.
+     */
+    void record(std::size_t itemCount, const Task &task);
+};
+
+} // namespace progressia::desktop
@@ -1,7 +1,11 @@
 #include "vulkan_common.h"
 
 #include "vulkan_adapter.h"
+#include "vulkan_command_recorder.h"
 #include "vulkan_frame.h"
+#include "vulkan_frame_capture.h"
+#include "vulkan_gpu_culling.h"
+#include "vulkan_gpu_profiler.h"
 #include "vulkan_physical_device.h"
 #include "vulkan_pick_device.h"
 #include "vulkan_pipeline.h"
@@ -11,6 +15,7 @@
 
 #include "../../main/logging.h"
 #include "../../main/meta.h"
+#include "../../main/profiler.h"
 #include "glfw_mgmt_details.h"
 
 using namespace progressia::main::logging;
@@ -23,11 +28,12 @@ namespace progressia::desktop {
 
 Vulkan::Vulkan(std::vector<const char *> instanceExtensions,
                std::vector<const char *> deviceExtensions,
-               std::vector<const char *> validationLayers)
+               std::vector<const char *> validationLayers,
+               const PresentSettings &presentSettings)
     :
 
-      frames(MAX_FRAMES_IN_FLIGHT), currentFrame(0), isRenderingFrame(false),
-      lastStartedFrame(0) {
+      headless(presentSettings.headless), frames(MAX_FRAMES_IN_FLIGHT),
+      currentFrame(0), isRenderingFrame(false), lastStartedFrame(0) {
 
     /*
      * Create error handler
@@ -134,7 +140,9 @@ Vulkan::Vulkan(std::vector<const char *> instanceExtensions,
     /*
      * Create surface
      */
-    surface = std::make_unique<Surface>(*this);
+    if (!headless) {
+        surface = std::make_unique<Surface>(*this);
+    }
 
     /*
      * Pick physical device
@@ -209,12 +217,22 @@ Vulkan::Vulkan(std::vector<const char *> instanceExtensions,
         queues->storeHandles(device);
     }
 
+    /*
+     * Setup GPU profiling
+     */
+    gpuProfiler = std::make_unique<GpuProfiler>(*this);
+
     /*
      * Create command pool
      */
     commandPool =
         std::make_unique<CommandPool>(*this, queues->getGraphicsQueue());
 
+    /*
+     * Start command recording threads
+     */
+    commandRecorder = std::make_unique<CommandRecorder>(*this);
+
     /*
      * Create texture descriptor manager
      */
@@ -229,7 +247,7 @@ Vulkan::Vulkan(std::vector<const char *> instanceExtensions,
     /*
      * Initialize swap chain
      */
-    swapChain = std::make_unique<SwapChain>(*this);
+    swapChain = std::make_unique<SwapChain>(*this, presentSettings);
 
     /*
      * Create render pass
@@ -246,6 +264,16 @@ Vulkan::Vulkan(std::vector<const char *> instanceExtensions,
      */
     swapChain->recreate();
 
+    /*
+     * Setup frame capture
+     */
+    frameCapture = std::make_unique<FrameCapture>(*this);
+
+    /*
+     * Setup GPU culling
+     */
+    gpuCulling = std::make_unique<GpuCulling>(*this);
+
     /*
      * Create frames
      */
@@ -259,12 +287,16 @@ Vulkan::Vulkan(std::vector<const char *> instanceExtensions,
 Vulkan::~Vulkan() {
     gint.reset();
     frames.clear();
+    gpuCulling.reset();
+    frameCapture.reset();
     swapChain.reset();
     pipeline.reset();
     renderPass.reset();
     adapter.reset();
     textureDescriptors.reset();
+    commandRecorder.reset();
     commandPool.reset();
+    gpuProfiler.reset();
     vkDestroyDevice(device, nullptr);
     surface.reset();
     physicalDevice.reset();
@@ -274,6 +306,8 @@ Vulkan::~Vulkan() {
 
 VkInstance Vulkan::getInstance() const { return instance; }
 
+bool Vulkan::isHeadless() const { return headless; }
+
 const PhysicalDevice &Vulkan::getPhysicalDevice() const {
     return *physicalDevice;
 }
@@ -288,10 +322,20 @@ Queues &Vulkan::getQueues() { return *queues; }
 
 const Queues &Vulkan::getQueues() const { return *queues; }
 
+GpuProfiler &Vulkan::getGpuProfiler() { return *gpuProfiler; }
+
+const GpuProfiler &Vulkan::getGpuProfiler() const { return *gpuProfiler; }
+
 CommandPool &Vulkan::getCommandPool() { return *commandPool; }
 
 const CommandPool &Vulkan::getCommandPool() const { return *commandPool; }
 
+CommandRecorder &Vulkan::getCommandRecorder() { return *commandRecorder; }
+
+const CommandRecorder &Vulkan::getCommandRecorder() const {
+    return *commandRecorder;
+}
+
 RenderPass &Vulkan::getRenderPass() { return *renderPass; }
 
 const RenderPass &Vulkan::getRenderPass() const { return *renderPass; }
@@ -304,6 +348,14 @@ SwapChain &Vulkan::getSwapChain() { return *swapChain; }
 
 const SwapChain &Vulkan::getSwapChain() const { return *swapChain; }
 
+FrameCapture &Vulkan::getFrameCapture() { return *frameCapture; }
+
+const FrameCapture &Vulkan::getFrameCapture() const { return *frameCapture; }
+
+GpuCulling &Vulkan::getGpuCulling() { return *gpuCulling; }
+
+const GpuCulling &Vulkan::getGpuCulling() const { return *gpuCulling; }
+
 TextureDescriptors &Vulkan::getTextureDescriptors() {
     return *textureDescriptors;
 }
@@ -383,6 +435,8 @@ uint64_t Vulkan::getLastStartedFrame() const { return lastStartedFrame; }
 std::size_t Vulkan::getFrameInFlightIndex() const { return currentFrame; }
 
 bool Vulkan::startRender() {
+    PROFILE_SCOPE("Vulkan::startRender");
+
     if (currentFrame >= MAX_FRAMES_IN_FLIGHT - 1) {
         currentFrame = 0;
     } else {
@@ -612,6 +666,11 @@ bool presentQueueTest(VkPhysicalDevice physicalDevice, uint32_t familyIndex,
 Queues::Queues(VkPhysicalDevice physicalDevice, Vulkan &vulkan)
     : graphicsQueue(graphicsQueueTest), presentQueue(presentQueueTest) {
 
+    requiredQueues.push_back(&graphicsQueue);
+    if (!vulkan.isHeadless()) {
+        requiredQueues.push_back(&presentQueue);
+    }
+
     uint32_t queueFamilyCount = 0;
     vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount,
                                              nullptr);
@@ -622,7 +681,7 @@ Queues::Queues(VkPhysicalDevice physicalDevice, Vulkan &vulkan)
 
     for (std::size_t index = 0; index < queueFamilyCount; index++) {
 
-        for (auto *queue : {&graphicsQueue, &presentQueue}) {
+        for (auto *queue : requiredQueues) {
             if (!queue->isSuitable(physicalDevice, index, vulkan,
                                    properties[index])) {
                 continue;
@@ -640,7 +699,7 @@ Queues::Queues(VkPhysicalDevice physicalDevice, Vulkan &vulkan)
 Queues::~Queues() = default;
 
 void Queues::storeHandles(VkDevice device) {
-    for (auto *queue : {&graphicsQueue, &presentQueue}) {
+    for (auto *queue : requiredQueues) {
         vkGetDeviceQueue(device, queue->getFamilyIndex(), 0, &queue->vk);
     }
 }
@@ -652,7 +711,7 @@ Queues::requestCreation(VkDeviceCreateInfo &createInfo) const {
     result->priority = 1.0F;
 
     std::unordered_set<uint32_t> uniqueQueues;
-    for (const auto *queue : {&graphicsQueue, &presentQueue}) {
+    for (const auto *queue : requiredQueues) {
         uniqueQueues.insert(queue->getFamilyIndex());
     }
 
@@ -674,7 +733,7 @@ Queues::requestCreation(VkDeviceCreateInfo &createInfo) const {
 }
 
 bool Queues::isComplete() const {
-    for (const auto *queue : {&graphicsQueue, &presentQueue}) {
+    for (const auto *queue : requiredQueues) {
         if (!queue->familyIndex.has_value()) {
             return false;
         }
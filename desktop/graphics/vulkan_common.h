@@ -59,15 +59,46 @@ class VkObjectWrapper : private progressia::main::NonCopyable {
 
 constexpr std::size_t MAX_FRAMES_IN_FLIGHT = 2;
 
+/*
+ * Settings that control how rendered frames are presented.
+ */
+struct PresentSettings {
+    /*
+     * Preferred present mode. FIFO is used if this mode is not supported.
+     */
+    VkPresentModeKHR mode = VK_PRESENT_MODE_MAILBOX_KHR;
+
+    /*
+     * Preferred number of swap chain images, clamped to surface limits.
+     * 0 selects one image more than the minimum.
+     */
+    uint32_t imageCount = 0;
+
+    /*
+     * Render into offscreen images instead of a window surface. Neither a
+     * window nor a present-capable queue is required.
+     */
+    bool headless = false;
+
+    /*
+     * Size of offscreen images in headless mode.
+     */
+    VkExtent2D headlessExtent = {800, 800};
+};
+
 class VulkanErrorHandler;
 class PhysicalDevice;
 class Surface;
 class Queue;
 class Queues;
 class CommandPool;
+class CommandRecorder;
+class GpuProfiler;
 class RenderPass;
 class Pipeline;
 class SwapChain;
+class FrameCapture;
+class GpuCulling;
 class TextureDescriptors;
 class Adapter;
 class Frame;
@@ -76,15 +107,20 @@ class Vulkan : public VkObjectWrapper {
   private:
     VkInstance instance = VK_NULL_HANDLE;
     VkDevice device = VK_NULL_HANDLE;
+    bool headless;
 
     std::unique_ptr<VulkanErrorHandler> errorHandler;
     std::unique_ptr<PhysicalDevice> physicalDevice;
     std::unique_ptr<Surface> surface;
     std::unique_ptr<Queues> queues;
+    std::unique_ptr<GpuProfiler> gpuProfiler;
     std::unique_ptr<CommandPool> commandPool;
+    std::unique_ptr<CommandRecorder> commandRecorder;
     std::unique_ptr<RenderPass> renderPass;
     std::unique_ptr<Pipeline> pipeline;
     std::unique_ptr<SwapChain> swapChain;
+    std::unique_ptr<FrameCapture> frameCapture;
+    std::unique_ptr<GpuCulling> gpuCulling;
     std::unique_ptr<TextureDescriptors> textureDescriptors;
     std::unique_ptr<Adapter> adapter;
 
@@ -98,22 +134,37 @@ class Vulkan : public VkObjectWrapper {
   public:
     Vulkan(std::vector<const char *> instanceExtensions,
            std::vector<const char *> deviceExtensions,
-           std::vector<const char *> validationLayers);
+           std::vector<const char *> validationLayers,
+           const PresentSettings &presentSettings);
 
     ~Vulkan();
 
     VkInstance getInstance() const;
     VkDevice getDevice() const;
 
+    /*
+     * Returns true if frames are rendered into offscreen images and there is
+     * no Surface.
+     */
+    bool isHeadless() const;
+
     const PhysicalDevice &getPhysicalDevice() const;
     Surface &getSurface();
     const Surface &getSurface() const;
     Queues &getQueues();
     const Queues &getQueues() const;
+    GpuProfiler &getGpuProfiler();
+    const GpuProfiler &getGpuProfiler() const;
     SwapChain &getSwapChain();
     const SwapChain &getSwapChain() const;
+    FrameCapture &getFrameCapture();
+    const FrameCapture &getFrameCapture() const;
+    GpuCulling &getGpuCulling();
+    const GpuCulling &getGpuCulling() const;
     CommandPool &getCommandPool();
     const CommandPool &getCommandPool() const;
+    CommandRecorder &getCommandRecorder();
+    const CommandRecorder &getCommandRecorder() const;
     RenderPass &getRenderPass();
     const RenderPass &getRenderPass() const;
     Pipeline &getPipeline();
@@ -239,11 +290,14 @@ class Queue {
     void waitIdle() const;
 };
 
-class Queues {
+class Queues : private progressia::main::NonCopyable {
   private:
     Queue graphicsQueue;
     Queue presentQueue;
 
+    // Present queue is not required in headless mode
+    std::vector<Queue *> requiredQueues;
+
   public:
     Queues(VkPhysicalDevice physicalDevice, Vulkan &vulkan);
     ~Queues();
@@ -261,6 +315,10 @@ class Queues {
     requestCreation(VkDeviceCreateInfo &) const;
 
     const Queue &getGraphicsQueue() const;
+
+    /*
+     * Not available in headless mode.
+     */
     const Queue &getPresentQueue() const;
 };
 
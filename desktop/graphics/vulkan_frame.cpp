@@ -1,18 +1,26 @@
 #include "vulkan_frame.h"
 
+#include <algorithm>
 #include <limits>
 
 #include "vulkan_adapter.h"
+#include "vulkan_command_recorder.h"
 #include "vulkan_common.h"
+#include "vulkan_frame_capture.h"
+#include "vulkan_gpu_culling.h"
 #include "vulkan_pipeline.h"
 #include "vulkan_render_pass.h"
 #include "vulkan_swap_chain.h"
 
+#include "../../main/profiler.h"
+
 namespace progressia::desktop {
 
 Frame::Frame(Vulkan &vulkan)
     : vulkan(vulkan), commandBuffer(vulkan.getCommandPool().allocateMultiUse()),
-      imageAvailableSemaphore(), renderFinishedSemaphore(), inFlightFence() {
+      imageAvailableSemaphore(), renderFinishedSemaphore(), inFlightFence(),
+      acquireWait(0), timestamps(vulkan.getGpuProfiler()),
+      frameScope(GpuProfiler::FrameQueries::NO_SCOPE) {
 
     VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -34,10 +42,20 @@ Frame::Frame(Vulkan &vulkan)
     for (const auto &attachment : vulkan.getAdapter().getAttachments()) {
         clearValues.push_back(attachment.clearValue);
     }
+
+    std::size_t threadCount = vulkan.getCommandRecorder().getThreadCount();
+    for (std::size_t i = 0; i < threadCount; i++) {
+        secondaryPools.push_back(std::make_unique<SecondaryCommandPool>(
+            vulkan, vulkan.getQueues().getGraphicsQueue()));
+    }
+
+    boundDescriptorSets.resize(vulkan.getAdapter().getUsedDSLayouts().size(),
+                               VK_NULL_HANDLE);
 }
 
 Frame::~Frame() {
     vulkan.waitIdle();
+    secondaryPools.clear();
     vkDestroySemaphore(vulkan.getDevice(), imageAvailableSemaphore, nullptr);
     vkDestroySemaphore(vulkan.getDevice(), renderFinishedSemaphore, nullptr);
     vkDestroyFence(vulkan.getDevice(), inFlightFence, nullptr);
@@ -46,12 +64,60 @@ Frame::~Frame() {
 bool Frame::startRender() {
     // Wait for frame
     vkWaitForFences(vulkan.getDevice(), 1, &inFlightFence, VK_TRUE, UINT64_MAX);
+    vulkan.getSwapChain().releaseRetired();
+    timestamps.collect();
+    vulkan.getFrameCapture().collect(vulkan.getFrameInFlightIndex());
+    vulkan.getGpuCulling().collect(vulkan.getFrameInFlightIndex());
 
     // Acquire an image
+    if (vulkan.isHeadless()) {
+        // Each frame slot owns an offscreen image guarded by its fence
+        imageIndexInFlight =
+            static_cast<uint32_t>(vulkan.getFrameInFlightIndex());
+        acquiredAt = std::chrono::steady_clock::now();
+        acquireWait = 0;
+    } else if (!acquireImage()) {
+        return false;
+    }
+
+    vulkan.getAdapter().onPreFrame();
+
+    // Reset command buffers
+    vkResetCommandBuffer(commandBuffer, 0);
+
+    for (auto &pool : secondaryPools) {
+        pool->reset();
+    }
+    secondaryBuffers.clear();
+    std::fill(boundDescriptorSets.begin(), boundDescriptorSets.end(),
+              VK_NULL_HANDLE);
+
+    // Setup command buffer
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    vulkan.handleVkResult("Could not begin recording command buffer",
+                          vkBeginCommandBuffer(commandBuffer, &beginInfo));
+
+    timestamps.reset(commandBuffer);
+    frameScope = timestamps.allocateScope("frame");
+    timestamps.writeBegin(commandBuffer, frameScope);
+
+    // Render pass is begun in endRender() once all secondary command buffers
+    // are known
+
+    return true;
+}
+
+bool Frame::acquireImage() {
     imageIndexInFlight = 0;
+    auto acquireStart = std::chrono::steady_clock::now();
     VkResult result = vkAcquireNextImageKHR(
         vulkan.getDevice(), vulkan.getSwapChain().getVk(), UINT64_MAX,
         imageAvailableSemaphore, VK_NULL_HANDLE, &*imageIndexInFlight);
+    acquiredAt = std::chrono::steady_clock::now();
+    acquireWait =
+        std::chrono::duration<double>(acquiredAt - acquireStart).count();
 
     switch (result) {
     case VK_ERROR_OUT_OF_DATE_KHR:
@@ -66,56 +132,54 @@ bool Frame::startRender() {
         break;
     }
 
-    vulkan.getAdapter().onPreFrame();
-
-    // Reset command buffer
-    vkResetCommandBuffer(commandBuffer, 0);
-
-    // Setup command buffer
-
-    VkCommandBufferBeginInfo beginInfo{};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    vulkan.handleVkResult("Could not begin recording command buffer",
-                          vkBeginCommandBuffer(commandBuffer, &beginInfo));
+    return true;
+}
 
-    auto extent = vulkan.getSwapChain().getExtent();
+void Frame::endRender() {
+    PROFILE_SCOPE("Frame::endRender");
 
+    // Execute render pass
     VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassInfo.renderPass = vulkan.getRenderPass().getVk();
     renderPassInfo.framebuffer =
         vulkan.getSwapChain().getFramebuffer(*imageIndexInFlight);
     renderPassInfo.renderArea.offset = {0, 0};
-    renderPassInfo.renderArea.extent = extent;
+    renderPassInfo.renderArea.extent = vulkan.getSwapChain().getExtent();
     renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
     renderPassInfo.pClearValues = clearValues.data();
 
+    // Draws of the render pass read commands written by the dispatch
+    auto &gpuCulling = vulkan.getGpuCulling();
+    if (gpuCulling.hasWork()) {
+        uint32_t cullingScope = timestamps.allocateScope("gpu culling");
+        timestamps.writeBegin(commandBuffer, cullingScope);
+        gpuCulling.recordDispatch(commandBuffer);
+        timestamps.writeEnd(commandBuffer, cullingScope);
+    }
+
+    uint32_t renderPassScope = timestamps.allocateScope("render pass");
+    timestamps.writeBegin(commandBuffer, renderPassScope);
+
     vkCmdBeginRenderPass(commandBuffer, &renderPassInfo,
-                         VK_SUBPASS_CONTENTS_INLINE);
+                         VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                      vulkan.getPipeline().getVk());
+    if (!secondaryBuffers.empty()) {
+        vkCmdExecuteCommands(commandBuffer,
+                             static_cast<uint32_t>(secondaryBuffers.size()),
+                             secondaryBuffers.data());
+    }
 
-    VkViewport viewport{};
-    viewport.x = 0.0F;
-    viewport.y = 0.0F;
-    viewport.width = (float)extent.width;
-    viewport.height = (float)extent.height;
-    viewport.minDepth = 0.0F;
-    viewport.maxDepth = 1.0F;
-    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdEndRenderPass(commandBuffer);
 
-    VkRect2D scissor{};
-    scissor.offset = {0, 0};
-    scissor.extent = extent;
-    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    timestamps.writeEnd(commandBuffer, renderPassScope);
 
-    return true;
-}
+    vulkan.getFrameCapture().recordCopy(
+        commandBuffer, vulkan.getFrameInFlightIndex(), *imageIndexInFlight);
+
+    timestamps.writeEnd(commandBuffer, frameScope);
 
-void Frame::endRender() {
     // End command buffer
-    vkCmdEndRenderPass(commandBuffer);
 
     vulkan.handleVkResult("Could not end recording command buffer",
                           vkEndCommandBuffer(commandBuffer));
@@ -127,22 +191,31 @@ void Frame::endRender() {
     VkSemaphore waitSemaphores[] = {imageAvailableSemaphore};
     VkPipelineStageFlags waitStages[] = {
         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
+    VkSemaphore signalSemaphores[] = {renderFinishedSemaphore};
+
+    // Offscreen images are not acquired or presented
+    if (!vulkan.isHeadless()) {
+        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.pWaitSemaphores = waitSemaphores;
+        submitInfo.pWaitDstStageMask = waitStages;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = signalSemaphores;
+    }
+
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffer;
 
-    VkSemaphore signalSemaphores[] = {renderFinishedSemaphore};
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = signalSemaphores;
-
     vkResetFences(vulkan.getDevice(), 1, &inFlightFence);
     vulkan.handleVkResult(
         "Could not submit draw command buffer",
         vkQueueSubmit(vulkan.getQueues().getGraphicsQueue().getVk(), 1,
                       &submitInfo, inFlightFence));
 
+    if (vulkan.isHeadless()) {
+        imageIndexInFlight.reset();
+        return;
+    }
+
     // Present result
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -155,6 +228,11 @@ void Frame::endRender() {
     presentInfo.pSwapchains = swapChains;
     presentInfo.pImageIndices = &*imageIndexInFlight;
 
+    vulkan.getSwapChain().recordLatency(
+        acquireWait, std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - acquiredAt)
+                         .count());
+
     VkResult result = vkQueuePresentKHR(
         vulkan.getQueues().getPresentQueue().getVk(), &presentInfo);
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
@@ -169,4 +247,74 @@ void Frame::endRender() {
 
 VkCommandBuffer Frame::getCommandBuffer() { return commandBuffer; }
 
+void Frame::bindDescriptorSet(uint32_t setNumber, VkDescriptorSet set) {
+    boundDescriptorSets.at(setNumber) = set;
+}
+
+VkCommandBuffer Frame::beginSecondary(std::size_t threadIndex) {
+    VkCommandBuffer buffer = secondaryPools.at(threadIndex)->next();
+
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = vulkan.getRenderPass().getVk();
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer =
+        vulkan.getSwapChain().getFramebuffer(*imageIndexInFlight);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT |
+                      VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    vulkan.handleVkResult("Could not begin recording secondary command buffer",
+                          vkBeginCommandBuffer(buffer, &beginInfo));
+
+    // Secondary command buffers do not inherit state
+
+    vkCmdBindPipeline(buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                      vulkan.getPipeline().getVk());
+
+    auto extent = vulkan.getSwapChain().getExtent();
+
+    VkViewport viewport{};
+    viewport.x = 0.0F;
+    viewport.y = 0.0F;
+    viewport.width = (float)extent.width;
+    viewport.height = (float)extent.height;
+    viewport.minDepth = 0.0F;
+    viewport.maxDepth = 1.0F;
+    vkCmdSetViewport(buffer, 0, 1, &viewport);
+
+    VkRect2D scissor{};
+    scissor.offset = {0, 0};
+    scissor.extent = extent;
+    vkCmdSetScissor(buffer, 0, 1, &scissor);
+
+    auto *pipelineLayout = vulkan.getPipeline().getLayout();
+    for (std::size_t i = 0; i < boundDescriptorSets.size(); i++) {
+        if (boundDescriptorSets[i] == VK_NULL_HANDLE) {
+            continue;
+        }
+
+        vkCmdBindDescriptorSets(buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                pipelineLayout, static_cast<uint32_t>(i), 1,
+                                &boundDescriptorSets[i], 0, nullptr);
+    }
+
+    return buffer;
+}
+
+void Frame::endSecondary(VkCommandBuffer buffer) {
+    vulkan.handleVkResult("Could not end recording secondary command buffer",
+                          vkEndCommandBuffer(buffer));
+}
+
+GpuProfiler::FrameQueries &Frame::getTimestamps() { return timestamps; }
+
+void Frame::executeSecondaries(const std::vector<VkCommandBuffer> &buffers) {
+    secondaryBuffers.insert(secondaryBuffers.end(), buffers.begin(),
+                            buffers.end());
+}
+
 } // namespace progressia::desktop
@@ -1,15 +1,25 @@
 #pragma once
 
+#include <chrono>
+
 #include "vulkan_common.h"
+#include "vulkan_gpu_profiler.h"
 
 namespace progressia::desktop {
 
+class SecondaryCommandPool;
+
 class Frame : public VkObjectWrapper {
   private:
     Vulkan &vulkan;
 
     VkCommandBuffer commandBuffer;
 
+    // One pool per recording thread
+    std::vector<std::unique_ptr<SecondaryCommandPool>> secondaryPools;
+    std::vector<VkCommandBuffer> secondaryBuffers;
+    std::vector<VkDescriptorSet> boundDescriptorSets;
+
     VkSemaphore imageAvailableSemaphore;
     VkSemaphore renderFinishedSemaphore;
     VkFence inFlightFence;
@@ -18,6 +28,14 @@ class Frame : public VkObjectWrapper {
 
     std::optional<uint32_t> imageIndexInFlight;
 
+    std::chrono::steady_clock::time_point acquiredAt;
+    double acquireWait;
+
+    GpuProfiler::FrameQueries timestamps;
+    uint32_t frameScope;
+
+    bool acquireImage();
+
   public:
     Frame(Vulkan &vulkan);
     ~Frame();
@@ -28,7 +46,33 @@ class Frame : public VkObjectWrapper {
     bool startRender();
     void endRender();
 
+    /*
+     * Returns the primary command buffer. Commands recorded into it are
+     * executed before the render pass.
+     */
     VkCommandBuffer getCommandBuffer();
+
+    /*
+     * Sets the descriptor set bound in secondary command buffers that are
+     * begun after this call.
+     */
+    void bindDescriptorSet(uint32_t setNumber, VkDescriptorSet);
+
+    /*
+     * Begins a secondary command buffer that continues the render pass with
+     * pipeline, viewport, scissor and bound descriptor sets already set.
+     * Thread-safe for distinct values of threadIndex.
+     */
+    VkCommandBuffer beginSecondary(std::size_t threadIndex);
+    void endSecondary(VkCommandBuffer);
+
+    /*
+     * Schedules secondary command buffers for execution inside the render
+     * pass, after all previously scheduled buffers.
+     */
+    void executeSecondaries(const std::vector<VkCommandBuffer> &);
+
+    GpuProfiler::FrameQueries &getTimestamps();
 };
 
 } // namespace progressia::desktop
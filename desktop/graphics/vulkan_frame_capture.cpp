@@ -0,0 +1,227 @@
+#include "vulkan_frame_capture.h"
+
+#include <cstring>
+
+#include "vulkan_swap_chain.h"
+
+#include "../../main/logging.h"
+#include "../../main/profiler.h"
+using namespace progressia::main::logging;
+
+namespace progressia::desktop {
+
+FrameCapture::FrameCapture(Vulkan &vulkan)
+    : slots(), workerBusy(false), shuttingDown(false), vulkan(vulkan) {
+
+    worker = std::thread([this]() { runWorker(); });
+}
+
+FrameCapture::~FrameCapture() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        shuttingDown = true;
+    }
+    workAvailable.notify_all();
+    worker.join();
+
+    for (const auto &slot : slots) {
+        if (!slot.callbacks.empty()) {
+            warn() << "Discarding a frame capture that was never collected";
+        }
+    }
+}
+
+bool FrameCapture::isSupported() const {
+    const auto &swapChain = vulkan.getSwapChain();
+    switch (swapChain.getColorFormat()) {
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_R8G8B8A8_UNORM:
+        return swapChain.isColorReadable();
+    default:
+        return false;
+    }
+}
+
+void FrameCapture::request(Callback callback) {
+    if (!isSupported()) {
+        warn("Frame capture is not supported by the swap chain, ignoring "
+             "request");
+        return;
+    }
+
+    requests.push_back(std::move(callback));
+}
+
+void FrameCapture::recordCopy(VkCommandBuffer commandBuffer,
+                              std::size_t frameIndex, uint32_t imageIndex) {
+    if (requests.empty()) {
+        return;
+    }
+
+    auto &slot = slots.at(frameIndex);
+    const auto &swapChain = vulkan.getSwapChain();
+
+    auto extent = swapChain.getExtent();
+    std::size_t size =
+        std::size_t(extent.width) * extent.height * BYTES_PER_PIXEL;
+
+    if (!slot.buffer || slot.buffer->getItemCount() != size) {
+        slot.buffer = std::make_unique<Buffer<Byte>>(
+            size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            vulkan);
+    }
+
+    slot.callbacks.insert(slot.callbacks.end(),
+                          std::make_move_iterator(requests.begin()),
+                          std::make_move_iterator(requests.end()));
+    requests.clear();
+
+    slot.extent = extent;
+    VkFormat format = swapChain.getColorFormat();
+    slot.swapRedBlue = format == VK_FORMAT_B8G8R8A8_SRGB ||
+                       format == VK_FORMAT_B8G8R8A8_UNORM;
+
+    VkImage image = swapChain.getColorImage(imageIndex);
+    VkImageLayout finalLayout = swapChain.getColorLayout();
+
+    // Wait for color attachment writes and move to a layout suitable for
+    // copying
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = finalLayout;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                         nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = {extent.width, extent.height, 1};
+
+    vkCmdCopyImageToBuffer(commandBuffer, image,
+                           VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           slot.buffer->buffer, 1, &region);
+
+    // Return the image to the layout expected by presentation
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = finalLayout;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.dstAccessMask = 0;
+
+    VkBufferMemoryBarrier hostBarrier{};
+    hostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostBarrier.buffer = slot.buffer->buffer;
+    hostBarrier.size = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(
+        commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0,
+        0, nullptr, 1, &hostBarrier, 1, &barrier);
+}
+
+void FrameCapture::collect(std::size_t frameIndex) {
+    auto &slot = slots.at(frameIndex);
+    if (slot.callbacks.empty()) {
+        return;
+    }
+
+    PROFILE_SCOPE("FrameCapture::collect");
+
+    Job job{{slot.extent.width, slot.extent.height,
+             std::vector<Byte>(slot.buffer->getItemCount())},
+            std::move(slot.callbacks),
+            slot.swapRedBlue};
+    slot.callbacks.clear();
+
+    std::memcpy(job.image.data.data(), slot.buffer->map(),
+                job.image.data.size());
+    slot.buffer->unmap();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    workAvailable.notify_one();
+}
+
+void FrameCapture::finish() {
+    vulkan.waitIdle();
+
+    for (std::size_t i = 0; i < slots.size(); i++) {
+        collect(i);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    workDone.wait(lock, [&]() { return jobs.empty() && !workerBusy; });
+}
+
+void FrameCapture::runWorker() {
+    progressia::main::profiler::setThreadName("Frame capture");
+
+    while (true) {
+        Job job{};
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workAvailable.wait(
+                lock, [&]() { return shuttingDown || !jobs.empty(); });
+
+            // Deliver collected frames before shutting down
+            if (jobs.empty()) {
+                return;
+            }
+
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            workerBusy = true;
+        }
+
+        {
+            PROFILE_SCOPE("FrameCapture::deliver");
+
+            // Swap chains typically use BGRA while Image is RGBA
+            if (job.swapRedBlue) {
+                auto &data = job.image.data;
+                for (std::size_t i = 0; i + BYTES_PER_PIXEL <= data.size();
+                     i += BYTES_PER_PIXEL) {
+                    std::swap(data[i], data[i + 2]);
+                }
+            }
+
+            for (std::size_t i = 0; i < job.callbacks.size(); i++) {
+                if (i + 1 == job.callbacks.size()) {
+                    job.callbacks[i](std::move(job.image));
+                } else {
+                    job.callbacks[i](progressia::main::Image(job.image));
+                }
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            workerBusy = false;
+        }
+        workDone.notify_all();
+    }
+}
+
+} // namespace progressia::desktop
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "vulkan_buffer.h"
+#include "vulkan_common.h"
+
+#include "../../main/rendering/image.h"
+
+namespace progressia::desktop {
+
+/*
+ * Copies rendered frames into host memory without stalling the pipeline.
+ *
+ * The copy is recorded into the frame's own command buffer after the render
+ * pass. Data is read once the frame's fence is signaled, which Frame waits
+ * for anyway, and callbacks run on a background thread.
+ */
+class FrameCapture : public VkObjectWrapper {
+  public:
+    /*
+     * Receives the captured frame as RGBA. Called on the capture thread.
+     */
+    using Callback = std::function<void(progressia::main::Image &&)>;
+
+  private:
+    using Byte = progressia::main::Image::Byte;
+    constexpr static std::size_t BYTES_PER_PIXEL = 4;
+
+    // Copy recorded in a frame in flight
+    struct Slot {
+        std::unique_ptr<Buffer<Byte>> buffer;
+        std::vector<Callback> callbacks;
+        VkExtent2D extent;
+        bool swapRedBlue;
+    };
+
+    struct Job {
+        progressia::main::Image image;
+        std::vector<Callback> callbacks;
+        bool swapRedBlue;
+    };
+
+    std::array<Slot, MAX_FRAMES_IN_FLIGHT> slots;
+    std::vector<Callback> requests;
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable workDone;
+    std::deque<Job> jobs;
+    bool workerBusy;
+    bool shuttingDown;
+
+    Vulkan &vulkan;
+
+    void runWorker();
+
+  public:
+    FrameCapture(Vulkan &vulkan);
+
+    /*
+     * Runs callbacks of collected frames. Frames that have not been collected
+     * are discarded.
+     */
+    ~FrameCapture();
+
+    /*
+     * Returns false if color images cannot be read, in which case requests
+     * are ignored.
+     */
+    bool isSupported() const;
+
+    /*
+     * Captures the frame that is being rendered, or the next frame if none
+     * is. May only be called on the rendering thread.
+     */
+    void request(Callback);
+
+    /*
+     * Records the copy of the color image into commandBuffer if a capture
+     * was requested. Called by Frame after the render pass.
+     */
+    void recordCopy(VkCommandBuffer commandBuffer, std::size_t frameIndex,
+                    uint32_t imageIndex);
+
+    /*
+     * Hands the copy made by frameIndex to the capture thread. Called by
+     * Frame after waiting for its fence.
+     */
+    void collect(std::size_t frameIndex);
+
+    /*
+     * Waits for the device to become idle and for the callbacks of all
+     * recorded captures to return.
+     */
+    void finish();
+};
+
+} // namespace progressia::desktop
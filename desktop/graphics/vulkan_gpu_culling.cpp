@@ -0,0 +1,341 @@
+#include "vulkan_gpu_culling.h"
+
+#include <algorithm>
+
+#include "vulkan_adapter.h"
+#include "vulkan_physical_device.h"
+
+#include "../../main/logging.h"
+#include "../../main/profiler.h"
+
+namespace progressia::desktop {
+
+namespace {
+
+constexpr uint32_t BINDING_COUNT = 4;
+
+bool canRunCompute(Vulkan &vulkan) {
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(
+        vulkan.getPhysicalDevice().getVk(), &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(
+        vulkan.getPhysicalDevice().getVk(), &familyCount, families.data());
+
+    auto family = vulkan.getQueues().getGraphicsQueue().getFamilyIndex();
+    return (families.at(family).queueFlags & VK_QUEUE_COMPUTE_BIT) != 0;
+}
+
+} // namespace
+
+GpuCulling::GpuCulling(Vulkan &vulkan)
+    : supported(canRunCompute(vulkan)), descriptorSetLayout(VK_NULL_HANDLE),
+      descriptorPool(VK_NULL_HANDLE), pipelineLayout(VK_NULL_HANDLE),
+      pipeline(VK_NULL_HANDLE), current(nullptr), lastStats{0, 0},
+      vulkan(vulkan) {
+
+    static_assert(sizeof(Object) == 112, "Object must match std430 layout");
+
+    if (!supported) {
+        progressia::main::logging::warn()
+            << "Graphics queue does not support compute, GPU culling is "
+               "not available";
+        return;
+    }
+
+    // Descriptor set layout: objects, views, commands, visible count
+
+    std::array<VkDescriptorSetLayoutBinding, BINDING_COUNT> bindings{};
+    for (uint32_t i = 0; i < BINDING_COUNT; i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = BINDING_COUNT;
+    layoutInfo.pBindings = bindings.data();
+
+    vulkan.handleVkResult("Could not create culling descriptor set layout",
+                          vkCreateDescriptorSetLayout(vulkan.getDevice(),
+                                                      &layoutInfo, nullptr,
+                                                      &descriptorSetLayout));
+
+    // Descriptor pool
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = BINDING_COUNT * MAX_FRAMES_IN_FLIGHT;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = MAX_FRAMES_IN_FLIGHT;
+
+    vulkan.handleVkResult("Could not create culling descriptor pool",
+                          vkCreateDescriptorPool(vulkan.getDevice(), &poolInfo,
+                                                 nullptr, &descriptorPool));
+
+    // Pipeline
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(uint32_t);
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    vulkan.handleVkResult("Could not create culling pipeline layout",
+                          vkCreatePipelineLayout(vulkan.getDevice(),
+                                                 &pipelineLayoutInfo, nullptr,
+                                                 &pipelineLayout));
+
+    auto bytecode = vulkan.getAdapter().loadCullingShader();
+
+    VkShaderModuleCreateInfo shaderInfo{};
+    shaderInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shaderInfo.codeSize = bytecode.size();
+    shaderInfo.pCode = reinterpret_cast<const uint32_t *>(bytecode.data());
+
+    VkShaderModule shader = VK_NULL_HANDLE;
+    vulkan.handleVkResult("Could not load culling shader",
+                          vkCreateShaderModule(vulkan.getDevice(), &shaderInfo,
+                                               nullptr, &shader));
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType =
+        VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shader;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = pipelineLayout;
+
+    vulkan.handleVkResult(
+        "Could not create culling pipeline",
+        vkCreateComputePipelines(vulkan.getDevice(), VK_NULL_HANDLE, 1,
+                                 &pipelineInfo, nullptr, &pipeline));
+
+    vkDestroyShaderModule(vulkan.getDevice(), shader, nullptr);
+
+    // Buffers
+
+    for (auto &slot : slots) {
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = descriptorPool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &descriptorSetLayout;
+
+        vulkan.handleVkResult("Could not allocate culling descriptor set",
+                              vkAllocateDescriptorSets(vulkan.getDevice(),
+                                                       &allocInfo,
+                                                       &slot.descriptorSet));
+
+        allocate(slot, INITIAL_OBJECTS, INITIAL_VIEWS);
+    }
+}
+
+GpuCulling::~GpuCulling() {
+    for (auto &slot : slots) {
+        release(slot);
+    }
+
+    if (pipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(vulkan.getDevice(), pipeline, nullptr);
+        vkDestroyPipelineLayout(vulkan.getDevice(), pipelineLayout, nullptr);
+        vkDestroyDescriptorPool(vulkan.getDevice(), descriptorPool, nullptr);
+        vkDestroyDescriptorSetLayout(vulkan.getDevice(), descriptorSetLayout,
+                                     nullptr);
+    }
+}
+
+void GpuCulling::allocate(Slot &slot, std::size_t objectCapacity,
+                          std::size_t viewCapacity) {
+    release(slot);
+
+    constexpr auto HOST_MEMORY = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                 VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    slot.objects = std::make_unique<Buffer<Object>>(
+        objectCapacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, HOST_MEMORY,
+        vulkan);
+    slot.views = std::make_unique<Buffer<Planes>>(
+        viewCapacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, HOST_MEMORY, vulkan);
+    slot.commands = std::make_unique<Buffer<VkDrawIndexedIndirectCommand>>(
+        objectCapacity,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vulkan);
+    slot.visibleCount = std::make_unique<Buffer<uint32_t>>(
+        1, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, HOST_MEMORY, vulkan);
+
+    // Host-visible buffers stay mapped for their whole lifetime
+    slot.mappedObjects = static_cast<Object *>(slot.objects->map());
+    slot.mappedViews = static_cast<Planes *>(slot.views->map());
+    slot.mappedVisibleCount =
+        static_cast<uint32_t *>(slot.visibleCount->map());
+    *slot.mappedVisibleCount = 0;
+
+    std::array<VkDescriptorBufferInfo, BINDING_COUNT> bufferInfos{};
+    bufferInfos[0] = {slot.objects->buffer, 0, slot.objects->getSize()};
+    bufferInfos[1] = {slot.views->buffer, 0, slot.views->getSize()};
+    bufferInfos[2] = {slot.commands->buffer, 0, slot.commands->getSize()};
+    bufferInfos[3] = {slot.visibleCount->buffer, 0,
+                      slot.visibleCount->getSize()};
+
+    std::array<VkWriteDescriptorSet, BINDING_COUNT> writes{};
+    for (uint32_t i = 0; i < BINDING_COUNT; i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = slot.descriptorSet;
+        writes[i].dstBinding = i;
+        writes[i].dstArrayElement = 0;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].descriptorCount = 1;
+        writes[i].pBufferInfo = &bufferInfos[i];
+    }
+
+    vkUpdateDescriptorSets(vulkan.getDevice(), BINDING_COUNT, writes.data(), 0,
+                           nullptr);
+}
+
+void GpuCulling::release(Slot &slot) {
+    if (slot.objects) {
+        slot.objects->unmap();
+        slot.views->unmap();
+        slot.visibleCount->unmap();
+    }
+
+    slot.objects.reset();
+    slot.views.reset();
+    slot.commands.reset();
+    slot.visibleCount.reset();
+
+    slot.mappedObjects = nullptr;
+    slot.mappedViews = nullptr;
+    slot.mappedVisibleCount = nullptr;
+}
+
+bool GpuCulling::isSupported() const { return supported; }
+
+void GpuCulling::collect(std::size_t frameIndex) {
+    Slot &slot = slots.at(frameIndex);
+    current = &slot;
+
+    if (!supported) {
+        return;
+    }
+
+    if (slot.pending) {
+        auto visible = static_cast<uint64_t>(*slot.mappedVisibleCount);
+        lastStats = {visible, slot.objectCount - visible};
+        slot.pending = false;
+    }
+
+    // The device no longer uses the buffers of this slot
+    std::size_t objectCapacity = slot.objects->getItemCount();
+    std::size_t viewCapacity = slot.views->getItemCount();
+    if (slot.objectDemand > objectCapacity ||
+        slot.viewDemand > viewCapacity) {
+        allocate(slot,
+                 std::max(slot.objectDemand, objectCapacity +
+                                                 objectCapacity / 2),
+                 std::max(slot.viewDemand, viewCapacity + viewCapacity / 2));
+    }
+
+    *slot.mappedVisibleCount = 0;
+    slot.objectCount = 0;
+    slot.viewCount = 0;
+    slot.objectDemand = 0;
+    slot.viewDemand = 0;
+}
+
+bool GpuCulling::beginBatch(const progressia::main::Frustum &frustum,
+                            std::size_t objectCount) {
+    Slot &slot = *current;
+
+    std::size_t objectsNeeded = slot.objectCount + objectCount;
+    std::size_t viewsNeeded = slot.viewCount + 1;
+    slot.objectDemand = std::max(slot.objectDemand, objectsNeeded);
+    slot.viewDemand = std::max(slot.viewDemand, viewsNeeded);
+
+    if (objectsNeeded > slot.objects->getItemCount() ||
+        viewsNeeded > slot.views->getItemCount()) {
+        return false;
+    }
+
+    slot.mappedViews[slot.viewCount++] = frustum.getPlanes();
+    return true;
+}
+
+VkDeviceSize GpuCulling::addObject(const progressia::main::BoundingBox &bounds,
+                                   const glm::mat4 &model,
+                                   uint32_t indexCount) {
+    Slot &slot = *current;
+    std::size_t index = slot.objectCount++;
+
+    slot.mappedObjects[index] = {glm::vec4(bounds.min, 1),
+                                 glm::vec4(bounds.max, 1),
+                                 model,
+                                 indexCount,
+                                 static_cast<uint32_t>(slot.viewCount - 1),
+                                 {}};
+
+    return index * sizeof(VkDrawIndexedIndirectCommand);
+}
+
+VkBuffer GpuCulling::getIndirectBuffer() const {
+    return current->commands->buffer;
+}
+
+bool GpuCulling::hasWork() const {
+    return current != nullptr && current->objectCount != 0;
+}
+
+void GpuCulling::recordDispatch(VkCommandBuffer commandBuffer) {
+    PROFILE_SCOPE("GpuCulling::recordDispatch");
+
+    if (!hasWork()) {
+        return;
+    }
+
+    Slot &slot = *current;
+
+    auto objectCount = static_cast<uint32_t>(slot.objectCount);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                            pipelineLayout, 0, 1, &slot.descriptorSet, 0,
+                            nullptr);
+    vkCmdPushConstants(commandBuffer, pipelineLayout,
+                       VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(objectCount),
+                       &objectCount);
+    vkCmdDispatch(commandBuffer, (objectCount + GROUP_SIZE - 1) / GROUP_SIZE,
+                  1, 1);
+
+    // Commands are read by indirect draws, the visible count by the host
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask =
+        VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+                             VK_PIPELINE_STAGE_HOST_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    slot.pending = true;
+}
+
+GpuCulling::Stats GpuCulling::getLastStats() const { return lastStats; }
+
+} // namespace progressia::desktop
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <array>
+#include <memory>
+
+#include "vulkan_buffer.h"
+#include "vulkan_common.h"
+
+#include "../../main/rendering/culling.h"
+
+namespace progressia::desktop {
+
+/*
+ * Tests bounds of draw requests against view frustums in a compute shader
+ * and writes one indirect draw command per request. Commands of requests
+ * outside of their frustum have instanceCount set to 0.
+ *
+ * Objects are written into host-visible buffers while draws are flushed.
+ * The dispatch is recorded into the frame's primary command buffer before
+ * the render pass, so draws may reference their commands before the
+ * dispatch is recorded.
+ *
+ * Buffers have a fixed capacity within a frame. Batches that do not fit are
+ * refused, and the buffers of the frame slot grow before its next frame.
+ */
+class GpuCulling : public VkObjectWrapper {
+  public:
+    /*
+     * Draw requests of a completed frame that were drawn or skipped.
+     */
+    struct Stats {
+        uint64_t visible;
+        uint64_t culled;
+    };
+
+  private:
+    // Matches struct Object in cull.comp, std430 layout
+    struct Object {
+        glm::vec4 boundsMin;
+        glm::vec4 boundsMax;
+        glm::mat4 model;
+        uint32_t indexCount;
+        uint32_t view;
+        std::array<uint32_t, 2> padding;
+    };
+
+    using Planes = std::array<glm::vec4, 6>;
+
+    constexpr static uint32_t GROUP_SIZE = 64;
+    constexpr static std::size_t INITIAL_OBJECTS = 4096;
+    constexpr static std::size_t INITIAL_VIEWS = 64;
+
+    // Buffers of a frame in flight
+    struct Slot {
+        std::unique_ptr<Buffer<Object>> objects;
+        std::unique_ptr<Buffer<Planes>> views;
+        std::unique_ptr<Buffer<VkDrawIndexedIndirectCommand>> commands;
+        std::unique_ptr<Buffer<uint32_t>> visibleCount;
+
+        Object *mappedObjects = nullptr;
+        Planes *mappedViews = nullptr;
+        uint32_t *mappedVisibleCount = nullptr;
+
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+        std::size_t objectCount = 0;
+        std::size_t viewCount = 0;
+
+        // Largest counts requested this frame, including refused batches
+        std::size_t objectDemand = 0;
+        std::size_t viewDemand = 0;
+
+        bool pending = false;
+    };
+
+    bool supported;
+
+    VkDescriptorSetLayout descriptorSetLayout;
+    VkDescriptorPool descriptorPool;
+    VkPipelineLayout pipelineLayout;
+    VkPipeline pipeline;
+
+    std::array<Slot, MAX_FRAMES_IN_FLIGHT> slots;
+    Slot *current;
+
+    Stats lastStats;
+
+    Vulkan &vulkan;
+
+    void allocate(Slot &, std::size_t objectCapacity,
+                  std::size_t viewCapacity);
+    void release(Slot &);
+
+  public:
+    GpuCulling(Vulkan &);
+    ~GpuCulling();
+
+    /*
+     * Returns false if the graphics queue cannot run compute shaders, in
+     * which case no other methods may be called.
+     */
+    bool isSupported() const;
+
+    /*
+     * Reads back results of the previous frame in frameIndex, grows its
+     * buffers if needed and makes it current. Called by Frame after waiting
+     * for its fence.
+     */
+    void collect(std::size_t frameIndex);
+
+    /*
+     * Reserves space for objectCount objects tested against frustum.
+     * Returns false if the current frame has no space left; no objects may
+     * be added then.
+     */
+    bool beginBatch(const progressia::main::Frustum &frustum,
+                    std::size_t objectCount);
+
+    /*
+     * Adds an object to the last batch and returns the offset of its draw
+     * command in getIndirectBuffer().
+     */
+    VkDeviceSize addObject(const progressia::main::BoundingBox &,
+                           const glm::mat4 &model, uint32_t indexCount);
+
+    VkBuffer getIndirectBuffer() const;
+
+    /*
+     * Returns true if objects were added in the current frame.
+     */
+    bool hasWork() const;
+
+    /*
+     * Records the culling dispatch and the barrier that makes its commands
+     * available to indirect draws. Must be recorded outside of a render
+     * pass.
+     */
+    void recordDispatch(VkCommandBuffer);
+
+    /*
+     * Returns counts of the latest frame that has completed on the device.
+     */
+    Stats getLastStats() const;
+};
+
+} // namespace progressia::desktop
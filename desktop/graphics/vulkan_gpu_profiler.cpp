@@ -0,0 +1,260 @@
+#include "vulkan_gpu_profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "vulkan_physical_device.h"
+
+#include "../../main/logging.h"
+using namespace progressia::main::logging;
+
+namespace progressia::desktop {
+
+namespace {
+
+VkQueryPool createTimestampPool(Vulkan &vulkan, uint32_t count) {
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = count;
+
+    VkQueryPool pool = VK_NULL_HANDLE;
+    vulkan.handleVkResult(
+        "Could not create timestamp query pool",
+        vkCreateQueryPool(vulkan.getDevice(), &poolInfo, nullptr, &pool));
+
+    return pool;
+}
+
+double percentile(const std::vector<double> &sorted, double fraction) {
+    auto index = static_cast<std::size_t>(
+        std::ceil(fraction * static_cast<double>(sorted.size())));
+    return sorted[std::clamp<std::size_t>(index, 1, sorted.size()) - 1];
+}
+
+} // namespace
+
+/*
+ * GpuProfiler::FrameQueries
+ */
+
+GpuProfiler::FrameQueries::FrameQueries(GpuProfiler &profiler)
+    : pool(VK_NULL_HANDLE), pending(false), profiler(profiler) {
+
+    if (profiler.isSupported()) {
+        pool = createTimestampPool(profiler.vulkan, QUERY_COUNT);
+    }
+}
+
+GpuProfiler::FrameQueries::~FrameQueries() {
+    if (pool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(profiler.vulkan.getDevice(), pool, nullptr);
+    }
+}
+
+void GpuProfiler::FrameQueries::collect() {
+    if (!pending) {
+        return;
+    }
+    pending = false;
+
+    if (!scopeNames.empty()) {
+        auto queryCount = static_cast<uint32_t>(scopeNames.size() * 2);
+        std::vector<uint64_t> results(queryCount);
+
+        // The fence has been signaled, so results do not need to be awaited
+        VkResult result = vkGetQueryPoolResults(
+            profiler.vulkan.getDevice(), pool, 0, queryCount,
+            results.size() * sizeof(uint64_t), results.data(),
+            sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+        if (result == VK_SUCCESS) {
+            for (std::size_t i = 0; i < scopeNames.size(); i++) {
+                profiler.addSample(scopeNames[i], results[i * 2],
+                                   results[i * 2 + 1]);
+            }
+        }
+    }
+
+    scopeNames.clear();
+    profiler.onFrameCollected();
+}
+
+void GpuProfiler::FrameQueries::reset(VkCommandBuffer commandBuffer) {
+    scopeNames.clear();
+
+    if (pool == VK_NULL_HANDLE) {
+        return;
+    }
+
+    vkCmdResetQueryPool(commandBuffer, pool, 0, QUERY_COUNT);
+    pending = true;
+}
+
+uint32_t GpuProfiler::FrameQueries::allocateScope(const char *name) {
+    if (pool == VK_NULL_HANDLE || (scopeNames.size() + 1) * 2 > QUERY_COUNT) {
+        return NO_SCOPE;
+    }
+
+    scopeNames.push_back(name);
+    return static_cast<uint32_t>(scopeNames.size() - 1);
+}
+
+void GpuProfiler::FrameQueries::writeBegin(VkCommandBuffer commandBuffer,
+                                           uint32_t scope) {
+    if (scope == NO_SCOPE) {
+        return;
+    }
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pool,
+                        scope * 2);
+}
+
+void GpuProfiler::FrameQueries::writeEnd(VkCommandBuffer commandBuffer,
+                                         uint32_t scope) {
+    if (scope == NO_SCOPE) {
+        return;
+    }
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                        pool, scope * 2 + 1);
+}
+
+/*
+ * GpuProfiler
+ */
+
+GpuProfiler::GpuProfiler(Vulkan &vulkan)
+    : supported(false), nsPerTick(0), validMask(0), uploadPool(VK_NULL_HANDLE),
+      collectedFrames(0), vulkan(vulkan) {
+
+    const auto &limits = vulkan.getPhysicalDevice().getLimits();
+
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(
+        vulkan.getPhysicalDevice().getVk(), &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(
+        vulkan.getPhysicalDevice().getVk(), &familyCount, families.data());
+
+    uint32_t validBits =
+        families.at(vulkan.getQueues().getGraphicsQueue().getFamilyIndex())
+            .timestampValidBits;
+
+    if (validBits == 0 || limits.timestampPeriod <= 0) {
+        info("GPU timestamps are not supported by graphics queue, GPU "
+             "profiling disabled");
+        return;
+    }
+
+    supported = true;
+    nsPerTick = limits.timestampPeriod;
+    validMask = validBits >= 64 ? UINT64_MAX : (uint64_t(1) << validBits) - 1;
+
+    uploadPool = createTimestampPool(vulkan, 2);
+}
+
+GpuProfiler::~GpuProfiler() {
+    if (uploadPool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(vulkan.getDevice(), uploadPool, nullptr);
+    }
+}
+
+bool GpuProfiler::isSupported() const { return supported; }
+
+void GpuProfiler::addSample(const char *name, uint64_t begin, uint64_t end) {
+    constexpr double NS_PER_MS = 1e6;
+    uint64_t ticks = (end - begin) & validMask;
+
+    auto &window = samples[name];
+    window.push_back(static_cast<double>(ticks) * nsPerTick / NS_PER_MS);
+    if (window.size() > WINDOW) {
+        window.pop_front();
+    }
+}
+
+void GpuProfiler::beginUpload(VkCommandBuffer commandBuffer) {
+    if (!supported) {
+        return;
+    }
+
+    vkCmdResetQueryPool(commandBuffer, uploadPool, 0, 2);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                        uploadPool, 0);
+}
+
+void GpuProfiler::endUpload(VkCommandBuffer commandBuffer) {
+    if (!supported) {
+        return;
+    }
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                        uploadPool, 1);
+}
+
+void GpuProfiler::collectUpload() {
+    if (!supported) {
+        return;
+    }
+
+    std::array<uint64_t, 2> results{};
+    VkResult result = vkGetQueryPoolResults(
+        vulkan.getDevice(), uploadPool, 0, 2, sizeof(results), results.data(),
+        sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+    if (result == VK_SUCCESS) {
+        addSample("upload", results[0], results[1]);
+    }
+}
+
+void GpuProfiler::onFrameCollected() {
+    collectedFrames++;
+    if (collectedFrames % LOG_INTERVAL == 0) {
+        logStats();
+    }
+}
+
+void GpuProfiler::logStats() const {
+    auto m = debug("GPU time, ms (avg / p50 / p95 / p99):");
+    for (const auto &name : getScopeNames()) {
+        auto stats = *getStats(name);
+        m << "\n\t" << name << ": " << stats.average << " / " << stats.p50
+          << " / " << stats.p95 << " / " << stats.p99;
+    }
+}
+
+std::vector<std::string> GpuProfiler::getScopeNames() const {
+    std::vector<std::string> result;
+    result.reserve(samples.size());
+    for (const auto &entry : samples) {
+        result.push_back(entry.first);
+    }
+    return result;
+}
+
+std::optional<GpuProfiler::Stats>
+GpuProfiler::getStats(const std::string &name) const {
+    auto it = samples.find(name);
+    if (it == samples.end() || it->second.empty()) {
+        return std::nullopt;
+    }
+
+    std::vector<double> sorted(it->second.begin(), it->second.end());
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0;
+    for (double sample : sorted) {
+        sum += sample;
+    }
+
+    constexpr double P50 = 0.50;
+    constexpr double P95 = 0.95;
+    constexpr double P99 = 0.99;
+
+    return Stats{sum / static_cast<double>(sorted.size()),
+                 percentile(sorted, P50), percentile(sorted, P95),
+                 percentile(sorted, P99), sorted.size()};
+}
+
+} // namespace progressia::desktop
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <deque>
+#include <map>
+#include <optional>
+#include <string>
+
+#include "vulkan_common.h"
+
+namespace progressia::desktop {
+
+/*
+ * Measures GPU execution time of named scopes using timestamp queries and
+ * keeps rolling statistics for each scope name.
+ */
+class GpuProfiler : public VkObjectWrapper {
+  public:
+    /*
+     * Rolling statistics of a scope, in milliseconds.
+     */
+    struct Stats {
+        double average;
+        double p50;
+        double p95;
+        double p99;
+        std::size_t samples;
+    };
+
+    /*
+     * Timestamp queries recorded during a single Frame. Results are read
+     * back after the frame's fence is signaled.
+     */
+    class FrameQueries : public VkObjectWrapper {
+      public:
+        constexpr static uint32_t NO_SCOPE = UINT32_MAX;
+
+      private:
+        constexpr static uint32_t QUERY_COUNT = 256;
+
+        VkQueryPool pool;
+        std::vector<const char *> scopeNames;
+        bool pending;
+
+        GpuProfiler &profiler;
+
+      public:
+        FrameQueries(GpuProfiler &);
+        ~FrameQueries();
+
+        /*
+         * Reads back results of the previous submission. The frame's fence
+         * must be signaled.
+         */
+        void collect();
+
+        /*
+         * Records a reset of all queries. Must be called outside of a render
+         * pass before any scopes are allocated.
+         */
+        void reset(VkCommandBuffer);
+
+        /*
+         * Reserves a pair of queries for a scope. name must be a string with
+         * static storage duration. Returns NO_SCOPE if no queries are left
+         * or timestamps are not supported.
+         */
+        uint32_t allocateScope(const char *name);
+
+        void writeBegin(VkCommandBuffer, uint32_t scope);
+        void writeEnd(VkCommandBuffer, uint32_t scope);
+    };
+
+  private:
+    constexpr static std::size_t WINDOW = 256;
+    constexpr static uint64_t LOG_INTERVAL = 600;
+
+    bool supported;
+    double nsPerTick;
+    uint64_t validMask;
+
+    // Uploads wait for completion, so a single query pair is enough
+    VkQueryPool uploadPool;
+
+    std::map<std::string, std::deque<double>> samples;
+    uint64_t collectedFrames;
+
+    Vulkan &vulkan;
+
+    void addSample(const char *name, uint64_t begin, uint64_t end);
+    void logStats() const;
+
+  public:
+    GpuProfiler(Vulkan &);
+    ~GpuProfiler();
+
+    bool isSupported() const;
+
+    /*
+     * Bracket the commands of a synchronous upload. collectUpload() must be
+     * called after the upload has completed.
+     */
+    void beginUpload(VkCommandBuffer);
+    void endUpload(VkCommandBuffer);
+    void collectUpload();
+
+    void onFrameCollected();
+
+    std::vector<std::string> getScopeNames() const;
+    std::optional<Stats> getStats(const std::string &name) const;
+};
+
+} // namespace progressia::desktop
@@ -6,9 +6,12 @@
 #include "vulkan_buffer.h"
 #include "vulkan_common.h"
 #include "vulkan_frame.h"
+#include "vulkan_gpu_profiler.h"
 #include "vulkan_pipeline.h"
 #include "vulkan_texture_descriptors.h"
 
+#include "../../main/profiler.h"
+
 namespace progressia::desktop {
 
 /*
@@ -146,6 +149,7 @@ Texture::Texture(const progressia::main::Image &src, Vulkan &vulkan)
                    VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
                    vulkan),
       sampler() {
+    PROFILE_SCOPE("Texture upload");
 
     /*
      * Create a staging buffer
@@ -173,6 +177,8 @@ Texture::Texture(const progressia::main::Image &src, Vulkan &vulkan)
                 VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT});
 
     VkCommandBuffer commandBuffer = vulkan.getCommandPool().beginSingleUse();
+    vulkan.getGpuProfiler().beginUpload(commandBuffer);
+
     VkBufferImageCopy region{};
     region.bufferOffset = 0;
     region.bufferRowLength = 0;
@@ -186,7 +192,10 @@ Texture::Texture(const progressia::main::Image &src, Vulkan &vulkan)
                           static_cast<uint32_t>(src.height), 1};
     vkCmdCopyBufferToImage(commandBuffer, stagingBuffer.buffer, vk,
                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    vulkan.getGpuProfiler().endUpload(commandBuffer);
     vulkan.getCommandPool().runSingleUse(commandBuffer, true);
+    vulkan.getGpuProfiler().collectUpload();
 
     transition({VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
                 VK_ACCESS_SHADER_READ_BIT,
@@ -231,9 +240,7 @@ Texture::~Texture() {
     // TODO free descriptorSet
 }
 
-void Texture::bind() {
-    // REPORT_ERROR if getCurrentFrame() == nullptr
-    auto *commandBuffer = vulkan.getCurrentFrame()->getCommandBuffer();
+void Texture::bind(VkCommandBuffer commandBuffer) {
     auto *pipelineLayout = vulkan.getPipeline().getLayout();
 
     vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -52,7 +52,7 @@ class Texture : public ManagedImage {
     Texture(const main::Image &src, Vulkan &vulkan);
     ~Texture();
 
-    void bind();
+    void bind(VkCommandBuffer);
 };
 
 } // namespace progressia::desktop
@@ -8,13 +8,14 @@ using namespace progressia::main::logging;
 
 namespace progressia::desktop {
 
-VulkanManager::VulkanManager() {
+VulkanManager::VulkanManager(const PresentSettings &presentSettings) {
     debug("Vulkan initializing");
 
     // Instance extensions
 
     std::vector<const char *> instanceExtensions;
-    {
+    // GLFW is not initialized in headless mode
+    if (!presentSettings.headless) {
         uint32_t glfwExtensionCount = 0;
         const char **glfwExtensions =
             glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
@@ -24,15 +25,18 @@ VulkanManager::VulkanManager() {
         for (std::size_t i = 0; i < glfwExtensionCount; i++) {
             instanceExtensions.emplace_back(glfwExtensions[i]);
         }
+    }
 
 #ifdef VULKAN_ERROR_CHECKING
-        instanceExtensions.emplace_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+    instanceExtensions.emplace_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 #endif
-    }
 
     // Device extensions
 
-    std::vector<const char *> deviceExtensions{VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+    std::vector<const char *> deviceExtensions;
+    if (!presentSettings.headless) {
+        deviceExtensions.emplace_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
 
     // Validation layers
 
@@ -43,7 +47,7 @@ VulkanManager::VulkanManager() {
     };
 
     vulkan = std::make_unique<Vulkan>(instanceExtensions, deviceExtensions,
-                                      validationLayers);
+                                      validationLayers, presentSettings);
 
     debug("Vulkan initialized");
 }
@@ -10,7 +10,7 @@ class VulkanManager {
     std::unique_ptr<Vulkan> vulkan;
 
   public:
-    VulkanManager();
+    VulkanManager(const PresentSettings &);
     ~VulkanManager();
 
     Vulkan *getVulkan();
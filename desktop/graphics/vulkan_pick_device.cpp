@@ -44,7 +44,8 @@ bool isDeviceSuitable(const PhysicalDevice &data, Vulkan &vulkan,
     }
 
     // Check requires that the swap chain extension is present
-    if (!SwapChain::isSwapChainSuitable(
+    if (!vulkan.isHeadless() &&
+        !SwapChain::isSwapChainSuitable(
             SwapChain::querySwapChainSupport(data.getVk(), vulkan))) {
         return false;
     }
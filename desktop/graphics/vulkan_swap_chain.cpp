@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <limits>
 
 #include "glfw_mgmt_details.h"
@@ -50,18 +51,94 @@ bool SwapChain::isSwapChainSuitable(const SupportDetails &details) {
     return !details.formats.empty() && !details.presentModes.empty();
 }
 
-void SwapChain::create() {
+void SwapChain::create(VkSwapchainKHR oldSwapChain) {
+    auto oldExtent = extent;
+
+    if (vulkan.isHeadless()) {
+        createOffscreenImages();
+    } else {
+        createSwapChainImages(oldSwapChain);
+    }
+
+    bool extentChanged =
+        oldExtent.width != extent.width || oldExtent.height != extent.height;
+
+    // Create attachment images
+
+    for (auto &attachment : vulkan.getAdapter().getAttachments()) {
+        if (attachment.format == VK_FORMAT_UNDEFINED) {
+            if (!attachment.image) {
+                fatal() << "Attachment " << attachment.name
+                        << " format is VK_FORMAT_UNDEFINED but it does not "
+                           "have an image";
+                // REPORT_ERROR
+                exit(1);
+            }
+            continue;
+        }
+
+        if (attachment.image) {
+            if (!extentChanged) {
+                // Reuse attachment image
+                continue;
+            }
+
+            // Old framebuffers may still reference the image
+            if (retired.empty()) {
+                attachment.image.reset();
+            } else {
+                retired.back().attachmentImages.push_back(
+                    std::move(attachment.image));
+            }
+        }
+
+        attachment.image = std::make_unique<ManagedImage>(
+            extent.width, extent.height, attachment.format, attachment.aspect,
+            attachment.usage, vulkan);
+    }
+
+    // Create framebuffer
+
+    framebuffers.resize(colorBufferViews.size());
+    for (size_t i = 0; i < framebuffers.size(); i++) {
+        std::vector<VkImageView> attachmentViews;
+        for (const auto &attachment : vulkan.getAdapter().getAttachments()) {
+            if (&attachment == colorBuffer) {
+                attachmentViews.push_back(colorBufferViews[i]);
+            } else if (attachment.image) {
+                attachmentViews.push_back(attachment.image->view);
+            } else {
+                fatal() << "Attachment " << attachment.name
+                        << " is not colorBuffer but it does not have an image";
+                // REPORT_ERROR
+                exit(1);
+            }
+        }
+
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = vulkan.getRenderPass().getVk();
+        framebufferInfo.attachmentCount =
+            static_cast<uint32_t>(attachmentViews.size());
+        framebufferInfo.pAttachments = attachmentViews.data();
+        framebufferInfo.width = extent.width;
+        framebufferInfo.height = extent.height;
+        framebufferInfo.layers = 1;
+
+        vulkan.handleVkResult("Could not create Framebuffer",
+                              vkCreateFramebuffer(vulkan.getDevice(),
+                                                  &framebufferInfo, nullptr,
+                                                  &framebuffers[i]));
+    }
+}
+
+void SwapChain::createSwapChainImages(VkSwapchainKHR oldSwapChain) {
     auto details =
         querySwapChainSupport(vulkan.getPhysicalDevice().getVk(), vulkan);
     auto surfaceFormat = chooseSurfaceFormat(details.formats);
-    auto presentMode = choosePresentMode(details.presentModes, true);
-    this->extent = chooseExtent(details.capabilities);
-
-    uint32_t imageCount = details.capabilities.minImageCount + 1;
-    uint32_t maxImageCount = details.capabilities.maxImageCount;
-    if (maxImageCount > 0 && imageCount > maxImageCount) {
-        imageCount = maxImageCount;
-    }
+    presentMode = choosePresentMode(details.presentModes);
+    imageCount = chooseImageCount(details.capabilities);
+    extent = chooseExtent(details.capabilities);
 
     // Fill out the createInfo
 
@@ -76,13 +153,19 @@ void SwapChain::create() {
     createInfo.imageArrayLayers = 1;
     createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
+    // Allow frame capture where supported
+    colorBufferReadable = (details.capabilities.supportedUsageFlags &
+                           VK_IMAGE_USAGE_TRANSFER_SRC_BIT) != 0;
+    if (colorBufferReadable) {
+        createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
+
     createInfo.preTransform = details.capabilities.currentTransform;
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
-    createInfo.oldSwapchain =
-        VK_NULL_HANDLE; // TODO Figure out if this should be used
+    createInfo.oldSwapchain = oldSwapChain;
 
     // Specify queues
 
@@ -106,12 +189,15 @@ void SwapChain::create() {
 
     // Store color buffers
 
-    std::vector<VkImage> colorBufferImages;
     vkGetSwapchainImagesKHR(vulkan.getDevice(), vk, &imageCount, nullptr);
     colorBufferImages.resize(imageCount);
     vkGetSwapchainImagesKHR(vulkan.getDevice(), vk, &imageCount,
                             colorBufferImages.data());
 
+    debug() << "Swap chain created: " << extent.width << "x" << extent.height
+            << ", " << imageCount << " images, "
+            << getPresentModeName(presentMode);
+
     colorBufferViews.resize(colorBufferImages.size());
     for (size_t i = 0; i < colorBufferImages.size(); i++) {
         VkImageViewCreateInfo viewCreateInfo{};
@@ -134,59 +220,26 @@ void SwapChain::create() {
                                                 &viewCreateInfo, nullptr,
                                                 &colorBufferViews[i]));
     }
+}
 
-    // Create attachment images
-
-    for (auto &attachment : vulkan.getAdapter().getAttachments()) {
-        if (attachment.format == VK_FORMAT_UNDEFINED) {
-            if (!attachment.image) {
-                fatal() << "Attachment " << attachment.name
-                        << " format is VK_FORMAT_UNDEFINED but it does not "
-                           "have an image";
-                // REPORT_ERROR
-                exit(1);
-            }
-            continue;
-        }
-
-        attachment.image = std::make_unique<ManagedImage>(
-            extent.width, extent.height, attachment.format, attachment.aspect,
-            attachment.usage, vulkan);
+void SwapChain::createOffscreenImages() {
+    extent = settings.headlessExtent;
+    imageCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+    colorBufferReadable = true;
+
+    for (uint32_t i = 0; i < imageCount; i++) {
+        offscreenImages.push_back(std::make_unique<ManagedImage>(
+            extent.width, extent.height, colorBuffer->image->format,
+            VK_IMAGE_ASPECT_COLOR_BIT,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            vulkan));
+        colorBufferImages.push_back(offscreenImages.back()->vk);
+        colorBufferViews.push_back(offscreenImages.back()->view);
     }
 
-    // Create framebuffer
-
-    framebuffers.resize(colorBufferViews.size());
-    for (size_t i = 0; i < framebuffers.size(); i++) {
-        std::vector<VkImageView> attachmentViews;
-        for (const auto &attachment : vulkan.getAdapter().getAttachments()) {
-            if (&attachment == colorBuffer) {
-                attachmentViews.push_back(colorBufferViews[i]);
-            } else if (attachment.image) {
-                attachmentViews.push_back(attachment.image->view);
-            } else {
-                fatal() << "Attachment " << attachment.name
-                        << " is not colorBuffer but it does not have an image";
-                // REPORT_ERROR
-                exit(1);
-            }
-        }
-
-        VkFramebufferCreateInfo framebufferInfo{};
-        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferInfo.renderPass = vulkan.getRenderPass().getVk();
-        framebufferInfo.attachmentCount =
-            static_cast<uint32_t>(attachmentViews.size());
-        framebufferInfo.pAttachments = attachmentViews.data();
-        framebufferInfo.width = extent.width;
-        framebufferInfo.height = extent.height;
-        framebufferInfo.layers = 1;
-
-        vulkan.handleVkResult("Could not create Framebuffer",
-                              vkCreateFramebuffer(vulkan.getDevice(),
-                                                  &framebufferInfo, nullptr,
-                                                  &framebuffers[i]));
-    }
+    debug() << "Offscreen color targets created: " << extent.width << "x"
+            << extent.height << ", " << imageCount << " images";
 }
 
 // NOLINTNEXTLINE(readability-convert-member-functions-to-static): future-proofing
@@ -204,23 +257,65 @@ VkSurfaceFormatKHR SwapChain::chooseSurfaceFormat(
     exit(1);
 }
 
-// NOLINTNEXTLINE(readability-convert-member-functions-to-static): future-proofing
-bool SwapChain::isTripleBufferingSupported(
-    const std::vector<VkPresentModeKHR> &supported) {
-    return std::find(supported.begin(), supported.end(),
-                     VK_PRESENT_MODE_MAILBOX_KHR) != supported.end();
-}
-
 VkPresentModeKHR
-SwapChain::choosePresentMode(const std::vector<VkPresentModeKHR> &supported,
-                             bool avoidVsync) {
-    if (avoidVsync && isTripleBufferingSupported(supported)) {
-        return VK_PRESENT_MODE_MAILBOX_KHR;
+SwapChain::choosePresentMode(const std::vector<VkPresentModeKHR> &supported) {
+    if (std::find(supported.begin(), supported.end(), settings.mode) !=
+        supported.end()) {
+        return settings.mode;
     }
 
+    // FIFO is the only mode required to be supported
+    warn() << "Present mode " << getPresentModeName(settings.mode)
+           << " is not supported, falling back to "
+           << getPresentModeName(VK_PRESENT_MODE_FIFO_KHR);
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+uint32_t
+SwapChain::chooseImageCount(const VkSurfaceCapabilitiesKHR &capabilities) {
+    uint32_t result = settings.imageCount;
+    if (result == 0) {
+        result = capabilities.minImageCount + 1;
+    }
+
+    result = std::max(result, capabilities.minImageCount);
+
+    uint32_t maxImageCount = capabilities.maxImageCount;
+    if (maxImageCount > 0 && result > maxImageCount) {
+        result = maxImageCount;
+    }
+
+    return result;
+}
+
+const char *SwapChain::getPresentModeName(VkPresentModeKHR mode) {
+    switch (mode) {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+        return "immediate";
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+        return "mailbox";
+    case VK_PRESENT_MODE_FIFO_KHR:
+        return "fifo";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+        return "fifo-relaxed";
+    default:
+        return "<unknown>";
+    }
+}
+
+std::optional<VkPresentModeKHR>
+SwapChain::parsePresentMode(const char *name) {
+    for (auto mode :
+         {VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR,
+          VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR}) {
+        if (strcmp(name, getPresentModeName(mode)) == 0) {
+            return mode;
+        }
+    }
+
+    return std::nullopt;
+}
+
 VkExtent2D
 // NOLINTNEXTLINE(readability-convert-member-functions-to-static): future-proofing
 SwapChain::chooseExtent(const VkSurfaceCapabilitiesKHR &capabilities) {
@@ -252,11 +347,6 @@ void SwapChain::destroy() {
     }
     framebuffers.clear();
 
-    if (depthBuffer != nullptr) {
-        delete depthBuffer;
-        depthBuffer = nullptr;
-    }
-
     auto &attachments = vulkan.getAdapter().getAttachments();
     for (auto &attachment : attachments) {
         if (attachment.format != VK_FORMAT_UNDEFINED) {
@@ -264,10 +354,14 @@ void SwapChain::destroy() {
         }
     }
 
-    for (auto *colorBufferView : colorBufferViews) {
-        vkDestroyImageView(vulkan.getDevice(), colorBufferView, nullptr);
+    if (offscreenImages.empty()) {
+        for (auto *colorBufferView : colorBufferViews) {
+            vkDestroyImageView(vulkan.getDevice(), colorBufferView, nullptr);
+        }
     }
     colorBufferViews.clear();
+    colorBufferImages.clear();
+    offscreenImages.clear();
 
     if (vk != VK_NULL_HANDLE) {
         vkDestroySwapchainKHR(vulkan.getDevice(), vk, nullptr);
@@ -275,12 +369,44 @@ void SwapChain::destroy() {
     }
 }
 
-SwapChain::SwapChain(Vulkan &vulkan)
-    : vk(VK_NULL_HANDLE), colorBuffer(nullptr), extent{0, 0},
-      depthBuffer(nullptr), vulkan(vulkan) {
-    auto details =
-        querySwapChainSupport(vulkan.getPhysicalDevice().getVk(), vulkan);
-    auto surfaceFormat = chooseSurfaceFormat(details.formats);
+void SwapChain::destroyRetired(Retired &old) {
+    for (auto *framebuffer : old.framebuffers) {
+        vkDestroyFramebuffer(vulkan.getDevice(), framebuffer, nullptr);
+    }
+    old.framebuffers.clear();
+
+    old.attachmentImages.clear();
+
+    for (auto *colorBufferView : old.colorBufferViews) {
+        vkDestroyImageView(vulkan.getDevice(), colorBufferView, nullptr);
+    }
+    old.colorBufferViews.clear();
+
+    if (old.vk != VK_NULL_HANDLE) {
+        vkDestroySwapchainKHR(vulkan.getDevice(), old.vk, nullptr);
+        old.vk = VK_NULL_HANDLE;
+    }
+}
+
+SwapChain::SwapChain(Vulkan &vulkan, const PresentSettings &settings)
+    : vk(VK_NULL_HANDLE), colorBuffer(nullptr), colorBufferReadable(false),
+      extent{0, 0}, fenceWaitCount(0), settings(settings),
+      presentMode(VK_PRESENT_MODE_FIFO_KHR), imageCount(0), latencyStats{},
+      latencyAccumulator{}, vulkan(vulkan) {
+
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (vulkan.isHeadless()) {
+        // RGBA order matches main::Image, so readback needs no swizzling
+        format = VK_FORMAT_R8G8B8A8_SRGB;
+        finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    } else {
+        auto details =
+            querySwapChainSupport(vulkan.getPhysicalDevice().getVk(), vulkan);
+        format = chooseSurfaceFormat(details.formats).format;
+        finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    }
 
     vulkan.getAdapter().getAttachments().push_back(
         {"Color buffer",
@@ -290,7 +416,7 @@ SwapChain::SwapChain(Vulkan &vulkan)
          0,
 
          VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-         VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+         finalLayout,
          VK_ATTACHMENT_LOAD_OP_CLEAR,
          VK_ATTACHMENT_STORE_OP_STORE,
 
@@ -298,7 +424,7 @@ SwapChain::SwapChain(Vulkan &vulkan)
 
          std::make_unique<Image>(static_cast<VkImage>(VK_NULL_HANDLE),
                                  static_cast<VkImageView>(VK_NULL_HANDLE),
-                                 surfaceFormat.format)});
+                                 format)});
 
     colorBuffer = &vulkan.getAdapter().getAttachments().back();
 }
@@ -306,6 +432,11 @@ SwapChain::SwapChain(Vulkan &vulkan)
 SwapChain::~SwapChain() {
     destroy();
 
+    for (auto &old : retired) {
+        destroyRetired(old);
+    }
+    retired.clear();
+
     auto &attachments = vulkan.getAdapter().getAttachments();
     for (auto it = attachments.begin(); it != attachments.end(); it++) {
         if (&(*it) == colorBuffer) {
@@ -317,9 +448,85 @@ SwapChain::~SwapChain() {
 }
 
 void SwapChain::recreate() {
-    vulkan.waitIdle();
-    destroy();
-    create();
+    if (vulkan.isHeadless()) {
+        // Offscreen images are only recreated when settings change
+        vulkan.waitIdle();
+        destroy();
+        create(VK_NULL_HANDLE);
+        return;
+    }
+
+    VkSwapchainKHR oldSwapChain = vk;
+
+    if (oldSwapChain != VK_NULL_HANDLE) {
+        retired.push_back({fenceWaitCount, oldSwapChain,
+                           std::move(colorBufferViews), std::move(framebuffers),
+                           {}});
+        colorBufferViews.clear();
+        colorBufferImages.clear();
+        framebuffers.clear();
+        vk = VK_NULL_HANDLE;
+    }
+
+    create(oldSwapChain);
+}
+
+void SwapChain::releaseRetired() {
+    fenceWaitCount++;
+
+    // Every frame in flight has waited for its fence since retirement, so
+    // no submitted work can reference retired resources
+    auto it = retired.begin();
+    while (it != retired.end() &&
+           it->retiredAt + MAX_FRAMES_IN_FLIGHT <= fenceWaitCount) {
+        destroyRetired(*it);
+        it++;
+    }
+    retired.erase(retired.begin(), it);
+}
+
+const PresentSettings &SwapChain::getSettings() const { return settings; }
+
+void SwapChain::setSettings(const PresentSettings &newSettings) {
+    settings = newSettings;
+    recreate();
+}
+
+VkPresentModeKHR SwapChain::getPresentMode() const { return presentMode; }
+
+uint32_t SwapChain::getImageCount() const { return imageCount; }
+
+void SwapChain::recordLatency(double acquireWait, double acquireToPresent) {
+    auto &acc = latencyAccumulator;
+
+    // Accumulate sums, convert to averages when the window is full
+    acc.averageAcquireWait += acquireWait;
+    acc.averageAcquireToPresent += acquireToPresent;
+    acc.maxAcquireToPresent =
+        std::max(acc.maxAcquireToPresent, acquireToPresent);
+    acc.samples++;
+
+    if (acc.samples < LATENCY_WINDOW) {
+        return;
+    }
+
+    auto samples = static_cast<double>(acc.samples);
+    acc.averageAcquireWait /= samples;
+    acc.averageAcquireToPresent /= samples;
+    latencyStats = acc;
+    acc = {};
+
+    constexpr double MS = 1000.0;
+    debug() << "Present latency (" << getPresentModeName(presentMode) << ", "
+            << imageCount << " images): acquire wait "
+            << latencyStats.averageAcquireWait * MS
+            << " ms, acquire to present "
+            << latencyStats.averageAcquireToPresent * MS << " ms avg, "
+            << latencyStats.maxAcquireToPresent * MS << " ms max";
+}
+
+const SwapChain::LatencyStats &SwapChain::getLatencyStats() const {
+    return latencyStats;
 }
 
 VkSwapchainKHR SwapChain::getVk() const { return vk; }
@@ -330,4 +537,18 @@ VkFramebuffer SwapChain::getFramebuffer(std::size_t index) const {
 
 VkExtent2D SwapChain::getExtent() const { return extent; }
 
+VkImage SwapChain::getColorImage(std::size_t index) const {
+    return colorBufferImages.at(index);
+}
+
+VkFormat SwapChain::getColorFormat() const {
+    return colorBuffer->image->format;
+}
+
+VkImageLayout SwapChain::getColorLayout() const {
+    return colorBuffer->finalLayout;
+}
+
+bool SwapChain::isColorReadable() const { return colorBufferReadable; }
+
 } // namespace progressia::desktop
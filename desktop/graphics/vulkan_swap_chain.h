@@ -5,6 +5,10 @@
 
 namespace progressia::desktop {
 
+/*
+ * Color targets that frames are rendered into. In headless mode, a set of
+ * offscreen images is used instead of a VkSwapchainKHR.
+ */
 class SwapChain : public VkObjectWrapper {
 
   public:
@@ -18,39 +22,123 @@ class SwapChain : public VkObjectWrapper {
                                                 Vulkan &vulkan);
     static bool isSwapChainSuitable(const SupportDetails &details);
 
+    static const char *getPresentModeName(VkPresentModeKHR);
+    static std::optional<VkPresentModeKHR> parsePresentMode(const char *name);
+
+    /*
+     * CPU-side timings of recent frames, in seconds.
+     */
+    struct LatencyStats {
+        // Time spent blocked in vkAcquireNextImageKHR
+        double averageAcquireWait;
+        // Time from image acquisition to vkQueuePresentKHR
+        double averageAcquireToPresent;
+        double maxAcquireToPresent;
+        std::size_t samples;
+    };
+
   private:
+    constexpr static std::size_t LATENCY_WINDOW = 300;
     VkSwapchainKHR vk;
 
     Attachment *colorBuffer;
+    std::vector<VkImage> colorBufferImages;
     std::vector<VkImageView> colorBufferViews;
+    bool colorBufferReadable;
 
     VkExtent2D extent;
 
-    Image *depthBuffer;
-
     std::vector<VkFramebuffer> framebuffers;
 
+    // Headless mode only; colorBufferViews are owned by these images
+    std::vector<std::unique_ptr<ManagedImage>> offscreenImages;
+
+    /*
+     * Resources replaced by recreate() that may still be used by frames in
+     * flight.
+     */
+    struct Retired {
+        uint64_t retiredAt;
+        VkSwapchainKHR vk;
+        std::vector<VkImageView> colorBufferViews;
+        std::vector<VkFramebuffer> framebuffers;
+        std::vector<std::unique_ptr<Image>> attachmentImages;
+    };
+
+    std::vector<Retired> retired;
+    uint64_t fenceWaitCount;
+
+    PresentSettings settings;
+    VkPresentModeKHR presentMode;
+    uint32_t imageCount;
+
+    LatencyStats latencyStats;
+    LatencyStats latencyAccumulator;
+
     Vulkan &vulkan;
 
-    void create();
+    void create(VkSwapchainKHR oldSwapChain);
+    void createSwapChainImages(VkSwapchainKHR oldSwapChain);
+    void createOffscreenImages();
     void destroy();
+    void destroyRetired(Retired &);
 
     VkSurfaceFormatKHR
     chooseSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &);
-    bool isTripleBufferingSupported(const std::vector<VkPresentModeKHR> &);
-    VkPresentModeKHR choosePresentMode(const std::vector<VkPresentModeKHR> &,
-                                       bool avoidVsync);
+    VkPresentModeKHR choosePresentMode(const std::vector<VkPresentModeKHR> &);
+    uint32_t chooseImageCount(const VkSurfaceCapabilitiesKHR &);
     VkExtent2D chooseExtent(const VkSurfaceCapabilitiesKHR &);
 
   public:
-    SwapChain(Vulkan &);
+    SwapChain(Vulkan &, const PresentSettings &);
     ~SwapChain();
 
+    /*
+     * Creates a new swap chain that replaces the current one, if any. Old
+     * resources are released by releaseRetired() once they are no longer in
+     * use. Does not wait for the device to become idle.
+     */
     void recreate();
 
+    /*
+     * Destroys retired resources that are guaranteed not to be used by any
+     * frame. Must be called by each Frame after waiting for its fence.
+     */
+    void releaseRetired();
+
+    const PresentSettings &getSettings() const;
+
+    /*
+     * Changes present settings and recreates the swap chain.
+     */
+    void setSettings(const PresentSettings &);
+
+    VkPresentModeKHR getPresentMode() const;
+    uint32_t getImageCount() const;
+
+    void recordLatency(double acquireWait, double acquireToPresent);
+
+    /*
+     * Returns statistics over the last complete window of frames.
+     */
+    const LatencyStats &getLatencyStats() const;
+
     VkSwapchainKHR getVk() const;
     VkFramebuffer getFramebuffer(std::size_t index) const;
     VkExtent2D getExtent() const;
+
+    VkImage getColorImage(std::size_t index) const;
+    VkFormat getColorFormat() const;
+
+    /*
+     * Returns the layout color images are left in after the render pass.
+     */
+    VkImageLayout getColorLayout() const;
+
+    /*
+     * Returns true if color images may be used as transfer sources.
+     */
+    bool isColorReadable() const;
 };
 
 } // namespace progressia::desktop
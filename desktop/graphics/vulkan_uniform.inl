@@ -96,12 +96,8 @@ template <typename... Entries> void Uniform<Entries...>::State::bind() {
     auto &set = *state.sets.at(uniform->vulkan.getFrameInFlightIndex());
 
     // REPORT_ERROR if getCurrentFrame() == nullptr
-    auto commandBuffer = uniform->vulkan.getCurrentFrame()->getCommandBuffer();
-    auto pipelineLayout = uniform->vulkan.getPipeline().getLayout();
-
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                            pipelineLayout, uniform->getSetNumber(), 1, &set.vk,
-                            0, nullptr);
+    uniform->vulkan.getCurrentFrame()->bindDescriptorSet(
+        uniform->getSetNumber(), set.vk);
 }
 
 template <typename... Entries>
@@ -1,17 +1,169 @@
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
 #include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
 
 #include "../main/game.h"
+#include "../main/jobs/job_system.h"
 #include "../main/logging.h"
 #include "../main/meta.h"
+#include "../main/profiler.h"
+#include "../main/rendering/image.h"
+#include "../main/simulation_clock.h"
 #include "graphics/glfw_mgmt.h"
+#include "graphics/vulkan_frame_capture.h"
 #include "graphics/vulkan_mgmt.h"
+#include "graphics/vulkan_swap_chain.h"
 
 using namespace progressia::main::logging;
 
+namespace {
+
+struct HeadlessOptions {
+    uint64_t frames = 600;
+    std::string output;
+    std::vector<uint64_t> captureFrames;
+
+    // Simulated seconds per frame, so that captures do not depend on how
+    // fast frames are rendered
+    double frameTime = 1.0 / 60;
+};
+
+/*
+ * Parses a decimal number that makes up all of text and is at most max.
+ * Returns false without changing result if text is not such a number.
+ */
+bool parseUnsigned(const char *text, uint64_t max, uint64_t &result) {
+    // strtoull accepts leading whitespace and signs
+    if (std::isdigit(static_cast<unsigned char>(*text)) == 0) {
+        return false;
+    }
+
+    char *end = nullptr;
+    errno = 0;
+    unsigned long long value = std::strtoull(text, &end, 10);
+    if (*end != '\0' || errno == ERANGE || value > max) {
+        return false;
+    }
+
+    result = value;
+    return true;
+}
+
+void logSimulationStats(const progressia::main::SimulationClock &clock) {
+    const auto &stats = clock.getStats();
+    info() << "Simulated " << stats.ticks << " ticks, "
+           << stats.averageTickTime << " us per tick on average, "
+           << stats.maxTickTime << " us at most, " << stats.droppedTicks
+           << " ticks dropped";
+}
+
+/*
+ * Writes the frame that is being rendered to path without waiting for it.
+ */
+void captureFrame(progressia::desktop::Vulkan &vulkan,
+                  const std::filesystem::path &path) {
+    if (path.has_parent_path()) {
+        std::error_code errorCode;
+        std::filesystem::create_directories(path.parent_path(), errorCode);
+        if (errorCode) {
+            error() << "Could not create directory "
+                    << path.parent_path().string() << ": "
+                    << errorCode.message();
+            return;
+        }
+    }
+
+    vulkan.getFrameCapture().request(
+        [path](progressia::main::Image &&image) {
+            if (progressia::main::saveImageTga(image, path.string())) {
+                info() << "Frame written to " << path.string();
+            } else {
+                error() << "Could not write frame to " << path.string();
+            }
+        });
+}
+
+int runHeadless(const progressia::desktop::PresentSettings &presentSettings,
+                const HeadlessOptions &options) {
+    using namespace progressia;
+
+    desktop::VulkanManager vulkanManager(presentSettings);
+    auto *vulkan = vulkanManager.getVulkan();
+    auto game = main::makeGame(vulkan->getGint());
+    main::SimulationClock clock;
+
+    info() << "Loading complete, rendering " << options.frames
+           << " frames offscreen";
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t rendered = 0;
+
+    while (rendered < options.frames) {
+        {
+            PROFILE_SCOPE("Frame");
+
+            if (!vulkanManager.startRender()) {
+                continue;
+            }
+
+            main::getJobSystem().runMainThreadJobs();
+            clock.advance(options.frameTime,
+                          [&]() { game->tick(clock.getTickLength()); });
+            game->renderTick(clock.getAlpha());
+
+            // FIXME this is relative to bin, not root dir
+            const auto &captures = options.captureFrames;
+            if (std::find(captures.begin(), captures.end(), rendered) !=
+                captures.end()) {
+                captureFrame(*vulkan, "run/captures/frame-" +
+                                          std::to_string(rendered) + ".tga");
+            }
+
+            if (!options.output.empty() && rendered + 1 == options.frames) {
+                captureFrame(*vulkan, options.output);
+            }
+
+            vulkanManager.endRender();
+        }
+
+        main::profiler::onFrameEnd();
+        rendered++;
+    }
+
+    vulkan->waitIdle();
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+
+    constexpr double MS = 1000.0;
+    info() << "Rendered " << rendered << " frames in " << seconds << " s, "
+           << (rendered == 0 ? 0 : seconds * MS / static_cast<double>(rendered))
+           << " ms per frame";
+    logSimulationStats(clock);
+
+    vulkan->getFrameCapture().finish();
+    return 0;
+}
+
+} // namespace
+
 int main(int argc, char *argv[]) {
 
     using namespace progressia;
 
+    desktop::PresentSettings presentSettings;
+    HeadlessOptions headlessOptions;
+
     for (int i = 1; i < argc; i++) {
         char *arg = argv[i];
         if (strcmp(arg, "--version") == 0 || strcmp(arg, "-v") == 0) {
@@ -20,6 +172,89 @@ int main(int argc, char *argv[]) {
                       << main::meta::VERSION_NUMBER << ")" << std::endl;
             return 0;
         }
+
+        if (strncmp(arg, "--present-mode=", strlen("--present-mode=")) == 0) {
+            const char *value = arg + strlen("--present-mode=");
+            auto mode = desktop::SwapChain::parsePresentMode(value);
+            if (!mode.has_value()) {
+                std::cerr << "Unknown present mode \"" << value
+                          << "\"; expected fifo, fifo-relaxed, mailbox or "
+                             "immediate"
+                          << std::endl;
+                return 1;
+            }
+            presentSettings.mode = *mode;
+            continue;
+        }
+
+        if (strncmp(arg, "--swap-images=", strlen("--swap-images=")) == 0) {
+            const char *value = arg + strlen("--swap-images=");
+            uint64_t count = 0;
+            if (!parseUnsigned(value, std::numeric_limits<uint32_t>::max(),
+                               count)) {
+                std::cerr << "Invalid swap image count \"" << value
+                          << "\"; expected a non-negative integer"
+                          << std::endl;
+                return 1;
+            }
+            presentSettings.imageCount = static_cast<uint32_t>(count);
+            continue;
+        }
+
+        if (strcmp(arg, "--headless") == 0) {
+            presentSettings.headless = true;
+            continue;
+        }
+
+        if (strncmp(arg, "--frames=", strlen("--frames=")) == 0) {
+            const char *value = arg + strlen("--frames=");
+            if (!parseUnsigned(value, std::numeric_limits<uint64_t>::max(),
+                               headlessOptions.frames)) {
+                std::cerr << "Invalid frame count \"" << value
+                          << "\"; expected a non-negative integer"
+                          << std::endl;
+                return 1;
+            }
+            continue;
+        }
+
+        if (strncmp(arg, "--size=", strlen("--size=")) == 0) {
+            unsigned int width = 0;
+            unsigned int height = 0;
+            if (sscanf(arg + strlen("--size="), "%ux%u", &width, &height) !=
+                    2 ||
+                width == 0 || height == 0) {
+                std::cerr << "Invalid size \"" << arg + strlen("--size=")
+                          << "\"; expected WIDTHxHEIGHT" << std::endl;
+                return 1;
+            }
+            presentSettings.headlessExtent = {width, height};
+            continue;
+        }
+
+        if (strncmp(arg, "--output=", strlen("--output=")) == 0) {
+            headlessOptions.output = arg + strlen("--output=");
+            continue;
+        }
+
+        if (strncmp(arg, "--capture=", strlen("--capture=")) == 0) {
+            std::stringstream list(arg + strlen("--capture="));
+            std::string item;
+            while (std::getline(list, item, ',')) {
+                uint64_t frame = 0;
+                if (!parseUnsigned(item.c_str(),
+                                   std::numeric_limits<uint64_t>::max(),
+                                   frame)) {
+                    std::cerr << "Invalid capture frame \"" << item
+                              << "\"; expected a comma-separated list of "
+                                 "frame numbers"
+                              << std::endl;
+                    return 1;
+                }
+                headlessOptions.captureFrames.push_back(frame);
+            }
+            continue;
+        }
     }
 
     info() << "Starting " << main::meta::NAME << " " << main::meta::VERSION
@@ -27,28 +262,64 @@ int main(int argc, char *argv[]) {
            << main::meta::VERSION_NUMBER << ")";
     debug("Debug is enabled");
 
+    main::profiler::setThreadName("Main");
+    main::initializeJobSystem();
+
+    if (presentSettings.headless) {
+        int exitCode = runHeadless(presentSettings, headlessOptions);
+        info("Shutting down");
+        main::shutdownJobSystem();
+        return exitCode;
+    }
+
     auto glfwManager = desktop::makeGlfwManager();
-    desktop::VulkanManager vulkanManager;
+    desktop::VulkanManager vulkanManager(presentSettings);
     glfwManager->setOnScreenResize([&]() { vulkanManager.resizeSurface(); });
+    glfwManager->setOnScreenshot([&]() {
+        // FIXME this is relative to bin, not root dir
+        captureFrame(*vulkanManager.getVulkan(),
+                     "run/screenshots/screenshot-" +
+                         std::to_string(std::time(nullptr)) + ".tga");
+    });
     glfwManager->showWindow();
 
     auto game = main::makeGame(vulkanManager.getVulkan()->getGint());
+    main::SimulationClock clock;
+    auto lastFrame = std::chrono::steady_clock::now();
 
     info("Loading complete");
     while (glfwManager->shouldRun()) {
-        bool abortFrame = !vulkanManager.startRender();
-        if (abortFrame) {
-            continue;
-        }
+        {
+            PROFILE_SCOPE("Frame");
+
+            bool abortFrame = !vulkanManager.startRender();
+            if (abortFrame) {
+                continue;
+            }
 
-        game->renderTick();
+            main::getJobSystem().runMainThreadJobs();
 
-        vulkanManager.endRender();
-        glfwManager->doGlfwRoutine();
+            auto now = std::chrono::steady_clock::now();
+            clock.advance(
+                std::chrono::duration<double>(now - lastFrame).count(),
+                [&]() { game->tick(clock.getTickLength()); });
+            lastFrame = now;
+            game->renderTick(clock.getAlpha());
+
+            vulkanManager.endRender();
+            glfwManager->doGlfwRoutine();
+        }
+
+        main::profiler::onFrameEnd();
     }
     info("Shutting down");
+    logSimulationStats(clock);
 
     vulkanManager.getVulkan()->waitIdle();
 
+    // Game objects may still have jobs in flight
+    game.reset();
+    main::shutdownJobSystem();
+
     return 0;
 }
@@ -5,10 +5,24 @@
 
 namespace progressia::main {
 
+/*
+ * The game as seen by the platform loop, which calls tick() at the fixed
+ * rate of a SimulationClock and renderTick() once per frame.
+ */
 class Game : private NonCopyable {
   public:
     virtual ~Game() = default;
-    virtual void renderTick() = 0;
+
+    /*
+     * Advances the simulation by tickLength seconds.
+     */
+    virtual void tick(double tickLength) = 0;
+
+    /*
+     * Draws the frame. alpha is the fraction of a tick that has passed since
+     * the last tick; state is interpolated from the tick before by it.
+     */
+    virtual void renderTick(float alpha) = 0;
 };
 
 std::unique_ptr<Game> makeGame(GraphicsInterface &);
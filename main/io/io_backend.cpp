@@ -0,0 +1,205 @@
+#include "io_backend.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+#include "../logging.h"
+#include "../profiler.h"
+
+namespace progressia::main {
+
+bool runBlocking(IoBackend::Operation &op) {
+    uint8_t *data = op.data;
+    uint64_t offset = op.offset;
+    std::size_t left = op.size;
+
+    while (left > 0) {
+#ifdef _WIN32
+        OVERLAPPED overlapped{};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+        auto request = static_cast<DWORD>(
+            std::min<std::size_t>(left, std::size_t(1) << 30));
+        DWORD done = 0;
+        BOOL success =
+            op.type == IoBackend::Operation::Type::READ
+                ? ReadFile(op.file, data, request, &done, &overlapped)
+                : WriteFile(op.file, data, request, &done, &overlapped);
+        if (success == 0 || done == 0) {
+            return false;
+        }
+#else
+        ssize_t done =
+            op.type == IoBackend::Operation::Type::READ
+                ? ::pread(op.file, data, left, static_cast<off_t>(offset))
+                : ::pwrite(op.file, data, left, static_cast<off_t>(offset));
+        if (done < 0 && errno == EINTR) {
+            continue;
+        }
+        if (done <= 0) {
+            return false;
+        }
+#endif
+        data += done;
+        offset += static_cast<uint64_t>(done);
+        left -= static_cast<std::size_t>(done);
+    }
+
+    return true;
+}
+
+namespace {
+
+/*
+ * Runs chains of linked operations on a fixed set of threads. Each chain is
+ * run by one thread in order.
+ */
+class ThreadPoolBackend : public IoBackend {
+  private:
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable batchReady;
+    std::condition_variable batchDone;
+
+    std::vector<Operation> *batch;
+    std::vector<std::size_t> chainStarts;
+    std::atomic<std::size_t> nextChain;
+    uint64_t generation;
+    std::size_t busyThreads;
+    bool stopping;
+
+    void runChains() {
+        while (true) {
+            std::size_t chain = nextChain.fetch_add(1);
+            if (chain >= chainStarts.size()) {
+                return;
+            }
+
+            bool linkBroken = false;
+            for (std::size_t i = chainStarts[chain]; i < batch->size(); i++) {
+                auto &op = (*batch)[i];
+                op.succeeded = !linkBroken && runBlocking(op);
+                linkBroken = !op.succeeded;
+
+                if (!op.linkNext) {
+                    break;
+                }
+            }
+        }
+    }
+
+    void work() {
+        uint64_t seen = 0;
+
+        while (true) {
+            {
+                std::unique_lock lock(mutex);
+                batchReady.wait(
+                    lock, [&]() { return stopping || generation != seen; });
+                if (stopping) {
+                    return;
+                }
+                seen = generation;
+            }
+
+            runChains();
+
+            std::lock_guard lock(mutex);
+            if (--busyThreads == 0) {
+                batchDone.notify_one();
+            }
+        }
+    }
+
+  public:
+    explicit ThreadPoolBackend(std::size_t threadCount)
+        : batch(nullptr), nextChain(0), generation(0), busyThreads(0),
+          stopping(false) {
+
+        // The calling thread takes part in each batch
+        for (std::size_t i = 1; i < threadCount; i++) {
+            threads.emplace_back([this]() {
+                profiler::setThreadName("I/O pool");
+                work();
+            });
+        }
+    }
+
+    ~ThreadPoolBackend() override {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        batchReady.notify_all();
+
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+    void run(std::vector<Operation> &operations) override {
+        PROFILE_SCOPE("ThreadPoolBackend::run");
+
+        chainStarts.clear();
+        for (std::size_t i = 0; i < operations.size(); i++) {
+            if (i == 0 || !operations[i - 1].linkNext) {
+                chainStarts.push_back(i);
+            }
+        }
+
+        batch = &operations;
+        nextChain = 0;
+
+        {
+            std::lock_guard lock(mutex);
+            busyThreads = threads.size();
+            generation++;
+        }
+        batchReady.notify_all();
+
+        runChains();
+
+        std::unique_lock lock(mutex);
+        batchDone.wait(lock, [this]() { return busyThreads == 0; });
+        batch = nullptr;
+    }
+
+    const char *getName() const override { return "thread pool"; }
+};
+
+} // namespace
+
+std::unique_ptr<IoBackend>
+IoBackend::createThreadPool(std::size_t threadCount) {
+    return std::make_unique<ThreadPoolBackend>(
+        std::max<std::size_t>(threadCount, 1));
+}
+
+std::unique_ptr<IoBackend> IoBackend::create(std::size_t threadCount) {
+    auto backend = createIoUring();
+    if (backend) {
+        return backend;
+    }
+
+    return createThreadPool(threadCount);
+}
+
+} // namespace progressia::main
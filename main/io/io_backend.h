@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../util.h"
+
+namespace progressia::main {
+
+/*
+ * Operating system handle of an open file: a file descriptor on POSIX
+ * systems, a HANDLE on Windows.
+ */
+#ifdef _WIN32
+using NativeFile = void *;
+#else
+using NativeFile = int;
+#endif
+
+/*
+ * Positioned reads and writes of native files, issued in batches.
+ */
+class IoBackend : private NonCopyable {
+  public:
+    struct Operation {
+        enum class Type : uint8_t { READ, WRITE };
+
+        Type type;
+        NativeFile file;
+        uint64_t offset;
+        uint8_t *data;
+        std::size_t size;
+
+        // The next operation starts only after this one has succeeded
+        bool linkNext = false;
+
+        // Set by run(): true if all size bytes were transferred
+        bool succeeded = false;
+    };
+
+    virtual ~IoBackend() = default;
+
+    /*
+     * Performs all operations and returns once they have completed.
+     * Operations that are not linked may run in any order and in parallel.
+     * An operation fails without running if the one linked before it
+     * failed.
+     */
+    virtual void run(std::vector<Operation> &) = 0;
+
+    virtual const char *getName() const = 0;
+
+    /*
+     * Creates the fastest backend available: io_uring on Linux if the
+     * kernel allows it, otherwise a pool of threadCount threads issuing
+     * blocking calls.
+     */
+    static std::unique_ptr<IoBackend> create(std::size_t threadCount = 4);
+
+    /*
+     * Creates a backend that issues blocking pread() and pwrite() calls, or
+     * their Windows equivalents, on threadCount threads. The thread that
+     * calls run() is one of them.
+     */
+    static std::unique_ptr<IoBackend>
+    createThreadPool(std::size_t threadCount);
+
+    /*
+     * Returns nullptr if io_uring is not supported by the platform or is
+     * not permitted.
+     */
+    static std::unique_ptr<IoBackend> createIoUring();
+};
+
+/*
+ * Performs a single blocking positioned read or write of all bytes.
+ * Returns false on errors and on reads past the end of the file.
+ */
+bool runBlocking(IoBackend::Operation &);
+
+} // namespace progressia::main
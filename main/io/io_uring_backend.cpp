@@ -0,0 +1,350 @@
+#include "io_backend.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define PROGRESSIA_IO_URING
+#endif
+
+#ifdef PROGRESSIA_IO_URING
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "../logging.h"
+#include "../profiler.h"
+
+namespace progressia::main {
+
+namespace {
+
+constexpr unsigned QUEUE_DEPTH = 128;
+
+/*
+ * Submits operations through an io_uring instance using raw system calls,
+ * so that liburing is not required.
+ *
+ * Chains of linked operations are submitted with IOSQE_IO_LINK. Batches
+ * larger than the queue are split between chains. Short transfers, which
+ * break links, are completed with blocking calls.
+ */
+class IoUringBackend : public IoBackend {
+  private:
+    int ring;
+    unsigned entries;
+
+    void *sqRing;
+    std::size_t sqRingSize;
+    void *cqRing;
+    std::size_t cqRingSize;
+    io_uring_sqe *sqes;
+    std::size_t sqesSize;
+
+    unsigned *sqHead;
+    unsigned *sqTail;
+    unsigned sqMask;
+    unsigned *sqArray;
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned cqMask;
+    io_uring_cqe *cqes;
+
+    std::vector<iovec> iovecs;
+    std::vector<int> results;
+
+    // Set when io_uring_enter fails; all later batches use blocking calls
+    bool failed;
+
+    static int enter(int fd, unsigned toSubmit, unsigned minComplete,
+                     unsigned flags) {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit,
+                                        minComplete, flags, nullptr, 0));
+    }
+
+    template <typename T> static T *at(void *base, uint32_t offset) {
+        return reinterpret_cast<T *>(static_cast<uint8_t *>(base) + offset);
+    }
+
+    /*
+     * Submits operations [begin; end) and waits for all of them.
+     */
+    bool submitWindow(std::vector<Operation> &operations, std::size_t begin,
+                      std::size_t end) {
+        unsigned tail = *sqTail;
+
+        for (std::size_t i = begin; i < end; i++) {
+            auto &op = operations[i];
+            unsigned slot = tail & sqMask;
+
+            iovecs[i - begin] = {op.data, op.size};
+
+            io_uring_sqe &sqe = sqes[slot];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = op.type == Operation::Type::READ ? IORING_OP_READV
+                                                          : IORING_OP_WRITEV;
+            sqe.fd = op.file;
+            sqe.off = op.offset;
+            sqe.addr = reinterpret_cast<uint64_t>(&iovecs[i - begin]);
+            sqe.len = 1;
+            sqe.user_data = i;
+            if (op.linkNext && i + 1 < end) {
+                sqe.flags = IOSQE_IO_LINK;
+            }
+
+            sqArray[slot] = slot;
+            tail++;
+        }
+
+        __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+
+        auto count = static_cast<unsigned>(end - begin);
+        unsigned submitted = 0;
+        unsigned completed = 0;
+
+        while (completed < count) {
+            int result = enter(ring, count - submitted, 1,
+                               IORING_ENTER_GETEVENTS);
+            if (result >= 0) {
+                submitted += static_cast<unsigned>(result);
+            } else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                int error = errno;
+                completed += reap();
+                drain(submitted - completed);
+                errno = error;
+                return false;
+            }
+
+            completed += reap();
+        }
+
+        return true;
+    }
+
+    /*
+     * Stores the results of completed operations. Returns their number.
+     */
+    unsigned reap() {
+        unsigned count = 0;
+        unsigned head = *cqHead;
+        unsigned cqTailValue = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        for (; head != cqTailValue; head++, count++) {
+            const io_uring_cqe &cqe = cqes[head & cqMask];
+            results[cqe.user_data] = cqe.res;
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+        return count;
+    }
+
+    /*
+     * Withdraws entries that the kernel has not consumed yet and waits for
+     * inFlight submitted operations, which still use the buffers of the
+     * current batch.
+     */
+    void drain(unsigned inFlight) {
+        __atomic_store_n(sqTail, __atomic_load_n(sqHead, __ATOMIC_ACQUIRE),
+                         __ATOMIC_RELEASE);
+
+        while (inFlight > 0) {
+            if (enter(ring, 0, inFlight, IORING_ENTER_GETEVENTS) < 0 &&
+                errno != EINTR) {
+                logging::error() << "Could not wait for " << inFlight
+                                 << " io_uring operations: "
+                                 << std::strerror(errno);
+                return;
+            }
+            inFlight -= reap();
+        }
+    }
+
+    /*
+     * Converts results of [begin; end) into Operation::succeeded, finishing
+     * short transfers and operations cancelled because of them. linkBroken
+     * carries a failure into the next window when a chain is split.
+     */
+    void finishWindow(std::vector<Operation> &operations, std::size_t begin,
+                      std::size_t end, bool &linkBroken) {
+        for (std::size_t i = begin; i < end; i++) {
+            auto &op = operations[i];
+            int result = results[i];
+
+            if (linkBroken) {
+                op.succeeded = false;
+            } else if (result >= 0 && std::size_t(result) == op.size) {
+                op.succeeded = true;
+            } else if (result > 0 || result == -ECANCELED) {
+                Operation rest = op;
+                auto done = static_cast<std::size_t>(std::max(result, 0));
+                rest.data += done;
+                rest.offset += done;
+                rest.size -= done;
+                op.succeeded = runBlocking(rest);
+            } else {
+                op.succeeded = false;
+            }
+
+            linkBroken = op.linkNext && !op.succeeded;
+        }
+    }
+
+  public:
+    IoUringBackend(int ring, const io_uring_params &params)
+        : ring(ring), entries(params.sq_entries), sqRing(nullptr),
+          sqRingSize(0), cqRing(nullptr), cqRingSize(0), sqes(nullptr),
+          sqesSize(0), sqHead(nullptr), sqTail(nullptr), sqMask(0),
+          sqArray(nullptr), cqHead(nullptr), cqTail(nullptr), cqMask(0),
+          cqes(nullptr), iovecs(params.sq_entries), failed(false) {}
+
+    ~IoUringBackend() override {
+        if (sqes != nullptr) {
+            munmap(sqes, sqesSize);
+        }
+        if (cqRing != nullptr && cqRing != sqRing) {
+            munmap(cqRing, cqRingSize);
+        }
+        if (sqRing != nullptr) {
+            munmap(sqRing, sqRingSize);
+        }
+        close(ring);
+    }
+
+    bool map(const io_uring_params &params) {
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize =
+            params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+        bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMap) {
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        }
+
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED) {
+            sqRing = nullptr;
+            return false;
+        }
+
+        if (singleMap) {
+            cqRing = sqRing;
+        } else {
+            cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_CQ_RING);
+            if (cqRing == MAP_FAILED) {
+                cqRing = nullptr;
+                return false;
+            }
+        }
+
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void *sqesAddress =
+            mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQES);
+        if (sqesAddress == MAP_FAILED) {
+            return false;
+        }
+        sqes = static_cast<io_uring_sqe *>(sqesAddress);
+
+        sqHead = at<unsigned>(sqRing, params.sq_off.head);
+        sqTail = at<unsigned>(sqRing, params.sq_off.tail);
+        sqMask = *at<unsigned>(sqRing, params.sq_off.ring_mask);
+        sqArray = at<unsigned>(sqRing, params.sq_off.array);
+        cqHead = at<unsigned>(cqRing, params.cq_off.head);
+        cqTail = at<unsigned>(cqRing, params.cq_off.tail);
+        cqMask = *at<unsigned>(cqRing, params.cq_off.ring_mask);
+        cqes = at<io_uring_cqe>(cqRing, params.cq_off.cqes);
+
+        return true;
+    }
+
+    void run(std::vector<Operation> &operations) override {
+        PROFILE_SCOPE("IoUringBackend::run");
+
+        if (failed) {
+            runAllBlocking(operations, 0, false);
+            return;
+        }
+
+        results.assign(operations.size(), -ECANCELED);
+
+        bool linkBroken = false;
+        std::size_t begin = 0;
+        while (begin < operations.size()) {
+            // Fill the queue with whole chains where possible
+            std::size_t end = begin;
+            std::size_t chainEnd = begin;
+            while (chainEnd < operations.size() && chainEnd - begin < entries) {
+                chainEnd++;
+                if (!operations[chainEnd - 1].linkNext) {
+                    end = chainEnd;
+                }
+            }
+            if (end == begin) {
+                // A chain longer than the queue is split
+                end = chainEnd;
+            }
+
+            if (!submitWindow(operations, begin, end)) {
+                logging::error() << "io_uring_enter failed, falling back to "
+                                 << "blocking I/O: " << std::strerror(errno);
+                failed = true;
+                runAllBlocking(operations, begin, linkBroken);
+                return;
+            }
+
+            finishWindow(operations, begin, end, linkBroken);
+            begin = end;
+        }
+    }
+
+    /*
+     * Runs operations from begin on with blocking calls.
+     */
+    void runAllBlocking(std::vector<Operation> &operations, std::size_t begin,
+                        bool linkBroken) {
+        for (std::size_t i = begin; i < operations.size(); i++) {
+            auto &op = operations[i];
+            op.succeeded = !linkBroken && runBlocking(op);
+            linkBroken = op.linkNext && !op.succeeded;
+        }
+    }
+
+    const char *getName() const override { return "io_uring"; }
+};
+
+} // namespace
+
+std::unique_ptr<IoBackend> IoBackend::createIoUring() {
+    io_uring_params params{};
+    auto ring = static_cast<int>(
+        syscall(__NR_io_uring_setup, QUEUE_DEPTH, &params));
+    if (ring < 0) {
+        logging::debug() << "io_uring is not available: "
+                         << std::strerror(errno);
+        return nullptr;
+    }
+
+    auto backend = std::make_unique<IoUringBackend>(ring, params);
+    if (!backend->map(params)) {
+        logging::debug() << "Could not map io_uring queues: "
+                         << std::strerror(errno);
+        return nullptr;
+    }
+
+    return backend;
+}
+
+} // namespace progressia::main
+
+#else
+
+namespace progressia::main {
+
+std::unique_ptr<IoBackend> IoBackend::createIoUring() { return nullptr; }
+
+} // namespace progressia::main
+
+#endif
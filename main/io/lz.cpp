@@ -0,0 +1,258 @@
+#include "lz.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace progressia::main::lz {
+
+namespace {
+
+constexpr std::size_t MIN_MATCH = 4;
+constexpr std::size_t MAX_OFFSET = 0xFFFF;
+
+// Format rules: the last match starts at least MATCH_END_LIMIT bytes before
+// the end, and the last LAST_LITERALS bytes are literals
+constexpr std::size_t MATCH_END_LIMIT = 12;
+constexpr std::size_t LAST_LITERALS = 5;
+
+constexpr unsigned HASH_BITS = 14;
+constexpr unsigned RUN_MASK = 0xF;
+
+uint32_t read32(const uint8_t *in) {
+    uint32_t v = 0;
+    std::memcpy(&v, in, sizeof(v));
+    return v;
+}
+
+uint32_t hash(uint32_t sequence) {
+    return (sequence * 2654435761U) >> (32 - HASH_BITS);
+}
+
+void writeLength(std::vector<uint8_t> &output, std::size_t length) {
+    while (length >= 0xFF) {
+        output.push_back(0xFF);
+        length -= 0xFF;
+    }
+    output.push_back(static_cast<uint8_t>(length));
+}
+
+/*
+ * Writes literals [anchor; anchor + literals) followed by a match, or no
+ * match if matchLength is zero.
+ */
+void writeSequence(std::vector<uint8_t> &output, const uint8_t *anchor,
+                   std::size_t literals, std::size_t offset,
+                   std::size_t matchLength) {
+    std::size_t matchCode = matchLength == 0 ? 0 : matchLength - MIN_MATCH;
+
+    auto token = static_cast<uint8_t>(
+        (std::min<std::size_t>(literals, RUN_MASK) << 4) |
+        std::min<std::size_t>(matchCode, RUN_MASK));
+    output.push_back(token);
+
+    if (literals >= RUN_MASK) {
+        writeLength(output, literals - RUN_MASK);
+    }
+    output.insert(output.end(), anchor, anchor + literals);
+
+    if (matchLength == 0) {
+        return;
+    }
+
+    output.push_back(static_cast<uint8_t>(offset));
+    output.push_back(static_cast<uint8_t>(offset >> 8));
+
+    if (matchCode >= RUN_MASK) {
+        writeLength(output, matchCode - RUN_MASK);
+    }
+}
+
+/*
+ * Reads an extended length, adding it to length. Returns false on
+ * truncated input.
+ */
+bool readLength(const uint8_t *&in, const uint8_t *end, std::size_t &length) {
+    uint8_t byte = 0;
+    do {
+        if (in == end) {
+            return false;
+        }
+        byte = *in++;
+        length += byte;
+    } while (byte == 0xFF);
+    return true;
+}
+
+} // namespace
+
+void compress(const uint8_t *input, std::size_t size,
+              std::vector<uint8_t> &output, int level) {
+    level = std::clamp(level, MIN_LEVEL, MAX_LEVEL);
+    std::size_t depth = std::size_t(1) << (level - MIN_LEVEL);
+
+    // Worst case: one token and a length byte per 255 literals
+    output.reserve(output.size() + size + size / 255 + 16);
+
+    if (size < MATCH_END_LIMIT + 1) {
+        writeSequence(output, input, size, 0, 0);
+        return;
+    }
+
+    // Most recent position of each hash, and for deeper levels the previous
+    // position with the same hash
+    std::vector<int32_t> heads(std::size_t(1) << HASH_BITS, -1);
+    std::vector<int32_t> chain;
+    std::size_t chainMask = 0;
+    if (depth > 1) {
+        std::size_t window = 1;
+        while (window < std::min(size, MAX_OFFSET + 1)) {
+            window *= 2;
+        }
+        chain.assign(window, -1);
+        chainMask = window - 1;
+    }
+
+    auto insert = [&](std::size_t position) {
+        uint32_t h = hash(read32(input + position));
+        if (depth > 1) {
+            chain[position & chainMask] = heads[h];
+        }
+        heads[h] = static_cast<int32_t>(position);
+    };
+
+    std::size_t matchStartLimit = size - MATCH_END_LIMIT;
+    std::size_t matchEndLimit = size - LAST_LITERALS;
+
+    std::size_t anchor = 0;
+    std::size_t position = 0;
+
+    while (position < matchStartLimit) {
+        uint32_t sequence = read32(input + position);
+        int32_t candidate = heads[hash(sequence)];
+
+        std::size_t bestLength = 0;
+        std::size_t bestOffset = 0;
+
+        for (std::size_t i = 0; i < depth && candidate >= 0; i++) {
+            auto from = static_cast<std::size_t>(candidate);
+            if (position - from > MAX_OFFSET) {
+                break;
+            }
+
+            if (read32(input + from) == sequence) {
+                std::size_t length = MIN_MATCH;
+                while (position + length < matchEndLimit &&
+                       input[from + length] == input[position + length]) {
+                    length++;
+                }
+
+                if (length > bestLength) {
+                    bestLength = length;
+                    bestOffset = position - from;
+                }
+            }
+
+            if (depth == 1) {
+                break;
+            }
+            candidate = chain[from & chainMask];
+        }
+
+        insert(position);
+
+        if (bestLength < MIN_MATCH) {
+            position++;
+            continue;
+        }
+
+        std::size_t indexed = position;
+
+        // Extend the match backwards over pending literals
+        while (position > anchor && position - bestOffset > 0 &&
+               input[position - 1] == input[position - bestOffset - 1]) {
+            position--;
+            bestLength++;
+        }
+
+        writeSequence(output, input + anchor, position - anchor, bestOffset,
+                      bestLength);
+
+        std::size_t matchEnd = position + bestLength;
+        if (depth > 1) {
+            // Deeper levels find more matches by indexing every position
+            std::size_t end = std::min(matchEnd, matchStartLimit);
+            for (std::size_t i = indexed + 1; i < end; i++) {
+                insert(i);
+            }
+        } else if (matchEnd - 2 < matchStartLimit) {
+            insert(matchEnd - 2);
+        }
+
+        position = matchEnd;
+        anchor = position;
+    }
+
+    writeSequence(output, input + anchor, size - anchor, 0, 0);
+}
+
+bool decompress(const uint8_t *input, std::size_t size, uint8_t *output,
+                std::size_t outputSize) {
+    const uint8_t *in = input;
+    const uint8_t *inEnd = input + size;
+    uint8_t *out = output;
+    uint8_t *outEnd = output + outputSize;
+
+    while (true) {
+        if (in == inEnd) {
+            return false;
+        }
+        uint8_t token = *in++;
+
+        std::size_t literals = token >> 4;
+        if (literals == RUN_MASK && !readLength(in, inEnd, literals)) {
+            return false;
+        }
+        if (literals > std::size_t(inEnd - in) ||
+            literals > std::size_t(outEnd - out)) {
+            return false;
+        }
+        std::memcpy(out, in, literals);
+        in += literals;
+        out += literals;
+
+        // The last sequence has no match
+        if (in == inEnd) {
+            return out == outEnd;
+        }
+
+        if (inEnd - in < 2) {
+            return false;
+        }
+        std::size_t offset = std::size_t(in[0]) | std::size_t(in[1]) << 8;
+        in += 2;
+
+        std::size_t length = token & RUN_MASK;
+        if (length == RUN_MASK && !readLength(in, inEnd, length)) {
+            return false;
+        }
+        length += MIN_MATCH;
+
+        if (offset == 0 || offset > std::size_t(out - output) ||
+            length > std::size_t(outEnd - out)) {
+            return false;
+        }
+
+        const uint8_t *from = out - offset;
+        if (offset >= length) {
+            std::memcpy(out, from, length);
+            out += length;
+        } else {
+            // Overlapping copies repeat the last offset bytes
+            for (std::size_t i = 0; i < length; i++) {
+                *out++ = from[i];
+            }
+        }
+    }
+}
+
+} // namespace progressia::main::lz
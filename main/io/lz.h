@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace progressia::main::lz {
+
+/*
+ * A byte-oriented LZ77 compressor producing the LZ4 block format: runs of
+ * literals followed by matches of at least four bytes within the previous
+ * 64 KiB. Decompression is a sequence of copies with no entropy coding, so
+ * it runs at memory speed.
+ *
+ * Levels from MIN_LEVEL to MAX_LEVEL trade compression speed for ratio.
+ * The lowest level checks one candidate match per position; each higher
+ * level follows a hash chain twice as deep. The output of every level is
+ * decompressed the same way.
+ */
+
+constexpr int MIN_LEVEL = 1;
+constexpr int MAX_LEVEL = 9;
+constexpr int DEFAULT_LEVEL = MIN_LEVEL;
+
+/*
+ * Appends size bytes at input, compressed, to output. level is clamped to
+ * the supported range.
+ */
+void compress(const uint8_t *input, std::size_t size,
+              std::vector<uint8_t> &output, int level = DEFAULT_LEVEL);
+
+/*
+ * Decompresses size bytes at input into exactly outputSize bytes at output.
+ * Returns false if input is malformed or decompresses to a different size.
+ */
+bool decompress(const uint8_t *input, std::size_t size, uint8_t *output,
+                std::size_t outputSize);
+
+} // namespace progressia::main::lz
@@ -0,0 +1,286 @@
+#include "job_system.h"
+
+#include <algorithm>
+
+#include "../logging.h"
+#include "../profiler.h"
+using namespace progressia::main::logging;
+
+namespace progressia::main {
+
+namespace {
+
+thread_local std::size_t currentWorker = JobSystem::NOT_A_WORKER;
+thread_local const JobSystem *currentSystem = nullptr;
+
+std::unique_ptr<JobSystem> globalJobSystem; // NOLINT
+
+std::size_t getDefaultThreadCount() {
+    std::size_t hardware = std::thread::hardware_concurrency();
+    return std::max<std::size_t>(hardware, 2) - 1;
+}
+
+} // namespace
+
+JobSystem::JobSystem(std::size_t threadCount)
+    : queuedCount(0), nextWorker(0), stopping(false),
+      mainThread(std::this_thread::get_id()) {
+
+    if (threadCount == 0) {
+        threadCount = getDefaultThreadCount();
+    }
+
+    workers.reserve(threadCount);
+    for (std::size_t i = 0; i < threadCount; i++) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+
+    // Workers may steal from each other as soon as they start
+    for (std::size_t i = 0; i < threadCount; i++) {
+        workers[i]->thread = std::thread([this, i]() { run(i); });
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard lock(sleepMutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+
+    for (auto &worker : workers) {
+        worker->thread.join();
+    }
+}
+
+void JobSystem::enqueue(Task task) {
+    std::size_t target = 0;
+    if (currentSystem == this) {
+        target = currentWorker;
+    } else {
+        target = nextWorker.fetch_add(1, std::memory_order_relaxed) %
+                 workers.size();
+    }
+
+    // Counting before the push keeps queuedCount from underflowing when the
+    // task is taken right away. Taking sleepMutex orders the increment
+    // before the check of a worker that is about to sleep.
+    {
+        std::lock_guard lock(sleepMutex);
+        queuedCount++;
+    }
+
+    {
+        Worker &worker = *workers[target];
+        std::lock_guard lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+
+    wakeUp.notify_one();
+}
+
+void JobSystem::complete(JobCounter *counter) {
+    if (counter == nullptr) {
+        return;
+    }
+
+    // submitAfter() checks the count under the same mutex, so every
+    // continuation is either taken here or submitted directly. wait() locks
+    // it before returning, so the counter is not touched after it may be
+    // destroyed.
+    std::vector<JobCounter::Continuation> ready;
+    {
+        std::lock_guard lock(counter->mutex);
+        if (counter->count.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return;
+        }
+        ready.swap(counter->continuations);
+    }
+
+    for (auto &continuation : ready) {
+        enqueue({std::move(continuation.job), continuation.counter});
+    }
+
+    {
+        std::lock_guard lock(sleepMutex);
+    }
+    counterDone.notify_all();
+}
+
+void JobSystem::execute(Task &task) {
+    task.job();
+    task.job = nullptr;
+    complete(task.counter);
+}
+
+void JobSystem::submit(Job job, JobCounter *counter) {
+    if (counter != nullptr) {
+        counter->count.fetch_add(1, std::memory_order_relaxed);
+    }
+    enqueue({std::move(job), counter});
+}
+
+void JobSystem::submitAfter(JobCounter &dependency, Job job,
+                            JobCounter *counter) {
+    if (counter != nullptr) {
+        counter->count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    {
+        std::lock_guard lock(dependency.mutex);
+        if (!dependency.isDone()) {
+            dependency.continuations.push_back({std::move(job), counter});
+            return;
+        }
+    }
+
+    enqueue({std::move(job), counter});
+}
+
+void JobSystem::submitToMain(Job job, JobCounter *counter) {
+    if (counter != nullptr) {
+        counter->count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    {
+        std::lock_guard lock(mainMutex);
+        mainTasks.push_back({std::move(job), counter});
+    }
+
+    // The main thread may be waiting for a counter that this job completes
+    {
+        std::lock_guard lock(sleepMutex);
+    }
+    counterDone.notify_all();
+}
+
+void JobSystem::runMainThreadJobs() {
+    std::vector<Task> tasks;
+    {
+        std::lock_guard lock(mainMutex);
+        tasks.swap(mainTasks);
+    }
+
+    for (auto &task : tasks) {
+        execute(task);
+    }
+}
+
+bool JobSystem::tryPop(std::size_t index, Task &task) {
+    Worker &worker = *workers[index];
+    std::lock_guard lock(worker.mutex);
+    if (worker.tasks.empty()) {
+        return false;
+    }
+
+    task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    queuedCount--;
+    return true;
+}
+
+bool JobSystem::trySteal(std::size_t thief, Task &task) {
+    std::size_t first = thief == NOT_A_WORKER ? 0 : thief + 1;
+
+    for (std::size_t i = 0; i < workers.size(); i++) {
+        std::size_t index = (first + i) % workers.size();
+        if (index == thief) {
+            continue;
+        }
+
+        Worker &victim = *workers[index];
+        std::unique_lock lock(victim.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || victim.tasks.empty()) {
+            continue;
+        }
+
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        queuedCount--;
+        return true;
+    }
+    return false;
+}
+
+void JobSystem::run(std::size_t index) {
+    currentWorker = index;
+    currentSystem = this;
+    profiler::setThreadName("Job worker");
+
+    Task task;
+    while (true) {
+        if (tryPop(index, task) || trySteal(index, task)) {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock lock(sleepMutex);
+        if (stopping) {
+            return;
+        }
+
+        // A failed try_lock may have skipped a task, so only sleep when
+        // nothing is queued anywhere
+        wakeUp.wait(lock, [this]() { return stopping || queuedCount > 0; });
+    }
+}
+
+void JobSystem::wait(JobCounter &counter) {
+    bool isMain = isMainThread();
+    std::size_t self = currentSystem == this ? currentWorker : NOT_A_WORKER;
+
+    Task task;
+    while (!counter.isDone()) {
+        if (isMain) {
+            runMainThreadJobs();
+        }
+
+        bool found = self == NOT_A_WORKER ? trySteal(self, task)
+                                          : tryPop(self, task) ||
+                                                trySteal(self, task);
+        if (found) {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock lock(sleepMutex);
+        counterDone.wait(lock, [&]() {
+            if (counter.isDone() || queuedCount > 0) {
+                return true;
+            }
+
+            std::lock_guard mainLock(mainMutex);
+            return isMain && !mainTasks.empty();
+        });
+    }
+
+    // Let the job that completed the counter leave complete()
+    std::lock_guard lock(counter.mutex);
+}
+
+std::size_t JobSystem::getThreadCount() const { return workers.size(); }
+
+bool JobSystem::isMainThread() const {
+    return std::this_thread::get_id() == mainThread;
+}
+
+std::size_t JobSystem::getCurrentWorker() { return currentWorker; }
+
+void initializeJobSystem(std::size_t threadCount) {
+    globalJobSystem = std::make_unique<JobSystem>(threadCount);
+    debug() << "Job system started with " << globalJobSystem->getThreadCount()
+            << " workers";
+}
+
+void shutdownJobSystem() { globalJobSystem.reset(); }
+
+JobSystem &getJobSystem() {
+    if (!globalJobSystem) {
+        fatal("Job system used before initialization");
+        // REPORT_ERROR
+        exit(1);
+    }
+    return *globalJobSystem;
+}
+
+} // namespace progressia::main
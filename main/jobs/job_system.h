@@ -0,0 +1,159 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../util.h"
+
+namespace progressia::main {
+
+class JobSystem;
+
+/*
+ * Counts unfinished jobs of a group. Jobs submitted with a counter increment
+ * it immediately and decrement it when they return. A counter must outlive
+ * its jobs; wait for it before destroying it.
+ */
+class JobCounter : private NonCopyable {
+  private:
+    friend class JobSystem;
+
+    struct Continuation {
+        std::function<void()> job;
+        JobCounter *counter;
+    };
+
+    std::atomic<std::size_t> count;
+
+    std::mutex mutex;
+    std::vector<Continuation> continuations;
+
+  public:
+    JobCounter() : count(0) {}
+
+    bool isDone() const { return count.load(std::memory_order_acquire) == 0; }
+};
+
+/*
+ * A pool of worker threads that run submitted jobs in no particular order.
+ *
+ * Each worker owns a deque. Jobs submitted by a worker go to its own deque
+ * and are taken from the back, so related work stays on one core. Jobs
+ * submitted by other threads are spread between workers. An idle worker
+ * steals from the front of other deques before going to sleep.
+ *
+ * Jobs that must run on the main thread, such as GraphicsInterface calls,
+ * are queued separately and run by runMainThreadJobs(). The main thread is
+ * the thread that created the JobSystem.
+ *
+ * Jobs must not throw. The destructor runs all queued jobs, including jobs
+ * submitted by them, before joining the workers. Main thread jobs that are
+ * still queued are discarded.
+ */
+class JobSystem : private NonCopyable {
+  public:
+    using Job = std::function<void()>;
+
+    constexpr static std::size_t NOT_A_WORKER = SIZE_MAX;
+
+  private:
+    struct Task {
+        Job job;
+        JobCounter *counter;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    // Number of tasks in all deques
+    std::atomic<std::size_t> queuedCount;
+    std::atomic<std::size_t> nextWorker;
+    std::atomic<bool> stopping;
+
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    std::condition_variable counterDone;
+
+    std::thread::id mainThread;
+    std::mutex mainMutex;
+    std::vector<Task> mainTasks;
+
+    void enqueue(Task);
+    void complete(JobCounter *);
+    void execute(Task &);
+
+    bool tryPop(std::size_t worker, Task &);
+    bool trySteal(std::size_t thief, Task &);
+    void run(std::size_t worker);
+
+  public:
+    /*
+     * Starts threadCount workers. Zero selects one worker per hardware
+     * thread except the one used by the caller.
+     */
+    explicit JobSystem(std::size_t threadCount = 0);
+    ~JobSystem();
+
+    void submit(Job, JobCounter *counter = nullptr);
+
+    /*
+     * Submits job once dependency reaches zero. counter is incremented
+     * right away.
+     */
+    void submitAfter(JobCounter &dependency, Job,
+                     JobCounter *counter = nullptr);
+
+    /*
+     * Queues job for the next runMainThreadJobs() call.
+     */
+    void submitToMain(Job, JobCounter *counter = nullptr);
+
+    /*
+     * Runs jobs queued with submitToMain(). Must be called by the main
+     * thread regularly, typically once per frame.
+     */
+    void runMainThreadJobs();
+
+    /*
+     * Blocks until counter reaches zero. The calling thread runs other jobs
+     * while it waits, including main thread jobs when called by the main
+     * thread, so waiting inside a job does not deadlock.
+     */
+    void wait(JobCounter &);
+
+    std::size_t getThreadCount() const;
+    bool isMainThread() const;
+
+    /*
+     * Returns the index of the calling worker in its JobSystem or
+     * NOT_A_WORKER.
+     */
+    static std::size_t getCurrentWorker();
+};
+
+/*
+ * Creates the JobSystem shared by the engine. Must be called by the main
+ * thread before getJobSystem().
+ */
+void initializeJobSystem(std::size_t threadCount = 0);
+
+/*
+ * Destroys the shared JobSystem. All users must have waited for their jobs.
+ */
+void shutdownJobSystem();
+
+JobSystem &getJobSystem();
+
+} // namespace progressia::main
@@ -0,0 +1,233 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "logging.h"
+using namespace progressia::main::logging;
+
+namespace progressia::main::profiler {
+
+namespace {
+
+/*
+ * Events are stored in relaxed atomics so that dumpTrace() may read a buffer
+ * while its owner keeps writing. Events overwritten during the read are
+ * detected by the write index and discarded.
+ */
+struct Event {
+    std::atomic<const char *> name{nullptr};
+    std::atomic<uint64_t> start{0};
+    std::atomic<uint64_t> end{0};
+};
+
+struct ThreadBuffer {
+    constexpr static std::size_t CAPACITY = 1 << 14;
+
+    std::array<Event, CAPACITY> events;
+    std::atomic<uint64_t> written{0};
+    std::atomic<const char *> threadName{nullptr};
+    uint64_t threadId;
+
+    explicit ThreadBuffer(uint64_t threadId) : threadId(threadId) {}
+};
+
+struct Registry {
+    std::mutex mutex;
+    // Buffers outlive their threads so that events remain available
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    std::atomic<bool> dumpRequested{false};
+    const std::chrono::steady_clock::time_point epoch =
+        std::chrono::steady_clock::now();
+};
+
+Registry &getRegistry() {
+    static Registry registry;
+    return registry;
+}
+
+ThreadBuffer &getThreadBuffer() {
+    thread_local std::shared_ptr<ThreadBuffer> buffer = []() {
+        auto &registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        auto result = std::make_shared<ThreadBuffer>(registry.buffers.size());
+        registry.buffers.push_back(result);
+        return result;
+    }();
+
+    return *buffer;
+}
+
+void writeEscaped(std::ostream &out, const char *str) {
+    for (; *str != '\0'; str++) {
+        char c = *str;
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) >= ' ') {
+            out << c;
+        }
+    }
+}
+
+// Chrome traces use microseconds; keep 0.1 us precision
+void writeMicroseconds(std::ostream &out, uint64_t ns) {
+    constexpr uint64_t NS_PER_US = 1000;
+    constexpr uint64_t NS_PER_DIGIT = 100;
+    out << ns / NS_PER_US << '.' << ns % NS_PER_US / NS_PER_DIGIT;
+}
+
+struct EventCopy {
+    const char *name;
+    uint64_t start;
+    uint64_t end;
+};
+
+std::vector<EventCopy> copyEvents(const ThreadBuffer &buffer) {
+    constexpr auto CAPACITY = ThreadBuffer::CAPACITY;
+
+    uint64_t before = buffer.written.load(std::memory_order_acquire);
+    uint64_t first = before > CAPACITY ? before - CAPACITY : 0;
+
+    std::vector<EventCopy> result;
+    result.reserve(before - first);
+
+    for (uint64_t i = first; i < before; i++) {
+        const auto &event = buffer.events[i % CAPACITY];
+        result.push_back({event.name.load(std::memory_order_relaxed),
+                          event.start.load(std::memory_order_relaxed),
+                          event.end.load(std::memory_order_relaxed)});
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t after = buffer.written.load(std::memory_order_relaxed);
+
+    // Discard events that the owner may have overwritten while copying
+    uint64_t safeFirst = after > CAPACITY ? after - CAPACITY : 0;
+    if (safeFirst > first) {
+        auto overwritten = std::min<uint64_t>(safeFirst - first, result.size());
+        result.erase(result.begin(),
+                     result.begin() + static_cast<std::ptrdiff_t>(overwritten));
+    }
+
+    return result;
+}
+
+} // namespace
+
+uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - getRegistry().epoch)
+        .count();
+}
+
+void record(const char *name, uint64_t start, uint64_t end) {
+    auto &buffer = getThreadBuffer();
+
+    uint64_t index = buffer.written.load(std::memory_order_relaxed);
+    auto &event = buffer.events[index % ThreadBuffer::CAPACITY];
+
+    event.name.store(name, std::memory_order_relaxed);
+    event.start.store(start, std::memory_order_relaxed);
+    event.end.store(end, std::memory_order_relaxed);
+
+    buffer.written.store(index + 1, std::memory_order_release);
+}
+
+void setThreadName(const char *name) {
+    getThreadBuffer().threadName.store(name, std::memory_order_relaxed);
+}
+
+bool dumpTrace(const std::string &path) {
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        auto &registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        buffers = registry.buffers;
+    }
+
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+
+    std::size_t eventCount = 0;
+    bool first = true;
+
+    auto separator = [&]() -> std::ostream & {
+        out << (first ? "\n" : ",\n");
+        first = false;
+        return out;
+    };
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    for (const auto &buffer : buffers) {
+        const char *threadName =
+            buffer->threadName.load(std::memory_order_relaxed);
+        if (threadName != nullptr) {
+            separator() << R"({"name":"thread_name","ph":"M","pid":1,"tid":)"
+                        << buffer->threadId << R"(,"args":{"name":")";
+            writeEscaped(out, threadName);
+            out << "\"}}";
+        }
+
+        for (const auto &event : copyEvents(*buffer)) {
+            separator() << "{\"name\":\"";
+            writeEscaped(out, event.name);
+            out << R"(","cat":"cpu","ph":"X","pid":1,"tid":)"
+                << buffer->threadId << ",\"ts\":";
+            writeMicroseconds(out, event.start);
+            out << ",\"dur\":";
+            writeMicroseconds(out, event.end - event.start);
+            out << "}";
+            eventCount++;
+        }
+    }
+
+    out << "\n]}\n";
+    out.close();
+
+    if (!out) {
+        return false;
+    }
+
+    info() << "Wrote " << eventCount << " profiler events to " << path;
+    return true;
+}
+
+void requestDump() {
+    getRegistry().dumpRequested.store(true, std::memory_order_relaxed);
+}
+
+void onFrameEnd() {
+    if (!getRegistry().dumpRequested.exchange(false,
+                                              std::memory_order_relaxed)) {
+        return;
+    }
+
+    // FIXME this is relative to bin, not root dir
+    std::error_code errorCode;
+    std::filesystem::create_directories("run/traces", errorCode);
+    if (errorCode) {
+        error() << "Could not create directory run/traces: "
+                << errorCode.message();
+        return;
+    }
+
+    std::string path = "run/traces/trace-" +
+                       std::to_string(std::time(nullptr)) + ".json";
+    if (!dumpTrace(path)) {
+        error() << "Could not write trace to " << path;
+    }
+}
+
+} // namespace progressia::main::profiler
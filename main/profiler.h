@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "util.h"
+
+namespace progressia::main::profiler {
+
+/*
+ * Returns nanoseconds since profiler epoch.
+ */
+uint64_t now();
+
+/*
+ * Appends a completed event to the ring buffer of the calling thread. name
+ * must be a string with static storage duration.
+ *
+ * Only the calling thread writes to its buffer, so no locks are taken unless
+ * this is the first event recorded by the thread.
+ */
+void record(const char *name, uint64_t start, uint64_t end);
+
+/*
+ * Sets the name of the calling thread as shown in traces. name must be a
+ * string with static storage duration.
+ */
+void setThreadName(const char *name);
+
+/*
+ * Writes all events currently held in ring buffers to a Chrome trace JSON
+ * file, readable by chrome://tracing and Perfetto. Returns false on I/O
+ * errors.
+ */
+bool dumpTrace(const std::string &path);
+
+/*
+ * Schedules a trace dump into run/traces at the end of the current frame.
+ * Safe to call from any thread.
+ */
+void requestDump();
+
+/*
+ * Performs a requested dump, if any. Must be called between frames.
+ */
+void onFrameEnd();
+
+/*
+ * Records the time between construction and destruction.
+ */
+class Scope : private NonCopyable {
+  private:
+    const char *name;
+    uint64_t start;
+
+  public:
+    explicit Scope(const char *name) : name(name), start(now()) {}
+    ~Scope() { record(name, start, now()); }
+};
+
+} // namespace progressia::main::profiler
+
+#define PROFILER_CONCAT_IMPL(A, B) A##B
+#define PROFILER_CONCAT(A, B) PROFILER_CONCAT_IMPL(A, B)
+
+// clang-format off
+#define PROFILE_SCOPE(NAME)                                           \
+    ::progressia::main::profiler::Scope PROFILER_CONCAT(profilerScope, \
+                                                        __LINE__)(NAME)
+// clang-format on
+
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
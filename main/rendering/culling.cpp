@@ -0,0 +1,151 @@
+#include "culling.h"
+
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) ||                                     \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define PROGRESSIA_CULLING_SSE
+#include <xmmintrin.h>
+#endif
+
+#include <glm/common.hpp>
+
+namespace progressia::main {
+
+BoundingBox computeBoundingBox(const std::vector<Vertex> &vertices) {
+    if (vertices.empty()) {
+        return {glm::vec3(0), glm::vec3(0)};
+    }
+
+    BoundingBox box{vertices[0].position, vertices[0].position};
+    for (const auto &vertex : vertices) {
+        box.min = glm::min(box.min, vertex.position);
+        box.max = glm::max(box.max, vertex.position);
+    }
+    return box;
+}
+
+Frustum::Frustum() : planes{} {}
+
+Frustum::Frustum(const glm::mat4 &m) {
+    // glm matrices are column-major, so row i is (m[0][i], ..., m[3][i])
+    auto row = [&m](int i) {
+        return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+    };
+
+    planes[0] = row(3) + row(0); // Left
+    planes[1] = row(3) - row(0); // Right
+    planes[2] = row(3) + row(1); // Bottom, or top if Y is flipped
+    planes[3] = row(3) - row(1); // Top, or bottom if Y is flipped
+    planes[4] = row(2);          // Near, for depth in [0; 1]
+    planes[5] = row(3) - row(2); // Far
+}
+
+const std::array<glm::vec4, 6> &Frustum::getPlanes() const { return planes; }
+
+void BoxBatch::clear() {
+    centerX.clear();
+    centerY.clear();
+    centerZ.clear();
+    extentX.clear();
+    extentY.clear();
+    extentZ.clear();
+}
+
+void BoxBatch::reserve(std::size_t size) {
+    centerX.reserve(size);
+    centerY.reserve(size);
+    centerZ.reserve(size);
+    extentX.reserve(size);
+    extentY.reserve(size);
+    extentZ.reserve(size);
+}
+
+std::size_t BoxBatch::getSize() const { return centerX.size(); }
+
+void BoxBatch::add(const BoundingBox &box, const glm::mat4 &m) {
+    glm::vec3 center = (box.min + box.max) * 0.5F;
+    glm::vec3 extent = (box.max - box.min) * 0.5F;
+
+    glm::vec4 newCenter = m * glm::vec4(center, 1.0F);
+
+    // Each new half-extent is the projection of the transformed box axes
+    glm::vec3 newExtent(0);
+    for (int axis = 0; axis < 3; axis++) {
+        for (int i = 0; i < 3; i++) {
+            newExtent[axis] += std::abs(m[i][axis]) * extent[i];
+        }
+    }
+
+    centerX.push_back(newCenter.x);
+    centerY.push_back(newCenter.y);
+    centerZ.push_back(newCenter.z);
+    extentX.push_back(newExtent.x);
+    extentY.push_back(newExtent.y);
+    extentZ.push_back(newExtent.z);
+}
+
+std::size_t BoxBatch::cull(const Frustum &frustum, uint8_t *visible) const {
+    const auto &planes = frustum.getPlanes();
+    std::size_t size = getSize();
+    std::size_t visibleCount = 0;
+    std::size_t i = 0;
+
+#ifdef PROGRESSIA_CULLING_SSE
+    constexpr std::size_t LANES = 4;
+    const __m128 zero = _mm_setzero_ps();
+
+    for (; i + LANES <= size; i += LANES) {
+        __m128 cx = _mm_loadu_ps(&centerX[i]);
+        __m128 cy = _mm_loadu_ps(&centerY[i]);
+        __m128 cz = _mm_loadu_ps(&centerZ[i]);
+        __m128 ex = _mm_loadu_ps(&extentX[i]);
+        __m128 ey = _mm_loadu_ps(&extentY[i]);
+        __m128 ez = _mm_loadu_ps(&extentZ[i]);
+
+        __m128 inside = _mm_cmpeq_ps(zero, zero);
+
+        for (const auto &plane : planes) {
+            // Distance of the center plus the extent projected on the normal
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.x)),
+                           _mm_mul_ps(cy, _mm_set1_ps(plane.y))),
+                _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(plane.z)),
+                           _mm_set1_ps(plane.w)));
+            __m128 radius = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(std::abs(plane.x))),
+                           _mm_mul_ps(ey, _mm_set1_ps(std::abs(plane.y)))),
+                _mm_mul_ps(ez, _mm_set1_ps(std::abs(plane.z))));
+
+            inside = _mm_and_ps(
+                inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+        }
+
+        auto mask = static_cast<unsigned>(_mm_movemask_ps(inside));
+        for (std::size_t lane = 0; lane < LANES; lane++) {
+            auto bit = static_cast<uint8_t>((mask >> lane) & 1U);
+            visible[i + lane] = bit;
+            visibleCount += bit;
+        }
+    }
+#endif
+
+    for (; i < size; i++) {
+        bool inside = true;
+        for (const auto &plane : planes) {
+            float distance = centerX[i] * plane.x + centerY[i] * plane.y +
+                             centerZ[i] * plane.z + plane.w;
+            float radius = extentX[i] * std::abs(plane.x) +
+                           extentY[i] * std::abs(plane.y) +
+                           extentZ[i] * std::abs(plane.z);
+            inside = inside && distance + radius >= 0;
+        }
+
+        visible[i] = inside ? 1 : 0;
+        visibleCount += visible[i];
+    }
+
+    return visibleCount;
+}
+
+} // namespace progressia::main
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include "graphics_interface.h"
+
+namespace progressia::main {
+
+struct BoundingBox {
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+/*
+ * Returns the smallest box that contains all vertex positions.
+ */
+BoundingBox computeBoundingBox(const std::vector<Vertex> &);
+
+/*
+ * The volume visible through a projection, as six planes facing inwards.
+ */
+class Frustum {
+  private:
+    // (normal, distance) pairs; points p with dot(normal, p) + distance < 0
+    // are outside. Planes are not normalized, which does not affect the sign.
+    std::array<glm::vec4, 6> planes;
+
+  public:
+    /*
+     * Creates a frustum that contains everything.
+     */
+    Frustum();
+
+    /*
+     * Extracts planes of proj * view. Depth is expected in [0; 1].
+     */
+    explicit Frustum(const glm::mat4 &viewProjection);
+
+    const std::array<glm::vec4, 6> &getPlanes() const;
+};
+
+/*
+ * Transformed bounding boxes in structure-of-arrays layout, so that several
+ * boxes can be tested against a plane with one SIMD instruction.
+ */
+class BoxBatch {
+  private:
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> extentX;
+    std::vector<float> extentY;
+    std::vector<float> extentZ;
+
+  public:
+    void clear();
+    void reserve(std::size_t);
+    std::size_t getSize() const;
+
+    /*
+     * Adds the axis-aligned box that contains box transformed by transform.
+     */
+    void add(const BoundingBox &box, const glm::mat4 &transform);
+
+    /*
+     * Sets visible[i] to 1 for boxes that may intersect frustum and to 0
+     * for others. Returns the number of visible boxes. Uses SSE when the
+     * target supports it.
+     */
+    std::size_t cull(const Frustum &, uint8_t *visible) const;
+};
+
+} // namespace progressia::main
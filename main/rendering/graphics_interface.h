@@ -22,6 +22,13 @@ struct Vertex {
     glm::vec4 color;
     glm::vec3 normal;
     glm::vec2 texCoord;
+
+    // Block light and skylight from 0 to 1; unlit geometry is in full
+    // skylight
+    glm::vec2 light = {0, 1};
+
+    // Ambient occlusion from 0 for fully occluded to 1 for open corners
+    float occlusion = 1;
 };
 
 class Texture : private progressia::main::NonCopyable {
@@ -85,6 +92,15 @@ class GraphicsInterface : private progressia::main::NonCopyable {
   public:
     using Backend = void *;
 
+    /*
+     * Draw requests of the current frame so far that were recorded or
+     * skipped by frustum culling.
+     */
+    struct CullingStats {
+        uint64_t visible;
+        uint64_t culled;
+    };
+
   private:
     Backend backend;
 
@@ -108,6 +124,21 @@ class GraphicsInterface : private progressia::main::NonCopyable {
     void flush();
     void startNextLayer();
 
+    /*
+     * Enables or disables frustum culling of draw requests. Enabled by
+     * default.
+     */
+    void setCullingEnabled(bool);
+    CullingStats getCullingStats();
+
+    /*
+     * Moves frustum culling to a compute shader that writes indirect draw
+     * commands, if the device supports it. getCullingStats() then describes
+     * the latest frame completed by the device. Disabled by default.
+     */
+    void setGpuCullingEnabled(bool);
+    bool isGpuCullingSupported();
+
     float tmp_getTime();
     uint64_t getLastStartedFrame();
 };
@@ -1,5 +1,7 @@
 #include "image.h"
 
+#include <array>
+#include <cstdint>
 #include <cstring>
 #include <filesystem>
 #include <fstream>
@@ -12,6 +14,7 @@
 #include <embedded_resources.h>
 
 #include "../logging.h"
+#include "../profiler.h"
 using namespace progressia::main::logging;
 
 namespace progressia::main {
@@ -23,6 +26,7 @@ const Image::Byte *Image::getData() const { return data.data(); }
 Image::Byte *Image::getData() { return data.data(); }
 
 Image loadImage(const std::string &path) {
+    PROFILE_SCOPE("loadImage");
 
     auto resource = __embedded_resources::getEmbeddedResource(path);
 
@@ -66,4 +70,41 @@ Image loadImage(const std::string &path) {
             data};
 }
 
+bool saveImageTga(const Image &image, const std::string &path) {
+    constexpr std::size_t HEADER_SIZE = 18;
+    constexpr std::size_t BYTES_PER_PIXEL = 4;
+
+    constexpr Image::Byte TYPE_UNCOMPRESSED_TRUE_COLOR = 2;
+    constexpr Image::Byte BITS_PER_PIXEL = 32;
+    // 8 alpha bits, origin in the top left corner
+    constexpr Image::Byte DESCRIPTOR = 8 | (1 << 5);
+
+    if (image.width > UINT16_MAX || image.height > UINT16_MAX) {
+        return false;
+    }
+
+    std::array<Image::Byte, HEADER_SIZE> header{};
+    header[2] = TYPE_UNCOMPRESSED_TRUE_COLOR;
+    header[12] = image.width & 0xFF;
+    header[13] = image.width >> 8;
+    header[14] = image.height & 0xFF;
+    header[15] = image.height >> 8;
+    header[16] = BITS_PER_PIXEL;
+    header[17] = DESCRIPTOR;
+
+    // TGA stores pixels in BGRA order
+    std::vector<Image::Byte> pixels(image.data);
+    for (std::size_t i = 0; i + BYTES_PER_PIXEL <= pixels.size();
+         i += BYTES_PER_PIXEL) {
+        std::swap(pixels[i], pixels[i + 2]);
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(header.data()), header.size());
+    file.write(reinterpret_cast<const char *>(pixels.data()),
+               static_cast<std::streamsize>(pixels.size()));
+
+    return static_cast<bool>(file);
+}
+
 } // namespace progressia::main
@@ -20,4 +20,10 @@ class Image {
 
 Image loadImage(const std::string &);
 
+/*
+ * Writes an RGBA image as an uncompressed TGA file. Returns false on I/O
+ * errors.
+ */
+bool saveImageTga(const Image &, const std::string &path);
+
 } // namespace progressia::main
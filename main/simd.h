@@ -0,0 +1,418 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PROGRESSIA_SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) ||                                \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PROGRESSIA_SIMD_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PROGRESSIA_SIMD_NEON
+#endif
+
+/*
+ * Thin wrappers over vectors of 32-bit lanes for kernels that are written
+ * once and compiled for several instruction sets.
+ *
+ * Each backend is a namespace with the types Float, Int and Mask and the
+ * same set of operators and free functions, so generic code calls them
+ * unqualified and lets argument-dependent lookup pick the backend. Every
+ * backend also has a descriptor struct (Scalar, Sse2, ...) with these types,
+ * WIDTH and NAME for use as a template argument.
+ *
+ * Int arithmetic wraps around and shifts are logical; comparisons and
+ * conversions treat Int lanes as signed. Masks have all bits of a lane set
+ * or cleared.
+ *
+ * Scalar is always available. Native is the widest backend enabled by the
+ * compiler flags; AVX2 has to be enabled explicitly, see SIMD_AVX2 in
+ * CMakeLists.txt.
+ */
+namespace progressia::main::simd {
+
+namespace scalar {
+
+struct Float {
+    float v;
+
+    static Float splat(float a) { return {a}; }
+    static Float load(const float *p) { return {*p}; }
+    void store(float *p) const { *p = v; }
+};
+
+struct Int {
+    uint32_t v;
+
+    static Int splat(uint32_t a) { return {a}; }
+    static Int load(const uint32_t *p) { return {*p}; }
+    void store(uint32_t *p) const { *p = v; }
+};
+
+struct Mask {
+    bool v;
+};
+
+inline Float operator+(Float a, Float b) { return {a.v + b.v}; }
+inline Float operator-(Float a, Float b) { return {a.v - b.v}; }
+inline Float operator*(Float a, Float b) { return {a.v * b.v}; }
+inline Float min(Float a, Float b) { return {std::min(a.v, b.v)}; }
+inline Float max(Float a, Float b) { return {std::max(a.v, b.v)}; }
+inline Float abs(Float a) { return {std::fabs(a.v)}; }
+inline Float floor(Float a) { return {std::floor(a.v)}; }
+
+inline Mask operator<(Float a, Float b) { return {a.v < b.v}; }
+inline Mask operator>(Float a, Float b) { return {a.v > b.v}; }
+inline Mask operator>=(Float a, Float b) { return {a.v >= b.v}; }
+
+inline Int operator+(Int a, Int b) { return {a.v + b.v}; }
+inline Int operator*(Int a, Int b) { return {a.v * b.v}; }
+inline Int operator&(Int a, Int b) { return {a.v & b.v}; }
+inline Int operator|(Int a, Int b) { return {a.v | b.v}; }
+inline Int operator^(Int a, Int b) { return {a.v ^ b.v}; }
+inline Int operator<<(Int a, int n) { return {a.v << n}; }
+inline Int operator>>(Int a, int n) { return {a.v >> n}; }
+
+inline Mask operator==(Int a, Int b) { return {a.v == b.v}; }
+inline Mask operator<(Int a, Int b) {
+    return {static_cast<int32_t>(a.v) < static_cast<int32_t>(b.v)};
+}
+
+inline Mask operator&(Mask a, Mask b) { return {a.v && b.v}; }
+inline Mask operator|(Mask a, Mask b) { return {a.v || b.v}; }
+inline Mask operator~(Mask a) { return {!a.v}; }
+
+inline Float select(Mask m, Float a, Float b) { return m.v ? a : b; }
+inline Int select(Mask m, Int a, Int b) { return m.v ? a : b; }
+
+// Rounds towards zero
+inline Int toInt(Float a) {
+    return {static_cast<uint32_t>(static_cast<int32_t>(a.v))};
+}
+inline Float toFloat(Int a) {
+    return {static_cast<float>(static_cast<int32_t>(a.v))};
+}
+
+} // namespace scalar
+
+struct Scalar {
+    using Float = scalar::Float;
+    using Int = scalar::Int;
+    using Mask = scalar::Mask;
+    constexpr static std::size_t WIDTH = 1;
+    constexpr static const char *NAME = "scalar";
+};
+
+#if defined(PROGRESSIA_SIMD_SSE2)
+
+namespace sse2 {
+
+struct Float {
+    __m128 v;
+
+    static Float splat(float a) { return {_mm_set1_ps(a)}; }
+    static Float load(const float *p) { return {_mm_loadu_ps(p)}; }
+    void store(float *p) const { _mm_storeu_ps(p, v); }
+};
+
+struct Int {
+    __m128i v;
+
+    static Int splat(uint32_t a) {
+        return {_mm_set1_epi32(static_cast<int>(a))};
+    }
+    static Int load(const uint32_t *p) {
+        return {_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))};
+    }
+    void store(uint32_t *p) const {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+    }
+};
+
+struct Mask {
+    __m128i v;
+};
+
+inline Float operator+(Float a, Float b) { return {_mm_add_ps(a.v, b.v)}; }
+inline Float operator-(Float a, Float b) { return {_mm_sub_ps(a.v, b.v)}; }
+inline Float operator*(Float a, Float b) { return {_mm_mul_ps(a.v, b.v)}; }
+inline Float min(Float a, Float b) { return {_mm_min_ps(a.v, b.v)}; }
+inline Float max(Float a, Float b) { return {_mm_max_ps(a.v, b.v)}; }
+inline Float abs(Float a) {
+    return {_mm_andnot_ps(_mm_set1_ps(-0.0F), a.v)};
+}
+
+inline Mask operator<(Float a, Float b) {
+    return {_mm_castps_si128(_mm_cmplt_ps(a.v, b.v))};
+}
+inline Mask operator>(Float a, Float b) {
+    return {_mm_castps_si128(_mm_cmpgt_ps(a.v, b.v))};
+}
+inline Mask operator>=(Float a, Float b) {
+    return {_mm_castps_si128(_mm_cmpge_ps(a.v, b.v))};
+}
+
+inline Int operator+(Int a, Int b) { return {_mm_add_epi32(a.v, b.v)}; }
+inline Int operator&(Int a, Int b) { return {_mm_and_si128(a.v, b.v)}; }
+inline Int operator|(Int a, Int b) { return {_mm_or_si128(a.v, b.v)}; }
+inline Int operator^(Int a, Int b) { return {_mm_xor_si128(a.v, b.v)}; }
+inline Int operator<<(Int a, int n) { return {_mm_slli_epi32(a.v, n)}; }
+inline Int operator>>(Int a, int n) { return {_mm_srli_epi32(a.v, n)}; }
+
+// SSE2 only multiplies even lanes into 64-bit results
+inline Int operator*(Int a, Int b) {
+    __m128i even = _mm_mul_epu32(a.v, b.v);
+    __m128i odd =
+        _mm_mul_epu32(_mm_srli_epi64(a.v, 32), _mm_srli_epi64(b.v, 32));
+    even = _mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0));
+    odd = _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0));
+    return {_mm_unpacklo_epi32(even, odd)};
+}
+
+inline Mask operator==(Int a, Int b) { return {_mm_cmpeq_epi32(a.v, b.v)}; }
+inline Mask operator<(Int a, Int b) { return {_mm_cmplt_epi32(a.v, b.v)}; }
+
+inline Mask operator&(Mask a, Mask b) { return {_mm_and_si128(a.v, b.v)}; }
+inline Mask operator|(Mask a, Mask b) { return {_mm_or_si128(a.v, b.v)}; }
+inline Mask operator~(Mask a) {
+    return {_mm_xor_si128(a.v, _mm_set1_epi32(-1))};
+}
+
+inline Float select(Mask m, Float a, Float b) {
+    __m128 mask = _mm_castsi128_ps(m.v);
+    return {_mm_or_ps(_mm_and_ps(mask, a.v), _mm_andnot_ps(mask, b.v))};
+}
+inline Int select(Mask m, Int a, Int b) {
+    return {_mm_or_si128(_mm_and_si128(m.v, a.v), _mm_andnot_si128(m.v, b.v))};
+}
+
+inline Int toInt(Float a) { return {_mm_cvttps_epi32(a.v)}; }
+inline Float toFloat(Int a) { return {_mm_cvtepi32_ps(a.v)}; }
+
+// SSE2 has no rounding instruction. Truncation rounds negative numbers up,
+// which is corrected by subtracting one where the result grew.
+inline Float floor(Float a) {
+    Float truncated = toFloat(toInt(a));
+    Float one = Float::splat(1.0F);
+    __m128 grew = _mm_cmpgt_ps(truncated.v, a.v);
+    return {_mm_sub_ps(truncated.v, _mm_and_ps(grew, one.v))};
+}
+
+} // namespace sse2
+
+struct Sse2 {
+    using Float = sse2::Float;
+    using Int = sse2::Int;
+    using Mask = sse2::Mask;
+    constexpr static std::size_t WIDTH = 4;
+    constexpr static const char *NAME = "SSE2";
+};
+
+using Native = Sse2;
+
+#elif defined(PROGRESSIA_SIMD_AVX2)
+
+namespace avx2 {
+
+struct Float {
+    __m256 v;
+
+    static Float splat(float a) { return {_mm256_set1_ps(a)}; }
+    static Float load(const float *p) { return {_mm256_loadu_ps(p)}; }
+    void store(float *p) const { _mm256_storeu_ps(p, v); }
+};
+
+struct Int {
+    __m256i v;
+
+    static Int splat(uint32_t a) {
+        return {_mm256_set1_epi32(static_cast<int>(a))};
+    }
+    static Int load(const uint32_t *p) {
+        return {_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p))};
+    }
+    void store(uint32_t *p) const {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v);
+    }
+};
+
+struct Mask {
+    __m256i v;
+};
+
+inline Float operator+(Float a, Float b) {
+    return {_mm256_add_ps(a.v, b.v)};
+}
+inline Float operator-(Float a, Float b) {
+    return {_mm256_sub_ps(a.v, b.v)};
+}
+inline Float operator*(Float a, Float b) {
+    return {_mm256_mul_ps(a.v, b.v)};
+}
+inline Float min(Float a, Float b) { return {_mm256_min_ps(a.v, b.v)}; }
+inline Float max(Float a, Float b) { return {_mm256_max_ps(a.v, b.v)}; }
+inline Float abs(Float a) {
+    return {_mm256_andnot_ps(_mm256_set1_ps(-0.0F), a.v)};
+}
+inline Float floor(Float a) { return {_mm256_floor_ps(a.v)}; }
+
+inline Mask operator<(Float a, Float b) {
+    return {_mm256_castps_si256(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ))};
+}
+inline Mask operator>(Float a, Float b) {
+    return {_mm256_castps_si256(_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ))};
+}
+inline Mask operator>=(Float a, Float b) {
+    return {_mm256_castps_si256(_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ))};
+}
+
+inline Int operator+(Int a, Int b) { return {_mm256_add_epi32(a.v, b.v)}; }
+inline Int operator*(Int a, Int b) {
+    return {_mm256_mullo_epi32(a.v, b.v)};
+}
+inline Int operator&(Int a, Int b) { return {_mm256_and_si256(a.v, b.v)}; }
+inline Int operator|(Int a, Int b) { return {_mm256_or_si256(a.v, b.v)}; }
+inline Int operator^(Int a, Int b) { return {_mm256_xor_si256(a.v, b.v)}; }
+inline Int operator<<(Int a, int n) { return {_mm256_slli_epi32(a.v, n)}; }
+inline Int operator>>(Int a, int n) { return {_mm256_srli_epi32(a.v, n)}; }
+
+inline Mask operator==(Int a, Int b) {
+    return {_mm256_cmpeq_epi32(a.v, b.v)};
+}
+inline Mask operator<(Int a, Int b) {
+    return {_mm256_cmpgt_epi32(b.v, a.v)};
+}
+
+inline Mask operator&(Mask a, Mask b) {
+    return {_mm256_and_si256(a.v, b.v)};
+}
+inline Mask operator|(Mask a, Mask b) { return {_mm256_or_si256(a.v, b.v)}; }
+inline Mask operator~(Mask a) {
+    return {_mm256_xor_si256(a.v, _mm256_set1_epi32(-1))};
+}
+
+inline Float select(Mask m, Float a, Float b) {
+    return {_mm256_blendv_ps(b.v, a.v, _mm256_castsi256_ps(m.v))};
+}
+inline Int select(Mask m, Int a, Int b) {
+    return {_mm256_blendv_epi8(b.v, a.v, m.v)};
+}
+
+inline Int toInt(Float a) { return {_mm256_cvttps_epi32(a.v)}; }
+inline Float toFloat(Int a) { return {_mm256_cvtepi32_ps(a.v)}; }
+
+} // namespace avx2
+
+struct Avx2 {
+    using Float = avx2::Float;
+    using Int = avx2::Int;
+    using Mask = avx2::Mask;
+    constexpr static std::size_t WIDTH = 8;
+    constexpr static const char *NAME = "AVX2";
+};
+
+using Native = Avx2;
+
+#elif defined(PROGRESSIA_SIMD_NEON)
+
+namespace neon {
+
+struct Float {
+    float32x4_t v;
+
+    static Float splat(float a) { return {vdupq_n_f32(a)}; }
+    static Float load(const float *p) { return {vld1q_f32(p)}; }
+    void store(float *p) const { vst1q_f32(p, v); }
+};
+
+struct Int {
+    uint32x4_t v;
+
+    static Int splat(uint32_t a) { return {vdupq_n_u32(a)}; }
+    static Int load(const uint32_t *p) { return {vld1q_u32(p)}; }
+    void store(uint32_t *p) const { vst1q_u32(p, v); }
+};
+
+struct Mask {
+    uint32x4_t v;
+};
+
+inline Float operator+(Float a, Float b) { return {vaddq_f32(a.v, b.v)}; }
+inline Float operator-(Float a, Float b) { return {vsubq_f32(a.v, b.v)}; }
+inline Float operator*(Float a, Float b) { return {vmulq_f32(a.v, b.v)}; }
+inline Float min(Float a, Float b) { return {vminq_f32(a.v, b.v)}; }
+inline Float max(Float a, Float b) { return {vmaxq_f32(a.v, b.v)}; }
+inline Float abs(Float a) { return {vabsq_f32(a.v)}; }
+
+inline Mask operator<(Float a, Float b) { return {vcltq_f32(a.v, b.v)}; }
+inline Mask operator>(Float a, Float b) { return {vcgtq_f32(a.v, b.v)}; }
+inline Mask operator>=(Float a, Float b) { return {vcgeq_f32(a.v, b.v)}; }
+
+inline Int operator+(Int a, Int b) { return {vaddq_u32(a.v, b.v)}; }
+inline Int operator*(Int a, Int b) { return {vmulq_u32(a.v, b.v)}; }
+inline Int operator&(Int a, Int b) { return {vandq_u32(a.v, b.v)}; }
+inline Int operator|(Int a, Int b) { return {vorrq_u32(a.v, b.v)}; }
+inline Int operator^(Int a, Int b) { return {veorq_u32(a.v, b.v)}; }
+inline Int operator<<(Int a, int n) {
+    return {vshlq_u32(a.v, vdupq_n_s32(n))};
+}
+inline Int operator>>(Int a, int n) {
+    return {vshlq_u32(a.v, vdupq_n_s32(-n))};
+}
+
+inline Mask operator==(Int a, Int b) { return {vceqq_u32(a.v, b.v)}; }
+inline Mask operator<(Int a, Int b) {
+    return {vcltq_s32(vreinterpretq_s32_u32(a.v), vreinterpretq_s32_u32(b.v))};
+}
+
+inline Mask operator&(Mask a, Mask b) { return {vandq_u32(a.v, b.v)}; }
+inline Mask operator|(Mask a, Mask b) { return {vorrq_u32(a.v, b.v)}; }
+inline Mask operator~(Mask a) { return {vmvnq_u32(a.v)}; }
+
+inline Float select(Mask m, Float a, Float b) {
+    return {vbslq_f32(m.v, a.v, b.v)};
+}
+inline Int select(Mask m, Int a, Int b) { return {vbslq_u32(m.v, a.v, b.v)}; }
+
+inline Int toInt(Float a) {
+    return {vreinterpretq_u32_s32(vcvtq_s32_f32(a.v))};
+}
+inline Float toFloat(Int a) {
+    return {vcvtq_f32_s32(vreinterpretq_s32_u32(a.v))};
+}
+
+#if defined(__aarch64__)
+inline Float floor(Float a) { return {vrndmq_f32(a.v)}; }
+#else
+// ARMv7 has no rounding instruction, see sse2::floor()
+inline Float floor(Float a) {
+    Float truncated = toFloat(toInt(a));
+    return select(truncated > a, truncated - Float::splat(1.0F), truncated);
+}
+#endif
+
+} // namespace neon
+
+struct Neon {
+    using Float = neon::Float;
+    using Int = neon::Int;
+    using Mask = neon::Mask;
+    constexpr static std::size_t WIDTH = 4;
+    constexpr static const char *NAME = "NEON";
+};
+
+using Native = Neon;
+
+#else
+
+using Native = Scalar;
+
+#endif
+
+} // namespace progressia::main::simd
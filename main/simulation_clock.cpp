@@ -0,0 +1,56 @@
+#include "simulation_clock.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "profiler.h"
+
+namespace progressia::main {
+
+SimulationClock::SimulationClock(const SimulationSettings &settings)
+    : settings(settings), tickLength(1 / settings.tickRate), accumulator(0) {}
+
+unsigned SimulationClock::advance(double elapsed,
+                                  const std::function<void()> &tick) {
+    // Weight of the newest tick in averageTickTime
+    constexpr double SMOOTHING = 0.05;
+    constexpr double NS_PER_US = 1000;
+
+    accumulator += std::max(elapsed, 0.0);
+
+    unsigned count = 0;
+    while (accumulator >= tickLength && count < settings.maxTicksPerAdvance) {
+        uint64_t start = profiler::now();
+        {
+            PROFILE_SCOPE("Tick");
+            tick();
+        }
+        double time = static_cast<double>(profiler::now() - start) / NS_PER_US;
+
+        accumulator -= tickLength;
+        count++;
+
+        stats.lastTickTime = time;
+        stats.maxTickTime = std::max(stats.maxTickTime, time);
+        stats.averageTickTime = stats.ticks == 0
+                                    ? time
+                                    : stats.averageTickTime +
+                                          (time - stats.averageTickTime) *
+                                              SMOOTHING;
+        stats.ticks++;
+    }
+
+    // Too far behind: keep the fraction of a tick so that interpolation
+    // stays smooth, and drop whole ticks
+    if (accumulator >= tickLength) {
+        double remainder = std::fmod(accumulator, tickLength);
+        stats.droppedTicks += static_cast<uint64_t>(
+            std::llround((accumulator - remainder) / tickLength));
+        accumulator = remainder;
+    }
+
+    stats.lastAdvanceTicks = count;
+    return count;
+}
+
+} // namespace progressia::main
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#include "util.h"
+
+namespace progressia::main {
+
+struct SimulationSettings {
+    // Ticks per second of simulated time
+    double tickRate = 20;
+
+    // Ticks run by one advance() at most. Time beyond that is dropped, so
+    // that slow ticks cannot make each frame run more of them.
+    unsigned maxTicksPerAdvance = 5;
+};
+
+/*
+ * Runs simulation ticks at a fixed rate, independent of the frame rate.
+ *
+ * Real time passed to advance() accumulates, and each full tick length of
+ * it runs one tick. The remainder carries over to the next frame; renderers
+ * interpolate between the last two simulation states by getAlpha().
+ *
+ * Not thread-safe.
+ */
+class SimulationClock : private NonCopyable {
+  public:
+    struct Stats {
+        uint64_t ticks = 0;
+
+        // Ticks skipped because of the catch-up limit
+        uint64_t droppedTicks = 0;
+
+        // Ticks run by the last advance()
+        unsigned lastAdvanceTicks = 0;
+
+        // Durations of the last tick, the slowest one and an exponential
+        // moving average, in microseconds
+        double lastTickTime = 0;
+        double maxTickTime = 0;
+        double averageTickTime = 0;
+    };
+
+  private:
+    SimulationSettings settings;
+    double tickLength;
+
+    // Real time not yet simulated, at most tickLength between calls
+    double accumulator;
+
+    Stats stats;
+
+  public:
+    explicit SimulationClock(const SimulationSettings & = {});
+
+    /*
+     * Adds elapsed seconds of real time and calls tick once for each tick
+     * that is due. Returns the number of ticks run.
+     */
+    unsigned advance(double elapsed, const std::function<void()> &tick);
+
+    /*
+     * Returns the fraction of a tick that has passed since the last one,
+     * from 0 to 1.
+     */
+    float getAlpha() const {
+        return static_cast<float>(accumulator / tickLength);
+    }
+
+    double getTickLength() const { return tickLength; }
+
+    /*
+     * Returns simulated seconds at the end of the last tick.
+     */
+    double getTime() const {
+        return static_cast<double>(stats.ticks) * tickLength;
+    }
+
+    const Stats &getStats() const { return stats; }
+};
+
+} // namespace progressia::main
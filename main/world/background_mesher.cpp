@@ -0,0 +1,205 @@
+#include "background_mesher.h"
+
+#include <algorithm>
+
+#include "../profiler.h"
+
+namespace progressia::main {
+
+BackgroundMesher::BackgroundMesher(const BlockTypes &types, JobSystem &jobs)
+    : jobs(jobs), focus(0, 0, 0), lastGeneration(0) {
+
+    for (std::size_t i = 0; i <= jobs.getThreadCount(); i++) {
+        meshers.push_back(std::make_unique<ChunkMesher>(types));
+    }
+}
+
+BackgroundMesher::~BackgroundMesher() {
+    {
+        std::lock_guard lock(mutex);
+        pending.clear();
+        generations.clear();
+    }
+
+    // Remaining jobs find nothing to do
+    jobs.wait(runningJobs);
+}
+
+bool BackgroundMesher::isCurrent(const glm::ivec3 &position,
+                                 uint64_t generation) const {
+    auto it = generations.find(position);
+    return it != generations.end() && it->second == generation;
+}
+
+bool BackgroundMesher::isFarther(const Task &a, const Task &b) const {
+    glm::vec3 toA = a.origin - focus;
+    glm::vec3 toB = b.origin - focus;
+    return glm::dot(toA, toA) > glm::dot(toB, toB);
+}
+
+std::unique_ptr<BackgroundMesher::Task> BackgroundMesher::popPending() {
+    auto compare = [this](const auto &a, const auto &b) {
+        return isFarther(*a, *b);
+    };
+
+    while (!pending.empty()) {
+        std::pop_heap(pending.begin(), pending.end(), compare);
+        std::unique_ptr<Task> task = std::move(pending.back());
+        pending.pop_back();
+
+        if (isCurrent(task->position, task->generation)) {
+            return task;
+        }
+    }
+
+    return nullptr;
+}
+
+void BackgroundMesher::runTask() {
+    std::unique_ptr<Task> task;
+    {
+        std::lock_guard lock(mutex);
+        task = popPending();
+    }
+
+    if (task) {
+        PROFILE_SCOPE("BackgroundMesher::runTask");
+
+        ChunkNeighbours neighbours;
+        ChunkLighting lighting;
+        lighting.light = task->light.get();
+        for (std::size_t i = 0; i < CHUNK_NEIGHBOUR_COUNT; i++) {
+            neighbours[i] = task->neighbours[i].get();
+            lighting.neighbours[i] = task->neighbourLights[i].get();
+        }
+
+        std::size_t worker = JobSystem::getCurrentWorker();
+        ChunkMesher &mesher = worker == JobSystem::NOT_A_WORKER
+                                  ? *meshers.back()
+                                  : *meshers[worker];
+        if (task->level == 0) {
+            mesher.build(task->chunk, neighbours, task->origin, task->mode,
+                         lighting);
+        } else {
+            mesher.buildLod(task->chunk, neighbours, task->origin,
+                            task->level);
+        }
+
+        Result result{task->generation, {task->position, task->level, {}}};
+        result.mesh.layers.reserve(mesher.getLayerCount());
+        for (std::size_t i = 0; i < mesher.getLayerCount(); i++) {
+            result.mesh.layers.push_back(mesher.getLayer(i));
+        }
+
+        std::lock_guard lock(mutex);
+        if (isCurrent(task->position, task->generation)) {
+            completed.push_back(std::move(result));
+        }
+    }
+}
+
+void BackgroundMesher::request(const glm::ivec3 &position, const Chunk &chunk,
+                               const ChunkNeighbours &neighbours,
+                               const glm::vec3 &origin, MeshingMode mode,
+                               const ChunkLighting &lighting) {
+
+    // Copy outside of the lock; workers only wait for the heap operations
+    auto task = std::make_unique<Task>();
+    task->position = position;
+    task->origin = origin;
+    task->mode = mode;
+    task->level = 0;
+    task->chunk = chunk;
+    if (lighting.light != nullptr) {
+        task->light = std::make_unique<ChunkLight>(*lighting.light);
+    }
+    for (std::size_t i = 0; i < CHUNK_NEIGHBOUR_COUNT; i++) {
+        if (neighbours[i] != nullptr) {
+            task->neighbours[i] = std::make_unique<Chunk>(*neighbours[i]);
+        }
+        if (lighting.neighbours[i] != nullptr) {
+            task->neighbourLights[i] =
+                std::make_unique<ChunkLight>(*lighting.neighbours[i]);
+        }
+    }
+
+    schedule(std::move(task));
+}
+
+void BackgroundMesher::requestLod(const glm::ivec3 &position,
+                                  const Chunk &chunk,
+                                  const ChunkNeighbours &neighbours,
+                                  const glm::vec3 &origin, unsigned level) {
+    auto task = std::make_unique<Task>();
+    task->position = position;
+    task->origin = origin;
+    task->mode = MeshingMode::GREEDY;
+    task->level = level;
+    task->chunk = chunk;
+    for (std::size_t i = 0; i < BLOCK_FACE_COUNT; i++) {
+        if (neighbours[i] != nullptr) {
+            task->neighbours[i] = std::make_unique<Chunk>(*neighbours[i]);
+        }
+    }
+
+    schedule(std::move(task));
+}
+
+void BackgroundMesher::schedule(std::unique_ptr<Task> task) {
+    {
+        std::lock_guard lock(mutex);
+        task->generation = ++lastGeneration;
+        generations[task->position] = task->generation;
+
+        pending.push_back(std::move(task));
+        std::push_heap(pending.begin(), pending.end(),
+                       [this](const auto &a, const auto &b) {
+                           return isFarther(*a, *b);
+                       });
+    }
+
+    // Each job serves the best pending task when it starts, not the one
+    // that caused it
+    jobs.submit([this]() { runTask(); }, &runningJobs);
+}
+
+void BackgroundMesher::cancel(const glm::ivec3 &position) {
+    std::lock_guard lock(mutex);
+    generations.erase(position);
+}
+
+void BackgroundMesher::setFocus(const glm::vec3 &newFocus) {
+    std::lock_guard lock(mutex);
+    if (focus == newFocus) {
+        return;
+    }
+
+    focus = newFocus;
+    std::make_heap(
+        pending.begin(), pending.end(),
+        [this](const auto &a, const auto &b) { return isFarther(*a, *b); });
+}
+
+std::vector<BackgroundMesher::Mesh> BackgroundMesher::takeCompleted() {
+    std::lock_guard lock(mutex);
+
+    std::vector<Mesh> meshes;
+    meshes.reserve(completed.size());
+
+    for (auto &result : completed) {
+        if (isCurrent(result.mesh.position, result.generation)) {
+            generations.erase(result.mesh.position);
+            meshes.push_back(std::move(result.mesh));
+        }
+    }
+
+    completed.clear();
+    return meshes;
+}
+
+std::size_t BackgroundMesher::getPendingCount() {
+    std::lock_guard lock(mutex);
+    return pending.size();
+}
+
+} // namespace progressia::main
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "../jobs/job_system.h"
+#include "chunk_mesher.h"
+
+namespace progressia::main {
+
+/*
+ * Builds chunk meshes on a JobSystem.
+ *
+ * request() copies the chunk, its neighbours and their light, so callers may
+ * modify them right away. Pending requests are served nearest to the focus
+ * first. A new request for the same position or a cancel() makes older
+ * requests stale; stale requests are skipped by workers and their results
+ * are never returned.
+ *
+ * Meshes are returned as vertex and index arrays by takeCompleted(); the
+ * caller uploads them on the thread that owns the GraphicsInterface.
+ *
+ * All methods must be called from one thread. The destructor waits for
+ * submitted jobs.
+ */
+class BackgroundMesher : private NonCopyable {
+  public:
+    struct Mesh {
+        glm::ivec3 position;
+
+        // Level of detail, 0 for full detail
+        unsigned level;
+
+        std::vector<ChunkMesher::Layer> layers;
+    };
+
+  private:
+    struct Task {
+        glm::ivec3 position;
+        uint64_t generation;
+        glm::vec3 origin;
+        MeshingMode mode;
+        unsigned level;
+        Chunk chunk;
+        std::array<std::unique_ptr<Chunk>, CHUNK_NEIGHBOUR_COUNT> neighbours;
+
+        std::unique_ptr<ChunkLight> light;
+        std::array<std::unique_ptr<ChunkLight>, CHUNK_NEIGHBOUR_COUNT>
+            neighbourLights;
+    };
+
+    struct Result {
+        uint64_t generation;
+        Mesh mesh;
+    };
+
+    JobSystem &jobs;
+
+    // One per worker, accessed only by the worker, and a last one for the
+    // main thread, which runs jobs while it waits
+    std::vector<std::unique_ptr<ChunkMesher>> meshers;
+
+    std::mutex mutex;
+
+    glm::vec3 focus;
+
+    // A heap with the task nearest to focus on top
+    std::vector<std::unique_ptr<Task>> pending;
+
+    std::unordered_map<glm::ivec3, uint64_t, ChunkPositionHash> generations;
+    uint64_t lastGeneration;
+
+    std::vector<Result> completed;
+
+    JobCounter runningJobs;
+
+    bool isCurrent(const glm::ivec3 &position, uint64_t generation) const;
+    bool isFarther(const Task &, const Task &) const;
+    std::unique_ptr<Task> popPending();
+    void runTask();
+    void schedule(std::unique_ptr<Task>);
+
+  public:
+    BackgroundMesher(const BlockTypes &, JobSystem &);
+    ~BackgroundMesher();
+
+    /*
+     * Schedules a mesh build of chunk with its block (0, 0, 0) placed at
+     * origin. Supersedes previous requests for position.
+     */
+    void request(const glm::ivec3 &position, const Chunk &,
+                 const ChunkNeighbours &, const glm::vec3 &origin,
+                 MeshingMode = MeshingMode::GREEDY,
+                 const ChunkLighting & = {});
+
+    /*
+     * Schedules a mesh build of chunk at level of detail level, see
+     * ChunkMesher::buildLod(). Supersedes previous requests for position.
+     */
+    void requestLod(const glm::ivec3 &position, const Chunk &,
+                    const ChunkNeighbours &, const glm::vec3 &origin,
+                    unsigned level);
+
+    /*
+     * Makes pending and running requests for position stale.
+     */
+    void cancel(const glm::ivec3 &position);
+
+    /*
+     * Sets the point that determines request priority, in the same space as
+     * request origins.
+     */
+    void setFocus(const glm::vec3 &);
+
+    /*
+     * Returns meshes completed since the last call, dropping stale ones.
+     */
+    std::vector<Mesh> takeCompleted();
+
+    std::size_t getPendingCount();
+};
+
+} // namespace progressia::main
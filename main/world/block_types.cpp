@@ -0,0 +1,38 @@
+#include "block_types.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "../logging.h"
+using namespace progressia::main::logging;
+
+namespace progressia::main {
+
+BlockTypes::BlockTypes() {
+    types.push_back({"air", false, false, 0, glm::vec4(0)});
+}
+
+BlockId BlockTypes::add(BlockType type) {
+    if (types.size() > std::numeric_limits<BlockId>::max()) {
+        fatal() << "Too many block types, cannot add " << type.name;
+        // REPORT_ERROR
+        exit(1);
+    }
+
+    types.push_back(std::move(type));
+    return static_cast<BlockId>(types.size() - 1);
+}
+
+std::size_t BlockTypes::getCount() const { return types.size(); }
+
+std::size_t BlockTypes::getTextureCount() const {
+    std::size_t result = 0;
+    for (const auto &type : types) {
+        if (type.visible) {
+            result = std::max(result, type.texture + 1);
+        }
+    }
+    return result;
+}
+
+} // namespace progressia::main
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/vec4.hpp>
+
+#include "chunk.h"
+
+namespace progressia::main {
+
+struct BlockType {
+    std::string name;
+
+    // Invisible blocks produce no faces
+    bool visible;
+
+    // Opaque blocks hide faces of their neighbours
+    bool opaque;
+
+    // Index of the texture used for all faces
+    std::size_t texture;
+
+    glm::vec4 color;
+
+    // Block light level emitted, up to ChunkLight::MAX_LIGHT
+    uint8_t emission = 0;
+};
+
+/*
+ * Properties of block IDs. BLOCK_AIR is always registered as an invisible,
+ * transparent block.
+ */
+class BlockTypes {
+  private:
+    std::vector<BlockType> types;
+
+  public:
+    BlockTypes();
+
+    BlockId add(BlockType);
+
+    /*
+     * id must have been returned by add() or be BLOCK_AIR.
+     */
+    const BlockType &get(BlockId id) const { return types[id]; }
+
+    std::size_t getCount() const;
+
+    /*
+     * Returns one more than the largest texture index in use.
+     */
+    std::size_t getTextureCount() const;
+};
+
+} // namespace progressia::main
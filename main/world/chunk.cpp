@@ -0,0 +1,478 @@
+#include "chunk.h"
+
+#include <algorithm>
+#include <array>
+
+namespace progressia::main {
+
+namespace {
+
+/*
+ * Returns the smallest supported width for indices into a palette of this
+ * size.
+ */
+unsigned getBitsFor(std::size_t paletteSize) {
+    unsigned bits = 0;
+    while ((std::size_t(1) << bits) < paletteSize) {
+        bits = bits == 0 ? 1 : bits * 2;
+    }
+    return bits;
+}
+
+unsigned getLog2(unsigned powerOfTwo) {
+    unsigned result = 0;
+    while ((1U << result) < powerOfTwo) {
+        result++;
+    }
+    return result;
+}
+
+template <typename T> void writeLittleEndian(std::vector<uint8_t> &out, T v) {
+    for (std::size_t i = 0; i < sizeof(T); i++) {
+        out.push_back(static_cast<uint8_t>(v >> (i * 8)));
+    }
+}
+
+template <typename T> T readLittleEndian(const uint8_t *in) {
+    T v = 0;
+    for (std::size_t i = 0; i < sizeof(T); i++) {
+        v |= static_cast<T>(T(in[i]) << (i * 8));
+    }
+    return v;
+}
+
+/*
+ * Adds the number of uses of each entry among VOLUME indices to references.
+ * Returns false if an index is out of range.
+ */
+bool countReferences(const uint16_t *indices,
+                     std::vector<uint16_t> &references) {
+    constexpr std::size_t SMALL_PALETTE = 256;
+    constexpr std::size_t LANES = 4;
+
+    std::size_t size = references.size();
+    uint16_t largest = 0;
+
+    if (size > SMALL_PALETTE) {
+        for (std::size_t i = 0; i < Chunk::VOLUME; i++) {
+            largest = std::max(largest, indices[i]);
+            references[std::min<std::size_t>(indices[i], size - 1)]++;
+        }
+        return largest < size;
+    }
+
+    // Runs of one entry would make each increment wait for the previous
+    // one, so consecutive indices go to separate counters
+    std::array<std::array<uint16_t, SMALL_PALETTE>, LANES> counts{};
+    for (std::size_t i = 0; i < Chunk::VOLUME; i += LANES) {
+        for (std::size_t lane = 0; lane < LANES; lane++) {
+            uint16_t index = indices[i + lane];
+            largest = std::max(largest, index);
+            counts[lane][index & (SMALL_PALETTE - 1)]++;
+        }
+    }
+
+    for (std::size_t i = 0; i < size; i++) {
+        std::size_t total = 0;
+        for (const auto &lane : counts) {
+            total += lane[i];
+        }
+        references[i] = static_cast<uint16_t>(total);
+    }
+    return largest < size;
+}
+
+// Faces in BlockFace order, then edges, then corners
+const std::array<glm::ivec3, CHUNK_NEIGHBOUR_COUNT> NEIGHBOUR_OFFSETS = {{
+    {-1, 0, 0},   {1, 0, 0},   {0, -1, 0},  {0, 1, 0},   {0, 0, -1},
+    {0, 0, 1},    {0, -1, -1}, {0, 1, -1},  {0, -1, 1},  {0, 1, 1},
+    {-1, 0, -1},  {1, 0, -1},  {-1, 0, 1},  {1, 0, 1},   {-1, -1, 0},
+    {1, -1, 0},   {-1, 1, 0},  {1, 1, 0},   {-1, -1, -1}, {1, -1, -1},
+    {-1, 1, -1},  {1, 1, -1},  {-1, -1, 1}, {1, -1, 1},  {-1, 1, 1},
+    {1, 1, 1},
+}};
+
+} // namespace
+
+glm::ivec3 getNeighbourOffset(std::size_t index) {
+    return NEIGHBOUR_OFFSETS[index];
+}
+
+Chunk::Chunk(BlockId fill) : bits(0), perWordLog2(0) { this->fill(fill); }
+
+void Chunk::setEntry(std::size_t index, PaletteIndex entry) {
+    auto shift =
+        static_cast<unsigned>(index & ((1U << perWordLog2) - 1)) * bits;
+    Word mask = ((Word(1) << bits) - 1) << shift;
+    Word &word = data[index >> perWordLog2];
+    word = (word & ~mask) | (Word(entry) << shift);
+}
+
+Chunk::PaletteIndex Chunk::findOrAdd(BlockId block) {
+    if (palette.size() <= LINEAR_SEARCH_LIMIT) {
+        for (std::size_t i = 0; i < palette.size(); i++) {
+            if (references[i] != 0 && palette[i] == block) {
+                return static_cast<PaletteIndex>(i);
+            }
+        }
+    } else {
+        auto it = paletteLookup.find(block);
+        if (it != paletteLookup.end()) {
+            return it->second;
+        }
+    }
+
+    PaletteIndex entry = 0;
+
+    if (!freeEntries.empty()) {
+        entry = freeEntries.back();
+        freeEntries.pop_back();
+        palette[entry] = block;
+    } else {
+        entry = static_cast<PaletteIndex>(palette.size());
+        palette.push_back(block);
+        references.push_back(0);
+
+        if (palette.size() > (std::size_t(1) << bits)) {
+            repack(getBitsFor(palette.size()));
+        }
+
+        if (palette.size() == LINEAR_SEARCH_LIMIT + 1) {
+            for (std::size_t i = 0; i < palette.size(); i++) {
+                if (references[i] != 0) {
+                    paletteLookup[palette[i]] = static_cast<PaletteIndex>(i);
+                }
+            }
+        }
+    }
+
+    if (palette.size() > LINEAR_SEARCH_LIMIT) {
+        paletteLookup[block] = entry;
+    }
+
+    return entry;
+}
+
+void Chunk::release(PaletteIndex entry) {
+    if (references[entry] != 0) {
+        return;
+    }
+
+    freeEntries.push_back(entry);
+    if (palette.size() > LINEAR_SEARCH_LIMIT) {
+        paletteLookup.erase(palette[entry]);
+    }
+}
+
+void Chunk::repack(unsigned newBits, const std::vector<PaletteIndex> &remap) {
+    std::vector<Word> newData;
+    unsigned newPerWordLog2 = 0;
+
+    if (newBits != 0) {
+        newPerWordLog2 = getLog2(WORD_BITS / newBits);
+        newData.assign(VOLUME >> newPerWordLog2, 0);
+
+        std::size_t perWordMask = (std::size_t(1) << newPerWordLog2) - 1;
+        for (std::size_t i = 0; i < VOLUME; i++) {
+            PaletteIndex entry = getEntry(i);
+            if (!remap.empty()) {
+                entry = remap[entry];
+            }
+
+            newData[i >> newPerWordLog2] |= Word(entry)
+                                            << ((i & perWordMask) * newBits);
+        }
+    }
+
+    data = std::move(newData);
+    bits = newBits;
+    perWordLog2 = newPerWordLog2;
+}
+
+void Chunk::set(std::size_t index, BlockId block) {
+    PaletteIndex old = getEntry(index);
+    if (palette[old] == block) {
+        return;
+    }
+
+    // May repack, which does not change existing entries
+    PaletteIndex entry = findOrAdd(block);
+
+    references[entry]++;
+    references[old]--;
+    release(old);
+
+    setEntry(index, entry);
+}
+
+void Chunk::fill(BlockId block) {
+    palette.assign(1, block);
+    references.assign(1, static_cast<uint16_t>(VOLUME));
+    freeEntries.clear();
+    paletteLookup.clear();
+
+    data.clear();
+    data.shrink_to_fit();
+    bits = 0;
+    perWordLog2 = 0;
+}
+
+void Chunk::fill(int minX, int minY, int minZ, int maxX, int maxY, int maxZ,
+                 BlockId block) {
+    minX = std::max(minX, 0);
+    minY = std::max(minY, 0);
+    minZ = std::max(minZ, 0);
+    maxX = std::min(maxX, SIZE);
+    maxY = std::min(maxY, SIZE);
+    maxZ = std::min(maxZ, SIZE);
+
+    if (minX >= maxX || minY >= maxY || minZ >= maxZ) {
+        return;
+    }
+
+    if (minX == 0 && minY == 0 && minZ == 0 && maxX == SIZE &&
+        maxY == SIZE && maxZ == SIZE) {
+        fill(block);
+        return;
+    }
+
+    PaletteIndex entry = findOrAdd(block);
+
+    for (int z = minZ; z < maxZ; z++) {
+        for (int y = minY; y < maxY; y++) {
+            std::size_t index = getIndex(minX, y, z);
+            for (int x = minX; x < maxX; x++, index++) {
+                PaletteIndex old = getEntry(index);
+                if (old == entry) {
+                    continue;
+                }
+
+                references[entry]++;
+                references[old]--;
+                release(old);
+                setEntry(index, entry);
+            }
+        }
+    }
+
+    // The entry may have been added for nothing
+    release(entry);
+}
+
+void Chunk::compact() {
+    std::size_t liveCount = palette.size() - freeEntries.size();
+    if (freeEntries.empty() && getBitsFor(liveCount) == bits) {
+        return;
+    }
+
+    std::vector<BlockId> newPalette;
+    std::vector<uint16_t> newReferences;
+    std::vector<PaletteIndex> remap(palette.size(), 0);
+
+    newPalette.reserve(liveCount);
+    newReferences.reserve(liveCount);
+
+    for (std::size_t i = 0; i < palette.size(); i++) {
+        if (references[i] == 0) {
+            continue;
+        }
+
+        remap[i] = static_cast<PaletteIndex>(newPalette.size());
+        newPalette.push_back(palette[i]);
+        newReferences.push_back(references[i]);
+    }
+
+    if (newPalette.size() == 1) {
+        fill(newPalette[0]);
+        return;
+    }
+
+    repack(getBitsFor(newPalette.size()), remap);
+
+    palette = std::move(newPalette);
+    references = std::move(newReferences);
+    freeEntries.clear();
+    freeEntries.shrink_to_fit();
+
+    paletteLookup.clear();
+    if (palette.size() > LINEAR_SEARCH_LIMIT) {
+        for (std::size_t i = 0; i < palette.size(); i++) {
+            paletteLookup[palette[i]] = static_cast<PaletteIndex>(i);
+        }
+    }
+}
+
+/*
+ * Serialized layout:
+ *   uint8_t  bits
+ *   uint16_t palette size
+ *   BlockId  palette[palette size]
+ *   uint64_t data[VOLUME * bits / 64]
+ */
+void Chunk::serialize(std::vector<uint8_t> &output) const {
+    output.reserve(output.size() + sizeof(uint8_t) + sizeof(uint16_t) +
+                   palette.size() * sizeof(BlockId) +
+                   data.size() * sizeof(Word));
+
+    writeLittleEndian(output, static_cast<uint8_t>(bits));
+    writeLittleEndian(output, static_cast<uint16_t>(palette.size()));
+    for (BlockId block : palette) {
+        writeLittleEndian(output, block);
+    }
+    for (Word word : data) {
+        writeLittleEndian(output, word);
+    }
+}
+
+bool Chunk::deserialize(const uint8_t *in, std::size_t size) {
+    constexpr std::size_t HEADER_SIZE = sizeof(uint8_t) + sizeof(uint16_t);
+    if (size < HEADER_SIZE) {
+        return false;
+    }
+
+    unsigned newBits = in[0];
+    std::size_t paletteSize = readLittleEndian<uint16_t>(in + 1);
+
+    // Widths are 0 or a power of two up to the width of PaletteIndex
+    if (newBits > sizeof(PaletteIndex) * 8 || (newBits & (newBits - 1)) != 0) {
+        return false;
+    }
+    if (paletteSize == 0 || paletteSize > (std::size_t(1) << newBits)) {
+        return false;
+    }
+
+    unsigned newPerWordLog2 = newBits == 0 ? 0 : getLog2(WORD_BITS / newBits);
+    std::size_t wordCount = newBits == 0 ? 0 : VOLUME >> newPerWordLog2;
+    if (size != HEADER_SIZE + paletteSize * sizeof(BlockId) +
+                    wordCount * sizeof(Word)) {
+        return false;
+    }
+
+    std::vector<BlockId> newPalette(paletteSize);
+    const uint8_t *cursor = in + HEADER_SIZE;
+    for (auto &block : newPalette) {
+        block = readLittleEndian<BlockId>(cursor);
+        cursor += sizeof(BlockId);
+    }
+
+    std::vector<Word> newData(wordCount);
+    for (auto &word : newData) {
+        word = readLittleEndian<Word>(cursor);
+        cursor += sizeof(Word);
+    }
+
+    // References are not stored; count them while checking entries
+    std::vector<uint16_t> newReferences(paletteSize, 0);
+    if (newBits == 0) {
+        newReferences[0] = static_cast<uint16_t>(VOLUME);
+    } else {
+        unsigned perWord = 1U << newPerWordLog2;
+        Word mask = (Word(1) << newBits) - 1;
+        for (Word word : newData) {
+            for (unsigned i = 0; i < perWord; i++, word >>= newBits) {
+                auto entry = static_cast<std::size_t>(word & mask);
+                if (entry >= paletteSize) {
+                    return false;
+                }
+                newReferences[entry]++;
+            }
+        }
+    }
+
+    palette = std::move(newPalette);
+    references = std::move(newReferences);
+    data = std::move(newData);
+    bits = newBits;
+    perWordLog2 = newPerWordLog2;
+
+    rebuildPaletteIndex();
+    return true;
+}
+
+void Chunk::getPaletteIndices(uint16_t *indices) const {
+    if (bits == 0) {
+        std::fill(indices, indices + VOLUME, 0);
+        return;
+    }
+
+    unsigned perWord = 1U << perWordLog2;
+    Word mask = (Word(1) << bits) - 1;
+    for (Word word : data) {
+        for (unsigned i = 0; i < perWord; i++, word >>= bits) {
+            *indices++ = static_cast<uint16_t>(word & mask);
+        }
+    }
+}
+
+bool Chunk::assign(std::vector<BlockId> newPalette, const uint16_t *indices) {
+    std::size_t paletteSize = newPalette.size();
+    if (paletteSize == 0 ||
+        paletteSize > std::size_t(1) << (sizeof(PaletteIndex) * 8)) {
+        return false;
+    }
+
+    std::vector<uint16_t> newReferences(paletteSize, 0);
+    if (!countReferences(indices, newReferences)) {
+        return false;
+    }
+
+    unsigned newBits = getBitsFor(paletteSize);
+    unsigned newPerWordLog2 = newBits == 0 ? 0 : getLog2(WORD_BITS / newBits);
+    std::vector<Word> newData;
+
+    if (newBits != 0) {
+        unsigned perWord = 1U << newPerWordLog2;
+        newData.resize(VOLUME >> newPerWordLog2);
+        for (Word &word : newData) {
+            Word packed = 0;
+            for (unsigned i = 0; i < perWord; i++) {
+                packed |= Word(*indices++) << (i * newBits);
+            }
+            word = packed;
+        }
+    }
+
+    palette = std::move(newPalette);
+    references = std::move(newReferences);
+    data = std::move(newData);
+    bits = newBits;
+    perWordLog2 = newPerWordLog2;
+
+    rebuildPaletteIndex();
+    return true;
+}
+
+/*
+ * Recomputes freeEntries and paletteLookup from palette and references.
+ */
+void Chunk::rebuildPaletteIndex() {
+    freeEntries.clear();
+    paletteLookup.clear();
+    for (std::size_t i = 0; i < palette.size(); i++) {
+        if (references[i] == 0) {
+            freeEntries.push_back(static_cast<PaletteIndex>(i));
+        } else if (palette.size() > LINEAR_SEARCH_LIMIT) {
+            paletteLookup[palette[i]] = static_cast<PaletteIndex>(i);
+        }
+    }
+}
+
+std::size_t Chunk::getPaletteSize() const {
+    return palette.size() - freeEntries.size();
+}
+
+std::size_t Chunk::getMemoryUsage() const {
+    // Hash map nodes hold the value and a next pointer; the estimate ignores
+    // allocator overhead
+    constexpr std::size_t LOOKUP_NODE_SIZE =
+        sizeof(std::pair<const BlockId, PaletteIndex>) + sizeof(void *);
+
+    return sizeof(Chunk) + palette.capacity() * sizeof(BlockId) +
+           references.capacity() * sizeof(uint16_t) +
+           freeEntries.capacity() * sizeof(PaletteIndex) +
+           data.capacity() * sizeof(Word) +
+           paletteLookup.size() * LOOKUP_NODE_SIZE +
+           paletteLookup.bucket_count() * sizeof(void *);
+}
+
+} // namespace progressia::main
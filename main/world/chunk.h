@@ -0,0 +1,208 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+namespace progressia::main {
+
+using BlockId = uint16_t;
+
+constexpr BlockId BLOCK_AIR = 0;
+
+/*
+ * Directions towards the six neighbours of a block or of a chunk.
+ */
+enum class BlockFace : uint8_t { NEG_X, POS_X, NEG_Y, POS_Y, NEG_Z, POS_Z };
+
+constexpr std::size_t BLOCK_FACE_COUNT = 6;
+
+/*
+ * Number of chunks around a chunk: the BLOCK_FACE_COUNT face neighbours in
+ * BlockFace order, then the 12 that share an edge and the 8 that share a
+ * corner.
+ */
+constexpr std::size_t CHUNK_NEIGHBOUR_COUNT = 26;
+
+/*
+ * Returns the position of neighbour number index relative to the chunk.
+ */
+glm::ivec3 getNeighbourOffset(std::size_t index);
+
+struct ChunkPositionHash {
+    std::size_t operator()(const glm::ivec3 &position) const {
+        // Large primes spread neighbouring positions across buckets
+        return std::size_t(position.x) * 73856093U ^
+               std::size_t(position.y) * 19349663U ^
+               std::size_t(position.z) * 83492791U;
+    }
+};
+
+/*
+ * A cube of Chunk::SIZE^3 blocks.
+ *
+ * Blocks are stored as indices into a palette of distinct block IDs. Indices
+ * are bit-packed into 64-bit words using the smallest power-of-two width
+ * that fits the palette: 0 bits when all blocks are the same, then 1, 2, 4,
+ * 8 or 16 bits. Entries never straddle words, so get() and set() are a
+ * shift and a mask.
+ *
+ * Blocks are ordered with X varying fastest, then Y, then Z. Iterating in
+ * this order touches each word once.
+ *
+ * Not thread-safe.
+ */
+class Chunk {
+  public:
+    constexpr static int SIZE_BITS = 4;
+    constexpr static int SIZE = 1 << SIZE_BITS;
+    constexpr static std::size_t VOLUME = std::size_t(SIZE) * SIZE * SIZE;
+
+    static std::size_t getIndex(int x, int y, int z) {
+        return (std::size_t(z) << (2 * SIZE_BITS)) |
+               (std::size_t(y) << SIZE_BITS) | std::size_t(x);
+    }
+
+  private:
+    using Word = uint64_t;
+    using PaletteIndex = uint16_t;
+
+    constexpr static unsigned WORD_BITS = 64;
+
+    // Palettes larger than this use paletteLookup to find block IDs
+    constexpr static std::size_t LINEAR_SEARCH_LIMIT = 16;
+
+    std::vector<BlockId> palette;
+    std::vector<uint16_t> references;
+    std::vector<PaletteIndex> freeEntries;
+    std::unordered_map<BlockId, PaletteIndex> paletteLookup;
+
+    std::vector<Word> data;
+    unsigned bits;
+    unsigned perWordLog2;
+
+    PaletteIndex getEntry(std::size_t index) const {
+        if (bits == 0) {
+            return 0;
+        }
+
+        auto shift =
+            static_cast<unsigned>(index & ((1U << perWordLog2) - 1)) * bits;
+        return static_cast<PaletteIndex>((data[index >> perWordLog2] >> shift) &
+                                         ((Word(1) << bits) - 1));
+    }
+
+    void setEntry(std::size_t index, PaletteIndex entry);
+
+    PaletteIndex findOrAdd(BlockId);
+    void release(PaletteIndex);
+    void repack(unsigned newBits,
+                const std::vector<PaletteIndex> &remap = {});
+    void rebuildPaletteIndex();
+
+  public:
+    explicit Chunk(BlockId fill = BLOCK_AIR);
+
+    BlockId get(std::size_t index) const { return palette[getEntry(index)]; }
+
+    BlockId get(int x, int y, int z) const { return get(getIndex(x, y, z)); }
+
+    void set(std::size_t index, BlockId);
+    void set(int x, int y, int z, BlockId block) {
+        set(getIndex(x, y, z), block);
+    }
+
+    /*
+     * Sets all blocks to the same ID and releases packed storage.
+     */
+    void fill(BlockId);
+
+    /*
+     * Sets all blocks with min <= coordinate < max.
+     */
+    void fill(int minX, int minY, int minZ, int maxX, int maxY, int maxZ,
+              BlockId);
+
+    /*
+     * Calls f(x, y, z, BlockId) for every block in storage order.
+     */
+    template <typename F> void forEach(F &&f) const {
+        if (bits == 0) {
+            BlockId block = palette[0];
+            for (int z = 0; z < SIZE; z++) {
+                for (int y = 0; y < SIZE; y++) {
+                    for (int x = 0; x < SIZE; x++) {
+                        f(x, y, z, block);
+                    }
+                }
+            }
+            return;
+        }
+
+        // Decode each word once instead of locating it for every block
+        unsigned perWord = 1U << perWordLog2;
+        Word mask = (Word(1) << bits) - 1;
+        std::size_t index = 0;
+
+        for (Word word : data) {
+            for (unsigned i = 0; i < perWord; i++, index++) {
+                int x = static_cast<int>(index & (SIZE - 1));
+                int y = static_cast<int>((index >> SIZE_BITS) & (SIZE - 1));
+                int z = static_cast<int>(index >> (2 * SIZE_BITS));
+                f(x, y, z, palette[static_cast<std::size_t>(word & mask)]);
+                word >>= bits;
+            }
+        }
+    }
+
+    /*
+     * Drops palette entries that are no longer used and shrinks storage to
+     * the smallest width that fits. set() never shrinks storage by itself.
+     */
+    void compact();
+
+    /*
+     * Appends the palette and the packed indices to output, little-endian.
+     * Free palette entries are written too, so compact() first for the
+     * smallest output.
+     */
+    void serialize(std::vector<uint8_t> &output) const;
+
+    /*
+     * Replaces contents with data written by serialize(). Returns false and
+     * leaves the chunk unchanged if data is malformed.
+     */
+    bool deserialize(const uint8_t *data, std::size_t size);
+
+    /*
+     * Returns the palette, including free entries.
+     */
+    const std::vector<BlockId> &getPalette() const { return palette; }
+
+    /*
+     * Writes the palette entry of each block to indices[0..VOLUME) in
+     * storage order.
+     */
+    void getPaletteIndices(uint16_t *indices) const;
+
+    /*
+     * Replaces contents with VOLUME blocks given as entries of newPalette.
+     * Returns false and leaves the chunk unchanged if newPalette is empty or
+     * an entry is out of range.
+     */
+    bool assign(std::vector<BlockId> newPalette, const uint16_t *indices);
+
+    bool isUniform() const { return bits == 0; }
+    unsigned getBitsPerBlock() const { return bits; }
+    std::size_t getPaletteSize() const;
+
+    /*
+     * Returns the number of bytes owned by this chunk, including the object
+     * itself.
+     */
+    std::size_t getMemoryUsage() const;
+};
+
+} // namespace progressia::main
@@ -0,0 +1,247 @@
+#include "chunk_codec.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                  \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PROGRESSIA_CODEC_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PROGRESSIA_CODEC_NEON
+#endif
+
+namespace progressia::main {
+
+namespace {
+
+// Larger sizes cannot come from a valid chunk
+constexpr std::size_t MAX_RAW_SIZE = std::size_t(1) << 20;
+
+// Number of palette entries in a 128-bit vector
+constexpr std::size_t FILL_WIDTH = 8;
+
+void writeVarint(std::vector<uint8_t> &output, std::size_t value) {
+    while (value >= 0x80) {
+        output.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    output.push_back(static_cast<uint8_t>(value));
+}
+
+bool readVarint(const uint8_t *&in, const uint8_t *end, std::size_t &value) {
+    value = 0;
+    for (unsigned shift = 0; shift < 35; shift += 7) {
+        if (in == end) {
+            return false;
+        }
+
+        uint8_t byte = *in++;
+        value |= std::size_t(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Sets count entries at out to value. Writes whole vectors, so up to
+ * FILL_WIDTH - 1 entries past the end may be overwritten.
+ */
+void fillRun(uint16_t *out, uint16_t value, std::size_t count) {
+#if defined(PROGRESSIA_CODEC_SSE2)
+    __m128i vector = _mm_set1_epi16(static_cast<short>(value));
+    for (std::size_t i = 0; i < count; i += FILL_WIDTH) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), vector);
+    }
+#elif defined(PROGRESSIA_CODEC_NEON)
+    uint16x8_t vector = vdupq_n_u16(value);
+    for (std::size_t i = 0; i < count; i += FILL_WIDTH) {
+        vst1q_u16(out + i, vector);
+    }
+#else
+    std::fill(out, out + count, value);
+#endif
+}
+
+class RawCodec : public ChunkCodec {
+  public:
+    const char *getName() const override { return "none"; }
+
+    void encode(const Chunk &chunk, int,
+                std::vector<uint8_t> &output) const override {
+        chunk.serialize(output);
+    }
+
+    bool decode(const uint8_t *data, std::size_t size,
+                Chunk &output) const override {
+        return output.deserialize(data, size);
+    }
+};
+
+/*
+ * Layout:
+ *   varint palette size
+ *   varint palette[palette size]
+ *   (varint entry, varint run length - 1) until VOLUME blocks are covered
+ *
+ * Entries are numbered in order of first use, so that free entries are
+ * dropped and common blocks tend to get one-byte codes.
+ */
+class RleCodec : public ChunkCodec {
+  public:
+    const char *getName() const override { return "rle"; }
+
+    void encode(const Chunk &chunk, int,
+                std::vector<uint8_t> &output) const override {
+        std::array<uint16_t, Chunk::VOLUME> indices; // NOLINT
+        chunk.getPaletteIndices(indices.data());
+
+        constexpr uint32_t UNUSED = std::numeric_limits<uint32_t>::max();
+        const auto &palette = chunk.getPalette();
+        std::vector<uint32_t> remap(palette.size(), UNUSED);
+        std::vector<BlockId> used;
+
+        for (uint16_t entry : indices) {
+            if (remap[entry] == UNUSED) {
+                remap[entry] = static_cast<uint32_t>(used.size());
+                used.push_back(palette[entry]);
+            }
+        }
+
+        writeVarint(output, used.size());
+        for (BlockId block : used) {
+            writeVarint(output, block);
+        }
+
+        std::size_t start = 0;
+        while (start < Chunk::VOLUME) {
+            std::size_t end = start + 1;
+            while (end < Chunk::VOLUME && indices[end] == indices[start]) {
+                end++;
+            }
+
+            writeVarint(output, remap[indices[start]]);
+            writeVarint(output, end - start - 1);
+            start = end;
+        }
+    }
+
+    bool decode(const uint8_t *data, std::size_t size,
+                Chunk &output) const override {
+        const uint8_t *in = data;
+        const uint8_t *end = data + size;
+
+        std::size_t paletteSize = 0;
+        if (!readVarint(in, end, paletteSize) || paletteSize == 0 ||
+            paletteSize > Chunk::VOLUME) {
+            return false;
+        }
+
+        std::vector<BlockId> palette(paletteSize);
+        for (auto &block : palette) {
+            std::size_t value = 0;
+            if (!readVarint(in, end, value) ||
+                value > std::numeric_limits<BlockId>::max()) {
+                return false;
+            }
+            block = static_cast<BlockId>(value);
+        }
+
+        // Room for the last fillRun() to overshoot
+        std::array<uint16_t, Chunk::VOLUME + FILL_WIDTH> indices; // NOLINT
+
+        std::size_t position = 0;
+        while (position < Chunk::VOLUME) {
+            std::size_t entry = 0;
+            std::size_t run = 0;
+            if (!readVarint(in, end, entry) || entry >= paletteSize ||
+                !readVarint(in, end, run) ||
+                run >= Chunk::VOLUME - position) {
+                return false;
+            }
+
+            fillRun(indices.data() + position, static_cast<uint16_t>(entry),
+                    run + 1);
+            position += run + 1;
+        }
+
+        return in == end && output.assign(std::move(palette), indices.data());
+    }
+};
+
+/*
+ * Compresses the output of another codec. Layout:
+ *   varint size of the inner encoding
+ *   lz::compress() output
+ */
+class LzCodec : public ChunkCodec {
+  private:
+    const ChunkCodec &inner;
+    const char *name;
+
+    static std::vector<uint8_t> &getScratch() {
+        thread_local std::vector<uint8_t> scratch;
+        return scratch;
+    }
+
+  public:
+    LzCodec(const ChunkCodec &inner, const char *name)
+        : inner(inner), name(name) {}
+
+    const char *getName() const override { return name; }
+
+    void encode(const Chunk &chunk, int level,
+                std::vector<uint8_t> &output) const override {
+        auto &raw = getScratch();
+        raw.clear();
+        inner.encode(chunk, level, raw);
+
+        writeVarint(output, raw.size());
+        lz::compress(raw.data(), raw.size(), output, level);
+    }
+
+    bool decode(const uint8_t *data, std::size_t size,
+                Chunk &output) const override {
+        const uint8_t *in = data;
+        const uint8_t *end = data + size;
+
+        std::size_t rawSize = 0;
+        if (!readVarint(in, end, rawSize) || rawSize > MAX_RAW_SIZE) {
+            return false;
+        }
+
+        auto &raw = getScratch();
+        raw.resize(rawSize);
+        return lz::decompress(in, static_cast<std::size_t>(end - in),
+                              raw.data(), rawSize) &&
+               inner.decode(raw.data(), rawSize, output);
+    }
+};
+
+} // namespace
+
+const ChunkCodec *getChunkCodec(ChunkCompression compression) {
+    static const RawCodec raw;
+    static const RleCodec rle;
+    static const LzCodec lz(raw, "lz");
+    static const LzCodec rleLz(rle, "rle+lz");
+
+    switch (compression) {
+    case ChunkCompression::NONE:
+        return &raw;
+    case ChunkCompression::RLE:
+        return &rle;
+    case ChunkCompression::LZ:
+        return &lz;
+    case ChunkCompression::RLE_LZ:
+        return &rleLz;
+    }
+
+    return nullptr;
+}
+
+} // namespace progressia::main
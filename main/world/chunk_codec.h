@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../io/lz.h"
+#include "chunk.h"
+
+namespace progressia::main {
+
+/*
+ * Identifies the codec of stored or transmitted chunk data. Values are
+ * persistent and must not be reused.
+ */
+enum class ChunkCompression : uint8_t {
+    // Output of Chunk::serialize() as is
+    NONE = 0,
+
+    // Runs of equal blocks in storage order
+    RLE = 1,
+
+    // Chunk::serialize() output compressed with lz::compress()
+    LZ = 2,
+
+    // RLE output compressed with lz::compress()
+    RLE_LZ = 3
+};
+
+/*
+ * A codec with the parameters used to encode with it.
+ */
+struct ChunkEncoding {
+    ChunkCompression compression = ChunkCompression::RLE_LZ;
+
+    // Speed to size trade-off of LZ codecs, see lz::compress()
+    int level = lz::DEFAULT_LEVEL;
+};
+
+/*
+ * Converts chunks to bytes and back.
+ *
+ * Implementations are stateless and may be used by several threads at once.
+ */
+class ChunkCodec {
+  public:
+    virtual ~ChunkCodec() = default;
+
+    virtual const char *getName() const = 0;
+
+    /*
+     * Appends the encoded chunk to output. Codecs without levels ignore
+     * level.
+     */
+    virtual void encode(const Chunk &, int level,
+                        std::vector<uint8_t> &output) const = 0;
+
+    /*
+     * Replaces output with the chunk encoded in data. Returns false and
+     * leaves output unchanged if data is malformed.
+     */
+    virtual bool decode(const uint8_t *data, std::size_t size,
+                        Chunk &output) const = 0;
+};
+
+/*
+ * Returns the codec for compression or nullptr if it is unknown, for
+ * example in data written by a newer version.
+ */
+const ChunkCodec *getChunkCodec(ChunkCompression);
+
+} // namespace progressia::main
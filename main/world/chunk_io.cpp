@@ -0,0 +1,245 @@
+#include "chunk_io.h"
+
+#include "../logging.h"
+#include "../profiler.h"
+
+namespace progressia::main {
+
+ChunkIO::ChunkIO(std::filesystem::path directory,
+                 std::unique_ptr<IoBackend> backend, JobSystem &jobs,
+                 ChunkEncoding encoding)
+    : storage(std::move(directory)), backend(std::move(backend)), jobs(jobs),
+      encoding(encoding), busy(false), syncRequested(false),
+      stopping(false) {
+
+    thread = std::thread([this]() {
+        profiler::setThreadName("Chunk I/O");
+        run();
+    });
+}
+
+ChunkIO::~ChunkIO() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wakeUp.notify_one();
+
+    // The I/O thread finishes queued requests before it returns
+    thread.join();
+}
+
+void ChunkIO::save(const glm::ivec3 &position, const Chunk &chunk,
+                   SaveCallback callback) {
+    auto copy = std::make_shared<const Chunk>(chunk);
+
+    {
+        std::lock_guard lock(mutex);
+        stats.savesRequested++;
+
+        PendingSave &pending = saves[position];
+        if (pending.chunk) {
+            stats.savesCoalesced++;
+        }
+
+        pending.chunk = std::move(copy);
+        if (callback) {
+            pending.callbacks.push_back(std::move(callback));
+        }
+    }
+
+    wakeUp.notify_one();
+}
+
+void ChunkIO::load(const glm::ivec3 &position, LoadCallback callback) {
+    std::shared_ptr<const Chunk> queued;
+
+    {
+        std::lock_guard lock(mutex);
+        stats.loadsRequested++;
+
+        auto it = saves.find(position);
+        if (it == saves.end()) {
+            loads.push_back({position, std::move(callback)});
+            wakeUp.notify_one();
+            return;
+        }
+
+        stats.loadsFromMemory++;
+        queued = it->second.chunk;
+    }
+
+    auto copy = std::make_shared<Chunk>(*queued);
+    jobs.submitToMain([callback = std::move(callback), copy]() {
+        callback(copy.get());
+    });
+}
+
+void ChunkIO::flush() {
+    std::unique_lock lock(mutex);
+    syncRequested = true;
+    wakeUp.notify_one();
+
+    idle.wait(lock, [this]() {
+        return saves.empty() && loads.empty() && !busy && !syncRequested;
+    });
+}
+
+ChunkIO::Stats ChunkIO::getStats() const {
+    std::lock_guard lock(mutex);
+
+    Stats result = stats;
+    result.pendingSaves = saves.size();
+    result.pendingLoads = loads.size();
+    return result;
+}
+
+const char *ChunkIO::getBackendName() const { return backend->getName(); }
+
+void ChunkIO::run() {
+    std::vector<PendingLoad> takenLoads;
+
+    while (true) {
+        bool sync = false;
+
+        {
+            std::unique_lock lock(mutex);
+            wakeUp.wait(lock, [this]() {
+                return stopping || syncRequested || !saves.empty() ||
+                       !loads.empty();
+            });
+
+            if (saves.empty() && loads.empty() && !syncRequested) {
+                return;
+            }
+
+            busy = true;
+
+            saveJobs.clear();
+            auto it = saves.begin();
+            while (it != saves.end() && saveJobs.size() < MAX_BATCH) {
+                saveJobs.push_back({it->first, std::move(it->second), nullptr,
+                                    {}, false});
+                it = saves.erase(it);
+            }
+
+            takenLoads.swap(loads);
+
+            // Sync once the last queued save is taken
+            if (syncRequested && saves.empty()) {
+                syncRequested = false;
+                sync = true;
+            }
+        }
+
+        runSaves();
+        std::size_t read = runLoads(takenLoads);
+
+        if (sync) {
+            PROFILE_SCOPE("ChunkIO sync");
+            storage.sync();
+            storage.closeIdle();
+        }
+
+        // Regions of this batch may be closed only now that it is done
+        storage.trim();
+
+        uint64_t written = 0;
+        for (const auto &job : saveJobs) {
+            written += job.written ? 1 : 0;
+        }
+
+        {
+            std::lock_guard lock(mutex);
+            stats.chunksWritten += written;
+            stats.writesFailed += saveJobs.size() - written;
+            stats.chunksRead += read;
+            stats.batches += saveJobs.empty() ? 0 : 1;
+            busy = false;
+        }
+        idle.notify_all();
+
+        takenLoads.clear();
+    }
+}
+
+void ChunkIO::runSaves() {
+    if (saveJobs.empty()) {
+        return;
+    }
+
+    PROFILE_SCOPE("ChunkIO::runSaves");
+
+    operations.clear();
+    for (auto &job : saveJobs) {
+        RegionFile *region =
+            storage.getRegion(RegionFile::getRegion(job.position), true);
+        if (region == nullptr ||
+            !region->prepareSave(RegionFile::getLocalIndex(job.position),
+                                 *job.save.chunk, encoding,
+                                 job.prepared)) {
+            continue;
+        }
+
+        job.region = region;
+
+        NativeFile file = region->getNativeFile();
+        auto &prepared = job.prepared;
+        operations.push_back({IoBackend::Operation::Type::WRITE, file,
+                              prepared.recordOffset, prepared.record.data(),
+                              prepared.record.size(), true});
+        operations.push_back({IoBackend::Operation::Type::WRITE, file,
+                              prepared.tableOffset, prepared.tableEntry.data(),
+                              prepared.tableEntry.size()});
+    }
+
+    backend->run(operations);
+
+    std::size_t next = 0;
+    for (auto &job : saveJobs) {
+        if (job.region != nullptr) {
+            // The table entry is written only if the record was
+            job.written = operations[next + 1].succeeded;
+            next += 2;
+
+            job.region->completeSave(job.prepared, job.written);
+            if (!job.written) {
+                logging::error() << "Could not write chunk to region file "
+                                 << job.region->getPath().string();
+            }
+        }
+
+        for (auto &callback : job.save.callbacks) {
+            jobs.submitToMain([callback = std::move(callback),
+                               written = job.written]() {
+                callback(written);
+            });
+        }
+    }
+}
+
+std::size_t ChunkIO::runLoads(std::vector<PendingLoad> &requests) {
+    if (requests.empty()) {
+        return 0;
+    }
+
+    PROFILE_SCOPE("ChunkIO::runLoads");
+
+    std::size_t read = 0;
+    for (auto &request : requests) {
+        auto chunk = std::make_shared<Chunk>();
+        if (storage.load(request.position, *chunk)) {
+            read++;
+        } else {
+            chunk.reset();
+        }
+
+        jobs.submitToMain([callback = std::move(request.callback), chunk]() {
+            callback(chunk.get());
+        });
+    }
+
+    return read;
+}
+
+} // namespace progressia::main
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "../io/io_backend.h"
+#include "../jobs/job_system.h"
+#include "../util.h"
+#include "chunk.h"
+#include "world_storage.h"
+
+namespace progressia::main {
+
+/*
+ * Saves and loads chunks of a WorldStorage on a dedicated I/O thread.
+ *
+ * save() copies the chunk, so callers may modify it right away. Saves of a
+ * position that is still queued are coalesced: the latest copy replaces the
+ * queued one and is written once. Loads of a position with a queued save
+ * are served from that copy without touching the disk.
+ *
+ * The I/O thread takes queued saves in batches of up to MAX_BATCH chunks,
+ * serializes them and issues all their writes with one IoBackend::run().
+ * Each save writes its record and then, linked after it, its table entry.
+ * Loads are read through the memory mappings of region files after the
+ * saves taken with them.
+ *
+ * Callbacks run on the main thread of the JobSystem, from
+ * JobSystem::runMainThreadJobs(). They must not refer to the ChunkIO, which
+ * may be destroyed before they run.
+ *
+ * All methods are thread-safe. The destructor finishes queued requests.
+ */
+class ChunkIO : private NonCopyable {
+  public:
+    constexpr static std::size_t MAX_BATCH = 256;
+
+    // Receives true if the chunk was written
+    using SaveCallback = std::function<void(bool saved)>;
+
+    // Receives nullptr if the chunk was never saved or cannot be read. The
+    // chunk may be moved from.
+    using LoadCallback = std::function<void(Chunk *loaded)>;
+
+    struct Stats {
+        std::size_t pendingSaves = 0;
+        std::size_t pendingLoads = 0;
+
+        uint64_t savesRequested = 0;
+        uint64_t savesCoalesced = 0;
+        uint64_t chunksWritten = 0;
+        uint64_t writesFailed = 0;
+
+        uint64_t loadsRequested = 0;
+        uint64_t loadsFromMemory = 0;
+        uint64_t chunksRead = 0; // Excludes chunks that were not found
+
+        uint64_t batches = 0;
+    };
+
+  private:
+    struct PendingSave {
+        std::shared_ptr<const Chunk> chunk;
+        std::vector<SaveCallback> callbacks;
+    };
+
+    struct PendingLoad {
+        glm::ivec3 position;
+        LoadCallback callback;
+    };
+
+    struct SaveJob {
+        glm::ivec3 position;
+        PendingSave save;
+        RegionFile *region;
+        RegionFile::PreparedSave prepared;
+        bool written;
+    };
+
+    WorldStorage storage;
+    std::unique_ptr<IoBackend> backend;
+    JobSystem &jobs;
+    ChunkEncoding encoding;
+
+    mutable std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::condition_variable idle;
+
+    std::unordered_map<glm::ivec3, PendingSave, ChunkPositionHash> saves;
+    std::vector<PendingLoad> loads;
+    bool busy;
+    bool syncRequested;
+    bool stopping;
+    Stats stats;
+
+    // Accessed only by the I/O thread
+    std::vector<SaveJob> saveJobs;
+    std::vector<IoBackend::Operation> operations;
+
+    std::thread thread;
+
+    void run();
+    void runSaves();
+    // Returns the number of chunks found
+    std::size_t runLoads(std::vector<PendingLoad> &);
+
+  public:
+    /*
+     * Stores chunks in region files in directory. backend is used by the
+     * I/O thread only.
+     */
+    ChunkIO(std::filesystem::path directory, std::unique_ptr<IoBackend>,
+            JobSystem &, ChunkEncoding = {});
+    ~ChunkIO();
+
+    void save(const glm::ivec3 &position, const Chunk &,
+              SaveCallback = nullptr);
+
+    void load(const glm::ivec3 &position, LoadCallback);
+
+    /*
+     * Blocks until all requests made so far are finished and their
+     * callbacks are queued, then syncs region files and closes those not
+     * used since the previous flush().
+     */
+    void flush();
+
+    Stats getStats() const;
+
+    const char *getBackendName() const;
+};
+
+} // namespace progressia::main
@@ -0,0 +1,45 @@
+#include "chunk_light.h"
+
+#include <algorithm>
+
+namespace progressia::main {
+
+ChunkLight::ChunkLight(uint8_t block, uint8_t sky)
+    : uniform(pack(block, sky)) {}
+
+void ChunkLight::setPacked(std::size_t index, uint8_t value) {
+    if (levels.empty()) {
+        if (value == uniform) {
+            return;
+        }
+        levels.assign(Chunk::VOLUME, uniform);
+    }
+
+    levels[index] = value;
+}
+
+void ChunkLight::fill(uint8_t block, uint8_t sky) {
+    uniform = pack(block, sky);
+    levels.clear();
+    levels.shrink_to_fit();
+}
+
+void ChunkLight::compact() {
+    if (levels.empty()) {
+        return;
+    }
+
+    uint8_t first = levels[0];
+    if (std::all_of(levels.begin(), levels.end(),
+                    [=](uint8_t value) { return value == first; })) {
+        uniform = first;
+        levels.clear();
+        levels.shrink_to_fit();
+    }
+}
+
+std::size_t ChunkLight::getMemoryUsage() const {
+    return sizeof(ChunkLight) + levels.capacity();
+}
+
+} // namespace progressia::main
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "chunk.h"
+
+namespace progressia::main {
+
+/*
+ * Light levels of the blocks of a chunk, indexed like Chunk.
+ *
+ * Each block has a block light level, emitted by blocks such as torches, and
+ * a skylight level, both from 0 to MAX_LIGHT. They share one byte: block
+ * light in the low nibble, skylight in the high nibble.
+ *
+ * Chunks deep underground or high in the air have the same levels
+ * everywhere, so storage is a single value until the first set() that
+ * breaks uniformity.
+ *
+ * Not thread-safe.
+ */
+class ChunkLight {
+  public:
+    constexpr static uint8_t MAX_LIGHT = 15;
+
+  private:
+    // Empty when every block has the levels of uniform
+    std::vector<uint8_t> levels;
+    uint8_t uniform;
+
+    static uint8_t pack(uint8_t block, uint8_t sky) {
+        return static_cast<uint8_t>(sky << 4 | block);
+    }
+
+    uint8_t getPacked(std::size_t index) const {
+        return levels.empty() ? uniform : levels[index];
+    }
+
+    void setPacked(std::size_t index, uint8_t value);
+
+  public:
+    explicit ChunkLight(uint8_t block = 0, uint8_t sky = 0);
+
+    uint8_t getBlock(std::size_t index) const {
+        return getPacked(index) & 0xF;
+    }
+
+    uint8_t getSky(std::size_t index) const { return getPacked(index) >> 4; }
+
+    void setBlock(std::size_t index, uint8_t level) {
+        setPacked(index, pack(level, getSky(index)));
+    }
+
+    void setSky(std::size_t index, uint8_t level) {
+        setPacked(index, pack(getBlock(index), level));
+    }
+
+    /*
+     * Sets the levels of all blocks and releases per-block storage.
+     */
+    void fill(uint8_t block, uint8_t sky);
+
+    bool isUniform() const { return levels.empty(); }
+
+    /*
+     * Releases per-block storage if all blocks have the same levels.
+     * set*() never does so by itself.
+     */
+    void compact();
+
+    /*
+     * Returns an estimate of heap and inline bytes used by this object.
+     */
+    std::size_t getMemoryUsage() const;
+};
+
+} // namespace progressia::main
@@ -0,0 +1,614 @@
+#include "chunk_manager.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/geometric.hpp>
+
+#include "../profiler.h"
+
+namespace progressia::main {
+
+namespace {
+
+// Level of chunks that have not been assigned one yet
+constexpr unsigned NO_LEVEL = MAX_LOD_LEVEL + 1;
+
+glm::ivec3 getChunkPosition(const glm::ivec3 &block) {
+    // Arithmetic shifts round towards negative infinity
+    return {block.x >> Chunk::SIZE_BITS, block.y >> Chunk::SIZE_BITS,
+            block.z >> Chunk::SIZE_BITS};
+}
+
+} // namespace
+
+ChunkManager::ChunkManager(const BlockTypes &types, JobSystem &jobs,
+                           const TerrainGenerator &generator, ChunkIO *io,
+                           const ChunkManagerSettings &settings)
+    : settings(settings), generator(generator), io(io), jobs(jobs),
+      mesher(types, jobs), inbox(std::make_shared<Inbox>()), light(types),
+      lightRunning(false), occupancy(types), viewer(0, 0, 0), updateCount(0) {
+}
+
+ChunkManager::~ChunkManager() {
+    // Generation jobs use the generator, the light job uses chunks
+    jobs.wait(generatorJobs);
+    jobs.wait(lightJob);
+
+    // Edits made while the light job ran are still queued
+    if (lightRunning) {
+        collectLight();
+    }
+    applyEdits();
+
+    if (io != nullptr) {
+        for (const auto &[position, entry] : chunks) {
+            if (entry.edited) {
+                io->save(position, entry.chunk);
+            }
+        }
+    }
+}
+
+void ChunkManager::setViewer(const glm::mat4 &view) {
+    // View matrices are rigid, so the inverse rotation is the transpose
+    glm::vec3 translation(view[3]);
+    viewer = -glm::vec3(glm::dot(glm::vec3(view[0]), translation),
+                        glm::dot(glm::vec3(view[1]), translation),
+                        glm::dot(glm::vec3(view[2]), translation));
+}
+
+void ChunkManager::setViewerPosition(const glm::vec3 &position) {
+    viewer = position;
+}
+
+float ChunkManager::getDistance(const glm::ivec3 &position) const {
+    glm::vec3 center = (glm::vec3(position) + 0.5F) * float(Chunk::SIZE);
+    return glm::length(center - viewer) / Chunk::SIZE;
+}
+
+float ChunkManager::getLevelRadius(unsigned level) const {
+    return level == 0 ? settings.loadRadius : settings.lodRadii[level - 1];
+}
+
+float ChunkManager::getViewRadius() const {
+    return std::max(settings.loadRadius,
+                    *std::max_element(settings.lodRadii.begin(),
+                                      settings.lodRadii.end()));
+}
+
+unsigned ChunkManager::getLevel(float distance, unsigned current) const {
+    // The finest level that reaches distance, or the coarsest one for
+    // chunks that are kept past the view radius
+    unsigned desired = 0;
+    for (unsigned level = 0; level <= MAX_LOD_LEVEL; level++) {
+        float radius = getLevelRadius(level);
+        if (radius <= 0) {
+            continue;
+        }
+
+        desired = level;
+        if (distance <= radius) {
+            break;
+        }
+    }
+
+    // Finer levels are kept within the margin, coarser ones never are
+    float margin = settings.unloadRadius - settings.loadRadius;
+    if (current < desired && distance <= getLevelRadius(current) + margin) {
+        return current;
+    }
+    return desired;
+}
+
+void ChunkManager::update() {
+    PROFILE_SCOPE("ChunkManager::update");
+
+    updateCount++;
+    mesher.setFocus(viewer);
+
+    receiveArrivals();
+    touchNear();
+
+    if (lightRunning && lightJob.isDone()) {
+        collectLight();
+    }
+
+    // The rest uses the light engine or changes chunks registered with it
+    if (!lightRunning) {
+        applyEdits();
+        unloadFar();
+        enforceBudget();
+        updateLevels();
+        if (settings.meshing) {
+            requestMeshes();
+        }
+        startLight();
+    }
+
+    requestMissing();
+    collectMeshes();
+}
+
+void ChunkManager::receiveArrivals() {
+    std::vector<Inbox::Arrival> arrivals;
+    {
+        std::lock_guard lock(inbox->mutex);
+        arrivals.swap(inbox->arrivals);
+    }
+
+    for (auto &arrival : arrivals) {
+        const glm::ivec3 &position = arrival.position;
+
+        if (!arrival.chunk) {
+            // Never saved
+            generate(position);
+            continue;
+        }
+
+        loading.erase(position);
+        if (arrival.generated) {
+            stats.chunksGenerated++;
+        } else {
+            stats.chunksRead++;
+        }
+
+        // The viewer has moved away in the meantime
+        float distance = getDistance(position);
+        float margin = settings.unloadRadius - settings.loadRadius;
+        if (distance > getViewRadius() + margin) {
+            continue;
+        }
+
+        Entry &entry = chunks[position];
+        entry.chunk = std::move(*arrival.chunk);
+        entry.level = getLevel(distance, NO_LEVEL);
+        entry.lastUsed = updateCount;
+        entry.lruPosition = lru.insert(lru.begin(), position);
+
+        occupancy.addChunk(position, entry.chunk);
+        updateMemoryUsage(position);
+        invalidateMeshes(position);
+    }
+}
+
+void ChunkManager::collectLight() {
+    lightRunning = false;
+
+    for (const auto &position : light.takeChanged()) {
+        auto it = chunks.find(position);
+        if (it != chunks.end()) {
+            it->second.lit = true;
+            updateMemoryUsage(position);
+            invalidateMeshes(position);
+        }
+    }
+}
+
+void ChunkManager::applyEdits() {
+    for (const auto &position : editedPositions) {
+        auto it = chunks.find(position);
+        if (it != chunks.end()) {
+            occupancy.addChunk(position, it->second.chunk);
+        }
+        updateMemoryUsage(position);
+        light.chunkChanged(position);
+    }
+    editedPositions.clear();
+
+    for (const auto &[position, block] : editedBlocks) {
+        glm::ivec3 chunkPosition = getChunkPosition(position);
+        auto it = chunks.find(chunkPosition);
+        if (it == chunks.end()) {
+            continue;
+        }
+
+        glm::ivec3 local = position - chunkPosition * Chunk::SIZE;
+        std::size_t index = Chunk::getIndex(local.x, local.y, local.z);
+
+        Entry &entry = it->second;
+        entry.chunk.set(index, block);
+        entry.edited = true;
+
+        light.blockChanged(chunkPosition, index);
+        occupancy.blockChanged(position, block);
+        updateMemoryUsage(chunkPosition);
+        invalidateMeshes(chunkPosition);
+    }
+    editedBlocks.clear();
+}
+
+void ChunkManager::updateLevels() {
+    std::vector<glm::ivec3> changed;
+
+    for (auto &[position, entry] : chunks) {
+        float distance = getDistance(position);
+
+        // Only chunks that may be shown in full detail need light
+        bool registered = distance <= settings.unloadRadius;
+        if (registered != entry.registered) {
+            if (registered) {
+                light.addChunk(position, entry.chunk);
+            } else {
+                light.removeChunk(position);
+                entry.lit = false;
+            }
+            entry.registered = registered;
+            changed.push_back(position);
+        }
+
+        unsigned level = getLevel(distance, entry.level);
+        if (level != entry.level) {
+            entry.level = level;
+            changed.push_back(position);
+        }
+    }
+
+    // Meshes of neighbours depend on the level and light of a chunk
+    for (const auto &position : changed) {
+        updateMemoryUsage(position);
+        invalidateMeshes(position);
+    }
+}
+
+void ChunkManager::startLight() {
+    if (!light.hasWork()) {
+        return;
+    }
+
+    lightRunning = true;
+    jobs.submit([this]() { light.run(); }, &lightJob);
+}
+
+void ChunkManager::unloadFar() {
+    float margin = settings.unloadRadius - settings.loadRadius;
+    float radius = getViewRadius() + margin;
+
+    std::vector<glm::ivec3> far;
+    for (const auto &[position, entry] : chunks) {
+        if (getDistance(position) > radius) {
+            far.push_back(position);
+        }
+    }
+
+    for (const auto &position : far) {
+        unload(position);
+        stats.unloaded++;
+    }
+}
+
+void ChunkManager::touchNear() {
+    missing.clear();
+
+    glm::ivec3 center(glm::floor(viewer / float(Chunk::SIZE)));
+    float radius = getViewRadius();
+    auto reach = static_cast<int>(std::ceil(radius));
+
+    for (int z = -reach; z <= reach; z++) {
+        for (int y = -reach; y <= reach; y++) {
+            for (int x = -reach; x <= reach; x++) {
+                glm::ivec3 position = center + glm::ivec3(x, y, z);
+                float distance = getDistance(position);
+                if (distance > radius) {
+                    continue;
+                }
+
+                auto it = chunks.find(position);
+                if (it != chunks.end()) {
+                    Entry &entry = it->second;
+                    entry.lastUsed = updateCount;
+                    lru.splice(lru.begin(), lru, entry.lruPosition);
+                } else if (loading.count(position) == 0) {
+                    missing.emplace_back(distance, position);
+                }
+            }
+        }
+    }
+}
+
+void ChunkManager::enforceBudget() {
+    // Chunks in the load radius are at the front, so eviction stops at them
+    while (stats.memoryUsage > settings.memoryBudget && !lru.empty()) {
+        glm::ivec3 position = lru.back();
+        if (chunks.at(position).lastUsed == updateCount) {
+            break;
+        }
+
+        unload(position);
+        stats.evicted++;
+    }
+}
+
+void ChunkManager::requestMissing() {
+    if (stats.memoryUsage > settings.memoryBudget) {
+        return;
+    }
+
+    std::sort(missing.begin(), missing.end(),
+              [](const auto &a, const auto &b) { return a.first < b.first; });
+
+    for (const auto &[distance, position] : missing) {
+        if (loading.size() >= settings.maxPendingLoads) {
+            break;
+        }
+
+        loading.insert(position);
+        if (io == nullptr) {
+            generate(position);
+            continue;
+        }
+
+        io->load(position,
+                 [inbox = inbox, position = position](Chunk *loaded) {
+                     std::unique_ptr<Chunk> chunk;
+                     if (loaded != nullptr) {
+                         chunk = std::make_unique<Chunk>(std::move(*loaded));
+                     }
+
+                     std::lock_guard lock(inbox->mutex);
+                     inbox->arrivals.push_back(
+                         {position, std::move(chunk), false});
+                 });
+    }
+}
+
+void ChunkManager::requestMeshes() {
+    for (auto &[position, entry] : chunks) {
+        if (!entry.needsMesh) {
+            continue;
+        }
+
+        bool requested = entry.level == 0 ? requestMesh(position, entry)
+                                          : requestLodMesh(position, entry);
+        if (requested) {
+            entry.needsMesh = false;
+            entry.meshing = true;
+        }
+    }
+}
+
+bool ChunkManager::requestMesh(const glm::ivec3 &position,
+                               const Entry &entry) {
+    if (!entry.lit) {
+        return false;
+    }
+
+    // Wait for neighbours that are about to arrive or to be lit. Faces
+    // towards coarser neighbours are kept, so that there are no holes where
+    // their meshes do not line up
+    ChunkNeighbours neighbours{};
+    ChunkLighting lighting;
+    lighting.light = light.getLight(position);
+    for (std::size_t i = 0; i < CHUNK_NEIGHBOUR_COUNT; i++) {
+        glm::ivec3 neighbour = position + getNeighbourOffset(i);
+        auto it = chunks.find(neighbour);
+        if (it == chunks.end()) {
+            if (loading.count(neighbour) != 0 ||
+                getDistance(neighbour) <= settings.loadRadius) {
+                return false;
+            }
+            continue;
+        }
+
+        const Entry &other = it->second;
+        if (other.level == 0) {
+            if (!other.lit) {
+                return false;
+            }
+            neighbours[i] = &other.chunk;
+        }
+        if (other.lit) {
+            lighting.neighbours[i] = light.getLight(neighbour);
+        }
+    }
+
+    mesher.request(position, entry.chunk, neighbours,
+                   glm::vec3(position * Chunk::SIZE), MeshingMode::GREEDY,
+                   lighting);
+    return true;
+}
+
+bool ChunkManager::requestLodMesh(const glm::ivec3 &position,
+                                  const Entry &entry) {
+    // Faces towards neighbours at other levels are kept as skirts
+    ChunkNeighbours neighbours{};
+    for (std::size_t face = 0; face < BLOCK_FACE_COUNT; face++) {
+        glm::ivec3 neighbour = position + getNeighbourOffset(face);
+        auto it = chunks.find(neighbour);
+        if (it == chunks.end()) {
+            if (loading.count(neighbour) != 0 ||
+                getDistance(neighbour) <= getViewRadius()) {
+                return false;
+            }
+            continue;
+        }
+
+        if (it->second.level == entry.level) {
+            neighbours[face] = &it->second.chunk;
+        }
+    }
+
+    mesher.requestLod(position, entry.chunk, neighbours,
+                      glm::vec3(position * Chunk::SIZE), entry.level);
+    return true;
+}
+
+void ChunkManager::collectMeshes() {
+    for (auto &mesh : mesher.takeCompleted()) {
+        auto it = chunks.find(mesh.position);
+        if (it == chunks.end()) {
+            continue;
+        }
+
+        Entry &entry = it->second;
+        entry.meshing = false;
+        entry.uploaded = true;
+        entry.vertices = 0;
+        entry.meshMemory = 0;
+        for (const auto &layer : mesh.layers) {
+            entry.vertices += layer.vertices.size();
+            entry.meshMemory += layer.vertices.size() * sizeof(Vertex) +
+                                layer.indices.size() * sizeof(Vertex::Index);
+        }
+
+        meshes.push_back(std::move(mesh));
+    }
+}
+
+void ChunkManager::generate(const glm::ivec3 &position) {
+    jobs.submit(
+        [this, inbox = inbox, position]() {
+            auto chunk = std::make_unique<Chunk>();
+            generator.generate(position, *chunk);
+
+            std::lock_guard lock(inbox->mutex);
+            inbox->arrivals.push_back({position, std::move(chunk), true});
+        },
+        &generatorJobs);
+}
+
+void ChunkManager::unload(const glm::ivec3 &position) {
+    auto it = chunks.find(position);
+    Entry &entry = it->second;
+
+    if (entry.edited && io != nullptr) {
+        io->save(position, entry.chunk);
+        stats.chunksSaved++;
+    }
+
+    if (entry.meshing) {
+        mesher.cancel(position);
+    }
+
+    // Meshes that the caller has not taken yet
+    meshes.erase(std::remove_if(meshes.begin(), meshes.end(),
+                                [&](const auto &mesh) {
+                                    return mesh.position == position;
+                                }),
+                 meshes.end());
+
+    if (entry.uploaded) {
+        unloaded.push_back(position);
+    }
+
+    stats.memoryUsage -= entry.memoryUsage;
+    lru.erase(entry.lruPosition);
+    light.removeChunk(position);
+    occupancy.removeChunk(position);
+    chunks.erase(it);
+}
+
+void ChunkManager::invalidateMeshes(const glm::ivec3 &position) {
+    auto it = chunks.find(position);
+    if (it != chunks.end()) {
+        it->second.needsMesh = true;
+    }
+
+    // Ambient occlusion and smooth light reach across edges and corners
+    for (std::size_t i = 0; i < CHUNK_NEIGHBOUR_COUNT; i++) {
+        it = chunks.find(position + getNeighbourOffset(i));
+        if (it != chunks.end()) {
+            it->second.needsMesh = true;
+        }
+    }
+}
+
+void ChunkManager::updateMemoryUsage(const glm::ivec3 &position) {
+    auto it = chunks.find(position);
+    if (it == chunks.end()) {
+        return;
+    }
+
+    Entry &entry = it->second;
+    stats.memoryUsage -= entry.memoryUsage;
+    entry.memoryUsage = entry.chunk.getMemoryUsage() +
+                        occupancy.getMemoryUsage(position);
+
+    const ChunkLight *chunkLight = light.getLight(position);
+    if (chunkLight != nullptr) {
+        entry.memoryUsage += chunkLight->getMemoryUsage();
+    }
+    stats.memoryUsage += entry.memoryUsage;
+}
+
+const Chunk *ChunkManager::find(const glm::ivec3 &position) const {
+    auto it = chunks.find(position);
+    return it == chunks.end() ? nullptr : &it->second.chunk;
+}
+
+Chunk *ChunkManager::edit(const glm::ivec3 &position) {
+    auto it = chunks.find(position);
+    if (it == chunks.end()) {
+        return nullptr;
+    }
+
+    if (lightRunning) {
+        jobs.wait(lightJob);
+        collectLight();
+    }
+
+    it->second.edited = true;
+    editedPositions.push_back(position);
+    invalidateMeshes(position);
+    return &it->second.chunk;
+}
+
+bool ChunkManager::setBlock(const glm::ivec3 &position, BlockId block) {
+    if (chunks.count(getChunkPosition(position)) == 0) {
+        return false;
+    }
+
+    editedBlocks.emplace_back(position, block);
+    if (!lightRunning) {
+        applyEdits();
+    }
+    return true;
+}
+
+std::vector<BackgroundMesher::Mesh> ChunkManager::takeMeshes() {
+    std::vector<BackgroundMesher::Mesh> result;
+    result.swap(meshes);
+    return result;
+}
+
+std::vector<glm::ivec3> ChunkManager::takeUnloaded() {
+    std::vector<glm::ivec3> result;
+    result.swap(unloaded);
+    return result;
+}
+
+ChunkManager::Stats ChunkManager::getStats() const {
+    Stats result = stats;
+    result.loaded = chunks.size();
+    result.loading = loading.size();
+    result.lighting = lightRunning || light.hasWork() ||
+                      !editedPositions.empty() || !editedBlocks.empty();
+
+    for (const auto &[position, entry] : chunks) {
+        bool registered = getDistance(position) <= settings.unloadRadius;
+        if (registered != entry.registered) {
+            // Waits for updateLevels()
+            result.lighting = true;
+        }
+        if (registered && !entry.lit) {
+            result.unlit++;
+        }
+
+        LevelStats &level = result.levels[entry.level];
+        level.chunks++;
+        level.memoryUsage += entry.memoryUsage;
+        level.vertices += entry.vertices;
+        level.meshMemory += entry.meshMemory;
+
+        if (entry.meshing) {
+            result.meshing++;
+        }
+        if (entry.uploaded) {
+            result.uploaded++;
+        }
+    }
+
+    return result;
+}
+
+} // namespace progressia::main
@@ -0,0 +1,290 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include "../jobs/job_system.h"
+#include "../util.h"
+#include "background_mesher.h"
+#include "chunk.h"
+#include "chunk_io.h"
+#include "light_engine.h"
+#include "occupancy_index.h"
+#include "terrain_generator.h"
+
+namespace progressia::main {
+
+struct ChunkManagerSettings {
+    // Chunks with centers within loadRadius chunks of the viewer are loaded,
+    // lit and meshed in full detail; chunks farther than unloadRadius are
+    // unloaded or only kept for coarser levels of detail. Chunks in between
+    // are kept, so that moving back and forth near a boundary does not
+    // reload them. The difference is also the margin by which a chunk must
+    // cross the boundary of its level of detail to become coarser.
+    float loadRadius = 4;
+    float unloadRadius = 6;
+
+    // Chunks beyond loadRadius are loaded and meshed at level of detail
+    // N + 1 up to lodRadii[N] chunks away, see ChunkMesher::buildLod(). A
+    // radius of 0 disables a level; others must grow with N.
+    std::array<float, MAX_LOD_LEVEL> lodRadii = {};
+
+    // Limit of Chunk::getMemoryUsage() over loaded chunks. Least recently
+    // used chunks outside loadRadius are evicted to stay within it, and no
+    // new chunks are loaded while it is exceeded.
+    std::size_t memoryBudget = std::size_t(256) << 20;
+
+    // Limit of chunks being loaded or generated at once
+    std::size_t maxPendingLoads = 64;
+
+    // Servers, which draw nothing, turn meshing off
+    bool meshing = true;
+};
+
+/*
+ * Keeps the chunks around a moving viewer in memory and meshed.
+ *
+ * Missing chunks within the load radius are requested nearest first: they
+ * are read with ChunkIO if one is given, and generated by a
+ * TerrainGenerator on the JobSystem if they were never saved.
+ *
+ * Chunks within the unload radius are lit by a LightEngine in a job; one
+ * light job runs at a time, and arrivals and edits made meanwhile wait for
+ * the next one. A chunk in full detail is meshed with its light once it and
+ * each of the 26 chunks around it are loaded and lit, at a coarser level, or
+ * outside the load radius. It is remeshed when light or blocks change in it
+ * or around it.
+ *
+ * Chunks at coarser levels of detail are meshed without light once their
+ * face neighbours are loaded or outside the view, and remeshed when their
+ * level or the level of a neighbour changes.
+ *
+ * Chunks are unloaded beyond the unload radius and when the memory budget
+ * is exceeded. Edited chunks are saved with ChunkIO before being unloaded.
+ *
+ * Meshes are placed in world space with block (0, 0, 0) of chunk (0, 0, 0)
+ * at the origin. The caller uploads meshes returned by takeMeshes() and
+ * destroys those of positions returned by takeUnloaded().
+ *
+ * All methods must be called from the main thread of the JobSystem, which
+ * must run main thread jobs for ChunkIO callbacks to arrive.
+ */
+class ChunkManager : private NonCopyable {
+  public:
+    struct LevelStats {
+        // Loaded chunks at the level and bytes used by them
+        std::size_t chunks = 0;
+        std::size_t memoryUsage = 0;
+
+        // Vertices and bytes of vertex and index data in their meshes
+        std::size_t vertices = 0;
+        std::size_t meshMemory = 0;
+    };
+
+    struct Stats {
+        // Chunks in memory and bytes used by them
+        std::size_t loaded = 0;
+        std::size_t memoryUsage = 0;
+
+        // Chunks requested from ChunkIO or TerrainGenerator
+        std::size_t loading = 0;
+
+        // Loaded chunks within the unload radius that are not lit yet
+        std::size_t unlit = 0;
+
+        // Light is being computed or there are changes waiting for it
+        bool lighting = false;
+
+        // Loaded chunks with a mesh being built
+        std::size_t meshing = 0;
+
+        // Loaded chunks with a mesh returned by takeMeshes()
+        std::size_t uploaded = 0;
+
+        uint64_t chunksRead = 0;
+        uint64_t chunksGenerated = 0;
+        uint64_t chunksSaved = 0;
+
+        // Unloaded because of distance and because of the memory budget
+        uint64_t unloaded = 0;
+        uint64_t evicted = 0;
+
+        // Indexed by level of detail
+        std::array<LevelStats, MAX_LOD_LEVEL + 1> levels;
+    };
+
+  private:
+    struct Entry {
+        Chunk chunk;
+        std::size_t memoryUsage = 0;
+
+        unsigned level = 0;
+
+        bool edited = false;
+        bool registered = false; // with the light engine
+        bool lit = false;
+        bool needsMesh = true;
+        bool meshing = false;
+        bool uploaded = false;
+
+        // Size of the last mesh returned by takeMeshes()
+        std::size_t vertices = 0;
+        std::size_t meshMemory = 0;
+
+        // Update number of the last time the chunk was in the load radius
+        uint64_t lastUsed = 0;
+        std::list<glm::ivec3>::iterator lruPosition;
+    };
+
+    // Filled by jobs and ChunkIO callbacks, which may outlive the manager
+    struct Inbox {
+        struct Arrival {
+            glm::ivec3 position;
+            std::unique_ptr<Chunk> chunk; // nullptr if not found by ChunkIO
+            bool generated;
+        };
+
+        std::mutex mutex;
+        std::vector<Arrival> arrivals;
+    };
+
+    ChunkManagerSettings settings;
+    TerrainGenerator generator;
+    ChunkIO *io;
+    JobSystem &jobs;
+    BackgroundMesher mesher;
+
+    std::unordered_map<glm::ivec3, Entry, ChunkPositionHash> chunks;
+
+    // Loaded chunks, most recently used first
+    std::list<glm::ivec3> lru;
+
+    std::unordered_set<glm::ivec3, ChunkPositionHash> loading;
+    std::shared_ptr<Inbox> inbox;
+    JobCounter generatorJobs;
+
+    // The engine and the chunks registered with it belong to the light job
+    // while it runs
+    LightEngine light;
+    JobCounter lightJob;
+    bool lightRunning;
+
+    OccupancyIndex occupancy;
+
+    // Changes that wait for the light job to finish
+    std::vector<glm::ivec3> editedPositions;
+    std::vector<std::pair<glm::ivec3, BlockId>> editedBlocks;
+
+    // Scratch space of update()
+    std::vector<std::pair<float, glm::ivec3>> missing;
+
+    std::vector<BackgroundMesher::Mesh> meshes;
+    std::vector<glm::ivec3> unloaded;
+
+    glm::vec3 viewer;
+    uint64_t updateCount;
+    Stats stats;
+
+    float getDistance(const glm::ivec3 &position) const;
+    float getLevelRadius(unsigned level) const;
+    float getViewRadius() const;
+    unsigned getLevel(float distance, unsigned current) const;
+
+    void receiveArrivals();
+    void collectLight();
+    void applyEdits();
+    void updateLevels();
+    void startLight();
+    void unloadFar();
+    void touchNear();
+    void enforceBudget();
+    void requestMissing();
+    void requestMeshes();
+    bool requestMesh(const glm::ivec3 &position, const Entry &);
+    bool requestLodMesh(const glm::ivec3 &position, const Entry &);
+    void collectMeshes();
+
+    void generate(const glm::ivec3 &position);
+    void unload(const glm::ivec3 &position);
+    void invalidateMeshes(const glm::ivec3 &position);
+    void updateMemoryUsage(const glm::ivec3 &position);
+
+  public:
+    /*
+     * io may be nullptr to generate every chunk. It must outlive the
+     * manager.
+     */
+    ChunkManager(const BlockTypes &, JobSystem &, const TerrainGenerator &,
+                 ChunkIO *io, const ChunkManagerSettings & = {});
+    ~ChunkManager();
+
+    /*
+     * Moves the viewer to the camera position of a view matrix as given to
+     * View::configure().
+     */
+    void setViewer(const glm::mat4 &view);
+
+    /*
+     * Moves the viewer to a position in blocks.
+     */
+    void setViewerPosition(const glm::vec3 &);
+
+    const glm::vec3 &getViewerPosition() const { return viewer; }
+
+    /*
+     * Processes arrived chunks and meshes and issues new requests. Call
+     * once per frame.
+     */
+    void update();
+
+    const Chunk *find(const glm::ivec3 &position) const;
+
+    /*
+     * Returns the chunk at position for modification, or nullptr if it is
+     * not loaded. The chunk is saved before it is unloaded, and it is
+     * relit and remeshed with its neighbours by the next update().
+     *
+     * Waits for the light job, which reads the chunk. Prefer setBlock() for
+     * changes of single blocks.
+     */
+    Chunk *edit(const glm::ivec3 &position);
+
+    /*
+     * Sets the block at position in blocks and updates light around it.
+     * Returns false if its chunk is not loaded. If the light job is running,
+     * the block is set by a later update().
+     */
+    bool setBlock(const glm::ivec3 &position, BlockId);
+
+    /*
+     * Returns occupancy of the loaded chunks for ray queries. It follows
+     * edits once they are applied to light, and may be used by jobs while
+     * no other method of the manager is running.
+     */
+    const OccupancyIndex &getOccupancy() const { return occupancy; }
+
+    /*
+     * Returns meshes completed since the last call.
+     */
+    std::vector<BackgroundMesher::Mesh> takeMeshes();
+
+    /*
+     * Returns positions of chunks unloaded since the last call. Their
+     * meshes are no longer valid.
+     */
+    std::vector<glm::ivec3> takeUnloaded();
+
+    Stats getStats() const;
+};
+
+} // namespace progressia::main
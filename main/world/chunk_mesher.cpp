@@ -0,0 +1,541 @@
+#include "chunk_mesher.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "../profiler.h"
+
+namespace progressia::main {
+
+namespace {
+
+constexpr std::size_t MAX_LAYER_VERTICES =
+    std::size_t(std::numeric_limits<Vertex::Index>::max()) + 1;
+
+// Side of the chunk with its one block border
+constexpr int P = Chunk::SIZE + 2;
+
+std::size_t getPaddedIndex(int x, int y, int z) {
+    return (std::size_t(z + 1) * P + (y + 1)) * P + (x + 1);
+}
+
+} // namespace
+
+ChunkMesher::ChunkMesher(const BlockTypes &types)
+    : types(types), padded(std::size_t(P) * P * P, BLOCK_AIR),
+      paddedLight(std::size_t(P) * P * P, 0),
+      mask(std::size_t(Chunk::SIZE) * Chunk::SIZE, BLOCK_AIR),
+      maskLighting(std::size_t(Chunk::SIZE) * Chunk::SIZE, 0), layerCount(0),
+      quadCount(0) {
+
+    // Outward normal equals cross(width, height), so faces wind
+    // counter-clockwise when seen from outside
+    glm::vec3 x(1, 0, 0);
+    glm::vec3 y(0, 1, 0);
+    glm::vec3 z(0, 0, 1);
+    glm::vec3 o(0, 0, 0);
+
+    constexpr int SX = 1;
+    constexpr int SY = P;
+    constexpr int SZ = P * P;
+
+    auto face = [this](BlockFace f) -> FaceGeometry & {
+        return faces[static_cast<std::size_t>(f)];
+    };
+
+    face(BlockFace::NEG_X) = {o, z, y, -x, -SX, SZ, SY, SX};
+    face(BlockFace::POS_X) = {x, y, z, x, SX, SY, SZ, SX};
+    face(BlockFace::NEG_Y) = {o, x, z, -y, -SY, SX, SZ, SY};
+    face(BlockFace::POS_Y) = {y, z, x, y, SY, SZ, SX, SY};
+    face(BlockFace::NEG_Z) = {o, y, x, -z, -SZ, SY, SX, SZ};
+    face(BlockFace::POS_Z) = {z, x, y, z, SZ, SX, SY, SZ};
+}
+
+void ChunkMesher::updateTypes() {
+    if (visible.size() == types.getCount()) {
+        return;
+    }
+
+    visible.resize(types.getCount());
+    opaque.resize(types.getCount());
+    for (std::size_t id = 0; id < types.getCount(); id++) {
+        const auto &type = types.get(static_cast<BlockId>(id));
+        visible[id] = type.visible ? 1 : 0;
+        opaque[id] = type.opaque ? 1 : 0;
+    }
+}
+
+void ChunkMesher::loadPadded(const Chunk &chunk,
+                             const ChunkNeighbours &neighbours,
+                             const ChunkLighting &lighting) {
+    constexpr int S = Chunk::SIZE;
+
+    auto pack = [](const ChunkLight &light, std::size_t index) {
+        return static_cast<uint8_t>(light.getSky(index) << 4 |
+                                    light.getBlock(index));
+    };
+
+    std::fill(padded.begin(), padded.end(), BLOCK_AIR);
+    std::fill(paddedLight.begin(), paddedLight.end(),
+              static_cast<uint8_t>(ChunkLight::MAX_LIGHT << 4));
+
+    chunk.forEach([&](int x, int y, int z, BlockId block) {
+        padded[getPaddedIndex(x, y, z)] = block;
+    });
+
+    if (lighting.light != nullptr) {
+        for (int z = 0; z < S; z++) {
+            for (int y = 0; y < S; y++) {
+                for (int x = 0; x < S; x++) {
+                    paddedLight[getPaddedIndex(x, y, z)] =
+                        pack(*lighting.light, Chunk::getIndex(x, y, z));
+                }
+            }
+        }
+    }
+
+    // Edges and corners are needed for ambient occlusion and smooth light
+    for (std::size_t i = 0; i < CHUNK_NEIGHBOUR_COUNT; i++) {
+        const Chunk *neighbour = neighbours[i];
+        const ChunkLight *light = lighting.neighbours[i];
+        if (neighbour == nullptr && light == nullptr) {
+            continue;
+        }
+
+        // Border cells next to the neighbour, in coordinates of chunk
+        glm::ivec3 offset = getNeighbourOffset(i);
+        glm::ivec3 first;
+        glm::ivec3 last;
+        for (int axis = 0; axis < 3; axis++) {
+            first[axis] = offset[axis] < 0 ? -1 : offset[axis] * S;
+            last[axis] = offset[axis] < 0 ? -1 : S - 1 + offset[axis];
+        }
+
+        for (int z = first.z; z <= last.z; z++) {
+            for (int y = first.y; y <= last.y; y++) {
+                for (int x = first.x; x <= last.x; x++) {
+                    std::size_t source = Chunk::getIndex(
+                        x - offset.x * S, y - offset.y * S, z - offset.z * S);
+                    std::size_t target = getPaddedIndex(x, y, z);
+
+                    if (neighbour != nullptr) {
+                        padded[target] = neighbour->get(source);
+                    }
+                    if (light != nullptr) {
+                        paddedLight[target] = pack(*light, source);
+                    }
+                }
+            }
+        }
+    }
+}
+
+uint64_t ChunkMesher::getCornerLighting(std::size_t cell,
+                                        const FaceGeometry &face) const {
+    auto front = static_cast<std::ptrdiff_t>(cell) + face.offset;
+    uint64_t result = 0;
+
+    for (unsigned corner = 0; corner < 4; corner++) {
+        // Same order as the vertices of addQuad()
+        std::ptrdiff_t u =
+            corner == 1 || corner == 2 ? face.widthStride : -face.widthStride;
+        std::ptrdiff_t v = corner >= 2 ? face.heightStride : -face.heightStride;
+
+        bool side1 = opaque[padded[front + u]] != 0;
+        bool side2 = opaque[padded[front + v]] != 0;
+        bool diagonal = opaque[padded[front + u + v]] != 0;
+
+        // The diagonal block is hidden when both sides are opaque
+        unsigned occlusion = 0;
+        if (!side1 || !side2) {
+            occlusion = 3 - unsigned(side1) - unsigned(side2) -
+                        unsigned(diagonal);
+        }
+
+        unsigned block = 0;
+        unsigned sky = 0;
+        unsigned count = 0;
+        auto sample = [&](std::ptrdiff_t index) {
+            block += paddedLight[index] & 0xFU;
+            sky += paddedLight[index] >> 4U;
+            count++;
+        };
+
+        sample(front);
+        if (!side1) {
+            sample(front + u);
+        }
+        if (!side2) {
+            sample(front + v);
+        }
+        if (!(side1 && side2) && !diagonal) {
+            sample(front + u + v);
+        }
+
+        // Averages are kept in quarter levels
+        block = (block * 4 + count / 2) / count;
+        sky = (sky * 4 + count / 2) / count;
+
+        result |= uint64_t(block | sky << 6U | occlusion << 12U)
+                  << (corner * 16);
+    }
+
+    return result;
+}
+
+void ChunkMesher::downsample(const Chunk &chunk, unsigned level,
+                             const glm::ivec3 &from, const glm::ivec3 &to) {
+    int factor = 1 << level;
+    int size = Chunk::SIZE >> level;
+    int volume = factor * factor * factor;
+
+    auto getCell = [&](int x, int y, int z) -> BlockId & {
+        return cells[(std::size_t(z) * size + y) * size + x];
+    };
+
+    if (chunk.isUniform()) {
+        BlockId block = visible[chunk.get(0)] != 0 ? chunk.get(0) : BLOCK_AIR;
+        for (int z = from.z; z < to.z; z++) {
+            for (int y = from.y; y < to.y; y++) {
+                for (int x = from.x; x < to.x; x++) {
+                    getCell(x, y, z) = block;
+                }
+            }
+        }
+        return;
+    }
+
+    for (int cz = from.z; cz < to.z; cz++) {
+        for (int cy = from.y; cy < to.y; cy++) {
+            for (int cx = from.x; cx < to.x; cx++) {
+                int count = 0;
+                BlockId highest = BLOCK_AIR;
+
+                glm::ivec3 base = glm::ivec3(cx, cy, cz) * factor;
+                for (int z = base.z + factor - 1; z >= base.z; z--) {
+                    for (int y = base.y; y < base.y + factor; y++) {
+                        for (int x = base.x; x < base.x + factor; x++) {
+                            BlockId block = chunk.get(x, y, z);
+                            if (visible[block] == 0) {
+                                continue;
+                            }
+
+                            count++;
+                            if (highest == BLOCK_AIR) {
+                                highest = block;
+                            }
+                        }
+                    }
+                }
+
+                // Cells that are mostly empty stay empty
+                if (count * 2 < volume) {
+                    highest = BLOCK_AIR;
+                }
+                getCell(cx, cy, cz) = highest;
+            }
+        }
+    }
+}
+
+void ChunkMesher::loadPaddedLod(const Chunk &chunk,
+                                const ChunkNeighbours &neighbours,
+                                unsigned level) {
+    int size = Chunk::SIZE >> level;
+    auto getCell = [&](const glm::ivec3 &at) {
+        return cells[(std::size_t(at.z) * size + at.y) * size + at.x];
+    };
+
+    cells.resize(std::size_t(size) * size * size);
+    std::fill(padded.begin(), padded.end(), BLOCK_AIR);
+    std::fill(paddedLight.begin(), paddedLight.end(),
+              static_cast<uint8_t>(ChunkLight::MAX_LIGHT << 4));
+
+    // The layer of cells of each neighbour that touches the chunk
+    for (std::size_t face = 0; face < BLOCK_FACE_COUNT; face++) {
+        if (neighbours[face] == nullptr) {
+            continue;
+        }
+
+        auto axis = static_cast<int>(face / 2);
+        int layer = face % 2 == 0 ? size - 1 : 0;
+
+        glm::ivec3 from(0, 0, 0);
+        glm::ivec3 to(size, size, size);
+        from[axis] = layer;
+        to[axis] = layer + 1;
+        downsample(*neighbours[face], level, from, to);
+
+        for (int b = 0; b < size; b++) {
+            for (int a = 0; a < size; a++) {
+                glm::ivec3 source;
+                source[axis] = layer;
+                source[(axis + 1) % 3] = a;
+                source[(axis + 2) % 3] = b;
+
+                glm::ivec3 target = source;
+                target[axis] = face % 2 == 0 ? -1 : size;
+
+                padded[getPaddedIndex(target.x, target.y, target.z)] =
+                    getCell(source);
+            }
+        }
+    }
+
+    downsample(chunk, level, {0, 0, 0}, {size, size, size});
+    for (int z = 0; z < size; z++) {
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                padded[getPaddedIndex(x, y, z)] = getCell({x, y, z});
+            }
+        }
+    }
+}
+
+ChunkMesher::Layer &ChunkMesher::getLayerFor(std::size_t texture) {
+    if (texture >= currentLayers.size()) {
+        currentLayers.resize(texture + 1, NO_LAYER);
+    }
+
+    std::size_t &index = currentLayers[texture];
+    if (index != NO_LAYER &&
+        layers[index].vertices.size() + 4 <= MAX_LAYER_VERTICES) {
+        return layers[index];
+    }
+
+    // Start a new layer, reusing storage of a previous build if possible
+    if (layerCount == layers.size()) {
+        layers.emplace_back();
+    }
+
+    index = layerCount++;
+    Layer &layer = layers[index];
+    layer.texture = texture;
+    layer.vertices.clear();
+    layer.indices.clear();
+    return layer;
+}
+
+void ChunkMesher::addQuad(const BlockType &type, const glm::vec3 &position,
+                          const FaceGeometry &face, uint64_t lighting,
+                          int width, int height, float scale) {
+    constexpr std::array<float, 4> OCCLUSION = {0.4F, 0.6F, 0.8F, 1.0F};
+    constexpr float LIGHT_SCALE = 1.0F / (4 * ChunkLight::MAX_LIGHT);
+
+    Layer &layer = getLayerFor(type.texture);
+
+    auto offset = static_cast<Vertex::Index>(layer.vertices.size());
+    glm::vec3 origin = position + face.origin * scale;
+    auto w = static_cast<float>(width) * scale;
+    auto h = static_cast<float>(height) * scale;
+
+    // Texture coordinates above 1 tile the texture across merged faces
+    std::array<Vertex, 4> corners = {{
+        {origin, type.color, face.normal, {0, 0}},
+        {origin + face.width * w, type.color, face.normal, {0, w}},
+        {origin + face.width * w + face.height * h, type.color, face.normal,
+         {h, w}},
+        {origin + face.height * h, type.color, face.normal, {h, 0}},
+    }};
+
+    std::array<unsigned, 4> occlusion{};
+    for (std::size_t i = 0; i < corners.size(); i++) {
+        auto packed = static_cast<unsigned>(lighting >> (i * 16));
+        occlusion[i] = packed >> 12U & 3U;
+
+        corners[i].light = {float(packed & 0x3FU) * LIGHT_SCALE,
+                            float(packed >> 6U & 0x3FU) * LIGHT_SCALE};
+        corners[i].occlusion = OCCLUSION[occlusion[i]];
+        layer.vertices.push_back(corners[i]);
+    }
+
+    // Splitting along the brighter diagonal keeps a single occluded corner
+    // from darkening half of the quad
+    constexpr std::array<Vertex::Index, 6> QUAD_INDICES = {0, 1, 2, 0, 2, 3};
+    constexpr std::array<Vertex::Index, 6> FLIPPED_INDICES = {1, 2, 3,
+                                                              1, 3, 0};
+    bool flip = occlusion[0] + occlusion[2] < occlusion[1] + occlusion[3];
+    for (Vertex::Index i : flip ? FLIPPED_INDICES : QUAD_INDICES) {
+        layer.indices.push_back(static_cast<Vertex::Index>(offset + i));
+    }
+
+    quadCount++;
+}
+
+void ChunkMesher::reset() {
+    layerCount = 0;
+    quadCount = 0;
+    std::fill(currentLayers.begin(), currentLayers.end(), NO_LAYER);
+}
+
+void ChunkMesher::buildNaive(const glm::vec3 &origin) {
+    for (int z = 0; z < Chunk::SIZE; z++) {
+        for (int y = 0; y < Chunk::SIZE; y++) {
+            const BlockId *cell = &padded[getPaddedIndex(0, y, z)];
+            for (int x = 0; x < Chunk::SIZE; x++, cell++) {
+                BlockId block = *cell;
+                if (visible[block] == 0) {
+                    continue;
+                }
+
+                const auto &type = types.get(block);
+                glm::vec3 position = origin + glm::vec3(x, y, z);
+
+                for (const auto &face : faces) {
+                    BlockId neighbour = cell[face.offset];
+
+                    // Transparent blocks of one type merge into one volume
+                    if (opaque[neighbour] != 0 || neighbour == block) {
+                        continue;
+                    }
+
+                    addQuad(type, position, face,
+                            getCornerLighting(
+                                static_cast<std::size_t>(cell - padded.data()),
+                                face));
+                }
+            }
+        }
+    }
+}
+
+void ChunkMesher::buildGreedy(const glm::vec3 &origin, int size,
+                              float scale) {
+    const int S = size;
+    const BlockId *base = &padded[getPaddedIndex(0, 0, 0)];
+
+    for (const auto &face : faces) {
+        glm::vec3 depthAxis = glm::abs(face.normal);
+
+        for (int d = 0; d < S; d++) {
+            const BlockId *slice = base + std::ptrdiff_t(d) * face.depthStride;
+
+            // Collect visible faces of the slice; BLOCK_AIR marks no face
+            bool empty = true;
+            for (int b = 0; b < S; b++) {
+                for (int a = 0; a < S; a++) {
+                    const BlockId *cell =
+                        slice + std::ptrdiff_t(a) * face.widthStride +
+                        std::ptrdiff_t(b) * face.heightStride;
+                    BlockId block = *cell;
+                    BlockId neighbour = cell[face.offset];
+
+                    bool hidden = visible[block] == 0 ||
+                                  opaque[neighbour] != 0 || neighbour == block;
+                    std::size_t i = std::size_t(b) * S + a;
+                    mask[i] = hidden ? BLOCK_AIR : block;
+                    maskLighting[i] =
+                        hidden ? 0
+                               : getCornerLighting(
+                                     static_cast<std::size_t>(cell -
+                                                              padded.data()),
+                                     face);
+                    empty = empty && hidden;
+                }
+            }
+
+            if (empty) {
+                continue;
+            }
+
+            for (int b = 0; b < S; b++) {
+                for (int a = 0; a < S;) {
+                    std::size_t start = std::size_t(b) * S + a;
+                    BlockId block = mask[start];
+                    if (block == BLOCK_AIR) {
+                        a++;
+                        continue;
+                    }
+
+                    // Faces merge only if every corner is lit alike
+                    uint64_t lighting = maskLighting[start];
+                    auto matches = [&](std::size_t i) {
+                        return mask[i] == block && maskLighting[i] == lighting;
+                    };
+
+                    int width = 1;
+                    while (a + width < S && matches(start + width)) {
+                        width++;
+                    }
+
+                    int height = 1;
+                    for (; b + height < S; height++) {
+                        std::size_t row = start + std::size_t(height) * S;
+                        bool full = true;
+                        for (int i = 0; i < width && full; i++) {
+                            full = matches(row + i);
+                        }
+                        if (!full) {
+                            break;
+                        }
+                    }
+
+                    for (int h = 0; h < height; h++) {
+                        BlockId *row = &mask[std::size_t(b + h) * S + a];
+                        std::fill(row, row + width, BLOCK_AIR);
+                    }
+
+                    glm::vec3 position =
+                        origin + (depthAxis * static_cast<float>(d) +
+                                  face.width * static_cast<float>(a) +
+                                  face.height * static_cast<float>(b)) *
+                                     scale;
+                    addQuad(types.get(block), position, face, lighting, width,
+                            height, scale);
+
+                    a += width;
+                }
+            }
+        }
+    }
+}
+
+void ChunkMesher::build(const Chunk &chunk, const ChunkNeighbours &neighbours,
+                        const glm::vec3 &origin, MeshingMode mode,
+                        const ChunkLighting &lighting) {
+    PROFILE_SCOPE("ChunkMesher::build");
+
+    updateTypes();
+    reset();
+
+    if (chunk.isUniform() && visible[chunk.get(0)] == 0) {
+        return;
+    }
+
+    loadPadded(chunk, neighbours, lighting);
+
+    switch (mode) {
+    case MeshingMode::NAIVE:
+        buildNaive(origin);
+        break;
+    case MeshingMode::GREEDY:
+        buildGreedy(origin);
+        break;
+    }
+}
+
+void ChunkMesher::buildLod(const Chunk &chunk,
+                           const ChunkNeighbours &neighbours,
+                           const glm::vec3 &origin, unsigned level) {
+    PROFILE_SCOPE("ChunkMesher::buildLod");
+
+    updateTypes();
+    reset();
+
+    if (chunk.isUniform() && visible[chunk.get(0)] == 0) {
+        return;
+    }
+
+    loadPaddedLod(chunk, neighbours, level);
+    buildGreedy(origin, Chunk::SIZE >> level, static_cast<float>(1U << level));
+}
+
+std::size_t ChunkMesher::getLayerCount() const { return layerCount; }
+
+const ChunkMesher::Layer &ChunkMesher::getLayer(std::size_t index) const {
+    return layers.at(index);
+}
+
+std::size_t ChunkMesher::getQuadCount() const { return quadCount; }
+
+} // namespace progressia::main
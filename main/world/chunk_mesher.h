@@ -0,0 +1,155 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "../rendering.h"
+#include "block_types.h"
+#include "chunk.h"
+#include "chunk_light.h"
+
+namespace progressia::main {
+
+/*
+ * Chunks around a chunk, indexed like getNeighbourOffset(). nullptr means
+ * that the neighbour is not loaded; faces towards it are emitted.
+ */
+using ChunkNeighbours = std::array<const Chunk *, CHUNK_NEIGHBOUR_COUNT>;
+
+/*
+ * Light of a chunk and of the chunks around it, indexed like
+ * ChunkNeighbours. nullptr means full skylight.
+ */
+struct ChunkLighting {
+    const ChunkLight *light = nullptr;
+    std::array<const ChunkLight *, CHUNK_NEIGHBOUR_COUNT> neighbours{};
+};
+
+/*
+ * Number of coarser levels of detail. Level N has one cell for each 2^N
+ * blocks along each axis.
+ */
+constexpr unsigned MAX_LOD_LEVEL = 3;
+
+enum class MeshingMode {
+    // One quad per visible face
+    NAIVE,
+
+    // Coplanar adjacent faces of the same block type and lighting are merged
+    // into larger quads with tiled texture coordinates
+    GREEDY
+};
+
+/*
+ * Builds chunk geometry that contains only faces between a visible block and
+ * a neighbour that does not hide it: a transparent block of another type or
+ * a missing neighbour chunk.
+ *
+ * Each vertex gets the average light of the up to four transparent blocks
+ * that touch it in front of the face, and ambient occlusion from the opaque
+ * ones among them. Quads are split along the diagonal that keeps occlusion
+ * symmetric.
+ *
+ * Distant chunks can be built at a coarser level of detail instead. The chunk
+ * is downsampled into cells of 2^level blocks, and the cells are meshed
+ * greedily without light. A cell is filled if at least half of its blocks
+ * are visible, with the highest of them so that surfaces keep their top
+ * blocks. Faces are culled only against neighbours built at the same level.
+ * Towards other neighbours the border faces act as skirts that hide the
+ * cracks between levels.
+ *
+ * Faces are grouped into layers by texture so that each layer can become one
+ * Primitive. Storage is reused between builds, so a mesher should be kept
+ * for the lifetime of the thread that meshes chunks.
+ */
+class ChunkMesher : private NonCopyable {
+  public:
+    struct Layer {
+        std::size_t texture;
+        std::vector<Vertex> vertices;
+        std::vector<Vertex::Index> indices;
+    };
+
+  private:
+    constexpr static std::size_t NO_LAYER = SIZE_MAX;
+
+    struct FaceGeometry {
+        glm::vec3 origin;
+        glm::vec3 width;
+        glm::vec3 height;
+        glm::vec3 normal;
+
+        // Offsets in padded towards the neighbour, along width and height,
+        // and between slices parallel to the face
+        int offset;
+        int widthStride;
+        int heightStride;
+        int depthStride;
+    };
+
+    const BlockTypes &types;
+    std::array<FaceGeometry, BLOCK_FACE_COUNT> faces;
+
+    // Cached from types, indexed by BlockId
+    std::vector<uint8_t> visible;
+    std::vector<uint8_t> opaque;
+
+    // Chunk blocks and packed ChunkLight levels with a one block border
+    // copied from neighbours
+    std::vector<BlockId> padded;
+    std::vector<uint8_t> paddedLight;
+
+    // Faces of one slice that are still to be merged and their corner
+    // lighting, used by greedy meshing
+    std::vector<BlockId> mask;
+    std::vector<uint64_t> maskLighting;
+
+    // Cells of a downsampled chunk, indexed like Chunk
+    std::vector<BlockId> cells;
+
+    std::vector<Layer> layers;
+    std::size_t layerCount;
+    std::vector<std::size_t> currentLayers;
+    std::size_t quadCount;
+
+    void updateTypes();
+    void loadPadded(const Chunk &, const ChunkNeighbours &,
+                    const ChunkLighting &);
+    void downsample(const Chunk &, unsigned level, const glm::ivec3 &from,
+                    const glm::ivec3 &to);
+    void loadPaddedLod(const Chunk &, const ChunkNeighbours &, unsigned level);
+    uint64_t getCornerLighting(std::size_t cell, const FaceGeometry &) const;
+    Layer &getLayerFor(std::size_t texture);
+    void addQuad(const BlockType &, const glm::vec3 &position,
+                 const FaceGeometry &, uint64_t lighting, int width = 1,
+                 int height = 1, float scale = 1);
+
+    void reset();
+    void buildNaive(const glm::vec3 &origin);
+    void buildGreedy(const glm::vec3 &origin, int size = Chunk::SIZE,
+                     float scale = 1);
+
+  public:
+    explicit ChunkMesher(const BlockTypes &);
+
+    /*
+     * Builds the mesh of chunk with its block (0, 0, 0) placed at origin.
+     * Previous results are discarded.
+     */
+    void build(const Chunk &, const ChunkNeighbours &, const glm::vec3 &origin,
+               MeshingMode = MeshingMode::NAIVE, const ChunkLighting & = {});
+
+    /*
+     * Builds the mesh of chunk at level of detail level, from 1 to
+     * MAX_LOD_LEVEL. Only face neighbours are used; they must be non-null
+     * only if they are built at the same level.
+     */
+    void buildLod(const Chunk &, const ChunkNeighbours &,
+                  const glm::vec3 &origin, unsigned level);
+
+    std::size_t getLayerCount() const;
+    const Layer &getLayer(std::size_t index) const;
+    std::size_t getQuadCount() const;
+};
+
+} // namespace progressia::main
@@ -0,0 +1,84 @@
+#include "chunk_occupancy.h"
+
+namespace progressia::main {
+
+void ChunkOccupancy::assignBit(std::size_t bit, bool value) {
+    Word mask = Word(1) << (bit % WORD_BITS);
+    Word &word = words[bit / WORD_BITS];
+    word = value ? word | mask : word & ~mask;
+}
+
+void ChunkOccupancy::buildLevels() {
+    for (unsigned level = 1; level < LEVEL_COUNT; level++) {
+        int size = Chunk::SIZE >> level;
+        for (int z = 0; z < size; z++) {
+            for (int y = 0; y < size; y++) {
+                for (int x = 0; x < size; x++) {
+                    bool any = false;
+                    for (int child = 0; child < 8 && !any; child++) {
+                        any = test(level - 1, x * 2 + (child & 1),
+                                   y * 2 + (child >> 1 & 1),
+                                   z * 2 + (child >> 2));
+                    }
+                    assignBit(getBit(level, x, y, z), any);
+                }
+            }
+        }
+    }
+}
+
+void ChunkOccupancy::assign(const Chunk &chunk,
+                            const std::vector<uint8_t> &occupied) {
+    words.fill(0);
+
+    if (chunk.isUniform()) {
+        if (occupied[chunk.get(0)] != 0) {
+            words.fill(~Word(0));
+        }
+        return;
+    }
+
+    // Level 0 is indexed like Chunk, so bits follow forEach() order
+    std::size_t bit = 0;
+    chunk.forEach([&](int, int, int, BlockId block) {
+        if (occupied[block] != 0) {
+            words[bit / WORD_BITS] |= Word(1) << (bit % WORD_BITS);
+        }
+        bit++;
+    });
+
+    buildLevels();
+}
+
+void ChunkOccupancy::set(int x, int y, int z, bool occupied) {
+    assignBit(getBit(0, x, y, z), occupied);
+
+    // A cell stays occupied while any of its children is
+    for (unsigned level = 1; level < LEVEL_COUNT; level++) {
+        x >>= 1;
+        y >>= 1;
+        z >>= 1;
+
+        bool any = occupied;
+        for (int child = 0; child < 8 && !any; child++) {
+            any = test(level - 1, x * 2 + (child & 1), y * 2 + (child >> 1 & 1),
+                       z * 2 + (child >> 2));
+        }
+
+        if (test(level, x, y, z) == any) {
+            return;
+        }
+        assignBit(getBit(level, x, y, z), any);
+    }
+}
+
+unsigned ChunkOccupancy::getEmptyLevel(int x, int y, int z) const {
+    for (unsigned level = LEVEL_COUNT; level-- > 0;) {
+        if (!test(level, x >> level, y >> level, z >> level)) {
+            return level;
+        }
+    }
+    return OCCUPIED;
+}
+
+} // namespace progressia::main
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "chunk.h"
+
+namespace progressia::main {
+
+/*
+ * Returns the index of the first bit of each level of ChunkOccupancy, and
+ * the total number of bits last.
+ */
+constexpr std::array<std::size_t, Chunk::SIZE_BITS + 2> getOccupancyOffsets() {
+    std::array<std::size_t, Chunk::SIZE_BITS + 2> result{};
+    for (std::size_t level = 1; level < result.size(); level++) {
+        auto size = std::size_t(Chunk::SIZE >> (level - 1));
+        result[level] = result[level - 1] + size * size * size;
+    }
+    return result;
+}
+
+/*
+ * Occupancy of the blocks of a chunk as a bitmask with coarser mip levels.
+ *
+ * Level 0 has one bit per block, indexed like Chunk. Each level above has
+ * one bit per cube of 2^level blocks along each axis, set if any block in it
+ * is occupied, up to level SIZE_BITS with one bit for the whole chunk. All
+ * levels are packed into one array of words.
+ *
+ * Not thread-safe.
+ */
+class ChunkOccupancy {
+  public:
+    constexpr static unsigned LEVEL_COUNT = Chunk::SIZE_BITS + 1;
+
+    // Returned by getEmptyLevel() for occupied blocks
+    constexpr static unsigned OCCUPIED = LEVEL_COUNT;
+
+  private:
+    using Word = uint64_t;
+
+    constexpr static unsigned WORD_BITS = 64;
+
+    constexpr static auto OFFSETS = getOccupancyOffsets();
+
+    constexpr static std::size_t WORD_COUNT =
+        (OFFSETS[LEVEL_COUNT] + WORD_BITS - 1) / WORD_BITS;
+
+    std::array<Word, WORD_COUNT> words{};
+
+    static std::size_t getBit(unsigned level, int x, int y, int z) {
+        auto size = std::size_t(Chunk::SIZE >> level);
+        return OFFSETS[level] + (std::size_t(z) * size + y) * size + x;
+    }
+
+    void assignBit(std::size_t bit, bool value);
+    void buildLevels();
+
+  public:
+    /*
+     * Sets the occupancy of every block of chunk. occupied is indexed by
+     * BlockId and nonzero for occupied types.
+     */
+    void assign(const Chunk &, const std::vector<uint8_t> &occupied);
+
+    /*
+     * Sets the occupancy of block (x, y, z) and updates the levels above.
+     */
+    void set(int x, int y, int z, bool occupied);
+
+    /*
+     * Returns true if any block in cell (x, y, z) of level is occupied.
+     */
+    bool test(unsigned level, int x, int y, int z) const {
+        std::size_t bit = getBit(level, x, y, z);
+        return (words[bit / WORD_BITS] >> (bit % WORD_BITS) & 1) != 0;
+    }
+
+    /*
+     * Returns the largest level at which the cell containing block
+     * (x, y, z) is empty, or OCCUPIED.
+     */
+    unsigned getEmptyLevel(int x, int y, int z) const;
+
+    bool isEmpty() const { return !test(Chunk::SIZE_BITS, 0, 0, 0); }
+};
+
+} // namespace progressia::main
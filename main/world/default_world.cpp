@@ -0,0 +1,21 @@
+#include "default_world.h"
+
+#include <glm/vec4.hpp>
+
+namespace progressia::main {
+
+TerrainSettings makeDefaultWorld(BlockTypes &types) {
+    auto white = glm::vec4(1, 1, 1, 1);
+    auto brown = glm::vec4(0.6F, 0.45F, 0.3F, 1);
+
+    TerrainSettings terrain;
+    terrain.stone = types.add({"stone", true, true, 0, white});
+    terrain.dirt = types.add({"dirt", true, true, 0, brown});
+    terrain.grass = types.add({"grass", true, true, 1, white});
+    terrain.baseHeight = 6;
+    terrain.amplitude = 4;
+    terrain.hillSize = 32;
+    return terrain;
+}
+
+} // namespace progressia::main
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "block_types.h"
+#include "terrain_generator.h"
+
+namespace progressia::main {
+
+/*
+ * Registers the block types of the default world in types and returns
+ * terrain settings that use them. Client and server both call this on
+ * empty BlockTypes, so block IDs in saved chunks mean the same to both.
+ */
+TerrainSettings makeDefaultWorld(BlockTypes &types);
+
+} // namespace progressia::main
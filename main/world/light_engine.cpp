@@ -0,0 +1,444 @@
+#include "light_engine.h"
+
+#include <algorithm>
+
+#include "../profiler.h"
+
+namespace progressia::main {
+
+namespace {
+
+constexpr std::size_t LAST = Chunk::SIZE - 1;
+
+constexpr auto NEG_Z = static_cast<std::size_t>(BlockFace::NEG_Z);
+constexpr auto POS_Z = static_cast<std::size_t>(BlockFace::POS_Z);
+
+std::size_t getOpposite(std::size_t face) { return face ^ 1U; }
+
+/*
+ * Returns the index of block (a, b) of the layer of a chunk that touches
+ * its side face.
+ */
+std::size_t getBorderIndex(std::size_t face, std::size_t a, std::size_t b) {
+    std::size_t depth = face % 2 == 0 ? 0 : LAST;
+    switch (face / 2) {
+    case 0:
+        return Chunk::getIndex(int(depth), int(a), int(b));
+    case 1:
+        return Chunk::getIndex(int(a), int(depth), int(b));
+    default:
+        return Chunk::getIndex(int(a), int(b), int(depth));
+    }
+}
+
+/*
+ * Moves to the next block towards face, which may be in a neighbouring
+ * slot. Returns false if that slot is not registered.
+ */
+template <typename Slot>
+bool step(Slot *&slot, std::size_t &index, std::size_t face) {
+    std::size_t shift = face / 2 * Chunk::SIZE_BITS;
+    std::size_t stride = std::size_t(1) << shift;
+    std::size_t coordinate = (index >> shift) & LAST;
+
+    if (face % 2 == 1) {
+        if (coordinate != LAST) {
+            index += stride;
+            return true;
+        }
+        index -= LAST * stride;
+    } else {
+        if (coordinate != 0) {
+            index -= stride;
+            return true;
+        }
+        index += LAST * stride;
+    }
+
+    slot = slot->neighbours[face];
+    return slot != nullptr;
+}
+
+} // namespace
+
+LightEngine::LightEngine(const BlockTypes &types) : types(types) {}
+
+void LightEngine::updateTypes() {
+    if (opaque.size() == types.getCount()) {
+        return;
+    }
+
+    opaque.resize(types.getCount());
+    emission.resize(types.getCount());
+    for (std::size_t id = 0; id < types.getCount(); id++) {
+        const auto &type = types.get(static_cast<BlockId>(id));
+        opaque[id] = type.opaque ? 1 : 0;
+        emission[id] = std::min(type.emission, ChunkLight::MAX_LIGHT);
+    }
+}
+
+uint8_t LightEngine::getLevel(const Slot &slot, std::size_t index,
+                              Channel channel) {
+    return channel == SKYLIGHT ? slot.light.getSky(index)
+                               : slot.light.getBlock(index);
+}
+
+void LightEngine::setLevel(Slot &slot, std::size_t index, Channel channel,
+                           uint8_t level) {
+    if (channel == SKYLIGHT) {
+        slot.light.setSky(index, level);
+    } else {
+        slot.light.setBlock(index, level);
+    }
+
+    if (!slot.changed) {
+        slot.changed = true;
+        changed.push_back(&slot);
+    }
+}
+
+void LightEngine::addSource(Slot &slot, std::size_t index, Channel channel,
+                            uint8_t level) {
+    if (getLevel(slot, index, channel) < level) {
+        setLevel(slot, index, channel, level);
+        additions[channel].push_back(
+            {&slot, static_cast<uint16_t>(index), 0});
+    }
+}
+
+void LightEngine::removeLight(Slot &slot, std::size_t index,
+                              Channel channel) {
+    uint8_t level = getLevel(slot, index, channel);
+    if (level != 0) {
+        setLevel(slot, index, channel, 0);
+        removals[channel].push_back(
+            {&slot, static_cast<uint16_t>(index), level});
+    }
+}
+
+void LightEngine::addFromNeighbours(Slot &slot, std::size_t index) {
+    for (std::size_t face = 0; face < BLOCK_FACE_COUNT; face++) {
+        Slot *neighbour = &slot;
+        std::size_t neighbourIndex = index;
+        if (!step(neighbour, neighbourIndex, face)) {
+            continue;
+        }
+
+        for (Channel channel : {BLOCK_LIGHT, SKYLIGHT}) {
+            if (getLevel(*neighbour, neighbourIndex, channel) != 0) {
+                additions[channel].push_back(
+                    {neighbour, static_cast<uint16_t>(neighbourIndex), 0});
+            }
+        }
+    }
+}
+
+void LightEngine::addFromBlock(Slot &slot, std::size_t index) {
+    BlockId block = slot.chunk->get(index);
+    addSource(slot, index, BLOCK_LIGHT, emission[block]);
+
+    bool top = (index >> (2 * Chunk::SIZE_BITS)) == LAST;
+    if (top && opaque[block] == 0 && slot.neighbours[POS_Z] == nullptr) {
+        addSource(slot, index, SKYLIGHT, ChunkLight::MAX_LIGHT);
+    }
+
+    addFromNeighbours(slot, index);
+}
+
+void LightEngine::addFromChunk(Slot &slot) {
+    const Chunk &chunk = *slot.chunk;
+
+    if (slot.neighbours[POS_Z] == nullptr) {
+        for (std::size_t b = 0; b < Chunk::SIZE; b++) {
+            for (std::size_t a = 0; a < Chunk::SIZE; a++) {
+                std::size_t index = getBorderIndex(POS_Z, a, b);
+                if (!isOpaque(slot, index)) {
+                    addSource(slot, index, SKYLIGHT, ChunkLight::MAX_LIGHT);
+                }
+            }
+        }
+    }
+
+    if (chunk.isUniform()) {
+        BlockId block = chunk.get(0);
+        if (emission[block] != 0) {
+            for (std::size_t i = 0; i < Chunk::VOLUME; i++) {
+                addSource(slot, i, BLOCK_LIGHT, emission[block]);
+            }
+        }
+    } else {
+        chunk.forEach([&](int x, int y, int z, BlockId block) {
+            if (emission[block] != 0) {
+                addSource(slot, Chunk::getIndex(x, y, z), BLOCK_LIGHT,
+                          emission[block]);
+            }
+        });
+    }
+
+    // Lit layers of neighbours shine in
+    for (std::size_t face = 0; face < BLOCK_FACE_COUNT; face++) {
+        Slot *neighbour = slot.neighbours[face];
+        if (neighbour == nullptr) {
+            continue;
+        }
+
+        for (std::size_t b = 0; b < Chunk::SIZE; b++) {
+            for (std::size_t a = 0; a < Chunk::SIZE; a++) {
+                std::size_t index = getBorderIndex(getOpposite(face), a, b);
+                for (Channel channel : {BLOCK_LIGHT, SKYLIGHT}) {
+                    if (getLevel(*neighbour, index, channel) != 0) {
+                        additions[channel].push_back(
+                            {neighbour, static_cast<uint16_t>(index), 0});
+                    }
+                }
+            }
+        }
+    }
+}
+
+void LightEngine::darkenCovered(Slot &slot) {
+    Slot *below = slot.neighbours[NEG_Z];
+    if (below == nullptr) {
+        return;
+    }
+
+    // The top layer of below was open to the sky before slot arrived
+    for (std::size_t b = 0; b < Chunk::SIZE; b++) {
+        for (std::size_t a = 0; a < Chunk::SIZE; a++) {
+            std::size_t bottom = getBorderIndex(NEG_Z, a, b);
+            std::size_t top = getBorderIndex(POS_Z, a, b);
+
+            if (below->light.getSky(top) == ChunkLight::MAX_LIGHT &&
+                slot.light.getSky(bottom) != ChunkLight::MAX_LIGHT) {
+                removeLight(*below, top, SKYLIGHT);
+            }
+        }
+    }
+}
+
+void LightEngine::propagate(Channel channel) {
+    auto &queue = additions[channel];
+
+    // The queue grows while it is processed
+    for (std::size_t next = 0; next < queue.size(); next++) {
+        Node node = queue[next];
+        uint8_t level = getLevel(*node.slot, node.index, channel);
+        if (level <= 1) {
+            continue;
+        }
+
+        for (std::size_t face = 0; face < BLOCK_FACE_COUNT; face++) {
+            Slot *slot = node.slot;
+            std::size_t index = node.index;
+            if (!step(slot, index, face) || isOpaque(*slot, index)) {
+                continue;
+            }
+
+            bool straightDown = channel == SKYLIGHT && face == NEG_Z &&
+                                level == ChunkLight::MAX_LIGHT;
+            uint8_t target = straightDown ? level : uint8_t(level - 1);
+
+            if (getLevel(*slot, index, channel) < target) {
+                setLevel(*slot, index, channel, target);
+                queue.push_back({slot, static_cast<uint16_t>(index), 0});
+            }
+        }
+    }
+
+    stats.additions += queue.size();
+    queue.clear();
+}
+
+void LightEngine::unpropagate(Channel channel) {
+    auto &queue = removals[channel];
+
+    for (std::size_t next = 0; next < queue.size(); next++) {
+        Node node = queue[next];
+
+        for (std::size_t face = 0; face < BLOCK_FACE_COUNT; face++) {
+            Slot *slot = node.slot;
+            std::size_t index = node.index;
+            if (!step(slot, index, face)) {
+                continue;
+            }
+
+            uint8_t level = getLevel(*slot, index, channel);
+            if (level == 0) {
+                continue;
+            }
+
+            // Dimmer blocks may have been lit through the removed one;
+            // others are lit independently and refill the cleared area
+            bool straightDown = channel == SKYLIGHT && face == NEG_Z &&
+                                node.level == ChunkLight::MAX_LIGHT &&
+                                level == ChunkLight::MAX_LIGHT;
+
+            if (level < node.level || straightDown) {
+                setLevel(*slot, index, channel, 0);
+                queue.push_back({slot, static_cast<uint16_t>(index), level});
+
+                if (channel == BLOCK_LIGHT) {
+                    addSource(*slot, index, channel,
+                              emission[slot->chunk->get(index)]);
+                }
+            } else {
+                additions[channel].push_back(
+                    {slot, static_cast<uint16_t>(index), 0});
+            }
+        }
+    }
+
+    stats.removals += queue.size();
+    queue.clear();
+}
+
+void LightEngine::addChunk(const glm::ivec3 &position, const Chunk &chunk) {
+    auto &slot = slots[position];
+    if (slot) {
+        slot->chunk = &chunk;
+        chunkChanged(position);
+        return;
+    }
+
+    slot = std::make_unique<Slot>();
+    slot->position = position;
+    slot->chunk = &chunk;
+
+    for (std::size_t face = 0; face < BLOCK_FACE_COUNT; face++) {
+        auto it = slots.find(position + getNeighbourOffset(face));
+        if (it != slots.end()) {
+            slot->neighbours[face] = it->second.get();
+            it->second->neighbours[getOpposite(face)] = slot.get();
+        }
+    }
+
+    added.push_back(slot.get());
+}
+
+void LightEngine::removeChunk(const glm::ivec3 &position) {
+    auto it = slots.find(position);
+    if (it == slots.end()) {
+        return;
+    }
+
+    Slot *slot = it->second.get();
+    for (std::size_t face = 0; face < BLOCK_FACE_COUNT; face++) {
+        if (slot->neighbours[face] != nullptr) {
+            slot->neighbours[face]->neighbours[getOpposite(face)] = nullptr;
+        }
+    }
+
+    added.erase(std::remove(added.begin(), added.end(), slot), added.end());
+    replaced.erase(std::remove(replaced.begin(), replaced.end(), slot),
+                   replaced.end());
+    changedBlocks.erase(
+        std::remove_if(changedBlocks.begin(), changedBlocks.end(),
+                       [=](const auto &block) { return block.first == slot; }),
+        changedBlocks.end());
+    changed.erase(std::remove(changed.begin(), changed.end(), slot),
+                  changed.end());
+
+    slots.erase(it);
+}
+
+void LightEngine::blockChanged(const glm::ivec3 &position,
+                               std::size_t index) {
+    auto it = slots.find(position);
+    if (it != slots.end()) {
+        changedBlocks.emplace_back(it->second.get(),
+                                   static_cast<uint16_t>(index));
+    }
+}
+
+void LightEngine::chunkChanged(const glm::ivec3 &position) {
+    auto it = slots.find(position);
+    if (it == slots.end()) {
+        return;
+    }
+
+    Slot *slot = it->second.get();
+    if (std::find(added.begin(), added.end(), slot) == added.end() &&
+        std::find(replaced.begin(), replaced.end(), slot) == replaced.end()) {
+        replaced.push_back(slot);
+    }
+}
+
+bool LightEngine::hasWork() const {
+    return !added.empty() || !replaced.empty() || !changedBlocks.empty();
+}
+
+void LightEngine::run() {
+    PROFILE_SCOPE("LightEngine::run");
+
+    updateTypes();
+
+    // Changed blocks lose their light along with everything lit through
+    // them
+    for (auto [slot, index] : changedBlocks) {
+        removeLight(*slot, index, BLOCK_LIGHT);
+        removeLight(*slot, index, SKYLIGHT);
+    }
+    for (Slot *slot : replaced) {
+        for (std::size_t i = 0; i < Chunk::VOLUME; i++) {
+            removeLight(*slot, i, BLOCK_LIGHT);
+            removeLight(*slot, i, SKYLIGHT);
+        }
+    }
+    unpropagate(BLOCK_LIGHT);
+    unpropagate(SKYLIGHT);
+
+    for (auto [slot, index] : changedBlocks) {
+        addFromBlock(*slot, index);
+    }
+    for (Slot *slot : replaced) {
+        addFromChunk(*slot);
+    }
+    for (Slot *slot : added) {
+        addFromChunk(*slot);
+    }
+    propagate(BLOCK_LIGHT);
+    propagate(SKYLIGHT);
+
+    // Columns below new chunks are no longer open to the sky, which is
+    // only known once the new chunks are lit
+    for (Slot *slot : added) {
+        darkenCovered(*slot);
+    }
+    unpropagate(SKYLIGHT);
+    propagate(SKYLIGHT);
+
+    for (Slot *slot : added) {
+        if (!slot->changed) {
+            slot->changed = true;
+            changed.push_back(slot);
+        }
+    }
+
+    for (Slot *slot : changed) {
+        slot->light.compact();
+    }
+
+    added.clear();
+    replaced.clear();
+    changedBlocks.clear();
+}
+
+std::vector<glm::ivec3> LightEngine::takeChanged() {
+    std::vector<glm::ivec3> result;
+    result.reserve(changed.size());
+
+    for (Slot *slot : changed) {
+        slot->changed = false;
+        result.push_back(slot->position);
+    }
+
+    changed.clear();
+    return result;
+}
+
+const ChunkLight *LightEngine::getLight(const glm::ivec3 &position) const {
+    auto it = slots.find(position);
+    return it == slots.end() ? nullptr : &it->second->light;
+}
+
+} // namespace progressia::main
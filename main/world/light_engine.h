@@ -0,0 +1,164 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "../util.h"
+#include "block_types.h"
+#include "chunk.h"
+#include "chunk_light.h"
+
+namespace progressia::main {
+
+/*
+ * Computes block light and skylight of a set of chunks.
+ *
+ * Light spreads by flood fill. A transparent block has the level of its
+ * brightest neighbour minus one, and block light at least the emission of
+ * its own type. Skylight of MAX_LIGHT also passes straight down without
+ * loss, so open columns are fully lit. Opaque blocks have no light of their
+ * own and stop it.
+ *
+ * The top of a chunk without a registered chunk above is open to the sky;
+ * other missing neighbours are dark. Registered chunks are lit from their
+ * neighbours and spread light into them, and columns that a new chunk
+ * covers from above are darkened. Chunks that are unregistered keep the
+ * light they have given to their neighbours.
+ *
+ * Changes are processed with breadth-first queues. Additions raise levels
+ * outwards from sources. Removals clear every level that may have depended
+ * on a darkened block and queue the lit blocks at the border of the cleared
+ * area as sources of additions, which then fill it back in.
+ *
+ * Chunks are registered and changes reported between calls to run(), which
+ * does the work and may be called on any thread. No other method may be
+ * called while run() is in progress, and registered chunks must not be
+ * modified then.
+ */
+class LightEngine : private NonCopyable {
+  public:
+    struct Stats {
+        // Queue entries processed by additions and by removals
+        uint64_t additions = 0;
+        uint64_t removals = 0;
+    };
+
+  private:
+    struct Slot {
+        glm::ivec3 position;
+        const Chunk *chunk;
+        ChunkLight light;
+
+        // Indexed by BlockFace; nullptr if not registered
+        std::array<Slot *, BLOCK_FACE_COUNT> neighbours{};
+
+        bool changed = false;
+    };
+
+    enum Channel : std::size_t { BLOCK_LIGHT, SKYLIGHT, CHANNEL_COUNT };
+
+    struct Node {
+        Slot *slot;
+        uint16_t index;
+
+        // Level before removal; unused by additions
+        uint8_t level;
+    };
+
+    const BlockTypes &types;
+
+    // Cached from types, indexed by BlockId
+    std::vector<uint8_t> opaque;
+    std::vector<uint8_t> emission;
+
+    std::unordered_map<glm::ivec3, std::unique_ptr<Slot>, ChunkPositionHash>
+        slots;
+
+    // Reported since the last run()
+    std::vector<Slot *> added;
+    std::vector<Slot *> replaced;
+    std::vector<std::pair<Slot *, uint16_t>> changedBlocks;
+
+    // Slots with changed levels since the last takeChanged()
+    std::vector<Slot *> changed;
+
+    // Indexed by Channel; storage is reused between runs
+    std::array<std::vector<Node>, CHANNEL_COUNT> additions;
+    std::array<std::vector<Node>, CHANNEL_COUNT> removals;
+
+    Stats stats;
+
+    void updateTypes();
+
+    bool isOpaque(const Slot &slot, std::size_t index) const {
+        return opaque[slot.chunk->get(index)] != 0;
+    }
+
+    static uint8_t getLevel(const Slot &, std::size_t index, Channel);
+    void setLevel(Slot &, std::size_t index, Channel, uint8_t level);
+
+    void addSource(Slot &, std::size_t index, Channel, uint8_t level);
+    void removeLight(Slot &, std::size_t index, Channel);
+    void addFromNeighbours(Slot &, std::size_t index);
+    void addFromBlock(Slot &, std::size_t index);
+    void addFromChunk(Slot &);
+    void darkenCovered(Slot &);
+
+    void propagate(Channel);
+    void unpropagate(Channel);
+
+  public:
+    explicit LightEngine(const BlockTypes &);
+
+    /*
+     * Registers chunk at position. chunk must stay valid until it is
+     * unregistered, and changes to it must be reported.
+     */
+    void addChunk(const glm::ivec3 &position, const Chunk &chunk);
+
+    void removeChunk(const glm::ivec3 &position);
+
+    /*
+     * Reports that block index of the chunk at position has been set.
+     */
+    void blockChanged(const glm::ivec3 &position, std::size_t index);
+
+    /*
+     * Reports that any blocks of the chunk at position may have changed.
+     */
+    void chunkChanged(const glm::ivec3 &position);
+
+    /*
+     * Returns true if there are changes for run() to process.
+     */
+    bool hasWork() const;
+
+    /*
+     * Updates light after the changes reported since the last call.
+     */
+    void run();
+
+    /*
+     * Returns positions of chunks whose levels have changed since the last
+     * call. Registered chunks are always included after their first run().
+     */
+    std::vector<glm::ivec3> takeChanged();
+
+    /*
+     * Returns light of the chunk at position, or nullptr if it is not
+     * registered.
+     */
+    const ChunkLight *getLight(const glm::ivec3 &position) const;
+
+    std::size_t getChunkCount() const { return slots.size(); }
+
+    const Stats &getStats() const { return stats; }
+};
+
+} // namespace progressia::main
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <cstdint>
+
+#include "../simd.h"
+
+/*
+ * Simplex noise written against the simd backends, so that one call
+ * evaluates B::WIDTH points. B is a backend descriptor such as simd::Native.
+ *
+ * Lattice gradients are picked by hashing integer coordinates with the seed
+ * instead of looking up a permutation table, which would need a gather per
+ * corner. Results are deterministic for a given seed and differ between
+ * backends only by floating point rounding.
+ */
+namespace progressia::main::noise {
+
+namespace detail {
+
+template <typename Int> Int hash(Int x, Int y, Int z, Int seed) {
+    Int h = seed ^ (x * Int::splat(0x8DA6B343U)) ^
+            (y * Int::splat(0xD8163841U)) ^ (z * Int::splat(0xCB1AB31FU));
+    h = h * Int::splat(0x9E3779B1U);
+    h = h ^ (h >> 15);
+    return h * Int::splat(0x85EBCA77U);
+}
+
+// Low bits of a product are poor, so gradients use the top bits of hashes
+template <typename B>
+typename B::Float gradient2(typename B::Int hash, typename B::Float x,
+                            typename B::Float y) {
+    using Float = typename B::Float;
+    using Int = typename B::Int;
+
+    Int h = hash >> 29;
+    Int zero = Int::splat(0);
+    auto swap = ~(h < Int::splat(4));
+    Float u = select(swap, y, x);
+    Float v = select(swap, x, y);
+    v = v + v;
+
+    Float negU = Float::splat(0) - u;
+    Float negV = Float::splat(0) - v;
+    return select(~((h & Int::splat(1)) == zero), negU, u) +
+           select(~((h & Int::splat(2)) == zero), negV, v);
+}
+
+// The twelve cube edge directions, four of them twice
+template <typename B>
+typename B::Float gradient3(typename B::Int hash, typename B::Float x,
+                            typename B::Float y, typename B::Float z) {
+    using Float = typename B::Float;
+    using Int = typename B::Int;
+
+    Int h = hash >> 28;
+    Int zero = Int::splat(0);
+    Float u = select(h < Int::splat(8), x, y);
+    auto useX = (h == Int::splat(12)) | (h == Int::splat(14));
+    Float v = select(h < Int::splat(4), y, select(useX, x, z));
+
+    Float negU = Float::splat(0) - u;
+    Float negV = Float::splat(0) - v;
+    return select(~((h & Int::splat(1)) == zero), negU, u) +
+           select(~((h & Int::splat(2)) == zero), negV, v);
+}
+
+template <typename Float> Float falloff(Float t) {
+    t = max(t, Float::splat(0));
+    t = t * t;
+    return t * t;
+}
+
+} // namespace detail
+
+/*
+ * 2D simplex noise in about [-1; 1] with features about one unit apart.
+ */
+template <typename B>
+typename B::Float simplex2(typename B::Float x, typename B::Float y,
+                           uint32_t seed) {
+    using Float = typename B::Float;
+    using Int = typename B::Int;
+
+    const Float F2 = Float::splat(0.36602540F); // (sqrt(3) - 1) / 2
+    const Float G2 = Float::splat(0.21132487F); // (3 - sqrt(3)) / 6
+    const Float ZERO = Float::splat(0);
+    const Float ONE = Float::splat(1);
+    const Float R2 = Float::splat(0.5F);
+
+    // Skew to find the cell, then unskew to get the first corner
+    Float s = (x + y) * F2;
+    Float fi = floor(x + s);
+    Float fj = floor(y + s);
+    Float t = (fi + fj) * G2;
+    Float x0 = x - (fi - t);
+    Float y0 = y - (fj - t);
+
+    // The second corner is along the larger coordinate
+    auto xFirst = x0 > y0;
+    Float i1 = select(xFirst, ONE, ZERO);
+    Float j1 = ONE - i1;
+
+    Float x1 = x0 - i1 + G2;
+    Float y1 = y0 - j1 + G2;
+    Float x2 = x0 - ONE + G2 + G2;
+    Float y2 = y0 - ONE + G2 + G2;
+
+    Int i = toInt(fi);
+    Int j = toInt(fj);
+    Int iOne = Int::splat(1);
+    Int zero = Int::splat(0);
+    Int salt = Int::splat(seed);
+    Int h0 = detail::hash(i, j, zero, salt);
+    Int h1 = detail::hash(i + toInt(i1), j + toInt(j1), zero, salt);
+    Int h2 = detail::hash(i + iOne, j + iOne, zero, salt);
+
+    Float n0 = detail::falloff(R2 - x0 * x0 - y0 * y0) *
+               detail::gradient2<B>(h0, x0, y0);
+    Float n1 = detail::falloff(R2 - x1 * x1 - y1 * y1) *
+               detail::gradient2<B>(h1, x1, y1);
+    Float n2 = detail::falloff(R2 - x2 * x2 - y2 * y2) *
+               detail::gradient2<B>(h2, x2, y2);
+
+    return (n0 + n1 + n2) * Float::splat(40.0F);
+}
+
+/*
+ * 3D simplex noise in about [-1; 1] with features about one unit apart.
+ */
+template <typename B>
+typename B::Float simplex3(typename B::Float x, typename B::Float y,
+                           typename B::Float z, uint32_t seed) {
+    using Float = typename B::Float;
+    using Int = typename B::Int;
+
+    const Float F3 = Float::splat(1.0F / 3);
+    const Float G3 = Float::splat(1.0F / 6);
+    const Float ZERO = Float::splat(0);
+    const Float ONE = Float::splat(1);
+    const Float R2 = Float::splat(0.6F);
+
+    Float s = (x + y + z) * F3;
+    Float fi = floor(x + s);
+    Float fj = floor(y + s);
+    Float fk = floor(z + s);
+    Float t = (fi + fj + fk) * G3;
+    Float x0 = x - (fi - t);
+    Float y0 = y - (fj - t);
+    Float z0 = z - (fk - t);
+
+    // Rank the coordinates: the second corner steps along the largest one,
+    // the third along the two largest ones
+    auto xy = x0 >= y0;
+    auto yz = y0 >= z0;
+    auto xz = x0 >= z0;
+    Float i1 = select(xy & xz, ONE, ZERO);
+    Float j1 = select(~xy & yz, ONE, ZERO);
+    Float k1 = select(~xz & ~yz, ONE, ZERO);
+    Float i2 = select(xy | xz, ONE, ZERO);
+    Float j2 = select(~xy | yz, ONE, ZERO);
+    Float k2 = select(~xz | ~yz, ONE, ZERO);
+
+    Float x1 = x0 - i1 + G3;
+    Float y1 = y0 - j1 + G3;
+    Float z1 = z0 - k1 + G3;
+    Float x2 = x0 - i2 + G3 + G3;
+    Float y2 = y0 - j2 + G3 + G3;
+    Float z2 = z0 - k2 + G3 + G3;
+    Float x3 = x0 - ONE + G3 + G3 + G3;
+    Float y3 = y0 - ONE + G3 + G3 + G3;
+    Float z3 = z0 - ONE + G3 + G3 + G3;
+
+    Int i = toInt(fi);
+    Int j = toInt(fj);
+    Int k = toInt(fk);
+    Int iOne = Int::splat(1);
+    Int salt = Int::splat(seed);
+    Int h0 = detail::hash(i, j, k, salt);
+    Int h1 = detail::hash(i + toInt(i1), j + toInt(j1), k + toInt(k1), salt);
+    Int h2 = detail::hash(i + toInt(i2), j + toInt(j2), k + toInt(k2), salt);
+    Int h3 = detail::hash(i + iOne, j + iOne, k + iOne, salt);
+
+    Float n0 = detail::falloff(R2 - x0 * x0 - y0 * y0 - z0 * z0) *
+               detail::gradient3<B>(h0, x0, y0, z0);
+    Float n1 = detail::falloff(R2 - x1 * x1 - y1 * y1 - z1 * z1) *
+               detail::gradient3<B>(h1, x1, y1, z1);
+    Float n2 = detail::falloff(R2 - x2 * x2 - y2 * y2 - z2 * z2) *
+               detail::gradient3<B>(h2, x2, y2, z2);
+    Float n3 = detail::falloff(R2 - x3 * x3 - y3 * y3 - z3 * z3) *
+               detail::gradient3<B>(h3, x3, y3, z3);
+
+    return (n0 + n1 + n2 + n3) * Float::splat(32.0F);
+}
+
+/*
+ * Sum of octaves of simplex2(), each at twice the frequency and half the
+ * amplitude of the previous one, scaled back into about [-1; 1].
+ */
+template <typename B>
+typename B::Float fractal2(typename B::Float x, typename B::Float y,
+                           uint32_t seed, int octaves) {
+    using Float = typename B::Float;
+
+    Float sum = Float::splat(0);
+    float amplitude = 1;
+    float total = 0;
+    for (int octave = 0; octave < octaves; octave++) {
+        sum = sum + simplex2<B>(x, y, seed + octave) * Float::splat(amplitude);
+        total += amplitude;
+        amplitude /= 2;
+        x = x + x;
+        y = y + y;
+    }
+    return sum * Float::splat(1 / total);
+}
+
+} // namespace progressia::main::noise
@@ -0,0 +1,179 @@
+#include "occupancy_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <glm/geometric.hpp>
+
+namespace progressia::main {
+
+namespace {
+
+glm::ivec3 getChunkPosition(const glm::ivec3 &block) {
+    // Arithmetic shifts round towards negative infinity
+    return {block.x >> Chunk::SIZE_BITS, block.y >> Chunk::SIZE_BITS,
+            block.z >> Chunk::SIZE_BITS};
+}
+
+} // namespace
+
+OccupancyIndex::OccupancyIndex(const BlockTypes &types) : types(types) {}
+
+void OccupancyIndex::updateTypes() {
+    if (occupied.size() == types.getCount()) {
+        return;
+    }
+
+    occupied.resize(types.getCount());
+    for (std::size_t id = 0; id < types.getCount(); id++) {
+        occupied[id] = types.get(static_cast<BlockId>(id)).visible ? 1 : 0;
+    }
+}
+
+const ChunkOccupancy *
+OccupancyIndex::find(const glm::ivec3 &position) const {
+    auto it = chunks.find(position);
+    return it == chunks.end() ? nullptr : it->second.get();
+}
+
+void OccupancyIndex::addChunk(const glm::ivec3 &position,
+                              const Chunk &chunk) {
+    updateTypes();
+
+    auto occupancy = std::make_unique<ChunkOccupancy>();
+    occupancy->assign(chunk, occupied);
+    if (occupancy->isEmpty()) {
+        occupancy.reset();
+    }
+    chunks[position] = std::move(occupancy);
+}
+
+void OccupancyIndex::removeChunk(const glm::ivec3 &position) {
+    chunks.erase(position);
+}
+
+void OccupancyIndex::blockChanged(const glm::ivec3 &block, BlockId id) {
+    updateTypes();
+
+    glm::ivec3 position = getChunkPosition(block);
+    auto it = chunks.find(position);
+    if (it == chunks.end()) {
+        return;
+    }
+
+    auto &occupancy = it->second;
+    bool value = occupied[id] != 0;
+    if (!occupancy) {
+        if (!value) {
+            return;
+        }
+        occupancy = std::make_unique<ChunkOccupancy>();
+    }
+
+    glm::ivec3 local = block - position * Chunk::SIZE;
+    occupancy->set(local.x, local.y, local.z, value);
+    if (occupancy->isEmpty()) {
+        occupancy.reset();
+    }
+}
+
+bool OccupancyIndex::isOccupied(const glm::ivec3 &block) const {
+    glm::ivec3 position = getChunkPosition(block);
+    const ChunkOccupancy *occupancy = find(position);
+    if (occupancy == nullptr) {
+        return false;
+    }
+
+    glm::ivec3 local = block - position * Chunk::SIZE;
+    return occupancy->test(0, local.x, local.y, local.z);
+}
+
+bool OccupancyIndex::raycast(const glm::vec3 &origin,
+                             const glm::vec3 &direction, float maxDistance,
+                             RayHit &hit) const {
+    float length = glm::length(direction);
+    if (length == 0) {
+        return false;
+    }
+
+    glm::vec3 step = direction / length;
+    glm::vec3 inverse;
+    for (int axis = 0; axis < 3; axis++) {
+        inverse[axis] = step[axis] == 0 ? 0 : 1 / step[axis];
+    }
+
+    glm::ivec3 block(glm::floor(origin));
+    glm::ivec3 normal(0, 0, 0);
+    float distance = 0;
+
+    // Rays take several steps in each chunk, so the lookup is kept
+    glm::ivec3 position = getChunkPosition(block);
+    const ChunkOccupancy *occupancy = find(position);
+
+    while (distance <= maxDistance) {
+        glm::ivec3 current = getChunkPosition(block);
+        if (current != position) {
+            position = current;
+            occupancy = find(position);
+        }
+
+        unsigned level = Chunk::SIZE_BITS;
+        if (occupancy != nullptr) {
+            glm::ivec3 local = block - position * Chunk::SIZE;
+            level = occupancy->getEmptyLevel(local.x, local.y, local.z);
+            if (level == ChunkOccupancy::OCCUPIED) {
+                hit = {block, normal, distance};
+                return true;
+            }
+        }
+
+        // Leave the empty cube around block through its nearest side
+        int size = 1 << level;
+        glm::ivec3 low(block.x & -size, block.y & -size, block.z & -size);
+        glm::ivec3 high = low + size;
+
+        float exit = std::numeric_limits<float>::infinity();
+        int exitAxis = 0;
+        for (int axis = 0; axis < 3; axis++) {
+            if (step[axis] == 0) {
+                continue;
+            }
+
+            int side = step[axis] > 0 ? high[axis] : low[axis];
+            float along = (static_cast<float>(side) - origin[axis]) *
+                          inverse[axis];
+            if (along < exit) {
+                exit = along;
+                exitAxis = axis;
+            }
+        }
+
+        // Rounding must not move the ray backwards or out of the cube
+        // sideways
+        distance = std::max(distance, exit);
+        glm::vec3 point = origin + step * distance;
+        for (int axis = 0; axis < 3; axis++) {
+            if (axis == exitAxis) {
+                block[axis] = step[axis] > 0 ? high[axis] : low[axis] - 1;
+            } else {
+                block[axis] =
+                    std::clamp(static_cast<int>(std::floor(point[axis])),
+                               low[axis], high[axis] - 1);
+            }
+        }
+
+        normal = glm::ivec3(0, 0, 0);
+        normal[exitAxis] = step[exitAxis] > 0 ? -1 : 1;
+    }
+
+    return false;
+}
+
+std::size_t
+OccupancyIndex::getMemoryUsage(const glm::ivec3 &position) const {
+    const ChunkOccupancy *occupancy = find(position);
+    return occupancy == nullptr ? 0 : sizeof(ChunkOccupancy);
+}
+
+} // namespace progressia::main
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "../util.h"
+#include "block_types.h"
+#include "chunk.h"
+#include "chunk_occupancy.h"
+
+namespace progressia::main {
+
+/*
+ * Occupancy of a set of chunks for ray queries such as block picking and
+ * line of sight.
+ *
+ * Blocks of visible types are occupied. Each registered chunk keeps a
+ * ChunkOccupancy, except chunks without occupied blocks, which keep nothing
+ * and are crossed like unregistered chunks.
+ *
+ * Rays are traced with a DDA over cells of varying size: each step crosses
+ * the largest empty cube of the mip levels around the current block, up to
+ * a whole chunk, so rays through air take few steps.
+ *
+ * Const methods may be called from several threads at once, but not while
+ * the index is modified.
+ */
+class OccupancyIndex : private NonCopyable {
+  public:
+    struct RayHit {
+        glm::ivec3 block;
+
+        // Normal of the face through which the ray entered block; zero if
+        // the ray starts inside it
+        glm::ivec3 normal;
+
+        // Along the ray, in blocks
+        float distance;
+    };
+
+  private:
+    const BlockTypes &types;
+
+    // Cached from types, indexed by BlockId
+    std::vector<uint8_t> occupied;
+
+    // nullptr for registered chunks without occupied blocks
+    std::unordered_map<glm::ivec3, std::unique_ptr<ChunkOccupancy>,
+                       ChunkPositionHash>
+        chunks;
+
+    void updateTypes();
+    const ChunkOccupancy *find(const glm::ivec3 &position) const;
+
+  public:
+    explicit OccupancyIndex(const BlockTypes &);
+
+    /*
+     * Registers chunk at position, or rebuilds the occupancy of a registered
+     * one after arbitrary changes. chunk is not referenced afterwards.
+     */
+    void addChunk(const glm::ivec3 &position, const Chunk &chunk);
+
+    void removeChunk(const glm::ivec3 &position);
+
+    /*
+     * Updates the occupancy of block, in world coordinates, after it has
+     * been set to id. Blocks of unregistered chunks are ignored.
+     */
+    void blockChanged(const glm::ivec3 &block, BlockId id);
+
+    bool isOccupied(const glm::ivec3 &block) const;
+
+    /*
+     * Finds the first occupied block along the ray from origin in
+     * direction, which need not be normalized, no farther than maxDistance.
+     * Returns false if there is none.
+     */
+    bool raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+                 float maxDistance, RayHit &) const;
+
+    std::size_t getChunkCount() const { return chunks.size(); }
+
+    /*
+     * Returns an estimate of heap bytes used by the occupancy of the chunk
+     * at position.
+     */
+    std::size_t getMemoryUsage(const glm::ivec3 &position) const;
+};
+
+} // namespace progressia::main
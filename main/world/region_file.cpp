@@ -0,0 +1,528 @@
+#include "region_file.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../logging.h"
+#include "../profiler.h"
+
+namespace progressia::main {
+
+namespace {
+
+constexpr std::array<uint8_t, 4> MAGIC = {'P', 'R', 'G', 'R'};
+constexpr uint32_t VERSION = 1;
+
+// Magic, version and reserved bytes precede the table
+constexpr std::size_t TABLE_OFFSET = 16;
+constexpr std::size_t HEADER_SIZE =
+    TABLE_OFFSET + RegionFile::CHUNK_COUNT * sizeof(uint32_t);
+constexpr std::size_t HEADER_SECTORS =
+    (HEADER_SIZE + RegionFile::SECTOR_SIZE - 1) / RegionFile::SECTOR_SIZE;
+
+constexpr std::size_t MAX_FIRST_SECTOR = std::size_t(1) << 24;
+
+void writeUint32(uint8_t *out, uint32_t v) {
+    for (std::size_t i = 0; i < sizeof(v); i++) {
+        out[i] = static_cast<uint8_t>(v >> (i * 8));
+    }
+}
+
+uint32_t readUint32(const uint8_t *in) {
+    uint32_t v = 0;
+    for (std::size_t i = 0; i < sizeof(v); i++) {
+        v |= uint32_t(in[i]) << (i * 8);
+    }
+    return v;
+}
+
+int floorDiv(int value, int divisor) {
+    return value >= 0 ? value / divisor : -((-value - 1) / divisor) - 1;
+}
+
+} // namespace
+
+/*
+ * File handles and the read-only mapping.
+ */
+struct RegionFile::Platform {
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int file = -1;
+#endif
+
+    const uint8_t *view = nullptr;
+    std::size_t viewSize = 0;
+    std::size_t fileSize = 0;
+
+    Platform() = default;
+    Platform(const Platform &) = delete;
+    Platform &operator=(const Platform &) = delete;
+
+    ~Platform() {
+        unmap();
+#ifdef _WIN32
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+        }
+#else
+        if (file >= 0) {
+            ::close(file);
+        }
+#endif
+    }
+
+    bool open(const std::filesystem::path &path) {
+#ifdef _WIN32
+        file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                           FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        LARGE_INTEGER size;
+        if (GetFileSizeEx(file, &size) == 0) {
+            return false;
+        }
+        fileSize = static_cast<std::size_t>(size.QuadPart);
+#else
+        file = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (file < 0) {
+            return false;
+        }
+
+        struct stat status {};
+        if (::fstat(file, &status) != 0) {
+            return false;
+        }
+        fileSize = static_cast<std::size_t>(status.st_size);
+#endif
+        return true;
+    }
+
+    bool write(std::size_t offset, const uint8_t *data, std::size_t size) {
+        std::size_t end = offset + size;
+
+        while (size > 0) {
+#ifdef _WIN32
+            OVERLAPPED overlapped{};
+            overlapped.Offset = static_cast<DWORD>(offset);
+            overlapped.OffsetHigh = static_cast<DWORD>(uint64_t(offset) >> 32);
+
+            DWORD written = 0;
+            if (WriteFile(file, data, static_cast<DWORD>(size), &written,
+                          &overlapped) == 0) {
+                return false;
+            }
+#else
+            ssize_t written = ::pwrite(file, data, size,
+                                       static_cast<off_t>(offset));
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+#endif
+            data += written;
+            offset += static_cast<std::size_t>(written);
+            size -= static_cast<std::size_t>(written);
+        }
+
+        fileSize = std::max(fileSize, end);
+        return true;
+    }
+
+    /*
+     * Maps the whole file as it is now. Writes made through write() are
+     * visible in the mapping, but the mapping does not grow with the file.
+     */
+    bool map() {
+        unmap();
+
+        if (fileSize == 0) {
+            return true;
+        }
+
+#ifdef _WIN32
+        mapping =
+            CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) {
+            return false;
+        }
+
+        void *address = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (address == nullptr) {
+            CloseHandle(mapping);
+            mapping = nullptr;
+            return false;
+        }
+#else
+        void *address =
+            ::mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, file, 0);
+        if (address == MAP_FAILED) {
+            return false;
+        }
+#endif
+
+        view = static_cast<const uint8_t *>(address);
+        viewSize = fileSize;
+        return true;
+    }
+
+    void unmap() {
+        if (view == nullptr) {
+            return;
+        }
+
+#ifdef _WIN32
+        UnmapViewOfFile(view);
+        CloseHandle(mapping);
+        mapping = nullptr;
+#else
+        ::munmap(const_cast<uint8_t *>(view), viewSize);
+#endif
+
+        view = nullptr;
+        viewSize = 0;
+    }
+
+    bool sync() {
+#ifdef _WIN32
+        return FlushFileBuffers(file) != 0;
+#else
+        return ::fsync(file) == 0;
+#endif
+    }
+};
+
+glm::ivec3 RegionFile::getRegion(const glm::ivec3 &chunk) {
+    return {floorDiv(chunk.x, SIZE), floorDiv(chunk.y, SIZE),
+            floorDiv(chunk.z, SIZE)};
+}
+
+std::size_t RegionFile::getLocalIndex(const glm::ivec3 &chunk) {
+    glm::ivec3 local = chunk - getRegion(chunk) * SIZE;
+    return (std::size_t(local.z) * SIZE + std::size_t(local.y)) * SIZE +
+           std::size_t(local.x);
+}
+
+RegionFile::RegionFile(std::filesystem::path path,
+                       std::unique_ptr<Platform> platform)
+    : platform(std::move(platform)), path(std::move(path)), table{} {}
+
+RegionFile::~RegionFile() = default;
+
+std::unique_ptr<RegionFile>
+RegionFile::open(const std::filesystem::path &path, bool create) {
+    PROFILE_SCOPE("RegionFile::open");
+
+    std::error_code errorCode;
+    if (!create && !std::filesystem::exists(path, errorCode)) {
+        return nullptr;
+    }
+
+    auto platform = std::make_unique<Platform>();
+    if (!platform->open(path)) {
+        logging::error() << "Could not open region file " << path.string();
+        return nullptr;
+    }
+
+    std::unique_ptr<RegionFile> region(
+        new RegionFile(path, std::move(platform)));
+
+    if (!region->initialize()) {
+        return nullptr;
+    }
+
+    return region;
+}
+
+bool RegionFile::initialize() {
+    if (platform->fileSize == 0) {
+        std::vector<uint8_t> header(HEADER_SECTORS * SECTOR_SIZE, 0);
+        std::copy(MAGIC.begin(), MAGIC.end(), header.begin());
+        writeUint32(&header[MAGIC.size()], VERSION);
+
+        if (!platform->write(0, header.data(), header.size())) {
+            logging::error() << "Could not write header of region file "
+                             << path.string();
+            return false;
+        }
+    }
+
+    if (!platform->map()) {
+        logging::error() << "Could not map region file " << path.string();
+        return false;
+    }
+
+    return readHeader();
+}
+
+bool RegionFile::readHeader() {
+    const uint8_t *view = platform->view;
+
+    if (platform->viewSize < HEADER_SECTORS * SECTOR_SIZE ||
+        !std::equal(MAGIC.begin(), MAGIC.end(), view) ||
+        readUint32(view + MAGIC.size()) != VERSION) {
+        logging::error() << "Region file " << path.string()
+                         << " has an unknown format";
+        return false;
+    }
+
+    usedSectors.assign(platform->viewSize / SECTOR_SIZE, false);
+    std::fill(usedSectors.begin(), usedSectors.begin() + HEADER_SECTORS, true);
+
+    std::size_t damaged = 0;
+    for (std::size_t i = 0; i < CHUNK_COUNT; i++) {
+        uint32_t entry = readUint32(view + TABLE_OFFSET + i * sizeof(uint32_t));
+        if (entry == 0) {
+            table[i] = 0;
+            continue;
+        }
+
+        std::size_t first = entry >> COUNT_BITS;
+        std::size_t count = entry & MAX_SECTOR_COUNT;
+
+        // Records must not overlap the header, the end or each other
+        bool valid = count != 0 && first >= HEADER_SECTORS &&
+                     first + count <= usedSectors.size() &&
+                     std::none_of(usedSectors.begin() + first,
+                                  usedSectors.begin() + first + count,
+                                  [](bool used) { return used; });
+
+        if (!valid) {
+            damaged++;
+            table[i] = 0;
+            continue;
+        }
+
+        table[i] = entry;
+        setUsed(entry, true);
+    }
+
+    if (damaged != 0) {
+        logging::warn() << "Region file " << path.string() << " has "
+                        << damaged << " damaged table entries, ignoring them";
+    }
+
+    return true;
+}
+
+bool RegionFile::writeTableEntry(std::size_t index, uint32_t entry) {
+    std::array<uint8_t, sizeof(uint32_t)> bytes{};
+    writeUint32(bytes.data(), entry);
+
+    if (!platform->write(TABLE_OFFSET + index * sizeof(uint32_t),
+                         bytes.data(), bytes.size())) {
+        return false;
+    }
+
+    table[index] = entry;
+    return true;
+}
+
+std::size_t RegionFile::allocate(std::size_t sectorCount) {
+    // First fit among free sectors
+    std::size_t run = 0;
+    for (std::size_t i = HEADER_SECTORS; i < usedSectors.size(); i++) {
+        run = usedSectors[i] ? 0 : run + 1;
+        if (run == sectorCount) {
+            return i + 1 - sectorCount;
+        }
+    }
+
+    // Append, reusing free sectors at the end of the file
+    std::size_t first = usedSectors.size() - run;
+    usedSectors.resize(first + sectorCount, false);
+    return first;
+}
+
+void RegionFile::setUsed(uint32_t entry, bool used) {
+    std::size_t first = entry >> COUNT_BITS;
+    std::size_t count = entry & MAX_SECTOR_COUNT;
+    std::fill(usedSectors.begin() + first, usedSectors.begin() + first + count,
+              used);
+}
+
+bool RegionFile::contains(std::size_t index) const {
+    return table.at(index) != 0;
+}
+
+bool RegionFile::load(std::size_t index, Chunk &output) {
+    PROFILE_SCOPE("RegionFile::load");
+
+    uint32_t entry = table.at(index);
+    if (entry == 0) {
+        return false;
+    }
+
+    std::size_t begin = std::size_t(entry >> COUNT_BITS) * SECTOR_SIZE;
+    std::size_t end = begin + (entry & MAX_SECTOR_COUNT) * SECTOR_SIZE;
+
+    // Records saved since the file was mapped lie past the mapping
+    if (end > platform->viewSize && !platform->map()) {
+        logging::error() << "Could not map region file " << path.string();
+        return false;
+    }
+
+    const uint8_t *recordStart = platform->view + begin;
+    std::size_t length = readUint32(recordStart);
+    const ChunkCodec *codec = getChunkCodec(
+        static_cast<ChunkCompression>(recordStart[sizeof(uint32_t)]));
+
+    bool loaded = false;
+    if (end <= platform->viewSize &&
+        length <= end - begin - RECORD_HEADER_SIZE && codec != nullptr) {
+        loaded = codec->decode(recordStart + RECORD_HEADER_SIZE, length,
+                               output);
+    }
+
+    if (!loaded) {
+        logging::error() << "Chunk record " << index << " of region file "
+                         << path.string() << " is damaged";
+    }
+
+    return loaded;
+}
+
+bool RegionFile::prepareSave(std::size_t index, const Chunk &chunk,
+                             const ChunkEncoding &encoding,
+                             PreparedSave &output) {
+    PROFILE_SCOPE("RegionFile::prepareSave");
+
+    const ChunkCodec *codec = getChunkCodec(encoding.compression);
+    if (codec == nullptr) {
+        logging::error() << "Unknown chunk compression "
+                         << static_cast<int>(encoding.compression);
+        return false;
+    }
+
+    auto &record = output.record;
+    record.assign(RECORD_HEADER_SIZE, 0);
+    codec->encode(chunk, encoding.level, record);
+
+    std::size_t length = record.size() - RECORD_HEADER_SIZE;
+    writeUint32(record.data(), static_cast<uint32_t>(length));
+    record[sizeof(uint32_t)] = static_cast<uint8_t>(encoding.compression);
+
+    std::size_t sectorCount = (record.size() + SECTOR_SIZE - 1) / SECTOR_SIZE;
+    if (sectorCount > MAX_SECTOR_COUNT) {
+        logging::error() << "Chunk record of " << record.size()
+                         << " bytes does not fit into a region file";
+        return false;
+    }
+
+    // Whole sectors are written so that the file ends on a sector boundary
+    record.resize(sectorCount * SECTOR_SIZE, 0);
+
+    std::size_t first = allocate(sectorCount);
+    if (first >= MAX_FIRST_SECTOR) {
+        logging::error() << "Region file " << path.string() << " is full";
+        return false;
+    }
+
+    output.index = index;
+    output.entry = static_cast<uint32_t>((first << COUNT_BITS) | sectorCount);
+    output.recordOffset = uint64_t(first) * SECTOR_SIZE;
+    output.tableOffset = TABLE_OFFSET + index * sizeof(uint32_t);
+    writeUint32(output.tableEntry.data(), output.entry);
+
+    setUsed(output.entry, true);
+    return true;
+}
+
+void RegionFile::completeSave(const PreparedSave &prepared, bool written) {
+    if (!written) {
+        setUsed(prepared.entry, false);
+        return;
+    }
+
+    // The old record stayed valid until the table pointed to the new one
+    uint32_t old = table[prepared.index];
+    table[prepared.index] = prepared.entry;
+    if (old != 0) {
+        setUsed(old, false);
+    }
+
+    platform->fileSize = std::max<std::size_t>(
+        platform->fileSize, prepared.recordOffset + prepared.record.size());
+}
+
+bool RegionFile::save(std::size_t index, const Chunk &chunk,
+                      const ChunkEncoding &encoding) {
+    PROFILE_SCOPE("RegionFile::save");
+
+    if (!prepareSave(index, chunk, encoding, scratch)) {
+        return false;
+    }
+
+    bool written =
+        platform->write(scratch.recordOffset, scratch.record.data(),
+                        scratch.record.size()) &&
+        platform->write(scratch.tableOffset, scratch.tableEntry.data(),
+                        scratch.tableEntry.size());
+    if (!written) {
+        logging::error() << "Could not write chunk to region file "
+                         << path.string();
+    }
+
+    completeSave(scratch, written);
+    return written;
+}
+
+bool RegionFile::remove(std::size_t index) {
+    uint32_t old = table.at(index);
+    if (old == 0) {
+        return true;
+    }
+
+    if (!writeTableEntry(index, 0)) {
+        logging::error() << "Could not write table of region file "
+                         << path.string();
+        return false;
+    }
+
+    setUsed(old, false);
+    return true;
+}
+
+bool RegionFile::sync() {
+    if (!platform->sync()) {
+        logging::error() << "Could not sync region file " << path.string();
+        return false;
+    }
+    return true;
+}
+
+std::size_t RegionFile::getSectorCount() const { return usedSectors.size(); }
+
+std::size_t RegionFile::getUsedSectorCount() const {
+    return static_cast<std::size_t>(
+        std::count(usedSectors.begin(), usedSectors.end(), true));
+}
+
+const std::filesystem::path &RegionFile::getPath() const { return path; }
+
+NativeFile RegionFile::getNativeFile() const { return platform->file; }
+
+} // namespace progressia::main
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "../io/io_backend.h"
+#include "../util.h"
+#include "chunk.h"
+#include "chunk_codec.h"
+
+namespace progressia::main {
+
+/*
+ * A file holding a cube of REGION_SIZE^3 chunks.
+ *
+ * The file is divided into sectors of SECTOR_SIZE bytes. The first sectors
+ * hold a header with a table that maps each chunk to a contiguous range of
+ * sectors; other sectors hold chunk records:
+ *
+ *   uint32_t         payload length
+ *   ChunkCompression compression
+ *   uint8_t          payload[payload length]
+ *
+ * Saves append records to free sectors and then update the table entry, so
+ * a record is never overwritten in place and an interrupted save leaves the
+ * previous version readable. Freed sectors are reused by later saves; the
+ * file never shrinks.
+ *
+ * Loads read records through a read-only memory mapping of the file, so
+ * loading a chunk touches one contiguous range of the file.
+ *
+ * A save may also be split into prepareSave() and completeSave() so that its
+ * writes can be issued by an IoBackend together with other saves.
+ *
+ * Not thread-safe.
+ */
+class RegionFile : private NonCopyable {
+  public:
+    constexpr static int SIZE_BITS = 4;
+    constexpr static int SIZE = 1 << SIZE_BITS;
+    constexpr static std::size_t CHUNK_COUNT =
+        std::size_t(SIZE) * SIZE * SIZE;
+
+    constexpr static std::size_t SECTOR_SIZE = 512;
+
+    /*
+     * Returns the position of the region that contains the chunk.
+     */
+    static glm::ivec3 getRegion(const glm::ivec3 &chunk);
+
+    /*
+     * Returns the index of the chunk within its region.
+     */
+    static std::size_t getLocalIndex(const glm::ivec3 &chunk);
+
+    /*
+     * A save whose sectors are reserved but whose bytes are not yet written.
+     * The record must be written first and the table entry after it.
+     */
+    struct PreparedSave {
+        std::size_t index = 0;
+        uint32_t entry = 0;
+
+        uint64_t recordOffset = 0;
+        std::vector<uint8_t> record;
+
+        uint64_t tableOffset = 0;
+        std::array<uint8_t, sizeof(uint32_t)> tableEntry{};
+    };
+
+  private:
+    // Table entries are (first sector << 8) | sector count; 0 means absent
+    constexpr static unsigned COUNT_BITS = 8;
+    constexpr static uint32_t MAX_SECTOR_COUNT = (1U << COUNT_BITS) - 1;
+
+    constexpr static std::size_t RECORD_HEADER_SIZE =
+        sizeof(uint32_t) + sizeof(ChunkCompression);
+
+    struct Platform;
+    std::unique_ptr<Platform> platform;
+
+    std::filesystem::path path;
+    std::array<uint32_t, CHUNK_COUNT> table;
+    std::vector<bool> usedSectors;
+
+    // Scratch space of save()
+    PreparedSave scratch;
+
+    RegionFile(std::filesystem::path path, std::unique_ptr<Platform>);
+
+    bool initialize();
+    bool readHeader();
+    bool writeTableEntry(std::size_t index, uint32_t entry);
+    std::size_t allocate(std::size_t sectorCount);
+    void setUsed(uint32_t entry, bool used);
+
+  public:
+    /*
+     * Opens a region file, creating an empty one if create is true. Returns
+     * nullptr if the file is missing or cannot be used.
+     */
+    static std::unique_ptr<RegionFile> open(const std::filesystem::path &,
+                                            bool create);
+
+    ~RegionFile();
+
+    bool contains(std::size_t index) const;
+
+    /*
+     * Loads the chunk at index into output. Returns false if the chunk is
+     * not stored or its record is damaged, leaving output unchanged.
+     */
+    bool load(std::size_t index, Chunk &output);
+
+    /*
+     * Stores chunk at index. Returns false if the chunk could not be
+     * written, in which case the previous version is kept.
+     */
+    bool save(std::size_t index, const Chunk &chunk,
+              const ChunkEncoding & = {});
+
+    /*
+     * Serializes chunk and reserves sectors for it. Returns false if the
+     * record does not fit, in which case nothing is reserved. Each prepared
+     * save must be passed to completeSave() before the next one for the same
+     * index is prepared.
+     */
+    bool prepareSave(std::size_t index, const Chunk &chunk,
+                     const ChunkEncoding &encoding, PreparedSave &output);
+
+    /*
+     * Updates the table after the writes of a prepared save have finished.
+     * If written is false, the reserved sectors are released and the
+     * previous version is kept.
+     */
+    void completeSave(const PreparedSave &, bool written);
+
+    /*
+     * Forgets the chunk at index and frees its sectors.
+     */
+    bool remove(std::size_t index);
+
+    /*
+     * Waits until saved data reaches the storage device.
+     */
+    bool sync();
+
+    std::size_t getSectorCount() const;
+    std::size_t getUsedSectorCount() const;
+    const std::filesystem::path &getPath() const;
+
+    /*
+     * Returns the handle that prepared saves must be written to.
+     */
+    NativeFile getNativeFile() const;
+};
+
+} // namespace progressia::main
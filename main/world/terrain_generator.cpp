@@ -0,0 +1,138 @@
+#include "terrain_generator.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "noise.h"
+
+namespace progressia::main {
+
+namespace {
+
+using B = simd::Native;
+using Float = B::Float;
+
+// Rows of columns and columns of blocks are split into whole vectors
+static_assert(Chunk::SIZE % B::WIDTH == 0);
+
+// Kinds of blocks in the order of TerrainSettings
+enum Layer : std::size_t { AIR, STONE, DIRT, GRASS, LAYER_COUNT };
+
+// Decorrelates caves from the surface
+constexpr uint32_t CAVE_SEED_OFFSET = 0x9E3779B9U;
+
+// Lane offsets of consecutive coordinates: 0, 1, 2...
+const std::array<float, Chunk::SIZE> RAMP = []() {
+    std::array<float, Chunk::SIZE> result{};
+    for (std::size_t i = 0; i < result.size(); i++) {
+        result[i] = static_cast<float>(i);
+    }
+    return result;
+}();
+
+} // namespace
+
+TerrainGenerator::TerrainGenerator(const TerrainSettings &settings)
+    : settings(settings) {}
+
+void TerrainGenerator::generate(const glm::ivec3 &position,
+                                Chunk &output) const {
+    constexpr int SIZE = Chunk::SIZE;
+    const glm::ivec3 origin = position * SIZE;
+
+    // Settings may map several layers to one block, which Chunk::assign()
+    // would keep as separate palette entries
+    std::array<BlockId, LAYER_COUNT> blocks = {BLOCK_AIR, settings.stone,
+                                               settings.dirt, settings.grass};
+    std::vector<BlockId> palette;
+    std::array<uint16_t, LAYER_COUNT> entries{};
+    for (std::size_t layer = 0; layer < LAYER_COUNT; layer++) {
+        auto found = std::find(palette.begin(), palette.end(), blocks[layer]);
+        entries[layer] = static_cast<uint16_t>(found - palette.begin());
+        if (found == palette.end()) {
+            palette.push_back(blocks[layer]);
+        }
+    }
+
+    // Surface heights, a row of columns at a time
+    std::array<float, std::size_t(SIZE) * SIZE> heights; // NOLINT
+    {
+        Float scale = Float::splat(1 / settings.hillSize);
+        Float base = Float::splat(settings.baseHeight);
+        Float amplitude = Float::splat(settings.amplitude);
+        Float x0 = Float::splat(static_cast<float>(origin.x));
+
+        for (int y = 0; y < SIZE; y++) {
+            Float wy = Float::splat(static_cast<float>(origin.y + y)) * scale;
+            for (std::size_t x = 0; x < SIZE; x += B::WIDTH) {
+                Float wx = (x0 + Float::load(&RAMP[x])) * scale;
+                Float height =
+                    base + amplitude * noise::fractal2<B>(
+                                           wx, wy, settings.seed,
+                                           settings.hillOctaves);
+                height.store(&heights[y * SIZE + x]);
+            }
+        }
+    }
+
+    std::array<uint16_t, Chunk::VOLUME> indices; // NOLINT
+    std::array<float, SIZE> caves;               // NOLINT
+
+    Float caveScale = Float::splat(1 / settings.caveSize);
+    Float z0 = Float::splat(static_cast<float>(origin.z));
+    uint32_t caveSeed = settings.seed + CAVE_SEED_OFFSET;
+
+    for (int y = 0; y < SIZE; y++) {
+        for (int x = 0; x < SIZE; x++) {
+            // Local z of the topmost block before caves are carved
+            int top = static_cast<int>(std::floor(heights[y * SIZE + x])) -
+                      origin.z;
+            int solidEnd = std::clamp(top + 1, 0, SIZE);
+
+            // Cave noise along the solid part of the column
+            Float wx = Float::splat(static_cast<float>(origin.x + x));
+            Float wy = Float::splat(static_cast<float>(origin.y + y));
+            wx = wx * caveScale;
+            wy = wy * caveScale;
+            for (int z = 0; z < solidEnd; z += B::WIDTH) {
+                Float wz = (z0 + Float::load(&RAMP[z])) * caveScale;
+                noise::simplex3<B>(wx, wy, wz, caveSeed).store(&caves[z]);
+            }
+
+            for (int z = 0; z < SIZE; z++) {
+                Layer layer = AIR;
+                if (z < solidEnd && caves[z] <= settings.caveThreshold) {
+                    int depth = top - z;
+                    if (depth == 0) {
+                        layer = GRASS;
+                    } else if (depth <= settings.dirtDepth) {
+                        layer = DIRT;
+                    } else {
+                        layer = STONE;
+                    }
+                }
+                indices[Chunk::getIndex(x, y, z)] = entries[layer];
+            }
+        }
+    }
+
+    output.assign(std::move(palette), indices.data());
+    output.compact();
+}
+
+void TerrainGenerator::generate(JobSystem &jobs,
+                                const std::vector<glm::ivec3> &positions,
+                                std::vector<Chunk> &output) const {
+    output.resize(positions.size());
+
+    JobCounter counter;
+    for (std::size_t i = 0; i < positions.size(); i++) {
+        jobs.submit([this, &positions, &output,
+                     i]() { generate(positions[i], output[i]); },
+                    &counter);
+    }
+    jobs.wait(counter);
+}
+
+} // namespace progressia::main
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "../jobs/job_system.h"
+#include "chunk.h"
+
+namespace progressia::main {
+
+struct TerrainSettings {
+    uint32_t seed = 0;
+
+    BlockId stone = BLOCK_AIR;
+    BlockId dirt = BLOCK_AIR;
+    BlockId grass = BLOCK_AIR;
+
+    // Surface height in blocks is baseHeight plus up to amplitude in either
+    // direction
+    float baseHeight = 8;
+    float amplitude = 8;
+
+    // Size in blocks of the largest hills and of caves
+    float hillSize = 96;
+    int hillOctaves = 4;
+    float caveSize = 24;
+
+    // Caves are where 3D noise exceeds caveThreshold, so higher values give
+    // fewer and thinner caves
+    float caveThreshold = 0.55F;
+
+    // Thickness of dirt under grass
+    int dirtDepth = 3;
+};
+
+/*
+ * Produces chunks of hilly terrain with caves from a seed. The same seed
+ * and settings always produce the same chunks, regardless of the order
+ * they are generated in.
+ *
+ * Noise is evaluated with the widest SIMD backend available, see simd.h:
+ * surface heights for a row of columns at once and cave noise for runs of
+ * blocks along a column. Cave noise is skipped above the surface.
+ *
+ * Generation does not modify the TerrainGenerator, so any number of threads
+ * may generate at once.
+ */
+class TerrainGenerator {
+  private:
+    TerrainSettings settings;
+
+  public:
+    explicit TerrainGenerator(const TerrainSettings &);
+
+    const TerrainSettings &getSettings() const { return settings; }
+
+    /*
+     * Replaces output with the chunk at position, in chunk coordinates.
+     */
+    void generate(const glm::ivec3 &position, Chunk &output) const;
+
+    /*
+     * Generates output[i] for positions[i] with one job per chunk and waits
+     * for all of them. output is resized to match positions.
+     */
+    void generate(JobSystem &, const std::vector<glm::ivec3> &positions,
+                  std::vector<Chunk> &output) const;
+};
+
+} // namespace progressia::main
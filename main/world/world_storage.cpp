@@ -0,0 +1,107 @@
+#include "world_storage.h"
+
+#include <string>
+
+#include "../logging.h"
+
+namespace progressia::main {
+
+WorldStorage::WorldStorage(std::filesystem::path directory,
+                           std::size_t maxOpenRegions)
+    : directory(std::move(directory)), maxOpenRegions(maxOpenRegions) {}
+
+std::filesystem::path
+WorldStorage::getRegionPath(const glm::ivec3 &region) const {
+    return directory / ("r." + std::to_string(region.x) + "." +
+                        std::to_string(region.y) + "." +
+                        std::to_string(region.z) + ".region");
+}
+
+RegionFile *WorldStorage::getRegion(const glm::ivec3 &region, bool create) {
+    auto it = regions.find(region);
+    if (it != regions.end()) {
+        OpenRegion &open = it->second;
+        lru.splice(lru.begin(), lru, open.lruPosition);
+        open.used = true;
+        return open.file.get();
+    }
+
+    if (create) {
+        std::error_code errorCode;
+        std::filesystem::create_directories(directory, errorCode);
+        if (errorCode) {
+            logging::error() << "Could not create directory "
+                             << directory.string() << ": "
+                             << errorCode.message();
+            return nullptr;
+        }
+    }
+
+    auto file = RegionFile::open(getRegionPath(region), create);
+    if (!file) {
+        return nullptr;
+    }
+
+    lru.push_front(region);
+    OpenRegion &open = regions[region];
+    open.file = std::move(file);
+    open.lruPosition = lru.begin();
+    open.used = true;
+    return open.file.get();
+}
+
+bool WorldStorage::load(const glm::ivec3 &position, Chunk &output) {
+    auto *region = getRegion(RegionFile::getRegion(position), false);
+    return region != nullptr &&
+           region->load(RegionFile::getLocalIndex(position), output);
+}
+
+bool WorldStorage::save(const glm::ivec3 &position, const Chunk &chunk,
+                        const ChunkEncoding &encoding) {
+    auto *region = getRegion(RegionFile::getRegion(position), true);
+    return region != nullptr &&
+           region->save(RegionFile::getLocalIndex(position), chunk,
+                        encoding);
+}
+
+bool WorldStorage::remove(const glm::ivec3 &position) {
+    auto *region = getRegion(RegionFile::getRegion(position), false);
+    return region == nullptr ||
+           region->remove(RegionFile::getLocalIndex(position));
+}
+
+bool WorldStorage::sync() {
+    bool success = true;
+    for (auto &entry : regions) {
+        success = entry.second.file->sync() && success;
+    }
+    return success;
+}
+
+void WorldStorage::trim() {
+    while (regions.size() > maxOpenRegions) {
+        regions.erase(lru.back());
+        lru.pop_back();
+    }
+}
+
+void WorldStorage::closeIdle() {
+    for (auto it = regions.begin(); it != regions.end();) {
+        if (it->second.used) {
+            it->second.used = false;
+            ++it;
+        } else {
+            lru.erase(it->second.lruPosition);
+            it = regions.erase(it);
+        }
+    }
+}
+
+void WorldStorage::close() {
+    regions.clear();
+    lru.clear();
+}
+
+std::size_t WorldStorage::getOpenRegionCount() const { return regions.size(); }
+
+} // namespace progressia::main
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+#include <glm/vec3.hpp>
+
+#include "../util.h"
+#include "chunk.h"
+#include "region_file.h"
+
+namespace progressia::main {
+
+/*
+ * Saves and loads chunks in a directory of region files, one file per
+ * region. Region files are opened on first use and kept open until trim()
+ * or closeIdle() closes them, so that a moving viewer does not exhaust file
+ * descriptors.
+ *
+ * Not thread-safe.
+ */
+class WorldStorage : private NonCopyable {
+  public:
+    constexpr static std::size_t DEFAULT_MAX_OPEN_REGIONS = 64;
+
+  private:
+    struct OpenRegion {
+        std::unique_ptr<RegionFile> file;
+
+        // Front is the most recently used
+        std::list<glm::ivec3>::iterator lruPosition;
+
+        // Used since the last closeIdle()
+        bool used;
+    };
+
+    std::filesystem::path directory;
+    std::size_t maxOpenRegions;
+    std::unordered_map<glm::ivec3, OpenRegion, ChunkPositionHash> regions;
+    std::list<glm::ivec3> lru;
+
+  public:
+    explicit WorldStorage(
+        std::filesystem::path directory,
+        std::size_t maxOpenRegions = DEFAULT_MAX_OPEN_REGIONS);
+
+    std::filesystem::path getRegionPath(const glm::ivec3 &region) const;
+
+    /*
+     * Returns nullptr if the region file does not exist and create is false,
+     * or if it cannot be opened. The pointer stays valid until trim(),
+     * closeIdle() or close().
+     */
+    RegionFile *getRegion(const glm::ivec3 &region, bool create);
+
+    /*
+     * Loads the chunk at position into output. Returns false if it was
+     * never saved or cannot be read, leaving output unchanged.
+     */
+    bool load(const glm::ivec3 &position, Chunk &output);
+
+    bool save(const glm::ivec3 &position, const Chunk &,
+              const ChunkEncoding & = {});
+
+    bool remove(const glm::ivec3 &position);
+
+    /*
+     * Waits until all saved data reaches the storage device.
+     */
+    bool sync();
+
+    /*
+     * Closes the least recently used region files beyond the limit given to
+     * the constructor.
+     */
+    void trim();
+
+    /*
+     * Closes region files that were not used since the last call.
+     */
+    void closeIdle();
+
+    /*
+     * Closes all region files. They are reopened when needed.
+     */
+    void close();
+
+    std::size_t getOpenRegionCount() const;
+};
+
+} // namespace progressia::main
@@ -0,0 +1,289 @@
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+
+#include "../main/io/io_backend.h"
+#include "../main/jobs/job_system.h"
+#include "../main/logging.h"
+#include "../main/meta.h"
+#include "../main/profiler.h"
+#include "../main/simulation_clock.h"
+#include "../main/world/block_types.h"
+#include "../main/world/chunk_io.h"
+#include "../main/world/chunk_manager.h"
+#include "../main/world/default_world.h"
+
+using namespace progressia::main::logging;
+
+namespace {
+
+struct ServerOptions {
+    // FIXME this is relative to bin, not root dir
+    std::string world = "run/world";
+
+    // Zero runs until interrupted
+    uint64_t ticks = 0;
+
+    double tickRate = 20;
+    float viewRadius = 6;
+
+    // Load testing: the viewer walks east at walkSpeed blocks per second,
+    // and editsPerTick random blocks around it change each tick
+    float walkSpeed = 0;
+    uint64_t editsPerTick = 0;
+
+    // Ticks run back to back instead of in real time
+    bool fast = false;
+
+    // Seconds between status lines
+    double statusInterval = 10;
+};
+
+volatile std::sig_atomic_t stopRequested = 0; // NOLINT
+
+void onSignal(int /*signal*/) { stopRequested = 1; }
+
+void printUsage(const char *me) {
+    std::cout << "Usage: " << me << " [OPTIONS...]\n"
+              << "Runs the world simulation without graphics.\n\n"
+              << "Options:\n"
+              << "  --world=PATH         world directory, default is "
+                 "run/world\n"
+              << "  --ticks=N            stop after N ticks, default is to "
+                 "run until\n"
+              << "                       interrupted\n"
+              << "  --tick-rate=HZ       default is 20\n"
+              << "  --view-radius=CHUNKS default is 6\n"
+              << "  --walk=BLOCKS        viewer speed per second\n"
+              << "  --edits=N            random block changes per tick\n"
+              << "  --fast               run ticks back to back\n"
+              << "  --status=SECONDS     time between status lines\n"
+              << "  --version, -v" << std::endl;
+}
+
+void logStatus(const progressia::main::SimulationClock &clock,
+               const progressia::main::ChunkManager &world,
+               const progressia::main::ChunkIO &io) {
+    constexpr double MIB = 1 << 20;
+
+    const auto &ticks = clock.getStats();
+    auto chunks = world.getStats();
+    auto storage = io.getStats();
+
+    info() << "Tick " << ticks.ticks << ": " << ticks.averageTickTime
+           << " us per tick on average, " << ticks.maxTickTime
+           << " us at most, " << ticks.droppedTicks << " dropped; "
+           << chunks.loaded << " chunks loaded, "
+           << static_cast<double>(chunks.memoryUsage) / MIB << " MiB; "
+           << storage.chunksWritten << " chunks written, "
+           << storage.chunksRead << " read";
+}
+
+int runServer(const ServerOptions &options) {
+    using namespace progressia::main;
+    using Clock = std::chrono::steady_clock;
+
+    BlockTypes types;
+    TerrainSettings terrain = makeDefaultWorld(types);
+
+    ChunkManagerSettings streaming;
+    streaming.loadRadius = options.viewRadius;
+    streaming.unloadRadius = options.viewRadius + 2;
+    streaming.meshing = false;
+
+    JobSystem &jobs = getJobSystem();
+    ChunkIO io(options.world, IoBackend::create(), jobs);
+    auto world = std::make_unique<ChunkManager>(
+        types, jobs, TerrainGenerator(terrain), &io, streaming);
+
+    glm::vec3 viewer(0, 0, terrain.baseHeight + 2);
+    world->setViewerPosition(viewer);
+
+    // Edits stay near the surface, where light changes the most
+    std::mt19937 random(0);
+    auto reach = static_cast<int>(options.viewRadius * Chunk::SIZE);
+    std::uniform_int_distribution<int> horizontal(-reach, reach);
+    std::uniform_int_distribution<int> vertical(
+        static_cast<int>(terrain.baseHeight - terrain.amplitude),
+        static_cast<int>(terrain.baseHeight + terrain.amplitude));
+
+    SimulationSettings simulation;
+    simulation.tickRate = options.tickRate;
+    SimulationClock clock(simulation);
+
+    // Edits of loaded chunks, which must all be saved by shutdown
+    uint64_t editsAccepted = 0;
+
+    auto tick = [&]() {
+        viewer.x += options.walkSpeed *
+                    static_cast<float>(clock.getTickLength());
+        world->setViewerPosition(viewer);
+
+        for (uint64_t i = 0; i < options.editsPerTick; i++) {
+            glm::ivec3 block(static_cast<int>(viewer.x) + horizontal(random),
+                             static_cast<int>(viewer.y) + horizontal(random),
+                             vertical(random));
+            if (world->setBlock(block,
+                                i % 2 == 0 ? terrain.stone : BLOCK_AIR)) {
+                editsAccepted++;
+            }
+        }
+
+        world->update();
+    };
+
+    info() << "Server started in " << options.world << " at "
+           << options.tickRate << " ticks per second";
+
+    auto start = Clock::now();
+    auto lastAdvance = start;
+    auto lastStatus = start;
+
+    while (stopRequested == 0 &&
+           (options.ticks == 0 || clock.getStats().ticks < options.ticks)) {
+        jobs.runMainThreadJobs();
+
+        auto now = Clock::now();
+        double elapsed =
+            options.fast
+                ? clock.getTickLength()
+                : std::chrono::duration<double>(now - lastAdvance).count();
+        clock.advance(elapsed, tick);
+        lastAdvance = now;
+
+        if (std::chrono::duration<double>(now - lastStatus).count() >=
+            options.statusInterval) {
+            logStatus(clock, *world, io);
+            lastStatus = now;
+        }
+
+        profiler::onFrameEnd();
+
+        // Sleep until the next tick is due
+        if (!options.fast) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(
+                (1 - clock.getAlpha()) * clock.getTickLength()));
+        }
+    }
+
+    double seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    info() << "Stopping after " << clock.getStats().ticks << " ticks in "
+           << seconds << " s";
+    logStatus(clock, *world, io);
+
+    // Edited chunks are saved when the manager is destroyed
+    world.reset();
+    io.flush();
+
+    auto storage = io.getStats();
+    info() << storage.chunksWritten << " chunks written in total, "
+           << storage.writesFailed << " failed";
+
+    if (editsAccepted > 0 && storage.chunksWritten == 0) {
+        error() << editsAccepted << " block edits were made but no chunks "
+                << "were saved";
+        return 1;
+    }
+
+    return storage.writesFailed == 0 ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    using namespace progressia;
+
+    ServerOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        char *arg = argv[i];
+        if (strcmp(arg, "--version") == 0 || strcmp(arg, "-v") == 0) {
+            std::cout << main::meta::NAME << " server " << main::meta::VERSION
+                      << "+" << main::meta::BUILD_ID << " (version number "
+                      << main::meta::VERSION_NUMBER << ")" << std::endl;
+            return 0;
+        }
+
+        if (strcmp(arg, "--help") == 0) {
+            printUsage(argv[0]);
+            return 0;
+        }
+
+        if (strncmp(arg, "--world=", strlen("--world=")) == 0) {
+            options.world = arg + strlen("--world=");
+            continue;
+        }
+
+        if (strncmp(arg, "--ticks=", strlen("--ticks=")) == 0) {
+            options.ticks =
+                std::strtoull(arg + strlen("--ticks="), nullptr, 10);
+            continue;
+        }
+
+        if (strncmp(arg, "--tick-rate=", strlen("--tick-rate=")) == 0) {
+            options.tickRate =
+                std::strtod(arg + strlen("--tick-rate="), nullptr);
+            if (options.tickRate <= 0) {
+                std::cerr << "Tick rate must be positive" << std::endl;
+                return 1;
+            }
+            continue;
+        }
+
+        if (strncmp(arg, "--view-radius=", strlen("--view-radius=")) == 0) {
+            options.viewRadius =
+                std::strtof(arg + strlen("--view-radius="), nullptr);
+            continue;
+        }
+
+        if (strncmp(arg, "--walk=", strlen("--walk=")) == 0) {
+            options.walkSpeed = std::strtof(arg + strlen("--walk="), nullptr);
+            continue;
+        }
+
+        if (strncmp(arg, "--edits=", strlen("--edits=")) == 0) {
+            options.editsPerTick =
+                std::strtoull(arg + strlen("--edits="), nullptr, 10);
+            continue;
+        }
+
+        if (strcmp(arg, "--fast") == 0) {
+            options.fast = true;
+            continue;
+        }
+
+        if (strncmp(arg, "--status=", strlen("--status=")) == 0) {
+            options.statusInterval =
+                std::strtod(arg + strlen("--status="), nullptr);
+            continue;
+        }
+
+        std::cerr << "Unknown option \"" << arg << "\"; see --help"
+                  << std::endl;
+        return 1;
+    }
+
+    info() << "Starting " << main::meta::NAME << " server "
+           << main::meta::VERSION << "+" << main::meta::BUILD_ID
+           << " (version number " << main::meta::VERSION_NUMBER << ")";
+    debug("Debug is enabled");
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    main::profiler::setThreadName("Main");
+    main::initializeJobSystem();
+
+    int exitCode = runServer(options);
+
+    info("Shutting down");
+    main::shutdownJobSystem();
+    return exitCode;
+}
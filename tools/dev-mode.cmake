@@ -7,7 +7,7 @@ if (DEV_MODE)
         "--warnings-as-errors=*"
         "--use-color")
 
-    set_target_properties(progressia
+    set_target_properties(${all_targets}
         PROPERTIES CXX_CLANG_TIDY "${clang_tidy_command}")
 
     # Display the marker for pre-commit.py at build time
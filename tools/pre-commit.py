@@ -32,7 +32,7 @@ Use semicolons to separate arguments in git, cmake and clang-format-diff'''
 version = 1
 
 # Source directories to format
-src_dirs = ['desktop', 'main']
+src_dirs = ['bench', 'desktop', 'main', 'server']
 
 # File extensions to format
 exts = ['cpp', 'h', 'inl']